@@ -27,9 +27,14 @@
 
 #include "collision/broad_phase.h"
 #include "collision/dynamic_tree.h"
+#include "collision/hashed_grid.h"
+#include "collision/quantized_tree.h"
+#include "collision/shapes/capsule_shape.h"
 #include "collision/shapes/chain_shape.h"
 #include "collision/shapes/circle_shape.h"
+#include "collision/shapes/compound_shape.h"
 #include "collision/shapes/edge_shape.h"
+#include "collision/shapes/grid_shape.h"
 #include "collision/shapes/polygon_shape.h"
 #include "common/draw.h"
 #include "common/settings.h"
@@ -50,6 +55,7 @@
 #include "dynamics/joint/wheel_joint.h"
 #include "dynamics/world.h"
 #include "dynamics/world_callbacks.h"
+#include "dynamics/world_snapshot.h"
 #include "particle/particle.h"
 #include "particle/particle_assembly.h"
 #include "particle/particle_group.h"
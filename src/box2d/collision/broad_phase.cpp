@@ -25,6 +25,7 @@
 
 b2BroadPhase::b2BroadPhase()
 {
+	m_type = b2_dynamicTreeBroadPhase;
 	m_proxyCount = 0;
 
 	m_pairCapacity = 16;
@@ -34,17 +35,124 @@ b2BroadPhase::b2BroadPhase()
 	m_moveCapacity = 16;
 	m_moveCount = 0;
 	m_moveBuffer = (int32*)b2Alloc(m_moveCapacity * sizeof(int32));
+
+	m_moveNodeCapacity = 0;
+	m_moveNodes = nullptr;
+
+	m_compressStatic = false;
+	m_queryTag = 0;
+
+	for (int32 i = 0; i < b2_maxCollisionLayers; ++i)
+	{
+		m_layerMasks[i] = (1u << b2_maxCollisionLayers) - 1;
+	}
 }
 
 b2BroadPhase::~b2BroadPhase()
 {
 	b2Free(m_moveBuffer);
+	b2Free(m_moveNodes);
 	b2Free(m_pairBuffer);
 }
 
-int32 b2BroadPhase::CreateProxy(const b2AABB& aabb, void* userData)
+void b2BroadPhase::SetType(b2BroadPhaseType type)
 {
-	int32 proxyId = m_tree.CreateProxy(aabb, userData);
+	b2Assert(m_proxyCount == 0);
+	m_type = type;
+}
+
+void b2BroadPhase::SetGridCellSize(float size)
+{
+	for (int32 i = 0; i < b2_maxCollisionLayers; ++i)
+	{
+		m_layers[i].grid.SetCellSize(size);
+	}
+}
+
+void b2BroadPhase::SetLayerCollision(int32 layerA, int32 layerB, bool flag)
+{
+	b2Assert(0 <= layerA && layerA < b2_maxCollisionLayers);
+	b2Assert(0 <= layerB && layerB < b2_maxCollisionLayers);
+
+	if (flag)
+	{
+		m_layerMasks[layerA] |= 1u << layerB;
+		m_layerMasks[layerB] |= 1u << layerA;
+	}
+	else
+	{
+		m_layerMasks[layerA] &= ~(1u << layerB);
+		m_layerMasks[layerB] &= ~(1u << layerA);
+	}
+}
+
+int32 b2BroadPhase::GetTreeHeight() const
+{
+	int32 height = 0;
+	for (int32 i = 0; i < b2_maxCollisionLayers; ++i)
+	{
+		height = b2Max(height, m_layers[i].tree.GetHeight());
+	}
+	return height;
+}
+
+int32 b2BroadPhase::GetTreeBalance() const
+{
+	int32 balance = 0;
+	for (int32 i = 0; i < b2_maxCollisionLayers; ++i)
+	{
+		balance = b2Max(balance, m_layers[i].tree.GetMaxBalance());
+	}
+	return balance;
+}
+
+float b2BroadPhase::GetTreeQuality() const
+{
+	float quality = 0.0f;
+	for (int32 i = 0; i < b2_maxCollisionLayers; ++i)
+	{
+		quality = b2Max(quality, m_layers[i].tree.GetAreaRatio());
+	}
+	return quality;
+}
+
+void b2BroadPhase::CompactTree()
+{
+	for (int32 i = 0; i < b2_maxCollisionLayers; ++i)
+	{
+		m_layers[i].tree.Compact();
+	}
+}
+
+void b2BroadPhase::ShiftOrigin(const b2Vec2& newOrigin)
+{
+	for (int32 i = 0; i < b2_maxCollisionLayers; ++i)
+	{
+		m_layers[i].tree.ShiftOrigin(newOrigin);
+		m_layers[i].grid.ShiftOrigin(newOrigin);
+		m_layers[i].staticTree.ShiftOrigin(newOrigin);
+	}
+}
+
+int32 b2BroadPhase::CreateProxy(const b2AABB& aabb, void* userData, bool isStatic, int32 layerIndex)
+{
+	b2Assert(0 <= layerIndex && layerIndex < b2_maxCollisionLayers);
+	b2BroadPhaseLayer& layer = m_layers[layerIndex];
+
+	int32 proxyId;
+	if (isStatic && m_compressStatic)
+	{
+		proxyId = (layer.staticTree.CreateProxy(aabb, userData) << b2_proxyIdShift) | (layerIndex << 1) | 1;
+	}
+	else if (m_type == b2_hashedGridBroadPhase)
+	{
+		proxyId = (layer.grid.CreateProxy(aabb, userData) << b2_proxyIdShift) | (layerIndex << 1);
+	}
+	else
+	{
+		proxyId = (layer.tree.CreateProxy(aabb, userData) << b2_proxyIdShift) | (layerIndex << 1);
+	}
+
 	++m_proxyCount;
 	BufferMove(proxyId);
 	return proxyId;
@@ -54,12 +162,39 @@ void b2BroadPhase::DestroyProxy(int32 proxyId)
 {
 	UnBufferMove(proxyId);
 	--m_proxyCount;
-	m_tree.DestroyProxy(proxyId);
+
+	b2BroadPhaseLayer& layer = m_layers[GetLayer(proxyId)];
+	if (IsStaticProxy(proxyId))
+	{
+		layer.staticTree.DestroyProxy(GetTreeProxyId(proxyId));
+	}
+	else if (m_type == b2_hashedGridBroadPhase)
+	{
+		layer.grid.DestroyProxy(GetTreeProxyId(proxyId));
+	}
+	else
+	{
+		layer.tree.DestroyProxy(GetTreeProxyId(proxyId));
+	}
 }
 
 void b2BroadPhase::MoveProxy(int32 proxyId, const b2AABB& aabb, const b2Vec2& displacement)
 {
-	bool buffer = m_tree.MoveProxy(proxyId, aabb, displacement);
+	b2BroadPhaseLayer& layer = m_layers[GetLayer(proxyId)];
+	bool buffer;
+	if (IsStaticProxy(proxyId))
+	{
+		buffer = layer.staticTree.MoveProxy(GetTreeProxyId(proxyId), aabb, displacement);
+	}
+	else if (m_type == b2_hashedGridBroadPhase)
+	{
+		buffer = layer.grid.MoveProxy(GetTreeProxyId(proxyId), aabb, displacement);
+	}
+	else
+	{
+		buffer = layer.tree.MoveProxy(GetTreeProxyId(proxyId), aabb, displacement);
+	}
+
 	if (buffer)
 	{
 		BufferMove(proxyId);
@@ -97,16 +232,18 @@ void b2BroadPhase::UnBufferMove(int32 proxyId)
 	}
 }
 
-// This is called from b2DynamicTree::Query when we are gathering pairs.
-bool b2BroadPhase::QueryCallback(int32 proxyId)
+// This is called from the Query of the trees and the grid when we are gathering pairs.
+bool b2BroadPhase::QueryCallback(int32 treeProxyId)
 {
+	int32 proxyId = (treeProxyId << b2_proxyIdShift) | m_queryTag;
+
 	// A proxy cannot form a pair with itself.
 	if (proxyId == m_queryProxyId)
 	{
 		return true;
 	}
 
-	const bool moved = m_tree.WasMoved(proxyId);
+	const bool moved = WasMoved(proxyId);
 	if (moved && proxyId > m_queryProxyId)
 	{
 		// Both proxies are moving. Avoid duplicate pairs.
@@ -129,3 +266,182 @@ bool b2BroadPhase::QueryCallback(int32 proxyId)
 
 	return true;
 }
+
+// This is called from b2DynamicTree::QueryTree and b2QuantizedTree::QueryTree with
+// a moved proxy and a tree proxy whose fat AABBs overlap.
+bool b2BroadPhase::PairCallback(int32 queryProxyId, int32 treeProxyId)
+{
+	// Compressed static proxies don't pair with each other.
+	if (IsStaticProxy(m_queryTag) && IsStaticProxy(queryProxyId))
+	{
+		return true;
+	}
+
+	// The move tree holds proxies of all layers.
+	if ((m_layerMasks[GetLayer(queryProxyId)] & (1u << GetLayer(m_queryTag))) == 0)
+	{
+		return true;
+	}
+
+	m_queryProxyId = queryProxyId;
+	return QueryCallback(treeProxyId);
+}
+
+void b2BroadPhase::QueryMoveTree()
+{
+	// The leaves go at the end of the node array, one per moved proxy.
+	int32 nodeCapacity = 2 * m_moveCount - 1;
+	if (nodeCapacity > m_moveNodeCapacity)
+	{
+		b2Free(m_moveNodes);
+		m_moveNodeCapacity = nodeCapacity;
+		m_moveNodes = (b2TreeNode*)b2Alloc(m_moveNodeCapacity * sizeof(b2TreeNode));
+	}
+
+	// Layers that interact with at least one moved proxy.
+	uint32 layerMask = 0;
+
+	int32 leafCount = 0;
+	b2TreeNode* leaves = m_moveNodes + m_moveCount - 1;
+	for (int32 i = 0; i < m_moveCount; ++i)
+	{
+		int32 proxyId = m_moveBuffer[i];
+		if (proxyId == e_nullProxy)
+		{
+			continue;
+		}
+
+		b2TreeNode* leaf = leaves + leafCount;
+		leaf->aabb = GetFatAABB(proxyId);
+		leaf->parent = b2_nullNode;
+		leaf->child1 = b2_nullNode;
+		leaf->child2 = b2_nullNode;
+		leaf->proxyId = proxyId;
+		++leafCount;
+
+		layerMask |= m_layerMasks[GetLayer(proxyId)];
+	}
+
+	if (leafCount == 0)
+	{
+		return;
+	}
+
+	struct BuildTask
+	{
+		int32 begin;
+		int32 end;
+		int32 node;
+	};
+
+	// Top down build over ranges of leaves. Single leaf ranges are used as is.
+	int32 leafBase = m_moveCount - 1;
+	int32 nodeCount = 0;
+	int32 root = leafBase;
+	b2GrowableStack<BuildTask, 64> stack;
+	if (leafCount > 1)
+	{
+		BuildTask task;
+		task.begin = leafBase;
+		task.end = leafBase + leafCount;
+		task.node = nodeCount++;
+		stack.Push(task);
+		root = task.node;
+	}
+
+	while (stack.GetCount() > 0)
+	{
+		BuildTask task = stack.Pop();
+
+		b2AABB aabb = m_moveNodes[task.begin].aabb;
+		b2AABB centers;
+		centers.lowerBound = aabb.GetCenter();
+		centers.upperBound = centers.lowerBound;
+		for (int32 i = task.begin + 1; i < task.end; ++i)
+		{
+			const b2AABB& leafAABB = m_moveNodes[i].aabb;
+			aabb.Combine(leafAABB);
+			b2Vec2 c = leafAABB.GetCenter();
+			centers.lowerBound = b2Min(centers.lowerBound, c);
+			centers.upperBound = b2Max(centers.upperBound, c);
+		}
+
+		// Split at the middle of the longest axis of the leaf centers.
+		b2Vec2 extents = centers.upperBound - centers.lowerBound;
+		int32 axis = extents.x > extents.y ? 0 : 1;
+		float split = 0.5f * (centers.lowerBound(axis) + centers.upperBound(axis));
+
+		int32 i1 = task.begin;
+		int32 i2 = task.end;
+		while (i1 < i2)
+		{
+			if (m_moveNodes[i1].aabb.GetCenter()(axis) < split)
+			{
+				++i1;
+			}
+			else
+			{
+				--i2;
+				b2Swap(m_moveNodes[i1], m_moveNodes[i2]);
+			}
+		}
+
+		if (i1 == task.begin || i1 == task.end)
+		{
+			// All centers are on one side, split by count.
+			i1 = (task.begin + task.end) >> 1;
+		}
+
+		b2TreeNode* node = m_moveNodes + task.node;
+		node->aabb = aabb;
+		node->parent = b2_nullNode;
+		node->proxyId = b2_nullNode;
+
+		int32 bounds[3] = { task.begin, i1, task.end };
+		for (int32 i = 0; i < 2; ++i)
+		{
+			BuildTask child;
+			child.begin = bounds[i];
+			child.end = bounds[i + 1];
+			if (child.end - child.begin == 1)
+			{
+				child.node = child.begin;
+			}
+			else
+			{
+				child.node = nodeCount++;
+				stack.Push(child);
+			}
+
+			if (i == 0)
+			{
+				node->child1 = child.node;
+			}
+			else
+			{
+				node->child2 = child.node;
+			}
+		}
+	}
+
+	b2Assert(nodeCount <= leafBase);
+
+	// Create pairs and add them to the pair buffer.
+	for (int32 i = 0; i < b2_maxCollisionLayers; ++i)
+	{
+		if ((layerMask & (1u << i)) == 0)
+		{
+			continue;
+		}
+
+		const b2BroadPhaseLayer& layer = m_layers[i];
+		m_queryTag = i << 1;
+		layer.tree.QueryTree(this, m_moveNodes, root);
+
+		if (layer.staticTree.GetProxyCount() > 0)
+		{
+			m_queryTag = (i << 1) | 1;
+			layer.staticTree.QueryTree(this, m_moveNodes, root);
+		}
+	}
+}
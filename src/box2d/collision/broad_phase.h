@@ -27,6 +27,19 @@
 #include "box2d/common/settings.h"
 #include "collision.h"
 #include "dynamic_tree.h"
+#include "hashed_grid.h"
+#include "quantized_tree.h"
+
+/// The structure that holds the proxies of the broad-phase.
+enum b2BroadPhaseType
+{
+	b2_dynamicTreeBroadPhase,
+	b2_hashedGridBroadPhase
+};
+
+/// Broad-phase proxy ids keep the static flag in the lowest bit and the collision
+/// layer in the next bits. The id within the layer structure starts at this bit.
+#define b2_proxyIdShift 4
 
 struct B2_API b2Pair
 {
@@ -34,9 +47,48 @@ struct B2_API b2Pair
 	int32 proxyIdB;
 };
 
+/// The proxies of one collision layer. Used internally by b2BroadPhase.
+struct B2_API b2BroadPhaseLayer
+{
+	b2DynamicTree tree;
+	b2HashedGrid grid;
+	b2QuantizedTree staticTree;
+};
+
+/// Forwards tree callbacks to a broad-phase client, converting tree proxy ids
+/// into broad-phase proxy ids. Used internally by b2BroadPhase.
+template <typename T>
+struct b2BroadPhaseCallback
+{
+	bool QueryCallback(int32 proxyId)
+	{
+		proceed = callback->QueryCallback((proxyId << b2_proxyIdShift) | tag);
+		return proceed;
+	}
+
+	float RayCastCallback(const b2RayCastInput& input, int32 proxyId)
+	{
+		float value = callback->RayCastCallback(input, (proxyId << b2_proxyIdShift) | tag);
+		if (value >= 0.0f)
+		{
+			maxFraction = value;
+		}
+		return value;
+	}
+
+	T* callback;
+	int32 tag;
+	bool proceed;
+	float maxFraction;
+};
+
 /// The broad-phase is used for computing pairs and performing volume queries and ray casts.
 /// This broad-phase does not persist pairs. Instead, this reports potentially new pairs.
 /// It is up to the client to consume the new pairs and to track subsequent overlap.
+/// Proxies are kept in a dynamic tree or in a hashed grid, see b2BroadPhaseType.
+/// Static proxies may optionally be kept in a compressed tree (see b2QuantizedTree).
+/// Each collision layer has its own structures and a layer matrix tells which
+/// layers form pairs, so layers that never collide are never traversed.
 class B2_API b2BroadPhase
 {
 public:
@@ -49,9 +101,21 @@ public:
 	b2BroadPhase();
 	~b2BroadPhase();
 
+	/// Choose the structure that holds the proxies. The broad-phase must be empty.
+	void SetType(b2BroadPhaseType type);
+
+	/// Get the structure that holds the proxies.
+	b2BroadPhaseType GetType() const;
+
+	/// Set the cell size of the finest hashed grid level. Pick about the size of
+	/// the common objects. The broad-phase must be empty.
+	void SetGridCellSize(float size);
+
 	/// Create a proxy with an initial AABB. Pairs are not reported until
-	/// UpdatePairs is called.
-	int32 CreateProxy(const b2AABB& aabb, void* userData);
+	/// UpdatePairs is called. Static proxies go to the compressed tree when it
+	/// is enabled, and then never form pairs with each other.
+	/// @param layer the collision layer, less than b2_maxCollisionLayers.
+	int32 CreateProxy(const b2AABB& aabb, void* userData, bool isStatic = false, int32 layer = 0);
 
 	/// Destroy a proxy. It is up to the client to remove any pairs.
 	void DestroyProxy(int32 proxyId);
@@ -94,15 +158,32 @@ public:
 	template <typename T>
 	void RayCast(T* callback, const b2RayCastInput& input) const;
 
-	/// Get the height of the embedded tree.
+	/// Get the height of the tallest embedded tree.
 	int32 GetTreeHeight() const;
 
-	/// Get the balance of the embedded tree.
+	/// Get the largest balance of the embedded trees.
 	int32 GetTreeBalance() const;
 
-	/// Get the quality metric of the embedded tree.
+	/// Get the worst quality metric of the embedded trees.
 	float GetTreeQuality() const;
 
+	/// Reorder the embedded trees for cache friendly traversal.
+	void CompactTree();
+
+	/// Enable or disable pairs between the proxies of two collision layers. This does
+	/// not remove existing pairs. All layers collide by default.
+	void SetLayerCollision(int32 layerA, int32 layerB, bool flag);
+
+	/// Do the proxies of these collision layers form pairs?
+	bool GetLayerCollision(int32 layerA, int32 layerB) const;
+
+	/// Keep static proxies created from now on in a compressed tree. This roughly
+	/// halves their memory footprint at the cost of decoding bounds during queries.
+	void SetStaticTreeCompression(bool flag);
+
+	/// Are static proxies kept in the compressed tree?
+	bool GetStaticTreeCompression() const;
+
 	/// Shift the world origin. Useful for large worlds.
 	/// The shift formula is: position -= newOrigin
 	/// @param newOrigin the new origin with respect to the old origin
@@ -111,13 +192,34 @@ public:
 private:
 
 	friend class b2DynamicTree;
+	friend class b2HashedGrid;
+	friend class b2QuantizedTree;
+
+	static bool IsStaticProxy(int32 proxyId);
+	static int32 GetLayer(int32 proxyId);
+	static int32 GetTreeProxyId(int32 proxyId);
+
+	bool WasMoved(int32 proxyId) const;
+	void ClearMoved(int32 proxyId);
 
 	void BufferMove(int32 proxyId);
 	void UnBufferMove(int32 proxyId);
 
-	bool QueryCallback(int32 proxyId);
+	bool QueryCallback(int32 treeProxyId);
+	bool PairCallback(int32 queryProxyId, int32 treeProxyId);
+
+	// Build a tree over the moved proxies and descend it against the layer trees.
+	void QueryMoveTree();
+
+	// Below this many moved proxies, individual queries are cheaper than building the move tree.
+	enum { e_moveTreeThreshold = 16 };
 
-	b2DynamicTree m_tree;
+	b2BroadPhaseType m_type;
+	b2BroadPhaseLayer m_layers[b2_maxCollisionLayers];
+	bool m_compressStatic;
+
+	// Bit j of entry i is set if layer i pairs with layer j.
+	uint32 m_layerMasks[b2_maxCollisionLayers];
 
 	int32 m_proxyCount;
 
@@ -125,28 +227,104 @@ private:
 	int32 m_moveCapacity;
 	int32 m_moveCount;
 
+	b2TreeNode* m_moveNodes;
+	int32 m_moveNodeCapacity;
+
 	b2Pair* m_pairBuffer;
 	int32 m_pairCapacity;
 	int32 m_pairCount;
 
 	int32 m_queryProxyId;
+
+	// Layer and static bits of the structure being queried.
+	int32 m_queryTag;
 };
 
+inline bool b2BroadPhase::IsStaticProxy(int32 proxyId)
+{
+	return (proxyId & 1) != 0;
+}
+
+inline int32 b2BroadPhase::GetLayer(int32 proxyId)
+{
+	return (proxyId >> 1) & (b2_maxCollisionLayers - 1);
+}
+
+inline int32 b2BroadPhase::GetTreeProxyId(int32 proxyId)
+{
+	return proxyId >> b2_proxyIdShift;
+}
+
 inline void* b2BroadPhase::GetUserData(int32 proxyId) const
 {
-	return m_tree.GetUserData(proxyId);
+	const b2BroadPhaseLayer& layer = m_layers[GetLayer(proxyId)];
+	if (IsStaticProxy(proxyId))
+	{
+		return layer.staticTree.GetUserData(GetTreeProxyId(proxyId));
+	}
+
+	if (m_type == b2_hashedGridBroadPhase)
+	{
+		return layer.grid.GetUserData(GetTreeProxyId(proxyId));
+	}
+
+	return layer.tree.GetUserData(GetTreeProxyId(proxyId));
 }
 
 inline bool b2BroadPhase::TestOverlap(int32 proxyIdA, int32 proxyIdB) const
 {
-	const b2AABB& aabbA = m_tree.GetFatAABB(proxyIdA);
-	const b2AABB& aabbB = m_tree.GetFatAABB(proxyIdB);
+	const b2AABB& aabbA = GetFatAABB(proxyIdA);
+	const b2AABB& aabbB = GetFatAABB(proxyIdB);
 	return b2TestOverlap(aabbA, aabbB);
 }
 
 inline const b2AABB& b2BroadPhase::GetFatAABB(int32 proxyId) const
 {
-	return m_tree.GetFatAABB(proxyId);
+	const b2BroadPhaseLayer& layer = m_layers[GetLayer(proxyId)];
+	if (IsStaticProxy(proxyId))
+	{
+		return layer.staticTree.GetFatAABB(GetTreeProxyId(proxyId));
+	}
+
+	if (m_type == b2_hashedGridBroadPhase)
+	{
+		return layer.grid.GetFatAABB(GetTreeProxyId(proxyId));
+	}
+
+	return layer.tree.GetFatAABB(GetTreeProxyId(proxyId));
+}
+
+inline bool b2BroadPhase::WasMoved(int32 proxyId) const
+{
+	const b2BroadPhaseLayer& layer = m_layers[GetLayer(proxyId)];
+	if (IsStaticProxy(proxyId))
+	{
+		return layer.staticTree.WasMoved(GetTreeProxyId(proxyId));
+	}
+
+	if (m_type == b2_hashedGridBroadPhase)
+	{
+		return layer.grid.WasMoved(GetTreeProxyId(proxyId));
+	}
+
+	return layer.tree.WasMoved(GetTreeProxyId(proxyId));
+}
+
+inline void b2BroadPhase::ClearMoved(int32 proxyId)
+{
+	b2BroadPhaseLayer& layer = m_layers[GetLayer(proxyId)];
+	if (IsStaticProxy(proxyId))
+	{
+		layer.staticTree.ClearMoved(GetTreeProxyId(proxyId));
+	}
+	else if (m_type == b2_hashedGridBroadPhase)
+	{
+		layer.grid.ClearMoved(GetTreeProxyId(proxyId));
+	}
+	else
+	{
+		layer.tree.ClearMoved(GetTreeProxyId(proxyId));
+	}
 }
 
 inline int32 b2BroadPhase::GetProxyCount() const
@@ -154,19 +332,26 @@ inline int32 b2BroadPhase::GetProxyCount() const
 	return m_proxyCount;
 }
 
-inline int32 b2BroadPhase::GetTreeHeight() const
+inline bool b2BroadPhase::GetLayerCollision(int32 layerA, int32 layerB) const
 {
-	return m_tree.GetHeight();
+	b2Assert(0 <= layerA && layerA < b2_maxCollisionLayers);
+	b2Assert(0 <= layerB && layerB < b2_maxCollisionLayers);
+	return (m_layerMasks[layerA] & (1u << layerB)) != 0;
 }
 
-inline int32 b2BroadPhase::GetTreeBalance() const
+inline b2BroadPhaseType b2BroadPhase::GetType() const
 {
-	return m_tree.GetMaxBalance();
+	return m_type;
 }
 
-inline float b2BroadPhase::GetTreeQuality() const
+inline void b2BroadPhase::SetStaticTreeCompression(bool flag)
 {
-	return m_tree.GetAreaRatio();
+	m_compressStatic = flag;
+}
+
+inline bool b2BroadPhase::GetStaticTreeCompression() const
+{
+	return m_compressStatic;
 }
 
 template <typename T>
@@ -175,29 +360,72 @@ void b2BroadPhase::UpdatePairs(T* callback)
 	// Reset pair buffer
 	m_pairCount = 0;
 
-	// Perform tree queries for all moving proxies.
-	for (int32 i = 0; i < m_moveCount; ++i)
+	// Fold the pending static proxies into the compressed nodes.
+	for (int32 i = 0; i < b2_maxCollisionLayers; ++i)
 	{
-		m_queryProxyId = m_moveBuffer[i];
-		if (m_queryProxyId == e_nullProxy)
+		if (m_layers[i].staticTree.ShouldRebuild())
 		{
-			continue;
+			m_layers[i].staticTree.Rebuild();
 		}
+	}
 
-		// We have to query the tree with the fat AABB so that
-		// we don't fail to create a pair that may touch later.
-		const b2AABB& fatAABB = m_tree.GetFatAABB(m_queryProxyId);
-
-		// Query tree, create pairs and add them pair buffer.
-		m_tree.Query(this, fatAABB);
+	if (m_type == b2_dynamicTreeBroadPhase && m_moveCount >= e_moveTreeThreshold)
+	{
+		// Many proxies moved, so descend the trees once for all of them.
+		QueryMoveTree();
+	}
+	else
+	{
+		// Perform tree queries for all moving proxies.
+		for (int32 i = 0; i < m_moveCount; ++i)
+		{
+			m_queryProxyId = m_moveBuffer[i];
+			if (m_queryProxyId == e_nullProxy)
+			{
+				continue;
+			}
+
+			// We have to query the tree with the fat AABB so that
+			// we don't fail to create a pair that may touch later.
+			const b2AABB& fatAABB = GetFatAABB(m_queryProxyId);
+			uint32 layerMask = m_layerMasks[GetLayer(m_queryProxyId)];
+
+			for (int32 j = 0; j < b2_maxCollisionLayers; ++j)
+			{
+				// Layers that don't interact are never traversed.
+				if ((layerMask & (1u << j)) == 0)
+				{
+					continue;
+				}
+
+				// Query tree, create pairs and add them pair buffer.
+				const b2BroadPhaseLayer& layer = m_layers[j];
+				m_queryTag = j << 1;
+				if (m_type == b2_hashedGridBroadPhase)
+				{
+					layer.grid.Query(this, fatAABB);
+				}
+				else
+				{
+					layer.tree.Query(this, fatAABB);
+				}
+
+				// Compressed static proxies don't pair with each other.
+				if (IsStaticProxy(m_queryProxyId) == false && layer.staticTree.GetProxyCount() > 0)
+				{
+					m_queryTag = (j << 1) | 1;
+					layer.staticTree.Query(this, fatAABB);
+				}
+			}
+		}
 	}
 
 	// Send pairs to caller
 	for (int32 i = 0; i < m_pairCount; ++i)
 	{
 		b2Pair* primaryPair = m_pairBuffer + i;
-		void* userDataA = m_tree.GetUserData(primaryPair->proxyIdA);
-		void* userDataB = m_tree.GetUserData(primaryPair->proxyIdB);
+		void* userDataA = GetUserData(primaryPair->proxyIdA);
+		void* userDataB = GetUserData(primaryPair->proxyIdB);
 
 		callback->AddPair(userDataA, userDataB);
 	}
@@ -211,7 +439,7 @@ void b2BroadPhase::UpdatePairs(T* callback)
 			continue;
 		}
 
-		m_tree.ClearMoved(proxyId);
+		ClearMoved(proxyId);
 	}
 
 	// Reset move buffer
@@ -221,18 +449,61 @@ void b2BroadPhase::UpdatePairs(T* callback)
 template <typename T>
 inline void b2BroadPhase::Query(T* callback, const b2AABB& aabb) const
 {
-	m_tree.Query(callback, aabb);
+	b2BroadPhaseCallback<T> wrapper;
+	wrapper.callback = callback;
+	wrapper.proceed = true;
+
+	for (int32 i = 0; i < b2_maxCollisionLayers && wrapper.proceed; ++i)
+	{
+		const b2BroadPhaseLayer& layer = m_layers[i];
+		wrapper.tag = i << 1;
+		if (m_type == b2_hashedGridBroadPhase)
+		{
+			layer.grid.Query(&wrapper, aabb);
+		}
+		else
+		{
+			layer.tree.Query(&wrapper, aabb);
+		}
+
+		if (wrapper.proceed && layer.staticTree.GetProxyCount() > 0)
+		{
+			wrapper.tag = (i << 1) | 1;
+			layer.staticTree.Query(&wrapper, aabb);
+		}
+	}
 }
 
 template <typename T>
 inline void b2BroadPhase::RayCast(T* callback, const b2RayCastInput& input) const
 {
-	m_tree.RayCast(callback, input);
-}
+	b2BroadPhaseCallback<T> wrapper;
+	wrapper.callback = callback;
+	wrapper.maxFraction = input.maxFraction;
 
-inline void b2BroadPhase::ShiftOrigin(const b2Vec2& newOrigin)
-{
-	m_tree.ShiftOrigin(newOrigin);
+	// Each structure continues with the clipped ray unless the client terminated the cast.
+	b2RayCastInput subInput = input;
+	for (int32 i = 0; i < b2_maxCollisionLayers && wrapper.maxFraction > 0.0f; ++i)
+	{
+		const b2BroadPhaseLayer& layer = m_layers[i];
+		subInput.maxFraction = wrapper.maxFraction;
+		wrapper.tag = i << 1;
+		if (m_type == b2_hashedGridBroadPhase)
+		{
+			layer.grid.RayCast(&wrapper, subInput);
+		}
+		else
+		{
+			layer.tree.RayCast(&wrapper, subInput);
+		}
+
+		if (wrapper.maxFraction > 0.0f && layer.staticTree.GetProxyCount() > 0)
+		{
+			subInput.maxFraction = wrapper.maxFraction;
+			wrapper.tag = (i << 1) | 1;
+			layer.staticTree.RayCast(&wrapper, subInput);
+		}
+	}
 }
 
 #endif
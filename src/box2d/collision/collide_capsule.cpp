@@ -0,0 +1,501 @@
+// MIT License
+
+// Copyright (c) 2019 Erin Catto
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "collision.h"
+#include "shapes/capsule_shape.h"
+#include "shapes/circle_shape.h"
+#include "shapes/edge_shape.h"
+#include "shapes/polygon_shape.h"
+
+// Capsules are segments with a radius. Polygons and edges are handled the same way:
+// as convex hulls with a radius. Unlike b2CollidePolygons, the radius can be large, so
+// when the cores are apart the closest features may be two vertices. That case gets a
+// single point with the vertex-to-vertex normal, which b2WorldManifold handles through
+// b2Manifold::e_circles.
+
+// A convex hull with a radius, expressed in the frame of shape A. A segment is a hull
+// with two vertices and opposite normals.
+struct b2RoundedHull
+{
+	b2Vec2 vertices[b2_maxPolygonVertices];
+	b2Vec2 normals[b2_maxPolygonVertices];
+	int32 count;
+	float radius;
+};
+
+static void b2MakeHull(b2RoundedHull* hull, const b2PolygonShape* polygon, const b2Transform& xf)
+{
+	hull->count = polygon->m_count;
+	for (int32 i = 0; i < polygon->m_count; ++i)
+	{
+		hull->vertices[i] = b2Mul(xf, polygon->m_vertices[i]);
+		hull->normals[i] = b2Mul(xf.q, polygon->m_normals[i]);
+	}
+	hull->radius = polygon->m_radius;
+}
+
+static void b2MakeHull(b2RoundedHull* hull, const b2Vec2& v1, const b2Vec2& v2, float radius, const b2Transform& xf)
+{
+	hull->count = 2;
+	hull->vertices[0] = b2Mul(xf, v1);
+	hull->vertices[1] = b2Mul(xf, v2);
+
+	// Normal points to the right for a CCW winding
+	b2Vec2 e = hull->vertices[1] - hull->vertices[0];
+	e.Normalize();
+	hull->normals[0].Set(e.y, -e.x);
+	hull->normals[1] = -hull->normals[0];
+	hull->radius = radius;
+}
+
+// Find the max separation between the cores of hull1 and hull2 using edge normals from hull1.
+static float b2FindHullSeparation(int32* edgeIndex, const b2RoundedHull& hull1, const b2RoundedHull& hull2)
+{
+	int32 bestIndex = 0;
+	float maxSeparation = -b2_maxFloat;
+	for (int32 i = 0; i < hull1.count; ++i)
+	{
+		b2Vec2 n = hull1.normals[i];
+		b2Vec2 v1 = hull1.vertices[i];
+
+		// Find deepest point for normal i.
+		float si = b2_maxFloat;
+		for (int32 j = 0; j < hull2.count; ++j)
+		{
+			float sij = b2Dot(n, hull2.vertices[j] - v1);
+			if (sij < si)
+			{
+				si = sij;
+			}
+		}
+
+		if (si > maxSeparation)
+		{
+			maxSeparation = si;
+			bestIndex = i;
+		}
+	}
+
+	*edgeIndex = bestIndex;
+	return maxSeparation;
+}
+
+// Find the edge of hull2 whose normal is most anti-parallel to the given normal.
+static int32 b2FindIncidentEdge(const b2RoundedHull& hull2, const b2Vec2& normal1)
+{
+	int32 index = 0;
+	float minDot = b2_maxFloat;
+	for (int32 i = 0; i < hull2.count; ++i)
+	{
+		float dot = b2Dot(normal1, hull2.normals[i]);
+		if (dot < minDot)
+		{
+			minDot = dot;
+			index = i;
+		}
+	}
+
+	return index;
+}
+
+// Fractions of the closest points between segments p1-q1 and p2-q2.
+// From Real-Time Collision Detection by Christer Ericson, Section 5.1.9.
+static void b2SegmentClosestFractions(float* f1, float* f2,
+									  const b2Vec2& p1, const b2Vec2& q1, const b2Vec2& p2, const b2Vec2& q2)
+{
+	b2Vec2 d1 = q1 - p1;
+	b2Vec2 d2 = q2 - p2;
+	b2Vec2 r = p1 - p2;
+	float dd1 = b2Dot(d1, d1);
+	float dd2 = b2Dot(d2, d2);
+	float rd1 = b2Dot(r, d1);
+	float rd2 = b2Dot(r, d2);
+
+	const float epsSqr = b2_epsilon * b2_epsilon;
+	if (dd1 < epsSqr || dd2 < epsSqr)
+	{
+		// Handle all degeneracies
+		*f1 = dd1 >= epsSqr ? b2Clamp(-rd1 / dd1, 0.0f, 1.0f) : 0.0f;
+		*f2 = dd1 < epsSqr && dd2 >= epsSqr ? b2Clamp(rd2 / dd2, 0.0f, 1.0f) : 0.0f;
+		return;
+	}
+
+	float d12 = b2Dot(d1, d2);
+	float denom = dd1 * dd2 - d12 * d12;
+
+	// Fraction on segment 1, arbitrary if parallel
+	float s = 0.0f;
+	if (denom != 0.0f)
+	{
+		s = b2Clamp((d12 * rd2 - rd1 * dd2) / denom, 0.0f, 1.0f);
+	}
+
+	// Point on segment 2 closest to the point on segment 1
+	float t = (d12 * s + rd2) / dd2;
+
+	// Clamping segment 2 requires a do over on segment 1
+	if (t < 0.0f)
+	{
+		t = 0.0f;
+		s = b2Clamp(-rd1 / dd1, 0.0f, 1.0f);
+	}
+	else if (t > 1.0f)
+	{
+		t = 1.0f;
+		s = b2Clamp((d12 - rd1) / dd1, 0.0f, 1.0f);
+	}
+
+	*f1 = s;
+	*f2 = t;
+}
+
+// Collide two rounded hulls given in the frame of A. xf is the transform of B relative
+// to A and is used to express the manifold in the body frames. The collision normal,
+// pointing from A to B in the frame of A, is returned through normalA. If forcedEdgeA
+// is not negative, that edge of A is the reference face.
+static void b2CollideHulls(b2Manifold* manifold, b2Vec2* normalA,
+						   const b2RoundedHull& hullA, const b2RoundedHull& hullB,
+						   const b2Transform& xf, int32 forcedEdgeA)
+{
+	manifold->pointCount = 0;
+	float radius = hullA.radius + hullB.radius;
+
+	int32 edgeA = 0;
+	float separationA = b2FindHullSeparation(&edgeA, hullA, hullB);
+	if (separationA > radius)
+		return;
+
+	int32 edgeB = 0;
+	float separationB = b2FindHullSeparation(&edgeB, hullB, hullA);
+	if (separationB > radius)
+		return;
+
+	const float k_tol = 0.1f * b2_linearSlop;
+	bool flip = separationB > separationA + k_tol;
+
+	if (forcedEdgeA >= 0)
+	{
+		edgeA = forcedEdgeA;
+		flip = false;
+	}
+
+	if (flip)
+	{
+		edgeA = b2FindIncidentEdge(hullA, hullB.normals[edgeB]);
+	}
+	else
+	{
+		edgeB = b2FindIncidentEdge(hullB, hullA.normals[edgeA]);
+	}
+
+	int32 iA1 = edgeA;
+	int32 iA2 = edgeA + 1 < hullA.count ? edgeA + 1 : 0;
+	int32 iB1 = edgeB;
+	int32 iB2 = edgeB + 1 < hullB.count ? edgeB + 1 : 0;
+
+	// The slop makes sure the vertex-vertex normal can be normalized.
+	if (forcedEdgeA < 0 && b2Max(separationA, separationB) > k_tol)
+	{
+		float fA, fB;
+		b2SegmentClosestFractions(&fA, &fB, hullA.vertices[iA1], hullA.vertices[iA2],
+								  hullB.vertices[iB1], hullB.vertices[iB2]);
+
+		if ((fA == 0.0f || fA == 1.0f) && (fB == 0.0f || fB == 1.0f))
+		{
+			int32 iA = fA == 0.0f ? iA1 : iA2;
+			int32 iB = fB == 0.0f ? iB1 : iB2;
+			b2Vec2 vA = hullA.vertices[iA];
+			b2Vec2 vB = hullB.vertices[iB];
+
+			b2Vec2 d = vB - vA;
+			if (b2Dot(d, d) > radius * radius)
+				return;
+
+			d.Normalize();
+			*normalA = d;
+
+			manifold->type = b2Manifold::e_circles;
+			manifold->localNormal.SetZero();
+			manifold->localPoint = vA;
+			manifold->pointCount = 1;
+			manifold->points[0].localPoint = b2MulT(xf, vB);
+			manifold->points[0].id.cf.indexA = (uint8)iA;
+			manifold->points[0].id.cf.indexB = (uint8)iB;
+			manifold->points[0].id.cf.typeA = b2ContactFeature::e_vertex;
+			manifold->points[0].id.cf.typeB = b2ContactFeature::e_vertex;
+			return;
+		}
+	}
+
+	// Clip the incident edge against the reference face side planes.
+	const b2RoundedHull& hull1 = flip ? hullB : hullA;
+	int32 iv1 = flip ? iB1 : iA1;
+	int32 iv2 = flip ? iB2 : iA2;
+	int32 i21 = flip ? iA1 : iB1;
+	int32 i22 = flip ? iA2 : iB2;
+	const b2RoundedHull& hull2 = flip ? hullA : hullB;
+
+	b2Vec2 v11 = hull1.vertices[iv1];
+	b2Vec2 v12 = hull1.vertices[iv2];
+	b2Vec2 normal = hull1.normals[iv1];
+	b2Vec2 tangent = b2Cross(1.0f, normal);
+
+	b2ClipVertex incidentEdge[2];
+	incidentEdge[0].v = hull2.vertices[i21];
+	incidentEdge[0].id.cf.indexA = (uint8)iv1;
+	incidentEdge[0].id.cf.indexB = (uint8)i21;
+	incidentEdge[0].id.cf.typeA = b2ContactFeature::e_face;
+	incidentEdge[0].id.cf.typeB = b2ContactFeature::e_vertex;
+
+	incidentEdge[1].v = hull2.vertices[i22];
+	incidentEdge[1].id.cf.indexA = (uint8)iv1;
+	incidentEdge[1].id.cf.indexB = (uint8)i22;
+	incidentEdge[1].id.cf.typeA = b2ContactFeature::e_face;
+	incidentEdge[1].id.cf.typeB = b2ContactFeature::e_vertex;
+
+	b2ClipVertex clipPoints1[2];
+	b2ClipVertex clipPoints2[2];
+
+	if (b2ClipSegmentToLine(clipPoints1, incidentEdge, -tangent, -b2Dot(tangent, v11), iv1) < 2)
+		return;
+
+	if (b2ClipSegmentToLine(clipPoints2, clipPoints1, tangent, b2Dot(tangent, v12), iv2) < 2)
+		return;
+
+	if (flip)
+	{
+		manifold->type = b2Manifold::e_faceB;
+		manifold->localNormal = b2MulT(xf.q, normal);
+		manifold->localPoint = b2MulT(xf, v11);
+		*normalA = -normal;
+	}
+	else
+	{
+		manifold->type = b2Manifold::e_faceA;
+		manifold->localNormal = normal;
+		manifold->localPoint = v11;
+		*normalA = normal;
+	}
+
+	int32 pointCount = 0;
+	for (int32 i = 0; i < b2_maxManifoldPoints; ++i)
+	{
+		float separation = b2Dot(normal, clipPoints2[i].v - v11);
+
+		if (separation <= radius)
+		{
+			b2ManifoldPoint* cp = manifold->points + pointCount;
+
+			if (flip)
+			{
+				// Swap features
+				cp->localPoint = clipPoints2[i].v;
+				cp->id.cf.indexA = clipPoints2[i].id.cf.indexB;
+				cp->id.cf.indexB = clipPoints2[i].id.cf.indexA;
+				cp->id.cf.typeA = clipPoints2[i].id.cf.typeB;
+				cp->id.cf.typeB = clipPoints2[i].id.cf.typeA;
+			}
+			else
+			{
+				cp->localPoint = b2MulT(xf, clipPoints2[i].v);
+				cp->id = clipPoints2[i].id;
+			}
+
+			++pointCount;
+		}
+	}
+
+	manifold->pointCount = pointCount;
+}
+
+void b2CollideCapsuleAndCircle(b2Manifold* manifold,
+							   const b2CapsuleShape* capsuleA, const b2Transform& xfA,
+							   const b2CircleShape* circleB, const b2Transform& xfB)
+{
+	manifold->pointCount = 0;
+
+	// Compute circle in frame of capsule
+	b2Vec2 Q = b2MulT(xfA, b2Mul(xfB, circleB->m_p));
+
+	b2Vec2 A = capsuleA->m_vertex1, B = capsuleA->m_vertex2;
+	b2Vec2 e = B - A;
+
+	// Barycentric coordinates
+	float u = b2Dot(e, B - Q);
+	float v = b2Dot(e, Q - A);
+
+	float radius = capsuleA->m_radius + circleB->m_radius;
+
+	b2ContactFeature cf;
+	cf.indexB = 0;
+	cf.typeB = b2ContactFeature::e_vertex;
+
+	// Region A or B: the circle touches an end cap.
+	if (u <= 0.0f || v <= 0.0f)
+	{
+		b2Vec2 P = v <= 0.0f ? A : B;
+		b2Vec2 d = Q - P;
+		if (b2Dot(d, d) > radius * radius)
+		{
+			return;
+		}
+
+		cf.indexA = v <= 0.0f ? 0 : 1;
+		cf.typeA = b2ContactFeature::e_vertex;
+		manifold->pointCount = 1;
+		manifold->type = b2Manifold::e_circles;
+		manifold->localNormal.SetZero();
+		manifold->localPoint = P;
+		manifold->points[0].id.key = 0;
+		manifold->points[0].id.cf = cf;
+		manifold->points[0].localPoint = circleB->m_p;
+		return;
+	}
+
+	// Region AB
+	float den = b2Dot(e, e);
+	b2Assert(den > 0.0f);
+	b2Vec2 P = (1.0f / den) * (u * A + v * B);
+	b2Vec2 d = Q - P;
+	float dd = b2Dot(d, d);
+	if (dd > radius * radius)
+	{
+		return;
+	}
+
+	b2Vec2 n(-e.y, e.x);
+	if (b2Dot(n, Q - A) < 0.0f)
+	{
+		n.Set(-n.x, -n.y);
+	}
+	n.Normalize();
+
+	cf.indexA = 0;
+	cf.typeA = b2ContactFeature::e_face;
+	manifold->pointCount = 1;
+	manifold->type = b2Manifold::e_faceA;
+	manifold->localNormal = n;
+	manifold->localPoint = A;
+	manifold->points[0].id.key = 0;
+	manifold->points[0].id.cf = cf;
+	manifold->points[0].localPoint = circleB->m_p;
+}
+
+void b2CollideCapsules(b2Manifold* manifold,
+					   const b2CapsuleShape* capsuleA, const b2Transform& xfA,
+					   const b2CapsuleShape* capsuleB, const b2Transform& xfB)
+{
+	b2Transform xf = b2MulT(xfA, xfB);
+	b2Transform identity;
+	identity.SetIdentity();
+
+	b2RoundedHull hullA, hullB;
+	b2MakeHull(&hullA, capsuleA->m_vertex1, capsuleA->m_vertex2, capsuleA->m_radius, identity);
+	b2MakeHull(&hullB, capsuleB->m_vertex1, capsuleB->m_vertex2, capsuleB->m_radius, xf);
+
+	b2Vec2 normal;
+	b2CollideHulls(manifold, &normal, hullA, hullB, xf, -1);
+}
+
+void b2CollidePolygonAndCapsule(b2Manifold* manifold,
+								const b2PolygonShape* polygonA, const b2Transform& xfA,
+								const b2CapsuleShape* capsuleB, const b2Transform& xfB)
+{
+	b2Transform xf = b2MulT(xfA, xfB);
+	b2Transform identity;
+	identity.SetIdentity();
+
+	b2RoundedHull hullA, hullB;
+	b2MakeHull(&hullA, polygonA, identity);
+	b2MakeHull(&hullB, capsuleB->m_vertex1, capsuleB->m_vertex2, capsuleB->m_radius, xf);
+
+	b2Vec2 normal;
+	b2CollideHulls(manifold, &normal, hullA, hullB, xf, -1);
+}
+
+// This accounts for edge connectivity in the same way as b2CollideEdgeAndPolygon.
+void b2CollideEdgeAndCapsule(b2Manifold* manifold,
+							 const b2EdgeShape* edgeA, const b2Transform& xfA,
+							 const b2CapsuleShape* capsuleB, const b2Transform& xfB)
+{
+	manifold->pointCount = 0;
+
+	b2Transform xf = b2MulT(xfA, xfB);
+	b2Transform identity;
+	identity.SetIdentity();
+
+	b2RoundedHull hullA, hullB;
+	b2MakeHull(&hullA, edgeA->m_vertex1, edgeA->m_vertex2, edgeA->m_radius, identity);
+	b2MakeHull(&hullB, capsuleB->m_vertex1, capsuleB->m_vertex2, capsuleB->m_radius, xf);
+
+	b2Vec2 edge1 = hullA.vertices[1] - hullA.vertices[0];
+	edge1.Normalize();
+	b2Vec2 normal1 = hullA.normals[0];
+
+	bool oneSided = edgeA->m_oneSided;
+	if (oneSided && b2Dot(normal1, 0.5f * (hullB.vertices[0] + hullB.vertices[1]) - hullA.vertices[0]) < 0.0f)
+	{
+		return;
+	}
+
+	b2Vec2 normal;
+	b2CollideHulls(manifold, &normal, hullA, hullB, xf, -1);
+
+	if (oneSided == false || manifold->pointCount == 0)
+	{
+		return;
+	}
+
+	// Smooth collision
+	// See https://box2d.org/posts/2020/06/ghost-collisions/
+
+	b2Vec2 edge0 = edgeA->m_vertex1 - edgeA->m_vertex0;
+	edge0.Normalize();
+	b2Vec2 normal0(edge0.y, -edge0.x);
+	bool convex1 = b2Cross(edge0, edge1) >= 0.0f;
+
+	b2Vec2 edge2 = edgeA->m_vertex3 - edgeA->m_vertex2;
+	edge2.Normalize();
+	b2Vec2 normal2(edge2.y, -edge2.x);
+	bool convex2 = b2Cross(edge1, edge2) >= 0.0f;
+
+	const float sinTol = 0.1f;
+	bool side1 = b2Dot(normal, edge1) <= 0.0f;
+
+	// Check Gauss Map
+	bool convex = side1 ? convex1 : convex2;
+	if (convex)
+	{
+		float sine = side1 ? b2Cross(normal, normal0) : b2Cross(normal2, normal);
+		if (sine > sinTol)
+		{
+			// Skip region
+			manifold->pointCount = 0;
+		}
+
+		// Admit region
+		return;
+	}
+
+	// Snap region
+	b2CollideHulls(manifold, &normal, hullA, hullB, xf, 0);
+}
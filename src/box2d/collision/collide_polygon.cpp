@@ -22,9 +22,15 @@
 
 #include "collision.h"
 #include "shapes/polygon_shape.h"
+#include "simd.h"
 
+// Define LIQUIDFUN_SIMD_TEST_VS_REFERENCE to run both SIMD and reference
+// versions, and assert that the results are identical.
+// #define LIQUIDFUN_SIMD_TEST_VS_REFERENCE
+
+#if !defined(LIQUIDFUN_SIMD_SSE) || defined(LIQUIDFUN_SIMD_TEST_VS_REFERENCE)
 // Find the max separation between poly1 and poly2 using edge normals from poly1.
-static float b2FindMaxSeparation(int32* edgeIndex,
+static float b2FindMaxSeparation_Reference(int32* edgeIndex,
 								 const b2PolygonShape* poly1, const b2Transform& xf1,
 								 const b2PolygonShape* poly2, const b2Transform& xf2)
 {
@@ -64,6 +70,118 @@ static float b2FindMaxSeparation(int32* edgeIndex,
 	*edgeIndex = bestIndex;
 	return maxSeparation;
 }
+#endif
+
+#if defined(LIQUIDFUN_SIMD_SSE)
+// Holds four poly1 normals and vertices in frame2, one per lane.
+struct b2PolygonLanes
+{
+	__m128 nx, ny;
+	__m128 vx, vy;
+};
+
+// The operations match b2Mul and b2Dot exactly, so each lane is bit-for-bit
+// equal to the reference.
+static inline __m128 b2FindMinSeparations(const b2Vec2* normals, const b2Vec2* vertices,
+										  const b2Transform& xf, const b2Vec2* v2s, int32 count2)
+{
+	__m128 c = _mm_set1_ps(xf.q.c);
+	__m128 s = _mm_set1_ps(xf.q.s);
+
+	b2PolygonLanes lanes;
+	__m128 x, y;
+	b2LoadPoints(&x, &y, normals);
+	lanes.nx = _mm_sub_ps(_mm_mul_ps(c, x), _mm_mul_ps(s, y));
+	lanes.ny = _mm_add_ps(_mm_mul_ps(s, x), _mm_mul_ps(c, y));
+	b2LoadPoints(&x, &y, vertices);
+	lanes.vx = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(c, x), _mm_mul_ps(s, y)), _mm_set1_ps(xf.p.x));
+	lanes.vy = _mm_add_ps(_mm_add_ps(_mm_mul_ps(s, x), _mm_mul_ps(c, y)), _mm_set1_ps(xf.p.y));
+
+	// Find deepest point of poly2 for all four normals at once.
+	__m128 si = _mm_set1_ps(b2_maxFloat);
+	for (int32 j = 0; j < count2; ++j)
+	{
+		__m128 dx = _mm_sub_ps(_mm_set1_ps(v2s[j].x), lanes.vx);
+		__m128 dy = _mm_sub_ps(_mm_set1_ps(v2s[j].y), lanes.vy);
+		__m128 sij = _mm_add_ps(_mm_mul_ps(lanes.nx, dx), _mm_mul_ps(lanes.ny, dy));
+		si = _mm_min_ps(si, sij);
+	}
+
+	return si;
+}
+
+// Tests the vertices of poly2 against four normals of poly1 at a time, then picks the
+// reference face with a vector max-reduction.
+static float b2FindMaxSeparation_Simd(int32* edgeIndex,
+									  const b2PolygonShape* poly1, const b2Transform& xf1,
+									  const b2PolygonShape* poly2, const b2Transform& xf2)
+{
+	int32 count1 = poly1->m_count;
+	b2Transform xf = b2MulT(xf2, xf1);
+
+	float separations[(b2_maxPolygonVertices + 3) & ~3];
+	__m128 maxSeparation = _mm_set1_ps(-b2_maxFloat);
+	for (int32 base = 0; base < count1; base += 4)
+	{
+		const b2Vec2* normals = poly1->m_normals + base;
+		const b2Vec2* vertices = poly1->m_vertices + base;
+
+		// A partial group repeats its last face, so no lane reads past count1.
+		b2Vec2 tailNormals[4], tailVertices[4];
+		if (count1 - base < 4)
+		{
+			for (int32 i = 0; i < 4; ++i)
+			{
+				int32 index = b2Min(base + i, count1 - 1);
+				tailNormals[i] = poly1->m_normals[index];
+				tailVertices[i] = poly1->m_vertices[index];
+			}
+
+			normals = tailNormals;
+			vertices = tailVertices;
+		}
+
+		__m128 si = b2FindMinSeparations(normals, vertices, xf, poly2->m_vertices, poly2->m_count);
+		_mm_storeu_ps(separations + base, si);
+		maxSeparation = _mm_max_ps(maxSeparation, si);
+	}
+
+	maxSeparation = _mm_max_ps(maxSeparation, _mm_shuffle_ps(maxSeparation, maxSeparation, _MM_SHUFFLE(1, 0, 3, 2)));
+	maxSeparation = _mm_max_ps(maxSeparation, _mm_shuffle_ps(maxSeparation, maxSeparation, _MM_SHUFFLE(2, 3, 0, 1)));
+	float best = _mm_cvtss_f32(maxSeparation);
+
+	// The reference keeps the first face on ties.
+	int32 bestIndex = 0;
+	while (bestIndex < count1 - 1 && separations[bestIndex] != best)
+	{
+		++bestIndex;
+	}
+
+	*edgeIndex = bestIndex;
+	return separations[bestIndex];
+}
+#endif // defined(LIQUIDFUN_SIMD_SSE)
+
+static inline float b2FindMaxSeparation(int32* edgeIndex,
+										const b2PolygonShape* poly1, const b2Transform& xf1,
+										const b2PolygonShape* poly2, const b2Transform& xf2)
+{
+#if defined(LIQUIDFUN_SIMD_SSE)
+	float separation = b2FindMaxSeparation_Simd(edgeIndex, poly1, xf1, poly2, xf2);
+#else
+	float separation = b2FindMaxSeparation_Reference(edgeIndex, poly1, xf1, poly2, xf2);
+#endif
+
+#if defined(LIQUIDFUN_SIMD_TEST_VS_REFERENCE)
+	int32 referenceIndex;
+	float referenceSeparation = b2FindMaxSeparation_Reference(&referenceIndex, poly1, xf1, poly2, xf2);
+	b2Assert(*edgeIndex == referenceIndex);
+	b2Assert(separation == referenceSeparation);
+	B2_NOT_USED(referenceSeparation);
+#endif // defined(LIQUIDFUN_SIMD_TEST_VS_REFERENCE)
+
+	return separation;
+}
 
 static void b2FindIncidentEdge(b2ClipVertex c[2],
 							 const b2PolygonShape* poly1, const b2Transform& xf1, int32 edge1,
@@ -241,3 +359,224 @@ void b2CollidePolygons(b2Manifold* manifold,
 
 	manifold->pointCount = pointCount;
 }
+
+// Box vertices and normals follow b2PolygonShape::SetAsBox. Normal 1 is the box x-axis
+// and normal 2 is the box y-axis.
+static inline b2Vec2 b2GetBoxExtents(const b2PolygonShape* box)
+{
+	b2Vec2 r = box->m_vertices[2] - box->m_centroid;
+	return b2Vec2(b2Dot(r, box->m_normals[1]), b2Dot(r, box->m_normals[2]));
+}
+
+// Pick the face of a box with the larger separation. The general collider keeps the
+// lower face index on ties.
+static inline float b2PickBoxFace(int32* edge, int32 faceX, float sx, int32 faceY, float sy)
+{
+	if (faceX < faceY ? sy > sx : sy >= sx)
+	{
+		*edge = faceY;
+		return sy;
+	}
+
+	*edge = faceX;
+	return sx;
+}
+
+// Clip the incident edge against one side plane of the reference face. This is
+// b2ClipSegmentToLine with the distances along the face tangent already known.
+static int32 b2ClipBoxSide(b2ClipVertex vOut[2], float sOut[2], const b2ClipVertex vIn[2], const float sIn[2],
+						   float distance0, float distance1, float sPlane, int32 vertexIndexA)
+{
+	int32 count = 0;
+
+	if (distance0 <= 0.0f)
+	{
+		vOut[count] = vIn[0];
+		sOut[count++] = sIn[0];
+	}
+
+	if (distance1 <= 0.0f)
+	{
+		vOut[count] = vIn[1];
+		sOut[count++] = sIn[1];
+	}
+
+	if (distance0 * distance1 < 0.0f)
+	{
+		float interp = distance0 / (distance0 - distance1);
+		vOut[count].v = vIn[0].v + interp * (vIn[1].v - vIn[0].v);
+		vOut[count].id.cf.indexA = static_cast<uint8>(vertexIndexA);
+		vOut[count].id.cf.indexB = vIn[0].id.cf.indexB;
+		vOut[count].id.cf.typeA = b2ContactFeature::e_vertex;
+		vOut[count].id.cf.typeB = b2ContactFeature::e_face;
+		sOut[count++] = sPlane;
+	}
+
+	return count;
+}
+
+// Boxes only need two axes each for the separating axis test. Everything is done in the
+// frame of the reference box, and the face and vertex numbering matches the general
+// polygon collider so warm starting works across both.
+void b2CollideBoxes(b2Manifold* manifold,
+					const b2PolygonShape* boxA, const b2Transform& xfA,
+					const b2PolygonShape* boxB, const b2Transform& xfB)
+{
+	b2Assert(boxA->m_isBox && boxB->m_isBox);
+
+	manifold->pointCount = 0;
+	float totalRadius = boxA->m_radius + boxB->m_radius;
+
+	// Box B in the frame of box A.
+	b2Transform xf = b2MulT(xfA, xfB);
+
+	b2Vec2 hA = b2GetBoxExtents(boxA);
+	b2Vec2 hB = b2GetBoxExtents(boxB);
+	b2Vec2 axisAx = boxA->m_normals[1];
+	b2Vec2 axisAy = boxA->m_normals[2];
+	b2Vec2 axisBx = b2Mul(xf.q, boxB->m_normals[1]);
+	b2Vec2 axisBy = b2Mul(xf.q, boxB->m_normals[2]);
+	b2Vec2 d = b2Mul(xf, boxB->m_centroid) - boxA->m_centroid;
+
+	float cxx = b2Abs(b2Dot(axisAx, axisBx));
+	float cxy = b2Abs(b2Dot(axisAx, axisBy));
+	float cyx = b2Abs(b2Dot(axisAy, axisBx));
+	float cyy = b2Abs(b2Dot(axisAy, axisBy));
+
+	// Faces of A.
+	float dx = b2Dot(d, axisAx);
+	float dy = b2Dot(d, axisAy);
+	int32 faceX = dx >= 0.0f ? 1 : 3;
+	int32 faceY = dy > 0.0f ? 2 : 0;
+	float sx = b2Abs(dx) - hA.x - (hB.x * cxx + hB.y * cxy);
+	float sy = b2Abs(dy) - hA.y - (hB.x * cyx + hB.y * cyy);
+
+	int32 edgeA;
+	float separationA = b2PickBoxFace(&edgeA, faceX, sx, faceY, sy);
+
+	if (separationA > totalRadius)
+		return;
+
+	// Faces of B point the other way along d.
+	dx = b2Dot(d, axisBx);
+	dy = b2Dot(d, axisBy);
+	faceX = dx <= 0.0f ? 1 : 3;
+	faceY = dy < 0.0f ? 2 : 0;
+	sx = b2Abs(dx) - hB.x - (hA.x * cxx + hA.y * cyx);
+	sy = b2Abs(dy) - hB.y - (hA.x * cxy + hA.y * cyy);
+
+	int32 edgeB;
+	float separationB = b2PickBoxFace(&edgeB, faceX, sx, faceY, sy);
+
+	if (separationB > totalRadius)
+		return;
+
+	const b2PolygonShape* box1;	// reference box
+	const b2PolygonShape* box2;	// incident box
+	b2Transform xf21;			// box2 in the frame of box1
+	int32 edge1;				// reference edge
+	uint8 flip;
+	const float k_tol = 0.1f * b2_linearSlop;
+
+	if (separationB > separationA + k_tol)
+	{
+		box1 = boxB;
+		box2 = boxA;
+		xf21 = b2MulT(xfB, xfA);
+		edge1 = edgeB;
+		manifold->type = b2Manifold::e_faceB;
+		flip = 1;
+	}
+	else
+	{
+		box1 = boxA;
+		box2 = boxB;
+		xf21 = xf;
+		edge1 = edgeA;
+		manifold->type = b2Manifold::e_faceA;
+		flip = 0;
+	}
+
+	b2Vec2 normal = box1->m_normals[edge1];
+
+	// Find the incident edge on box2.
+	b2Vec2 normal2 = b2MulT(xf21.q, normal);
+	int32 index = 0;
+	float minDot = b2_maxFloat;
+	for (int32 i = 0; i < 4; ++i)
+	{
+		float dot = b2Dot(normal2, box2->m_normals[i]);
+		if (dot < minDot)
+		{
+			minDot = dot;
+			index = i;
+		}
+	}
+
+	int32 i1 = index;
+	int32 i2 = (index + 1) & 3;
+
+	b2ClipVertex incidentEdge[2];
+	incidentEdge[0].v = b2Mul(xf21, box2->m_vertices[i1]);
+	incidentEdge[0].id.cf.indexA = (uint8)edge1;
+	incidentEdge[0].id.cf.indexB = (uint8)i1;
+	incidentEdge[0].id.cf.typeA = b2ContactFeature::e_face;
+	incidentEdge[0].id.cf.typeB = b2ContactFeature::e_vertex;
+
+	incidentEdge[1].v = b2Mul(xf21, box2->m_vertices[i2]);
+	incidentEdge[1].id.cf.indexA = (uint8)edge1;
+	incidentEdge[1].id.cf.indexB = (uint8)i2;
+	incidentEdge[1].id.cf.typeA = b2ContactFeature::e_face;
+	incidentEdge[1].id.cf.typeB = b2ContactFeature::e_vertex;
+
+	int32 iv1 = edge1;
+	int32 iv2 = (edge1 + 1) & 3;
+	b2Vec2 v11 = box1->m_vertices[iv1];
+	b2Vec2 v12 = box1->m_vertices[iv2];
+	b2Vec2 tangent = b2Cross(1.0f, normal);
+
+	// Clip the incident edge to the side planes, extended by the skin thickness.
+	float lower = b2Dot(tangent, v11) - totalRadius;
+	float upper = b2Dot(tangent, v12) + totalRadius;
+
+	float s[2] = { b2Dot(tangent, incidentEdge[0].v), b2Dot(tangent, incidentEdge[1].v) };
+	b2ClipVertex clipPoints1[2];
+	float s1[2];
+	if (b2ClipBoxSide(clipPoints1, s1, incidentEdge, s, lower - s[0], lower - s[1], lower, iv1) < 2)
+		return;
+
+	b2ClipVertex clipPoints2[2];
+	float s2[2];
+	if (b2ClipBoxSide(clipPoints2, s2, clipPoints1, s1, s1[0] - upper, s1[1] - upper, upper, iv2) < 2)
+		return;
+
+	manifold->localNormal = normal;
+	manifold->localPoint = 0.5f * (v11 + v12);
+
+	float frontOffset = b2Dot(normal, v11);
+
+	int32 pointCount = 0;
+	for (int32 i = 0; i < b2_maxManifoldPoints; ++i)
+	{
+		float separation = b2Dot(normal, clipPoints2[i].v) - frontOffset;
+
+		if (separation <= totalRadius)
+		{
+			b2ManifoldPoint* cp = manifold->points + pointCount;
+			cp->localPoint = b2MulT(xf21, clipPoints2[i].v);
+			cp->id = clipPoints2[i].id;
+			if (flip)
+			{
+				// Swap features
+				b2ContactFeature cf = cp->id.cf;
+				cp->id.cf.indexA = cf.indexB;
+				cp->id.cf.indexB = cf.indexA;
+				cp->id.cf.typeA = cf.typeB;
+				cp->id.cf.typeB = cf.typeA;
+			}
+			++pointCount;
+		}
+	}
+
+	manifold->pointCount = pointCount;
+}
@@ -33,6 +33,7 @@
 /// queries, and TOI queries.
 
 class b2Shape;
+class b2CapsuleShape;
 class b2CircleShape;
 class b2EdgeShape;
 class b2PolygonShape;
@@ -236,6 +237,12 @@ B2_API void b2CollidePolygons(b2Manifold* manifold,
 					   const b2PolygonShape* polygonA, const b2Transform& xfA,
 					   const b2PolygonShape* polygonB, const b2Transform& xfB);
 
+/// Compute the collision manifold between two polygons made with b2PolygonShape::SetAsBox.
+/// This gives the same manifold and feature ids as b2CollidePolygons, up to round-off.
+B2_API void b2CollideBoxes(b2Manifold* manifold,
+					   const b2PolygonShape* boxA, const b2Transform& xfA,
+					   const b2PolygonShape* boxB, const b2Transform& xfB);
+
 /// Compute the collision manifold between an edge and a circle.
 B2_API void b2CollideEdgeAndCircle(b2Manifold* manifold,
 							   const b2EdgeShape* polygonA, const b2Transform& xfA,
@@ -246,6 +253,26 @@ B2_API void b2CollideEdgeAndPolygon(b2Manifold* manifold,
 							   const b2EdgeShape* edgeA, const b2Transform& xfA,
 							   const b2PolygonShape* polygonB, const b2Transform& xfB);
 
+/// Compute the collision manifold between a capsule and a circle.
+B2_API void b2CollideCapsuleAndCircle(b2Manifold* manifold,
+							   const b2CapsuleShape* capsuleA, const b2Transform& xfA,
+							   const b2CircleShape* circleB, const b2Transform& xfB);
+
+/// Compute the collision manifold between two capsules.
+B2_API void b2CollideCapsules(b2Manifold* manifold,
+					   const b2CapsuleShape* capsuleA, const b2Transform& xfA,
+					   const b2CapsuleShape* capsuleB, const b2Transform& xfB);
+
+/// Compute the collision manifold between a polygon and a capsule.
+B2_API void b2CollidePolygonAndCapsule(b2Manifold* manifold,
+							   const b2PolygonShape* polygonA, const b2Transform& xfA,
+							   const b2CapsuleShape* capsuleB, const b2Transform& xfB);
+
+/// Compute the collision manifold between an edge and a capsule.
+B2_API void b2CollideEdgeAndCapsule(b2Manifold* manifold,
+							   const b2EdgeShape* edgeA, const b2Transform& xfA,
+							   const b2CapsuleShape* capsuleB, const b2Transform& xfB);
+
 /// Clipping for contact manifolds.
 B2_API int32 b2ClipSegmentToLine(b2ClipVertex vOut[2], const b2ClipVertex vIn[2],
 							const b2Vec2& normal, float offset, int32 vertexIndexA);
@@ -255,6 +282,21 @@ B2_API bool b2TestOverlap(	const b2Shape* shapeA, int32 indexA,
 					const b2Shape* shapeB, int32 indexB,
 					const b2Transform& xfA, const b2Transform& xfB);
 
+/// Bound an AABB after applying a transform. Use this to bring a box in the frame
+/// of a shape into world coordinates.
+b2AABB b2Mul(const b2Transform& xf, const b2AABB& aabb);
+
+/// Bound an AABB after applying the inverse of a transform. Use this to bring a
+/// world box into the frame of a shape.
+b2AABB b2MulT(const b2Transform& xf, const b2AABB& aabb);
+
+/// Does the segment p1 + t * d, 0 <= t <= maxFraction, touch the box? Unlike
+/// b2AABB::RayCast this also reports segments that start inside the box.
+/// @param fraction if not null, returns the t at which the segment enters the box,
+/// which is 0 if it starts inside.
+bool b2TestSegmentOverlap(const b2Vec2& p1, const b2Vec2& d, float maxFraction, const b2AABB& aabb,
+						  float* fraction = nullptr);
+
 /// Convex hull used for polygon collision
 struct b2Hull
 {
@@ -303,4 +345,67 @@ inline bool b2TestOverlap(const b2AABB& a, const b2AABB& b)
 	return true;
 }
 
+inline b2AABB b2Mul(const b2Transform& xf, const b2AABB& aabb)
+{
+	b2Vec2 center = b2Mul(xf, aabb.GetCenter());
+	b2Vec2 h = aabb.GetExtents();
+	float c = b2Abs(xf.q.c), s = b2Abs(xf.q.s);
+	b2Vec2 extents(c * h.x + s * h.y, s * h.x + c * h.y);
+
+	b2AABB result;
+	result.lowerBound = center - extents;
+	result.upperBound = center + extents;
+	return result;
+}
+
+inline b2AABB b2MulT(const b2Transform& xf, const b2AABB& aabb)
+{
+	b2Vec2 center = b2MulT(xf, aabb.GetCenter());
+	b2Vec2 h = aabb.GetExtents();
+	float c = b2Abs(xf.q.c), s = b2Abs(xf.q.s);
+	b2Vec2 extents(c * h.x + s * h.y, s * h.x + c * h.y);
+
+	b2AABB result;
+	result.lowerBound = center - extents;
+	result.upperBound = center + extents;
+	return result;
+}
+
+inline bool b2TestSegmentOverlap(const b2Vec2& p1, const b2Vec2& d, float maxFraction, const b2AABB& aabb,
+								 float* fraction)
+{
+	float tMin = 0.0f;
+	float tMax = maxFraction;
+	for (int32 axis = 0; axis < 2; ++axis)
+	{
+		float p = axis == 0 ? p1.x : p1.y;
+		float dp = axis == 0 ? d.x : d.y;
+		float lower = axis == 0 ? aabb.lowerBound.x : aabb.lowerBound.y;
+		float upper = axis == 0 ? aabb.upperBound.x : aabb.upperBound.y;
+		if (dp == 0.0f)
+		{
+			if (p < lower || upper < p)
+			{
+				return false;
+			}
+			continue;
+		}
+
+		float t1 = (lower - p) / dp;
+		float t2 = (upper - p) / dp;
+		tMin = b2Max(tMin, b2Min(t1, t2));
+		tMax = b2Min(tMax, b2Max(t1, t2));
+		if (tMax < tMin)
+		{
+			return false;
+		}
+	}
+
+	if (fraction)
+	{
+		*fraction = tMin;
+	}
+	return true;
+}
+
 #endif
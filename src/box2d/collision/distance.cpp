@@ -20,10 +20,13 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 // SOFTWARE.
 
+#include "shapes/capsule_shape.h"
 #include "shapes/circle_shape.h"
 #include "distance.h"
 #include "shapes/edge_shape.h"
 #include "shapes/chain_shape.h"
+#include "shapes/compound_shape.h"
+#include "shapes/grid_shape.h"
 #include "shapes/polygon_shape.h"
 
 // GJK using Voronoi regions (Christer Ericson) and Barycentric coordinates.
@@ -81,6 +84,49 @@ void b2DistanceProxy::Set(const b2Shape* shape, int32 index)
 		}
 		break;
 
+	case b2Shape::e_capsule:
+		{
+			const b2CapsuleShape* capsule = static_cast<const b2CapsuleShape*>(shape);
+			m_vertices = &capsule->m_vertex1;
+			m_count = 2;
+			m_radius = capsule->m_radius;
+		}
+		break;
+
+	case b2Shape::e_grid:
+		{
+			const b2GridShape* grid = static_cast<const b2GridShape*>(shape);
+			if (grid->IsHeightField())
+			{
+				b2EdgeShape edge;
+				grid->GetChildEdge(&edge, index);
+				m_buffer[0] = edge.m_vertex1;
+				m_buffer[1] = edge.m_vertex2;
+				m_count = 2;
+			}
+			else
+			{
+				b2PolygonShape box;
+				grid->GetChildBox(&box, index);
+				for (int32 i = 0; i < 4; ++i)
+				{
+					m_buffer[i] = box.m_vertices[i];
+				}
+				m_count = 4;
+			}
+
+			m_vertices = m_buffer;
+			m_radius = grid->m_radius;
+		}
+		break;
+
+	case b2Shape::e_compound:
+		{
+			const b2CompoundShape* compound = static_cast<const b2CompoundShape*>(shape);
+			Set(compound->GetChild(index), 0);
+		}
+		break;
+
 	default:
 		b2Assert(false);
 	}
@@ -378,13 +424,6 @@ void b2Simplex::Solve3()
 	float d23_1 = w3e23;
 	float d23_2 = -w2e23;
 	
-	// Triangle123
-	float n123 = b2Cross(e12, e13);
-
-	float d123_1 = n123 * b2Cross(w2, w3);
-	float d123_2 = n123 * b2Cross(w3, w1);
-	float d123_3 = n123 * b2Cross(w1, w2);
-
 	// w1 region
 	if (d12_2 <= 0.0f && d13_2 <= 0.0f)
 	{
@@ -393,8 +432,12 @@ void b2Simplex::Solve3()
 		return;
 	}
 
+	// Triangle123. Each edge test forms its cross product only once the edge
+	// coordinates pass, so the vertex regions mostly skip them.
+	float n123 = b2Cross(e12, e13);
+
 	// e12
-	if (d12_1 > 0.0f && d12_2 > 0.0f && d123_3 <= 0.0f)
+	if (d12_1 > 0.0f && d12_2 > 0.0f && n123 * b2Cross(w1, w2) <= 0.0f)
 	{
 		float inv_d12 = 1.0f / (d12_1 + d12_2);
 		m_v1.a = d12_1 * inv_d12;
@@ -404,7 +447,7 @@ void b2Simplex::Solve3()
 	}
 
 	// e13
-	if (d13_1 > 0.0f && d13_2 > 0.0f && d123_2 <= 0.0f)
+	if (d13_1 > 0.0f && d13_2 > 0.0f && n123 * b2Cross(w3, w1) <= 0.0f)
 	{
 		float inv_d13 = 1.0f / (d13_1 + d13_2);
 		m_v1.a = d13_1 * inv_d13;
@@ -433,7 +476,7 @@ void b2Simplex::Solve3()
 	}
 
 	// e23
-	if (d23_1 > 0.0f && d23_2 > 0.0f && d123_1 <= 0.0f)
+	if (d23_1 > 0.0f && d23_2 > 0.0f && n123 * b2Cross(w2, w3) <= 0.0f)
 	{
 		float inv_d23 = 1.0f / (d23_1 + d23_2);
 		m_v2.a = d23_1 * inv_d23;
@@ -444,6 +487,9 @@ void b2Simplex::Solve3()
 	}
 
 	// Must be in triangle123
+	float d123_1 = n123 * b2Cross(w2, w3);
+	float d123_2 = n123 * b2Cross(w3, w1);
+	float d123_3 = n123 * b2Cross(w1, w2);
 	float inv_d123 = 1.0f / (d123_1 + d123_2 + d123_3);
 	m_v1.a = d123_1 * inv_d123;
 	m_v2.a = d123_2 * inv_d123;
@@ -451,12 +497,10 @@ void b2Simplex::Solve3()
 	m_count = 3;
 }
 
-void b2Distance(b2DistanceOutput* output,
+void b2DistanceUncounted(b2DistanceOutput* output,
 				b2SimplexCache* cache,
 				const b2DistanceInput* input)
 {
-	++b2_gjkCalls;
-
 	const b2DistanceProxy* proxyA = &input->proxyA;
 	const b2DistanceProxy* proxyB = &input->proxyB;
 
@@ -536,7 +580,6 @@ void b2Distance(b2DistanceOutput* output,
 
 		// Iteration count is equated to the number of support point calls.
 		++iter;
-		++b2_gjkIters;
 
 		// Check for duplicate support points. This is the main termination criteria.
 		bool duplicate = false;
@@ -559,8 +602,6 @@ void b2Distance(b2DistanceOutput* output,
 		++simplex.m_count;
 	}
 
-	b2_gjkMaxIters = b2Max(b2_gjkMaxIters, iter);
-
 	// Prepare output.
 	simplex.GetWitnessPoints(&output->pointA, &output->pointB);
 	output->distance = b2Distance(output->pointA, output->pointB);
@@ -595,6 +636,17 @@ void b2Distance(b2DistanceOutput* output,
 	}
 }
 
+void b2Distance(b2DistanceOutput* output,
+				b2SimplexCache* cache,
+				const b2DistanceInput* input)
+{
+	b2DistanceUncounted(output, cache, input);
+
+	++b2_gjkCalls;
+	b2_gjkIters += output->iterations;
+	b2_gjkMaxIters = b2Max(b2_gjkMaxIters, output->iterations);
+}
+
 // GJK-raycast
 // Algorithm by Gino van den Bergen.
 // "Smooth Mesh Contacts with GJK" in Game Physics Pearls. 2010
@@ -54,7 +54,7 @@ struct B2_API b2DistanceProxy
 	/// Get a vertex by index. Used by b2Distance.
 	const b2Vec2& GetVertex(int32 index) const;
 
-	b2Vec2 m_buffer[2];
+	b2Vec2 m_buffer[4];
 	const b2Vec2* m_vertices;
 	int32 m_count;
 	float m_radius;
@@ -98,6 +98,12 @@ B2_API void b2Distance(b2DistanceOutput* output,
 				b2SimplexCache* cache,
 				const b2DistanceInput* input);
 
+/// The same as b2Distance but leaves the global GJK counters alone, so it is safe
+/// to call from threads that run alongside b2World::Step.
+B2_API void b2DistanceUncounted(b2DistanceOutput* output,
+				b2SimplexCache* cache,
+				const b2DistanceInput* input);
+
 /// Input parameters for b2ShapeCast
 struct B2_API b2ShapeCastInput
 {
@@ -153,19 +159,7 @@ inline int32 b2DistanceProxy::GetSupport(const b2Vec2& d) const
 
 inline const b2Vec2& b2DistanceProxy::GetSupportVertex(const b2Vec2& d) const
 {
-	int32 bestIndex = 0;
-	float bestValue = b2Dot(m_vertices[0], d);
-	for (int32 i = 1; i < m_count; ++i)
-	{
-		float value = b2Dot(m_vertices[i], d);
-		if (value > bestValue)
-		{
-			bestIndex = i;
-			bestValue = value;
-		}
-	}
-
-	return m_vertices[bestIndex];
+	return m_vertices[GetSupport(d)];
 }
 
 #endif
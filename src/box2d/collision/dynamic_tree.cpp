@@ -29,18 +29,29 @@ b2DynamicTree::b2DynamicTree()
 	m_nodeCapacity = 16;
 	m_nodeCount = 0;
 	m_nodes = (b2TreeNode*)b2Alloc(m_nodeCapacity * sizeof(b2TreeNode));
+	m_heights = (int32*)b2Alloc(m_nodeCapacity * sizeof(int32));
 	memset(m_nodes, 0, m_nodeCapacity * sizeof(b2TreeNode));
 
 	// Build a linked list for the free list.
 	for (int32 i = 0; i < m_nodeCapacity - 1; ++i)
 	{
 		m_nodes[i].next = i + 1;
-		m_nodes[i].height = -1;
+		m_heights[i] = -1;
 	}
 	m_nodes[m_nodeCapacity-1].next = b2_nullNode;
-	m_nodes[m_nodeCapacity-1].height = -1;
+	m_heights[m_nodeCapacity-1] = -1;
 	m_freeList = 0;
 
+	m_proxyCapacity = 16;
+	m_proxies = (b2TreeProxy*)b2Alloc(m_proxyCapacity * sizeof(b2TreeProxy));
+	memset(m_proxies, 0, m_proxyCapacity * sizeof(b2TreeProxy));
+	for (int32 i = 0; i < m_proxyCapacity - 1; ++i)
+	{
+		m_proxies[i].next = i + 1;
+	}
+	m_proxies[m_proxyCapacity-1].next = b2_nullNode;
+	m_freeProxy = 0;
+
 	m_insertionCount = 0;
 }
 
@@ -48,6 +59,8 @@ b2DynamicTree::~b2DynamicTree()
 {
 	// This frees the entire tree in one shot.
 	b2Free(m_nodes);
+	b2Free(m_heights);
+	b2Free(m_proxies);
 }
 
 // Allocate a node from the pool. Grow the pool if necessary.
@@ -60,20 +73,24 @@ int32 b2DynamicTree::AllocateNode()
 
 		// The free list is empty. Rebuild a bigger pool.
 		b2TreeNode* oldNodes = m_nodes;
+		int32* oldHeights = m_heights;
 		m_nodeCapacity *= 2;
 		m_nodes = (b2TreeNode*)b2Alloc(m_nodeCapacity * sizeof(b2TreeNode));
+		m_heights = (int32*)b2Alloc(m_nodeCapacity * sizeof(int32));
 		memcpy(m_nodes, oldNodes, m_nodeCount * sizeof(b2TreeNode));
+		memcpy(m_heights, oldHeights, m_nodeCount * sizeof(int32));
 		b2Free(oldNodes);
+		b2Free(oldHeights);
 
 		// Build a linked list for the free list. The parent
 		// pointer becomes the "next" pointer.
 		for (int32 i = m_nodeCount; i < m_nodeCapacity - 1; ++i)
 		{
 			m_nodes[i].next = i + 1;
-			m_nodes[i].height = -1;
+			m_heights[i] = -1;
 		}
 		m_nodes[m_nodeCapacity-1].next = b2_nullNode;
-		m_nodes[m_nodeCapacity-1].height = -1;
+		m_heights[m_nodeCapacity-1] = -1;
 		m_freeList = m_nodeCount;
 	}
 
@@ -83,9 +100,8 @@ int32 b2DynamicTree::AllocateNode()
 	m_nodes[nodeId].parent = b2_nullNode;
 	m_nodes[nodeId].child1 = b2_nullNode;
 	m_nodes[nodeId].child2 = b2_nullNode;
-	m_nodes[nodeId].height = 0;
-	m_nodes[nodeId].userData = nullptr;
-	m_nodes[nodeId].moved = false;
+	m_nodes[nodeId].proxyId = b2_nullNode;
+	m_heights[nodeId] = 0;
 	++m_nodeCount;
 	return nodeId;
 }
@@ -96,45 +112,91 @@ void b2DynamicTree::FreeNode(int32 nodeId)
 	b2Assert(0 <= nodeId && nodeId < m_nodeCapacity);
 	b2Assert(0 < m_nodeCount);
 	m_nodes[nodeId].next = m_freeList;
-	m_nodes[nodeId].height = -1;
+	m_nodes[nodeId].proxyId = b2_nullNode;
+	m_heights[nodeId] = -1;
 	m_freeList = nodeId;
 	--m_nodeCount;
 }
 
-// Create a proxy in the tree as a leaf node. We return the index
-// of the node instead of a pointer so that we can grow
-// the node pool.
+// Allocate a proxy id. Proxy ids are handed out independently of the nodes
+// so that Compact can move leaves around.
+int32 b2DynamicTree::AllocateProxy()
+{
+	if (m_freeProxy == b2_nullNode)
+	{
+		b2TreeProxy* oldProxies = m_proxies;
+		int32 oldCapacity = m_proxyCapacity;
+		m_proxyCapacity *= 2;
+		m_proxies = (b2TreeProxy*)b2Alloc(m_proxyCapacity * sizeof(b2TreeProxy));
+		memcpy(m_proxies, oldProxies, oldCapacity * sizeof(b2TreeProxy));
+		b2Free(oldProxies);
+
+		for (int32 i = oldCapacity; i < m_proxyCapacity - 1; ++i)
+		{
+			m_proxies[i].next = i + 1;
+		}
+		m_proxies[m_proxyCapacity-1].next = b2_nullNode;
+		m_freeProxy = oldCapacity;
+	}
+
+	int32 proxyId = m_freeProxy;
+	m_freeProxy = m_proxies[proxyId].next;
+	m_proxies[proxyId].node = b2_nullNode;
+	m_proxies[proxyId].userData = nullptr;
+	m_proxies[proxyId].moved = false;
+	return proxyId;
+}
+
+void b2DynamicTree::FreeProxy(int32 proxyId)
+{
+	b2Assert(0 <= proxyId && proxyId < m_proxyCapacity);
+	m_proxies[proxyId].next = m_freeProxy;
+	m_proxies[proxyId].userData = nullptr;
+	m_freeProxy = proxyId;
+}
+
+// Create a proxy in the tree as a leaf node. We return the proxy id
+// instead of a pointer so that we can grow and reorder the node pool.
 int32 b2DynamicTree::CreateProxy(const b2AABB& aabb, void* userData)
 {
-	int32 proxyId = AllocateNode();
+	int32 proxyId = AllocateProxy();
+	int32 leaf = AllocateNode();
 
 	// Fatten the aabb.
 	b2Vec2 r(b2_aabbExtension, b2_aabbExtension);
-	m_nodes[proxyId].aabb.lowerBound = aabb.lowerBound - r;
-	m_nodes[proxyId].aabb.upperBound = aabb.upperBound + r;
-	m_nodes[proxyId].userData = userData;
-	m_nodes[proxyId].height = 0;
-	m_nodes[proxyId].moved = true;
+	m_nodes[leaf].aabb.lowerBound = aabb.lowerBound - r;
+	m_nodes[leaf].aabb.upperBound = aabb.upperBound + r;
+	m_nodes[leaf].proxyId = proxyId;
+	m_heights[leaf] = 0;
 
-	InsertLeaf(proxyId);
+	m_proxies[proxyId].node = leaf;
+	m_proxies[proxyId].userData = userData;
+	m_proxies[proxyId].moved = true;
+
+	InsertLeaf(leaf);
 
 	return proxyId;
 }
 
 void b2DynamicTree::DestroyProxy(int32 proxyId)
 {
-	b2Assert(0 <= proxyId && proxyId < m_nodeCapacity);
-	b2Assert(m_nodes[proxyId].IsLeaf());
-
-	RemoveLeaf(proxyId);
-	FreeNode(proxyId);
+	b2Assert(0 <= proxyId && proxyId < m_proxyCapacity);
+	int32 leaf = m_proxies[proxyId].node;
+	b2Assert(0 <= leaf && leaf < m_nodeCapacity);
+	b2Assert(m_nodes[leaf].IsLeaf());
+
+	RemoveLeaf(leaf);
+	FreeNode(leaf);
+	FreeProxy(proxyId);
 }
 
 bool b2DynamicTree::MoveProxy(int32 proxyId, const b2AABB& aabb, const b2Vec2& displacement)
 {
-	b2Assert(0 <= proxyId && proxyId < m_nodeCapacity);
+	b2Assert(0 <= proxyId && proxyId < m_proxyCapacity);
+	int32 leaf = m_proxies[proxyId].node;
+	b2Assert(0 <= leaf && leaf < m_nodeCapacity);
 
-	b2Assert(m_nodes[proxyId].IsLeaf());
+	b2Assert(m_nodes[leaf].IsLeaf());
 
 	// Extend AABB
 	b2AABB fatAABB;
@@ -163,7 +225,7 @@ bool b2DynamicTree::MoveProxy(int32 proxyId, const b2AABB& aabb, const b2Vec2& d
 		fatAABB.upperBound.y += d.y;
 	}
 
-	const b2AABB& treeAABB = m_nodes[proxyId].aabb;
+	const b2AABB& treeAABB = m_nodes[leaf].aabb;
 	if (treeAABB.Contains(aabb))
 	{
 		// The tree AABB still contains the object, but it might be too large.
@@ -183,13 +245,13 @@ bool b2DynamicTree::MoveProxy(int32 proxyId, const b2AABB& aabb, const b2Vec2& d
 		// Otherwise the tree AABB is huge and needs to be shrunk
 	}
 
-	RemoveLeaf(proxyId);
+	RemoveLeaf(leaf);
 
-	m_nodes[proxyId].aabb = fatAABB;
+	m_nodes[leaf].aabb = fatAABB;
 
-	InsertLeaf(proxyId);
+	InsertLeaf(leaf);
 
-	m_nodes[proxyId].moved = true;
+	m_proxies[proxyId].moved = true;
 
 	return true;
 }
@@ -282,9 +344,8 @@ void b2DynamicTree::InsertLeaf(int32 leaf)
 	int32 oldParent = m_nodes[sibling].parent;
 	int32 newParent = AllocateNode();
 	m_nodes[newParent].parent = oldParent;
-	m_nodes[newParent].userData = nullptr;
 	m_nodes[newParent].aabb.Combine(leafAABB, m_nodes[sibling].aabb);
-	m_nodes[newParent].height = m_nodes[sibling].height + 1;
+	m_heights[newParent] = m_heights[sibling] + 1;
 
 	if (oldParent != b2_nullNode)
 	{
@@ -325,7 +386,7 @@ void b2DynamicTree::InsertLeaf(int32 leaf)
 		b2Assert(child1 != b2_nullNode);
 		b2Assert(child2 != b2_nullNode);
 
-		m_nodes[index].height = 1 + b2Max(m_nodes[child1].height, m_nodes[child2].height);
+		m_heights[index] = 1 + b2Max(m_heights[child1], m_heights[child2]);
 		m_nodes[index].aabb.Combine(m_nodes[child1].aabb, m_nodes[child2].aabb);
 
 		index = m_nodes[index].parent;
@@ -378,7 +439,7 @@ void b2DynamicTree::RemoveLeaf(int32 leaf)
 			int32 child2 = m_nodes[index].child2;
 
 			m_nodes[index].aabb.Combine(m_nodes[child1].aabb, m_nodes[child2].aabb);
-			m_nodes[index].height = 1 + b2Max(m_nodes[child1].height, m_nodes[child2].height);
+			m_heights[index] = 1 + b2Max(m_heights[child1], m_heights[child2]);
 
 			index = m_nodes[index].parent;
 		}
@@ -400,7 +461,7 @@ int32 b2DynamicTree::Balance(int32 iA)
 	b2Assert(iA != b2_nullNode);
 
 	b2TreeNode* A = m_nodes + iA;
-	if (A->IsLeaf() || A->height < 2)
+	if (A->IsLeaf() || m_heights[iA] < 2)
 	{
 		return iA;
 	}
@@ -413,7 +474,7 @@ int32 b2DynamicTree::Balance(int32 iA)
 	b2TreeNode* B = m_nodes + iB;
 	b2TreeNode* C = m_nodes + iC;
 
-	int32 balance = C->height - B->height;
+	int32 balance = m_heights[iC] - m_heights[iB];
 
 	// Rotate C up
 	if (balance > 1)
@@ -449,7 +510,7 @@ int32 b2DynamicTree::Balance(int32 iA)
 		}
 
 		// Rotate
-		if (F->height > G->height)
+		if (m_heights[iF] > m_heights[iG])
 		{
 			C->child2 = iF;
 			A->child2 = iG;
@@ -457,8 +518,8 @@ int32 b2DynamicTree::Balance(int32 iA)
 			A->aabb.Combine(B->aabb, G->aabb);
 			C->aabb.Combine(A->aabb, F->aabb);
 
-			A->height = 1 + b2Max(B->height, G->height);
-			C->height = 1 + b2Max(A->height, F->height);
+			m_heights[iA] = 1 + b2Max(m_heights[iB], m_heights[iG]);
+			m_heights[iC] = 1 + b2Max(m_heights[iA], m_heights[iF]);
 		}
 		else
 		{
@@ -468,8 +529,8 @@ int32 b2DynamicTree::Balance(int32 iA)
 			A->aabb.Combine(B->aabb, F->aabb);
 			C->aabb.Combine(A->aabb, G->aabb);
 
-			A->height = 1 + b2Max(B->height, F->height);
-			C->height = 1 + b2Max(A->height, G->height);
+			m_heights[iA] = 1 + b2Max(m_heights[iB], m_heights[iF]);
+			m_heights[iC] = 1 + b2Max(m_heights[iA], m_heights[iG]);
 		}
 
 		return iC;
@@ -509,7 +570,7 @@ int32 b2DynamicTree::Balance(int32 iA)
 		}
 
 		// Rotate
-		if (D->height > E->height)
+		if (m_heights[iD] > m_heights[iE])
 		{
 			B->child2 = iD;
 			A->child1 = iE;
@@ -517,8 +578,8 @@ int32 b2DynamicTree::Balance(int32 iA)
 			A->aabb.Combine(C->aabb, E->aabb);
 			B->aabb.Combine(A->aabb, D->aabb);
 
-			A->height = 1 + b2Max(C->height, E->height);
-			B->height = 1 + b2Max(A->height, D->height);
+			m_heights[iA] = 1 + b2Max(m_heights[iC], m_heights[iE]);
+			m_heights[iB] = 1 + b2Max(m_heights[iA], m_heights[iD]);
 		}
 		else
 		{
@@ -528,8 +589,8 @@ int32 b2DynamicTree::Balance(int32 iA)
 			A->aabb.Combine(C->aabb, D->aabb);
 			B->aabb.Combine(A->aabb, E->aabb);
 
-			A->height = 1 + b2Max(C->height, D->height);
-			B->height = 1 + b2Max(A->height, E->height);
+			m_heights[iA] = 1 + b2Max(m_heights[iC], m_heights[iD]);
+			m_heights[iB] = 1 + b2Max(m_heights[iA], m_heights[iE]);
 		}
 
 		return iB;
@@ -545,7 +606,7 @@ int32 b2DynamicTree::GetHeight() const
 		return 0;
 	}
 
-	return m_nodes[m_root].height;
+	return m_heights[m_root];
 }
 
 //
@@ -562,14 +623,13 @@ float b2DynamicTree::GetAreaRatio() const
 	float totalArea = 0.0f;
 	for (int32 i = 0; i < m_nodeCapacity; ++i)
 	{
-		const b2TreeNode* node = m_nodes + i;
-		if (node->height < 0)
+		if (m_heights[i] < 0)
 		{
 			// Free node in pool
 			continue;
 		}
 
-		totalArea += node->aabb.GetPerimeter();
+		totalArea += m_nodes[i].aabb.GetPerimeter();
 	}
 
 	return totalArea / rootArea;
@@ -618,10 +678,13 @@ void b2DynamicTree::ValidateStructure(int32 index) const
 	{
 		b2Assert(child1 == b2_nullNode);
 		b2Assert(child2 == b2_nullNode);
-		b2Assert(node->height == 0);
+		b2Assert(m_heights[index] == 0);
+		b2Assert(0 <= node->proxyId && node->proxyId < m_proxyCapacity);
+		b2Assert(m_proxies[node->proxyId].node == index);
 		return;
 	}
 
+	b2Assert(node->proxyId == b2_nullNode);
 	b2Assert(0 <= child1 && child1 < m_nodeCapacity);
 	b2Assert(0 <= child2 && child2 < m_nodeCapacity);
 
@@ -648,18 +711,18 @@ void b2DynamicTree::ValidateMetrics(int32 index) const
 	{
 		b2Assert(child1 == b2_nullNode);
 		b2Assert(child2 == b2_nullNode);
-		b2Assert(node->height == 0);
+		b2Assert(m_heights[index] == 0);
 		return;
 	}
 
 	b2Assert(0 <= child1 && child1 < m_nodeCapacity);
 	b2Assert(0 <= child2 && child2 < m_nodeCapacity);
 
-	int32 height1 = m_nodes[child1].height;
-	int32 height2 = m_nodes[child2].height;
+	int32 height1 = m_heights[child1];
+	int32 height2 = m_heights[child2];
 	int32 height;
 	height = 1 + b2Max(height1, height2);
-	b2Assert(node->height == height);
+	b2Assert(m_heights[index] == height);
 
 	b2AABB aabb;
 	aabb.Combine(m_nodes[child1].aabb, m_nodes[child2].aabb);
@@ -698,7 +761,7 @@ int32 b2DynamicTree::GetMaxBalance() const
 	for (int32 i = 0; i < m_nodeCapacity; ++i)
 	{
 		const b2TreeNode* node = m_nodes + i;
-		if (node->height <= 1)
+		if (m_heights[i] <= 1)
 		{
 			continue;
 		}
@@ -707,7 +770,7 @@ int32 b2DynamicTree::GetMaxBalance() const
 
 		int32 child1 = node->child1;
 		int32 child2 = node->child2;
-		int32 balance = b2Abs(m_nodes[child2].height - m_nodes[child1].height);
+		int32 balance = b2Abs(m_heights[child2] - m_heights[child1]);
 		maxBalance = b2Max(maxBalance, balance);
 	}
 
@@ -722,7 +785,7 @@ void b2DynamicTree::RebuildBottomUp()
 	// Build array of leaves. Free the rest.
 	for (int32 i = 0; i < m_nodeCapacity; ++i)
 	{
-		if (m_nodes[i].height < 0)
+		if (m_heights[i] < 0)
 		{
 			// free node in pool
 			continue;
@@ -772,7 +835,7 @@ void b2DynamicTree::RebuildBottomUp()
 		b2TreeNode* parent = m_nodes + parentIndex;
 		parent->child1 = index1;
 		parent->child2 = index2;
-		parent->height = 1 + b2Max(child1->height, child2->height);
+		m_heights[parentIndex] = 1 + b2Max(m_heights[index1], m_heights[index2]);
 		parent->aabb.Combine(child1->aabb, child2->aabb);
 		parent->parent = b2_nullNode;
 
@@ -790,6 +853,89 @@ void b2DynamicTree::RebuildBottomUp()
 	Validate();
 }
 
+void b2DynamicTree::Compact()
+{
+	if (m_root == b2_nullNode)
+	{
+		return;
+	}
+
+	// Assign new indices in pre-order. Child2 is pushed first so that child1
+	// is visited next and lands right after its parent.
+	int32* remap = (int32*)b2Alloc(m_nodeCapacity * sizeof(int32));
+	int32 count = 0;
+
+	b2GrowableStack<int32, 256> stack;
+	stack.Push(m_root);
+	while (stack.GetCount() > 0)
+	{
+		int32 nodeId = stack.Pop();
+		remap[nodeId] = count;
+		++count;
+
+		const b2TreeNode* node = m_nodes + nodeId;
+		if (node->IsLeaf() == false)
+		{
+			stack.Push(node->child2);
+			stack.Push(node->child1);
+		}
+	}
+
+	b2Assert(count == m_nodeCount);
+
+	b2TreeNode* nodes = (b2TreeNode*)b2Alloc(m_nodeCapacity * sizeof(b2TreeNode));
+	int32* heights = (int32*)b2Alloc(m_nodeCapacity * sizeof(int32));
+
+	for (int32 i = 0; i < m_nodeCapacity; ++i)
+	{
+		if (m_heights[i] < 0)
+		{
+			// free node in pool
+			continue;
+		}
+
+		const b2TreeNode* node = m_nodes + i;
+		int32 index = remap[i];
+		b2TreeNode* newNode = nodes + index;
+
+		newNode->aabb = node->aabb;
+		newNode->parent = node->parent == b2_nullNode ? b2_nullNode : remap[node->parent];
+		newNode->proxyId = node->proxyId;
+		heights[index] = m_heights[i];
+
+		if (node->IsLeaf())
+		{
+			newNode->child1 = b2_nullNode;
+			newNode->child2 = b2_nullNode;
+			m_proxies[node->proxyId].node = index;
+		}
+		else
+		{
+			newNode->child1 = remap[node->child1];
+			newNode->child2 = remap[node->child2];
+		}
+	}
+
+	// The free nodes are packed at the end of the pool.
+	for (int32 i = count; i < m_nodeCapacity; ++i)
+	{
+		nodes[i].next = i + 1 < m_nodeCapacity ? i + 1 : b2_nullNode;
+		nodes[i].proxyId = b2_nullNode;
+		heights[i] = -1;
+	}
+	m_freeList = count < m_nodeCapacity ? count : b2_nullNode;
+
+	m_root = remap[m_root];
+
+	b2Free(remap);
+	b2Free(m_nodes);
+	b2Free(m_heights);
+	m_nodes = nodes;
+	m_heights = heights;
+
+	Validate();
+}
+
 void b2DynamicTree::ShiftOrigin(const b2Vec2& newOrigin)
 {
 	// Build array of leaves. Free the rest.
@@ -30,6 +30,8 @@
 #define b2_nullNode (-1)
 
 /// A node in the dynamic tree. The client does not interact with this directly.
+/// Only the data touched during traversal is stored here so that two nodes fit
+/// in a cache line. Heights and proxy data live in parallel arrays.
 struct B2_API b2TreeNode
 {
 	bool IsLeaf() const
@@ -40,8 +42,6 @@ struct B2_API b2TreeNode
 	/// Enlarged AABB
 	b2AABB aabb;
 
-	void* userData;
-
 	union
 	{
 		int32 parent;
@@ -51,8 +51,21 @@ struct B2_API b2TreeNode
 	int32 child1;
 	int32 child2;
 
-	// leaf = 0, free node = -1
-	int32 height;
+	// leaf = proxy id, internal or free node = b2_nullNode
+	int32 proxyId;
+};
+
+/// Proxy data for a leaf of the dynamic tree. Proxy ids index this table rather
+/// than the node pool, so they remain valid when the nodes are reordered.
+struct B2_API b2TreeProxy
+{
+	void* userData;
+
+	union
+	{
+		int32 node;
+		int32 next;
+	};
 
 	bool moved;
 };
@@ -111,6 +124,13 @@ public:
 	template <typename T>
 	void RayCast(T* callback, const b2RayCastInput& input) const;
 
+	/// Find the overlaps between the leaves of this tree and the leaves of another
+	/// hierarchy using a simultaneous descent of both. The other hierarchy is given as
+	/// an array of nodes with the leaf proxy ids in b2TreeNode::proxyId. The callback
+	/// class is called with the other proxy id and the proxy id of this tree.
+	template <typename T>
+	void QueryTree(T* callback, const b2TreeNode* nodes, int32 root) const;
+
 	/// Validate this tree. For testing.
 	void Validate() const;
 
@@ -128,6 +148,12 @@ public:
 	/// Build an optimal tree. Very expensive. For testing.
 	void RebuildBottomUp();
 
+	/// Reorder the node pool depth-first so that a parent is followed by its first
+	/// child in memory. Insertions and removals scatter nodes over the pool, so call
+	/// this after heavy churn to make traversals touch fewer cache lines. Proxy ids
+	/// are not affected. This is O(n).
+	void Compact();
+
 	/// Shift the world origin. Useful for large worlds.
 	/// The shift formula is: position -= newOrigin
 	/// @param newOrigin the new origin with respect to the old origin
@@ -138,6 +164,9 @@ private:
 	int32 AllocateNode();
 	void FreeNode(int32 node);
 
+	int32 AllocateProxy();
+	void FreeProxy(int32 proxyId);
+
 	void InsertLeaf(int32 node);
 	void RemoveLeaf(int32 node);
 
@@ -152,36 +181,41 @@ private:
 	int32 m_root;
 
 	b2TreeNode* m_nodes;
+	int32* m_heights;
 	int32 m_nodeCount;
 	int32 m_nodeCapacity;
 
 	int32 m_freeList;
 
+	b2TreeProxy* m_proxies;
+	int32 m_proxyCapacity;
+	int32 m_freeProxy;
+
 	int32 m_insertionCount;
 };
 
 inline void* b2DynamicTree::GetUserData(int32 proxyId) const
 {
-	b2Assert(0 <= proxyId && proxyId < m_nodeCapacity);
-	return m_nodes[proxyId].userData;
+	b2Assert(0 <= proxyId && proxyId < m_proxyCapacity);
+	return m_proxies[proxyId].userData;
 }
 
 inline bool b2DynamicTree::WasMoved(int32 proxyId) const
 {
-	b2Assert(0 <= proxyId && proxyId < m_nodeCapacity);
-	return m_nodes[proxyId].moved;
+	b2Assert(0 <= proxyId && proxyId < m_proxyCapacity);
+	return m_proxies[proxyId].moved;
 }
 
 inline void b2DynamicTree::ClearMoved(int32 proxyId)
 {
-	b2Assert(0 <= proxyId && proxyId < m_nodeCapacity);
-	m_nodes[proxyId].moved = false;
+	b2Assert(0 <= proxyId && proxyId < m_proxyCapacity);
+	m_proxies[proxyId].moved = false;
 }
 
 inline const b2AABB& b2DynamicTree::GetFatAABB(int32 proxyId) const
 {
-	b2Assert(0 <= proxyId && proxyId < m_nodeCapacity);
-	return m_nodes[proxyId].aabb;
+	b2Assert(0 <= proxyId && proxyId < m_proxyCapacity);
+	return m_nodes[m_proxies[proxyId].node].aabb;
 }
 
 template <typename T>
@@ -204,7 +238,7 @@ inline void b2DynamicTree::Query(T* callback, const b2AABB& aabb) const
 		{
 			if (node->IsLeaf())
 			{
-				bool proceed = callback->QueryCallback(nodeId);
+				bool proceed = callback->QueryCallback(node->proxyId);
 				if (proceed == false)
 				{
 					return;
@@ -212,10 +246,73 @@ inline void b2DynamicTree::Query(T* callback, const b2AABB& aabb) const
 			}
 			else
 			{
-				stack.Push(node->child1);
+				// Visit child1 first. After Compact it is the next node in memory.
 				stack.Push(node->child2);
+				stack.Push(node->child1);
+			}
+		}
+	}
+}
+
+template <typename T>
+inline void b2DynamicTree::QueryTree(T* callback, const b2TreeNode* nodes, int32 root) const
+{
+	if (m_root == b2_nullNode || root == b2_nullNode)
+	{
+		return;
+	}
+
+	struct StackEntry
+	{
+		int32 nodeA;
+		int32 nodeB;
+	};
+
+	b2GrowableStack<StackEntry, 256> stack;
+	StackEntry entry;
+	entry.nodeA = m_root;
+	entry.nodeB = root;
+	stack.Push(entry);
+
+	while (stack.GetCount() > 0)
+	{
+		entry = stack.Pop();
+
+		const b2TreeNode* nodeA = m_nodes + entry.nodeA;
+		const b2TreeNode* nodeB = nodes + entry.nodeB;
+
+		if (b2TestOverlap(nodeA->aabb, nodeB->aabb) == false)
+		{
+			continue;
+		}
+
+		bool leafA = nodeA->IsLeaf();
+		bool leafB = nodeB->IsLeaf();
+		if (leafA && leafB)
+		{
+			bool proceed = callback->PairCallback(nodeB->proxyId, nodeA->proxyId);
+			if (proceed == false)
+			{
+				return;
 			}
 		}
+		else if (leafB || (leafA == false && nodeA->aabb.GetPerimeter() >= nodeB->aabb.GetPerimeter()))
+		{
+			// Descend into the larger node.
+			StackEntry child = entry;
+			child.nodeA = nodeA->child2;
+			stack.Push(child);
+			child.nodeA = nodeA->child1;
+			stack.Push(child);
+		}
+		else
+		{
+			StackEntry child = entry;
+			child.nodeB = nodeB->child2;
+			stack.Push(child);
+			child.nodeB = nodeB->child1;
+			stack.Push(child);
+		}
 	}
 }
 
@@ -280,7 +377,7 @@ inline void b2DynamicTree::RayCast(T* callback, const b2RayCastInput& input) con
 			subInput.p2 = input.p2;
 			subInput.maxFraction = maxFraction;
 
-			float value = callback->RayCastCallback(subInput, nodeId);
+			float value = callback->RayCastCallback(subInput, node->proxyId);
 
 			if (value == 0.0f)
 			{
@@ -299,8 +396,8 @@ inline void b2DynamicTree::RayCast(T* callback, const b2RayCastInput& input) con
 		}
 		else
 		{
-			stack.Push(node->child1);
 			stack.Push(node->child2);
+			stack.Push(node->child1);
 		}
 	}
 }
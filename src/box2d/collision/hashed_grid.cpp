@@ -0,0 +1,272 @@
+// MIT License
+
+// Copyright (c) 2019 Erin Catto
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include "hashed_grid.h"
+#include <string.h>
+
+b2HashedGrid::b2HashedGrid()
+{
+	m_proxyCapacity = 16;
+	m_proxyCount = 0;
+	m_proxies = (b2GridProxy*)b2Alloc(m_proxyCapacity * sizeof(b2GridProxy));
+	memset(m_proxies, 0, m_proxyCapacity * sizeof(b2GridProxy));
+	for (int32 i = 0; i < m_proxyCapacity - 1; ++i)
+	{
+		m_proxies[i].level = b2_nullNode;
+		m_proxies[i].next = i + 1;
+	}
+	m_proxies[m_proxyCapacity-1].level = b2_nullNode;
+	m_proxies[m_proxyCapacity-1].next = b2_nullNode;
+	m_freeProxy = 0;
+
+	m_bucketCount = 16;
+	m_buckets = (int32*)b2Alloc(m_bucketCount * sizeof(int32));
+	for (int32 i = 0; i < m_bucketCount; ++i)
+	{
+		m_buckets[i] = b2_nullNode;
+	}
+
+	m_oversized = b2_nullNode;
+
+	for (int32 i = 0; i < b2_gridLevelCount; ++i)
+	{
+		m_levelCounts[i] = 0;
+	}
+
+	m_cellSize = 1.0f;
+}
+
+b2HashedGrid::~b2HashedGrid()
+{
+	b2Free(m_proxies);
+	b2Free(m_buckets);
+}
+
+void b2HashedGrid::SetCellSize(float size)
+{
+	b2Assert(m_proxyCount == 0);
+	b2Assert(b2IsValid(size) && size > 0.0f);
+	m_cellSize = size;
+}
+
+int32 b2HashedGrid::CreateProxy(const b2AABB& aabb, void* userData)
+{
+	if (m_freeProxy == b2_nullNode)
+	{
+		b2GridProxy* oldProxies = m_proxies;
+		int32 oldCapacity = m_proxyCapacity;
+		m_proxyCapacity *= 2;
+		m_proxies = (b2GridProxy*)b2Alloc(m_proxyCapacity * sizeof(b2GridProxy));
+		memcpy(m_proxies, oldProxies, oldCapacity * sizeof(b2GridProxy));
+		memset(m_proxies + oldCapacity, 0, (m_proxyCapacity - oldCapacity) * sizeof(b2GridProxy));
+		b2Free(oldProxies);
+
+		for (int32 i = oldCapacity; i < m_proxyCapacity - 1; ++i)
+		{
+			m_proxies[i].level = b2_nullNode;
+			m_proxies[i].next = i + 1;
+		}
+		m_proxies[m_proxyCapacity-1].level = b2_nullNode;
+		m_proxies[m_proxyCapacity-1].next = b2_nullNode;
+		m_freeProxy = oldCapacity;
+	}
+
+	int32 proxyId = m_freeProxy;
+	b2GridProxy* proxy = m_proxies + proxyId;
+	m_freeProxy = proxy->next;
+
+	// Fatten the aabb.
+	b2Vec2 r(b2_aabbExtension, b2_aabbExtension);
+	proxy->aabb.lowerBound = aabb.lowerBound - r;
+	proxy->aabb.upperBound = aabb.upperBound + r;
+	proxy->userData = userData;
+	proxy->moved = true;
+	++m_proxyCount;
+
+	// Keep the load factor of the bucket table at or below one.
+	if (m_proxyCount > m_bucketCount)
+	{
+		Rehash(2 * m_bucketCount);
+	}
+
+	Insert(proxyId);
+
+	return proxyId;
+}
+
+void b2HashedGrid::DestroyProxy(int32 proxyId)
+{
+	b2Assert(0 <= proxyId && proxyId < m_proxyCapacity);
+	b2GridProxy* proxy = m_proxies + proxyId;
+	b2Assert(proxy->level != b2_nullNode);
+
+	Remove(proxyId);
+
+	proxy->userData = nullptr;
+	proxy->level = b2_nullNode;
+	proxy->moved = false;
+	proxy->next = m_freeProxy;
+	m_freeProxy = proxyId;
+	--m_proxyCount;
+}
+
+bool b2HashedGrid::MoveProxy(int32 proxyId, const b2AABB& aabb, const b2Vec2& displacement)
+{
+	b2Assert(0 <= proxyId && proxyId < m_proxyCapacity);
+	b2GridProxy* proxy = m_proxies + proxyId;
+	b2Assert(proxy->level != b2_nullNode);
+
+	// Use the same enlargement policy as b2DynamicTree::MoveProxy.
+	b2AABB fatAABB;
+	b2Vec2 r(b2_aabbExtension, b2_aabbExtension);
+	fatAABB.lowerBound = aabb.lowerBound - r;
+	fatAABB.upperBound = aabb.upperBound + r;
+
+	b2Vec2 d = b2_aabbMultiplier * displacement;
+	fatAABB.lowerBound += b2Min(d, b2Vec2_zero);
+	fatAABB.upperBound += b2Max(d, b2Vec2_zero);
+
+	if (proxy->aabb.Contains(aabb))
+	{
+		b2AABB hugeAABB;
+		hugeAABB.lowerBound = fatAABB.lowerBound - 4.0f * r;
+		hugeAABB.upperBound = fatAABB.upperBound + 4.0f * r;
+
+		if (hugeAABB.Contains(proxy->aabb))
+		{
+			return false;
+		}
+	}
+
+	Remove(proxyId);
+	proxy->aabb = fatAABB;
+	Insert(proxyId);
+
+	proxy->moved = true;
+
+	return true;
+}
+
+void b2HashedGrid::Insert(int32 proxyId)
+{
+	b2GridProxy* proxy = m_proxies + proxyId;
+
+	// Find the finest level with cells at least as large as the proxy.
+	b2Vec2 extents = proxy->aabb.upperBound - proxy->aabb.lowerBound;
+	float extent = b2Max(extents.x, extents.y);
+	float size = m_cellSize;
+	int32 level = 0;
+	while (level < b2_gridLevelCount && extent > size)
+	{
+		size *= 2.0f;
+		++level;
+	}
+
+	proxy->level = level;
+
+	if (level == b2_gridLevelCount)
+	{
+		proxy->x = 0;
+		proxy->y = 0;
+		proxy->next = m_oversized;
+		m_oversized = proxyId;
+		return;
+	}
+
+	float inverseSize = 1.0f / size;
+	proxy->x = GetCell(proxy->aabb.lowerBound.x, inverseSize);
+	proxy->y = GetCell(proxy->aabb.lowerBound.y, inverseSize);
+
+	int32 bucket = GetBucket(level, proxy->x, proxy->y);
+	proxy->next = m_buckets[bucket];
+	m_buckets[bucket] = proxyId;
+	++m_levelCounts[level];
+}
+
+void b2HashedGrid::Remove(int32 proxyId)
+{
+	b2GridProxy* proxy = m_proxies + proxyId;
+
+	int32* link;
+	if (proxy->level == b2_gridLevelCount)
+	{
+		link = &m_oversized;
+	}
+	else
+	{
+		link = m_buckets + GetBucket(proxy->level, proxy->x, proxy->y);
+		--m_levelCounts[proxy->level];
+	}
+
+	// Buckets are short, so a singly linked list is enough.
+	while (*link != proxyId)
+	{
+		b2Assert(*link != b2_nullNode);
+		link = &m_proxies[*link].next;
+	}
+
+	*link = proxy->next;
+	proxy->next = b2_nullNode;
+}
+
+void b2HashedGrid::Rehash(int32 bucketCount)
+{
+	b2Assert((bucketCount & (bucketCount - 1)) == 0);
+
+	b2Free(m_buckets);
+	m_bucketCount = bucketCount;
+	m_buckets = (int32*)b2Alloc(m_bucketCount * sizeof(int32));
+	for (int32 i = 0; i < m_bucketCount; ++i)
+	{
+		m_buckets[i] = b2_nullNode;
+	}
+
+	m_oversized = b2_nullNode;
+
+	for (int32 i = 0; i < b2_gridLevelCount; ++i)
+	{
+		m_levelCounts[i] = 0;
+	}
+
+	for (int32 i = 0; i < m_proxyCapacity; ++i)
+	{
+		if (m_proxies[i].level != b2_nullNode)
+		{
+			Insert(i);
+		}
+	}
+}
+
+void b2HashedGrid::ShiftOrigin(const b2Vec2& newOrigin)
+{
+	for (int32 i = 0; i < m_proxyCapacity; ++i)
+	{
+		if (m_proxies[i].level != b2_nullNode)
+		{
+			m_proxies[i].aabb.lowerBound -= newOrigin;
+			m_proxies[i].aabb.upperBound -= newOrigin;
+		}
+	}
+
+	Rehash(m_bucketCount);
+}
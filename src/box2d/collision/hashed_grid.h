@@ -0,0 +1,350 @@
+// MIT License
+
+// Copyright (c) 2019 Erin Catto
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#ifndef B2_HASHED_GRID_H
+#define B2_HASHED_GRID_H
+
+#include "box2d/api.h"
+#include "collision.h"
+#include "dynamic_tree.h"
+
+/// Number of grid levels. The cell size doubles from one level to the next.
+#define b2_gridLevelCount 16
+
+/// Proxy data for the hashed grid.
+struct B2_API b2GridProxy
+{
+	/// Enlarged AABB
+	b2AABB aabb;
+
+	void* userData;
+
+	// Cell of the lower bound on the proxy level.
+	int32 x, y;
+
+	// b2_gridLevelCount if the proxy is too large for the grid, b2_nullNode if free
+	int32 level;
+
+	// Next proxy in the same bucket or in the free list
+	int32 next;
+
+	bool moved;
+};
+
+/// A multi-level hashed grid. Each proxy is stored in a single cell on the level where
+/// the cells are at least as large as the proxy, so a proxy spans at most two cells
+/// per axis and a query only has to look one cell beyond its lower bound. Cells are
+/// hashed into a bucket table, so the grid is unbounded and empty space costs nothing.
+/// The grid suits many similarly sized objects in a bounded area, where it avoids the
+/// tree updates of b2DynamicTree. It has the same proxy interface as b2DynamicTree.
+class B2_API b2HashedGrid
+{
+public:
+	b2HashedGrid();
+	~b2HashedGrid();
+
+	/// Set the cell size of the finest level. The grid must be empty.
+	void SetCellSize(float size);
+
+	/// Get the cell size of the finest level.
+	float GetCellSize() const;
+
+	/// Create a proxy. Provide a tight fitting AABB and a userData pointer.
+	int32 CreateProxy(const b2AABB& aabb, void* userData);
+
+	/// Destroy a proxy. This asserts if the id is invalid.
+	void DestroyProxy(int32 proxyId);
+
+	/// Move a proxy with a swepted AABB. If the proxy has moved outside of its fattened AABB,
+	/// then the proxy is moved to its new cell.
+	/// @return true if the fat AABB changed.
+	bool MoveProxy(int32 proxyId, const b2AABB& aabb1, const b2Vec2& displacement);
+
+	/// Get proxy user data.
+	void* GetUserData(int32 proxyId) const;
+
+	bool WasMoved(int32 proxyId) const;
+	void ClearMoved(int32 proxyId);
+
+	/// Get the fat AABB for a proxy.
+	const b2AABB& GetFatAABB(int32 proxyId) const;
+
+	/// Get the number of proxies in the grid.
+	int32 GetProxyCount() const;
+
+	/// Query an AABB for overlapping proxies. The callback class
+	/// is called for each proxy that overlaps the supplied AABB.
+	template <typename T>
+	void Query(T* callback, const b2AABB& aabb) const;
+
+	/// Ray-cast against the proxies in the grid. See b2DynamicTree::RayCast.
+	/// Proxies are not reported in order along the ray.
+	template <typename T>
+	void RayCast(T* callback, const b2RayCastInput& input) const;
+
+	/// Shift the world origin. This rehashes all proxies.
+	void ShiftOrigin(const b2Vec2& newOrigin);
+
+private:
+
+	template <typename T>
+	friend struct b2GridRayCastCallback;
+
+	void Insert(int32 proxyId);
+	void Remove(int32 proxyId);
+	void Rehash(int32 bucketCount);
+
+	int32 GetBucket(int32 level, int32 x, int32 y) const;
+	static int32 GetCell(float value, float inverseSize);
+
+	b2GridProxy* m_proxies;
+	int32 m_proxyCount;
+	int32 m_proxyCapacity;
+	int32 m_freeProxy;
+
+	// Bucket heads, the count is a power of two.
+	int32* m_buckets;
+	int32 m_bucketCount;
+
+	// Proxies larger than the cells of the coarsest level.
+	int32 m_oversized;
+
+	int32 m_levelCounts[b2_gridLevelCount];
+	float m_cellSize;
+};
+
+/// Clips and filters the candidates of a grid ray cast. Used internally by b2HashedGrid.
+template <typename T>
+struct b2GridRayCastCallback
+{
+	bool QueryCallback(int32 proxyId)
+	{
+		const b2AABB& aabb = grid->m_proxies[proxyId].aabb;
+		if (b2TestOverlap(aabb, segmentAABB) == false)
+		{
+			return true;
+		}
+
+		// Separating axis for segment (Gino, p80).
+		// |dot(v, p1 - c)| > dot(|v|, h)
+		b2Vec2 c = aabb.GetCenter();
+		b2Vec2 h = aabb.GetExtents();
+		float separation = b2Abs(b2Dot(v, input.p1 - c)) - b2Dot(b2Abs(v), h);
+		if (separation > 0.0f)
+		{
+			return true;
+		}
+
+		float value = callback->RayCastCallback(input, proxyId);
+
+		if (value == 0.0f)
+		{
+			// The client has terminated the ray cast.
+			return false;
+		}
+
+		if (value > 0.0f)
+		{
+			// Update segment bounding box.
+			input.maxFraction = value;
+			b2Vec2 t = input.p1 + value * (input.p2 - input.p1);
+			segmentAABB.lowerBound = b2Min(input.p1, t);
+			segmentAABB.upperBound = b2Max(input.p1, t);
+		}
+
+		return true;
+	}
+
+	T* callback;
+	const b2HashedGrid* grid;
+	b2RayCastInput input;
+	b2AABB segmentAABB;
+	b2Vec2 v;
+};
+
+inline float b2HashedGrid::GetCellSize() const
+{
+	return m_cellSize;
+}
+
+inline void* b2HashedGrid::GetUserData(int32 proxyId) const
+{
+	b2Assert(0 <= proxyId && proxyId < m_proxyCapacity);
+	return m_proxies[proxyId].userData;
+}
+
+inline bool b2HashedGrid::WasMoved(int32 proxyId) const
+{
+	b2Assert(0 <= proxyId && proxyId < m_proxyCapacity);
+	return m_proxies[proxyId].moved;
+}
+
+inline void b2HashedGrid::ClearMoved(int32 proxyId)
+{
+	b2Assert(0 <= proxyId && proxyId < m_proxyCapacity);
+	m_proxies[proxyId].moved = false;
+}
+
+inline const b2AABB& b2HashedGrid::GetFatAABB(int32 proxyId) const
+{
+	b2Assert(0 <= proxyId && proxyId < m_proxyCapacity);
+	return m_proxies[proxyId].aabb;
+}
+
+inline int32 b2HashedGrid::GetProxyCount() const
+{
+	return m_proxyCount;
+}
+
+inline int32 b2HashedGrid::GetBucket(int32 level, int32 x, int32 y) const
+{
+	uint32 hash = (uint32(x) * 73856093u) ^ (uint32(y) * 19349663u) ^ (uint32(level) * 83492791u);
+	return int32(hash & uint32(m_bucketCount - 1));
+}
+
+inline int32 b2HashedGrid::GetCell(float value, float inverseSize)
+{
+	// Clamp so that far away proxies don't overflow the cell coordinates.
+	float cell = floorf(value * inverseSize);
+	return int32(b2Clamp(cell, -1.0e9f, 1.0e9f));
+}
+
+template <typename T>
+inline void b2HashedGrid::Query(T* callback, const b2AABB& aabb) const
+{
+	for (int32 proxyId = m_oversized; proxyId != b2_nullNode; proxyId = m_proxies[proxyId].next)
+	{
+		if (b2TestOverlap(m_proxies[proxyId].aabb, aabb))
+		{
+			bool proceed = callback->QueryCallback(proxyId);
+			if (proceed == false)
+			{
+				return;
+			}
+		}
+	}
+
+	// Levels where visiting the cells would cost more than a pass over all proxies
+	// are scanned linearly at the end.
+	uint32 scanLevels = 0;
+
+	float size = m_cellSize;
+	for (int32 level = 0; level < b2_gridLevelCount; ++level, size *= 2.0f)
+	{
+		if (m_levelCounts[level] == 0)
+		{
+			continue;
+		}
+
+		// A proxy may reach into the next cell, so start one cell early.
+		float inverseSize = 1.0f / size;
+		int32 x1 = GetCell(aabb.lowerBound.x, inverseSize) - 1;
+		int32 y1 = GetCell(aabb.lowerBound.y, inverseSize) - 1;
+		int32 x2 = GetCell(aabb.upperBound.x, inverseSize);
+		int32 y2 = GetCell(aabb.upperBound.y, inverseSize);
+
+		float cellCount = (float(x2) - float(x1) + 1.0f) * (float(y2) - float(y1) + 1.0f);
+		if (cellCount > float(m_proxyCapacity))
+		{
+			scanLevels |= 1u << level;
+			continue;
+		}
+
+		for (int32 y = y1; y <= y2; ++y)
+		{
+			for (int32 x = x1; x <= x2; ++x)
+			{
+				int32 proxyId = m_buckets[GetBucket(level, x, y)];
+				while (proxyId != b2_nullNode)
+				{
+					const b2GridProxy* proxy = m_proxies + proxyId;
+
+					// Different cells may share the bucket.
+					if (proxy->level == level && proxy->x == x && proxy->y == y && b2TestOverlap(proxy->aabb, aabb))
+					{
+						bool proceed = callback->QueryCallback(proxyId);
+						if (proceed == false)
+						{
+							return;
+						}
+					}
+
+					proxyId = proxy->next;
+				}
+			}
+		}
+	}
+
+	if (scanLevels == 0)
+	{
+		return;
+	}
+
+	for (int32 proxyId = 0; proxyId < m_proxyCapacity; ++proxyId)
+	{
+		const b2GridProxy* proxy = m_proxies + proxyId;
+		if (proxy->level < 0 || proxy->level >= b2_gridLevelCount || (scanLevels & (1u << proxy->level)) == 0)
+		{
+			continue;
+		}
+
+		if (b2TestOverlap(proxy->aabb, aabb))
+		{
+			bool proceed = callback->QueryCallback(proxyId);
+			if (proceed == false)
+			{
+				return;
+			}
+		}
+	}
+}
+
+template <typename T>
+inline void b2HashedGrid::RayCast(T* callback, const b2RayCastInput& input) const
+{
+	b2Vec2 p1 = input.p1;
+	b2Vec2 p2 = input.p2;
+	b2Vec2 r = p2 - p1;
+	b2Assert(r.LengthSquared() > 0.0f);
+	r.Normalize();
+
+	b2GridRayCastCallback<T> wrapper;
+	wrapper.callback = callback;
+	wrapper.grid = this;
+	wrapper.input = input;
+
+	// v is perpendicular to the segment.
+	wrapper.v = b2Cross(1.0f, r);
+
+	// Build a bounding box for the segment.
+	b2Vec2 t = p1 + input.maxFraction * (p2 - p1);
+	wrapper.segmentAABB.lowerBound = b2Min(p1, t);
+	wrapper.segmentAABB.upperBound = b2Max(p1, t);
+
+	// Gather the candidates in the segment box. The wrapper clips the segment as
+	// the client reports hits.
+	b2AABB segmentAABB = wrapper.segmentAABB;
+	Query(&wrapper, segmentAABB);
+}
+
+#endif
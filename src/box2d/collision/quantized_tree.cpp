@@ -0,0 +1,423 @@
+// MIT License
+
+// Copyright (c) 2019 Erin Catto
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include "quantized_tree.h"
+#include <math.h>
+#include <string.h>
+
+// Largest grid coordinate whose decoded lower bound does not exceed value.
+static uint16 b2QuantizeLower(float value, float base, float scale)
+{
+	if (scale <= 0.0f)
+	{
+		return 0;
+	}
+
+	int32 q = b2Clamp(int32(floorf((value - base) / scale)), 0, b2_quantizedTreeSteps);
+	while (q > 0 && base + scale * q > value)
+	{
+		--q;
+	}
+
+	return uint16(q);
+}
+
+// Smallest grid coordinate whose decoded upper bound is not below value.
+static uint16 b2QuantizeUpper(float value, float base, float scale)
+{
+	if (scale <= 0.0f)
+	{
+		return b2_quantizedTreeSteps;
+	}
+
+	int32 q = b2Clamp(b2_quantizedTreeSteps - int32(floorf((base - value) / scale)), 0, b2_quantizedTreeSteps);
+	while (q < b2_quantizedTreeSteps && base - scale * (b2_quantizedTreeSteps - q) < value)
+	{
+		++q;
+	}
+
+	return uint16(q);
+}
+
+// Store aabb relative to the decoded parent bounds. This must use the same
+// arithmetic as b2QuantizedNode::Decode.
+static void b2Quantize(b2QuantizedNode* node, const b2AABB& parent, const b2AABB& aabb)
+{
+	b2Vec2 scale = (1.0f / b2_quantizedTreeSteps) * (parent.upperBound - parent.lowerBound);
+	node->lowerX = b2QuantizeLower(aabb.lowerBound.x, parent.lowerBound.x, scale.x);
+	node->lowerY = b2QuantizeLower(aabb.lowerBound.y, parent.lowerBound.y, scale.y);
+	node->upperX = b2QuantizeUpper(aabb.upperBound.x, parent.upperBound.x, scale.x);
+	node->upperY = b2QuantizeUpper(aabb.upperBound.y, parent.upperBound.y, scale.y);
+}
+
+b2QuantizedTree::b2QuantizedTree()
+{
+	m_nodes = nullptr;
+	m_nodeCount = 0;
+	m_nodeCapacity = 0;
+
+	m_bounds.lowerBound.SetZero();
+	m_bounds.upperBound.SetZero();
+
+	m_proxyCapacity = 16;
+	m_proxyCount = 0;
+	m_proxies = (b2QuantizedProxy*)b2Alloc(m_proxyCapacity * sizeof(b2QuantizedProxy));
+	memset(m_proxies, 0, m_proxyCapacity * sizeof(b2QuantizedProxy));
+	for (int32 i = 0; i < m_proxyCapacity - 1; ++i)
+	{
+		m_proxies[i].next = i + 1;
+	}
+	m_proxies[m_proxyCapacity-1].next = b2_nullNode;
+	m_freeProxy = 0;
+
+	m_pendingCapacity = 16;
+	m_pendingCount = 0;
+	m_pending = (int32*)b2Alloc(m_pendingCapacity * sizeof(int32));
+
+	m_staleCount = 0;
+}
+
+b2QuantizedTree::~b2QuantizedTree()
+{
+	b2Free(m_nodes);
+	b2Free(m_proxies);
+	b2Free(m_pending);
+}
+
+int32 b2QuantizedTree::CreateProxy(const b2AABB& aabb, void* userData)
+{
+	if (m_freeProxy == b2_nullNode)
+	{
+		b2QuantizedProxy* oldProxies = m_proxies;
+		int32 oldCapacity = m_proxyCapacity;
+		m_proxyCapacity *= 2;
+		m_proxies = (b2QuantizedProxy*)b2Alloc(m_proxyCapacity * sizeof(b2QuantizedProxy));
+		memcpy(m_proxies, oldProxies, oldCapacity * sizeof(b2QuantizedProxy));
+		memset(m_proxies + oldCapacity, 0, (m_proxyCapacity - oldCapacity) * sizeof(b2QuantizedProxy));
+		b2Free(oldProxies);
+
+		for (int32 i = oldCapacity; i < m_proxyCapacity - 1; ++i)
+		{
+			m_proxies[i].next = i + 1;
+		}
+		m_proxies[m_proxyCapacity-1].next = b2_nullNode;
+		m_freeProxy = oldCapacity;
+	}
+
+	int32 proxyId = m_freeProxy;
+	b2QuantizedProxy* proxy = m_proxies + proxyId;
+	m_freeProxy = proxy->next;
+
+	// Fatten the aabb.
+	b2Vec2 r(b2_aabbExtension, b2_aabbExtension);
+	proxy->aabb.lowerBound = aabb.lowerBound - r;
+	proxy->aabb.upperBound = aabb.upperBound + r;
+	proxy->userData = userData;
+	proxy->node = b2_nullNode;
+	proxy->moved = true;
+	proxy->allocated = true;
+	++m_proxyCount;
+
+	AddPending(proxyId);
+
+	return proxyId;
+}
+
+void b2QuantizedTree::DestroyProxy(int32 proxyId)
+{
+	b2Assert(0 <= proxyId && proxyId < m_proxyCapacity);
+	b2QuantizedProxy* proxy = m_proxies + proxyId;
+	b2Assert(proxy->allocated);
+
+	if (proxy->node == b2_nullNode)
+	{
+		RemovePending(proxyId);
+	}
+	else
+	{
+		++m_staleCount;
+	}
+
+	proxy->userData = nullptr;
+	proxy->allocated = false;
+	proxy->moved = false;
+	proxy->next = m_freeProxy;
+	m_freeProxy = proxyId;
+	--m_proxyCount;
+}
+
+bool b2QuantizedTree::MoveProxy(int32 proxyId, const b2AABB& aabb, const b2Vec2& displacement)
+{
+	b2Assert(0 <= proxyId && proxyId < m_proxyCapacity);
+	b2QuantizedProxy* proxy = m_proxies + proxyId;
+	b2Assert(proxy->allocated);
+
+	// Use the same enlargement policy as b2DynamicTree::MoveProxy.
+	b2AABB fatAABB;
+	b2Vec2 r(b2_aabbExtension, b2_aabbExtension);
+	fatAABB.lowerBound = aabb.lowerBound - r;
+	fatAABB.upperBound = aabb.upperBound + r;
+
+	b2Vec2 d = b2_aabbMultiplier * displacement;
+	fatAABB.lowerBound += b2Min(d, b2Vec2_zero);
+	fatAABB.upperBound += b2Max(d, b2Vec2_zero);
+
+	if (proxy->aabb.Contains(aabb))
+	{
+		b2AABB hugeAABB;
+		hugeAABB.lowerBound = fatAABB.lowerBound - 4.0f * r;
+		hugeAABB.upperBound = fatAABB.upperBound + 4.0f * r;
+
+		if (hugeAABB.Contains(proxy->aabb))
+		{
+			return false;
+		}
+	}
+
+	proxy->aabb = fatAABB;
+	proxy->moved = true;
+
+	if (proxy->node != b2_nullNode)
+	{
+		// The leaf stays in the nodes until the next rebuild, but it no longer
+		// refers to this proxy.
+		proxy->node = b2_nullNode;
+		++m_staleCount;
+		AddPending(proxyId);
+	}
+
+	return true;
+}
+
+void b2QuantizedTree::AddPending(int32 proxyId)
+{
+	if (m_pendingCount == m_pendingCapacity)
+	{
+		int32* oldPending = m_pending;
+		m_pendingCapacity *= 2;
+		m_pending = (int32*)b2Alloc(m_pendingCapacity * sizeof(int32));
+		memcpy(m_pending, oldPending, m_pendingCount * sizeof(int32));
+		b2Free(oldPending);
+	}
+
+	m_pending[m_pendingCount] = proxyId;
+	++m_pendingCount;
+}
+
+void b2QuantizedTree::RemovePending(int32 proxyId)
+{
+	for (int32 i = 0; i < m_pendingCount; ++i)
+	{
+		if (m_pending[i] == proxyId)
+		{
+			m_pending[i] = m_pending[m_pendingCount - 1];
+			--m_pendingCount;
+			return;
+		}
+	}
+
+	b2Assert(false);
+}
+
+bool b2QuantizedTree::ShouldRebuild() const
+{
+	// The pending list is searched linearly by every query, so keep it short.
+	// Stale leaves only cost traversal, so tolerate more of them.
+	int32 leafCount = m_proxyCount - m_pendingCount + m_staleCount;
+	return m_pendingCount > 16 + (leafCount >> 6) || m_staleCount > 16 + (leafCount >> 2);
+}
+
+void b2QuantizedTree::Clear()
+{
+	memset(m_proxies, 0, m_proxyCapacity * sizeof(b2QuantizedProxy));
+	for (int32 i = 0; i < m_proxyCapacity - 1; ++i)
+	{
+		m_proxies[i].next = i + 1;
+	}
+	m_proxies[m_proxyCapacity-1].next = b2_nullNode;
+	m_freeProxy = 0;
+	m_proxyCount = 0;
+
+	m_nodeCount = 0;
+	m_pendingCount = 0;
+	m_staleCount = 0;
+}
+
+void b2QuantizedTree::Rebuild()
+{
+	m_pendingCount = 0;
+	m_staleCount = 0;
+	m_nodeCount = 0;
+
+	if (m_proxyCount == 0)
+	{
+		return;
+	}
+
+	int32* leaves = (int32*)b2Alloc(m_proxyCount * sizeof(int32));
+	int32 leafCount = 0;
+	for (int32 i = 0; i < m_proxyCapacity; ++i)
+	{
+		if (m_proxies[i].allocated)
+		{
+			leaves[leafCount] = i;
+			++leafCount;
+		}
+	}
+
+	b2Assert(leafCount == m_proxyCount);
+
+	int32 nodeCapacity = 2 * leafCount - 1;
+	if (nodeCapacity > m_nodeCapacity)
+	{
+		b2Free(m_nodes);
+		m_nodeCapacity = nodeCapacity;
+		m_nodes = (b2QuantizedNode*)b2Alloc(m_nodeCapacity * sizeof(b2QuantizedNode));
+	}
+
+	struct BuildTask
+	{
+		int32 begin;
+		int32 end;
+
+		// Node that takes this task as its second child, b2_nullNode otherwise.
+		int32 parent;
+
+		b2AABB parentBounds;
+	};
+
+	b2AABB bounds = m_proxies[leaves[0]].aabb;
+	for (int32 i = 1; i < leafCount; ++i)
+	{
+		bounds.Combine(m_proxies[leaves[i]].aabb);
+	}
+	m_bounds = bounds;
+
+	// Top down build. Pushing child2 before child1 makes the nodes come out
+	// in pre-order, so child1 always directly follows its parent.
+	b2GrowableStack<BuildTask, 64> stack;
+	BuildTask root;
+	root.begin = 0;
+	root.end = leafCount;
+	root.parent = b2_nullNode;
+	root.parentBounds = bounds;
+	stack.Push(root);
+
+	while (stack.GetCount() > 0)
+	{
+		BuildTask task = stack.Pop();
+
+		int32 nodeId = m_nodeCount;
+		++m_nodeCount;
+		b2QuantizedNode* node = m_nodes + nodeId;
+
+		if (task.parent != b2_nullNode)
+		{
+			m_nodes[task.parent].data = nodeId;
+		}
+
+		b2AABB aabb = m_proxies[leaves[task.begin]].aabb;
+		b2AABB centers;
+		centers.lowerBound = aabb.GetCenter();
+		centers.upperBound = centers.lowerBound;
+		for (int32 i = task.begin + 1; i < task.end; ++i)
+		{
+			const b2AABB& leafAABB = m_proxies[leaves[i]].aabb;
+			aabb.Combine(leafAABB);
+			b2Vec2 c = leafAABB.GetCenter();
+			centers.lowerBound = b2Min(centers.lowerBound, c);
+			centers.upperBound = b2Max(centers.upperBound, c);
+		}
+
+		b2Quantize(node, task.parentBounds, aabb);
+		b2AABB decoded = node->Decode(task.parentBounds);
+
+		if (task.end - task.begin == 1)
+		{
+			int32 proxyId = leaves[task.begin];
+			node->data = ~proxyId;
+			m_proxies[proxyId].node = nodeId;
+			continue;
+		}
+
+		// Split at the middle of the longest axis of the leaf centers.
+		b2Vec2 extents = centers.upperBound - centers.lowerBound;
+		int32 axis = extents.x > extents.y ? 0 : 1;
+		float split = 0.5f * (centers.lowerBound(axis) + centers.upperBound(axis));
+
+		int32 i1 = task.begin;
+		int32 i2 = task.end;
+		while (i1 < i2)
+		{
+			if (m_proxies[leaves[i1]].aabb.GetCenter()(axis) < split)
+			{
+				++i1;
+			}
+			else
+			{
+				--i2;
+				b2Swap(leaves[i1], leaves[i2]);
+			}
+		}
+
+		if (i1 == task.begin || i1 == task.end)
+		{
+			// All centers are on one side, split by count.
+			i1 = (task.begin + task.end) >> 1;
+		}
+
+		BuildTask child2;
+		child2.begin = i1;
+		child2.end = task.end;
+		child2.parent = nodeId;
+		child2.parentBounds = decoded;
+		stack.Push(child2);
+
+		BuildTask child1;
+		child1.begin = task.begin;
+		child1.end = i1;
+		child1.parent = b2_nullNode;
+		child1.parentBounds = decoded;
+		stack.Push(child1);
+	}
+
+	b2Assert(m_nodeCount == nodeCapacity);
+	b2Free(leaves);
+}
+
+int32 b2QuantizedTree::GetByteCount() const
+{
+	return m_nodeCapacity * sizeof(b2QuantizedNode) + m_proxyCapacity * sizeof(b2QuantizedProxy) + m_pendingCapacity * sizeof(int32);
+}
+
+void b2QuantizedTree::ShiftOrigin(const b2Vec2& newOrigin)
+{
+	for (int32 i = 0; i < m_proxyCapacity; ++i)
+	{
+		m_proxies[i].aabb.lowerBound -= newOrigin;
+		m_proxies[i].aabb.upperBound -= newOrigin;
+	}
+
+	// Decoding is not exact under translation, so rebuild to stay conservative.
+	Rebuild();
+}
@@ -0,0 +1,504 @@
+// MIT License
+
+// Copyright (c) 2019 Erin Catto
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#ifndef B2_QUANTIZED_TREE_H
+#define B2_QUANTIZED_TREE_H
+
+#include "box2d/api.h"
+#include "collision.h"
+#include "dynamic_tree.h"
+#include "box2d/common/growable_stack.h"
+
+/// Number of steps of the 16-bit grid used to store child bounds.
+#define b2_quantizedTreeSteps 65535
+
+/// A node of the quantized tree. The bounds are stored on a 16-bit grid that
+/// spans the decoded bounds of the parent node. Nodes are stored in pre-order, so
+/// the first child of an internal node is always the next node in the array.
+struct B2_API b2QuantizedNode
+{
+	bool IsLeaf() const
+	{
+		return data < 0;
+	}
+
+	/// Decode the bounds given the decoded bounds of the parent. Lower bounds are
+	/// measured from the parent lower bound and upper bounds from the parent upper
+	/// bound, so the grid end points reproduce the parent bounds exactly.
+	b2AABB Decode(const b2AABB& parent) const
+	{
+		b2Vec2 scale = (1.0f / b2_quantizedTreeSteps) * (parent.upperBound - parent.lowerBound);
+		b2AABB aabb;
+		aabb.lowerBound.x = parent.lowerBound.x + scale.x * lowerX;
+		aabb.lowerBound.y = parent.lowerBound.y + scale.y * lowerY;
+		aabb.upperBound.x = parent.upperBound.x - scale.x * (b2_quantizedTreeSteps - upperX);
+		aabb.upperBound.y = parent.upperBound.y - scale.y * (b2_quantizedTreeSteps - upperY);
+		return aabb;
+	}
+
+	uint16 lowerX, lowerY;
+	uint16 upperX, upperY;
+
+	// internal = index of child2, leaf = ~proxyId
+	int32 data;
+};
+
+/// Proxy data for the quantized tree. The exact fat AABB is kept here so that
+/// overlap tests between proxies do not need to decode the tree.
+struct B2_API b2QuantizedProxy
+{
+	/// Enlarged AABB
+	b2AABB aabb;
+
+	void* userData;
+
+	union
+	{
+		// leaf node index, b2_nullNode if the proxy is waiting for a rebuild
+		int32 node;
+		int32 next;
+	};
+
+	bool moved;
+	bool allocated;
+};
+
+/// A compressed bounding volume hierarchy for proxies that rarely move, such as
+/// the fixtures of static bodies. Nodes take 12 bytes instead of the 32 bytes of
+/// b2TreeNode and are decoded on the fly during traversal, with conservative
+/// rounding so that no overlap is ever missed.
+/// The tree has the same proxy interface as b2DynamicTree. Proxies that are created
+/// or moved are kept in a small pending list that is searched linearly until the
+/// next call to Rebuild.
+class B2_API b2QuantizedTree
+{
+public:
+	b2QuantizedTree();
+	~b2QuantizedTree();
+
+	/// Create a proxy. Provide a tight fitting AABB and a userData pointer.
+	int32 CreateProxy(const b2AABB& aabb, void* userData);
+
+	/// Destroy a proxy. This asserts if the id is invalid.
+	void DestroyProxy(int32 proxyId);
+
+	/// Move a proxy with a swepted AABB. If the proxy has moved outside of its fattened AABB,
+	/// then the proxy is moved to the pending list.
+	/// @return true if the fat AABB changed.
+	bool MoveProxy(int32 proxyId, const b2AABB& aabb1, const b2Vec2& displacement);
+
+	/// Get proxy user data.
+	void* GetUserData(int32 proxyId) const;
+
+	bool WasMoved(int32 proxyId) const;
+	void ClearMoved(int32 proxyId);
+
+	/// Get the fat AABB for a proxy.
+	const b2AABB& GetFatAABB(int32 proxyId) const;
+
+	/// Get the number of proxies in the tree.
+	int32 GetProxyCount() const;
+
+	/// Query an AABB for overlapping proxies. The callback class
+	/// is called for each proxy that overlaps the supplied AABB.
+	template <typename T>
+	void Query(T* callback, const b2AABB& aabb) const;
+
+	/// Ray-cast against the proxies in the tree. See b2DynamicTree::RayCast.
+	template <typename T>
+	void RayCast(T* callback, const b2RayCastInput& input) const;
+
+	/// Find the overlaps with the leaves of another hierarchy. See b2DynamicTree::QueryTree.
+	template <typename T>
+	void QueryTree(T* callback, const b2TreeNode* nodes, int32 root) const;
+
+	/// Does the tree have enough pending or stale proxies to be worth a rebuild?
+	bool ShouldRebuild() const;
+
+	/// Build the compressed nodes from scratch. This is O(n log n).
+	void Rebuild();
+
+	/// Remove all proxies, keeping the allocated memory for the next batch.
+	void Clear();
+
+	/// Get the number of bytes used by the nodes and proxies.
+	int32 GetByteCount() const;
+
+	/// Shift the world origin. This rebuilds the tree.
+	void ShiftOrigin(const b2Vec2& newOrigin);
+
+private:
+
+	struct StackEntry
+	{
+		int32 node;
+		b2AABB bounds;
+	};
+
+	void AddPending(int32 proxyId);
+	void RemovePending(int32 proxyId);
+
+	b2QuantizedNode* m_nodes;
+	int32 m_nodeCount;
+	int32 m_nodeCapacity;
+
+	// Decoded bounds of the root node.
+	b2AABB m_bounds;
+
+	b2QuantizedProxy* m_proxies;
+	int32 m_proxyCount;
+	int32 m_proxyCapacity;
+	int32 m_freeProxy;
+
+	int32* m_pending;
+	int32 m_pendingCount;
+	int32 m_pendingCapacity;
+
+	// Leaves whose proxy was moved or destroyed since the last build.
+	int32 m_staleCount;
+};
+
+inline void* b2QuantizedTree::GetUserData(int32 proxyId) const
+{
+	b2Assert(0 <= proxyId && proxyId < m_proxyCapacity);
+	return m_proxies[proxyId].userData;
+}
+
+inline bool b2QuantizedTree::WasMoved(int32 proxyId) const
+{
+	b2Assert(0 <= proxyId && proxyId < m_proxyCapacity);
+	return m_proxies[proxyId].moved;
+}
+
+inline void b2QuantizedTree::ClearMoved(int32 proxyId)
+{
+	b2Assert(0 <= proxyId && proxyId < m_proxyCapacity);
+	m_proxies[proxyId].moved = false;
+}
+
+inline const b2AABB& b2QuantizedTree::GetFatAABB(int32 proxyId) const
+{
+	b2Assert(0 <= proxyId && proxyId < m_proxyCapacity);
+	return m_proxies[proxyId].aabb;
+}
+
+inline int32 b2QuantizedTree::GetProxyCount() const
+{
+	return m_proxyCount;
+}
+
+template <typename T>
+inline void b2QuantizedTree::Query(T* callback, const b2AABB& aabb) const
+{
+	// Proxies that changed since the last build are not in the nodes yet.
+	for (int32 i = 0; i < m_pendingCount; ++i)
+	{
+		int32 proxyId = m_pending[i];
+		if (b2TestOverlap(m_proxies[proxyId].aabb, aabb))
+		{
+			bool proceed = callback->QueryCallback(proxyId);
+			if (proceed == false)
+			{
+				return;
+			}
+		}
+	}
+
+	if (m_nodeCount == 0)
+	{
+		return;
+	}
+
+	b2GrowableStack<StackEntry, 128> stack;
+	StackEntry root;
+	root.node = 0;
+	root.bounds = m_bounds;
+	stack.Push(root);
+
+	while (stack.GetCount() > 0)
+	{
+		StackEntry entry = stack.Pop();
+		if (b2TestOverlap(entry.bounds, aabb) == false)
+		{
+			continue;
+		}
+
+		const b2QuantizedNode* node = m_nodes + entry.node;
+		if (node->IsLeaf())
+		{
+			int32 proxyId = ~node->data;
+			const b2QuantizedProxy* proxy = m_proxies + proxyId;
+
+			// Skip stale leaves and false positives due to rounding.
+			if (proxy->allocated == false || proxy->node != entry.node || b2TestOverlap(proxy->aabb, aabb) == false)
+			{
+				continue;
+			}
+
+			bool proceed = callback->QueryCallback(proxyId);
+			if (proceed == false)
+			{
+				return;
+			}
+		}
+		else
+		{
+			StackEntry child2;
+			child2.node = node->data;
+			child2.bounds = m_nodes[child2.node].Decode(entry.bounds);
+			stack.Push(child2);
+
+			StackEntry child1;
+			child1.node = entry.node + 1;
+			child1.bounds = m_nodes[child1.node].Decode(entry.bounds);
+			stack.Push(child1);
+		}
+	}
+}
+
+template <typename T>
+inline void b2QuantizedTree::RayCast(T* callback, const b2RayCastInput& input) const
+{
+	b2Vec2 p1 = input.p1;
+	b2Vec2 p2 = input.p2;
+	b2Vec2 r = p2 - p1;
+	b2Assert(r.LengthSquared() > 0.0f);
+	r.Normalize();
+
+	// v is perpendicular to the segment.
+	b2Vec2 v = b2Cross(1.0f, r);
+	b2Vec2 abs_v = b2Abs(v);
+
+	float maxFraction = input.maxFraction;
+
+	// Build a bounding box for the segment.
+	b2AABB segmentAABB;
+	{
+		b2Vec2 t = p1 + maxFraction * (p2 - p1);
+		segmentAABB.lowerBound = b2Min(p1, t);
+		segmentAABB.upperBound = b2Max(p1, t);
+	}
+
+	b2GrowableStack<StackEntry, 128> stack;
+
+	// Pending proxies are tested first, then the nodes.
+	int32 pendingIndex = 0;
+	if (m_nodeCount > 0)
+	{
+		StackEntry root;
+		root.node = 0;
+		root.bounds = m_bounds;
+		stack.Push(root);
+	}
+
+	while (pendingIndex < m_pendingCount || stack.GetCount() > 0)
+	{
+		int32 proxyId;
+		if (pendingIndex < m_pendingCount)
+		{
+			proxyId = m_pending[pendingIndex];
+			++pendingIndex;
+		}
+		else
+		{
+			StackEntry entry = stack.Pop();
+			if (b2TestOverlap(entry.bounds, segmentAABB) == false)
+			{
+				continue;
+			}
+
+			// Separating axis for segment (Gino, p80).
+			// |dot(v, p1 - c)| > dot(|v|, h)
+			b2Vec2 c = entry.bounds.GetCenter();
+			b2Vec2 h = entry.bounds.GetExtents();
+			float separation = b2Abs(b2Dot(v, p1 - c)) - b2Dot(abs_v, h);
+			if (separation > 0.0f)
+			{
+				continue;
+			}
+
+			const b2QuantizedNode* node = m_nodes + entry.node;
+			if (node->IsLeaf() == false)
+			{
+				StackEntry child2;
+				child2.node = node->data;
+				child2.bounds = m_nodes[child2.node].Decode(entry.bounds);
+				stack.Push(child2);
+
+				StackEntry child1;
+				child1.node = entry.node + 1;
+				child1.bounds = m_nodes[child1.node].Decode(entry.bounds);
+				stack.Push(child1);
+				continue;
+			}
+
+			proxyId = ~node->data;
+			if (m_proxies[proxyId].allocated == false || m_proxies[proxyId].node != entry.node)
+			{
+				// Stale leaf
+				continue;
+			}
+		}
+
+		if (b2TestOverlap(m_proxies[proxyId].aabb, segmentAABB) == false)
+		{
+			continue;
+		}
+
+		b2RayCastInput subInput;
+		subInput.p1 = input.p1;
+		subInput.p2 = input.p2;
+		subInput.maxFraction = maxFraction;
+
+		float value = callback->RayCastCallback(subInput, proxyId);
+
+		if (value == 0.0f)
+		{
+			// The client has terminated the ray cast.
+			return;
+		}
+
+		if (value > 0.0f)
+		{
+			// Update segment bounding box.
+			maxFraction = value;
+			b2Vec2 t = p1 + maxFraction * (p2 - p1);
+			segmentAABB.lowerBound = b2Min(p1, t);
+			segmentAABB.upperBound = b2Max(p1, t);
+		}
+	}
+}
+
+template <typename T>
+inline void b2QuantizedTree::QueryTree(T* callback, const b2TreeNode* nodes, int32 root) const
+{
+	if (root == b2_nullNode)
+	{
+		return;
+	}
+
+	// Pending proxies query the other hierarchy one at a time.
+	for (int32 i = 0; i < m_pendingCount; ++i)
+	{
+		int32 proxyId = m_pending[i];
+		const b2AABB& aabb = m_proxies[proxyId].aabb;
+
+		b2GrowableStack<int32, 256> stack;
+		stack.Push(root);
+		while (stack.GetCount() > 0)
+		{
+			const b2TreeNode* node = nodes + stack.Pop();
+			if (b2TestOverlap(node->aabb, aabb) == false)
+			{
+				continue;
+			}
+
+			if (node->IsLeaf())
+			{
+				bool proceed = callback->PairCallback(node->proxyId, proxyId);
+				if (proceed == false)
+				{
+					return;
+				}
+			}
+			else
+			{
+				stack.Push(node->child2);
+				stack.Push(node->child1);
+			}
+		}
+	}
+
+	if (m_nodeCount == 0)
+	{
+		return;
+	}
+
+	struct PairEntry
+	{
+		int32 nodeA;
+		int32 nodeB;
+		b2AABB boundsA;
+	};
+
+	b2GrowableStack<PairEntry, 128> stack;
+	PairEntry entry;
+	entry.nodeA = 0;
+	entry.nodeB = root;
+	entry.boundsA = m_bounds;
+	stack.Push(entry);
+
+	while (stack.GetCount() > 0)
+	{
+		entry = stack.Pop();
+
+		const b2QuantizedNode* nodeA = m_nodes + entry.nodeA;
+		const b2TreeNode* nodeB = nodes + entry.nodeB;
+
+		if (b2TestOverlap(entry.boundsA, nodeB->aabb) == false)
+		{
+			continue;
+		}
+
+		bool leafA = nodeA->IsLeaf();
+		bool leafB = nodeB->IsLeaf();
+		if (leafA && leafB)
+		{
+			int32 proxyId = ~nodeA->data;
+			const b2QuantizedProxy* proxy = m_proxies + proxyId;
+
+			// Skip stale leaves and false positives due to rounding.
+			if (proxy->allocated == false || proxy->node != entry.nodeA || b2TestOverlap(proxy->aabb, nodeB->aabb) == false)
+			{
+				continue;
+			}
+
+			bool proceed = callback->PairCallback(nodeB->proxyId, proxyId);
+			if (proceed == false)
+			{
+				return;
+			}
+		}
+		else if (leafB || (leafA == false && entry.boundsA.GetPerimeter() >= nodeB->aabb.GetPerimeter()))
+		{
+			// Descend into the larger node.
+			PairEntry child = entry;
+			child.nodeA = nodeA->data;
+			child.boundsA = m_nodes[child.nodeA].Decode(entry.boundsA);
+			stack.Push(child);
+			child.nodeA = entry.nodeA + 1;
+			child.boundsA = m_nodes[child.nodeA].Decode(entry.boundsA);
+			stack.Push(child);
+		}
+		else
+		{
+			PairEntry child = entry;
+			child.nodeB = nodeB->child2;
+			stack.Push(child);
+			child.nodeB = nodeB->child1;
+			stack.Push(child);
+		}
+	}
+}
+
+#endif
@@ -0,0 +1,199 @@
+// MIT License
+
+// Copyright (c) 2019 Erin Catto
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "capsule_shape.h"
+
+#include "box2d/common/block_allocator.h"
+
+#include <new>
+
+void b2CapsuleShape::Set( const b2Vec2& v1, const b2Vec2& v2, float radius ) {
+  b2Assert( b2DistanceSquared( v1, v2 ) > b2_linearSlop * b2_linearSlop );
+  b2Assert( radius > 0.0f );
+  m_vertex1 = v1;
+  m_vertex2 = v2;
+  m_radius = radius;
+}
+
+b2Shape* b2CapsuleShape::Clone( b2BlockAllocator* allocator ) const {
+  void* mem = allocator->Allocate( sizeof( b2CapsuleShape ) );
+  b2CapsuleShape* clone = new( mem ) b2CapsuleShape;
+  *clone = *this;
+  return clone;
+}
+
+int32 b2CapsuleShape::GetChildCount() const {
+  return 1;
+}
+
+// Closest point to p on the segment v1-v2.
+static b2Vec2 b2ClosestPointOnSegment( const b2Vec2& v1, const b2Vec2& v2, const b2Vec2& p ) {
+  b2Vec2 e = v2 - v1;
+  float t = b2Dot( p - v1, e ) / b2Dot( e, e );
+  return v1 + b2Clamp( t, 0.0f, 1.0f ) * e;
+}
+
+bool b2CapsuleShape::TestPoint( const b2Transform& transform, const b2Vec2& p ) const {
+  b2Vec2 localP = b2MulT( transform, p );
+  b2Vec2 q = b2ClosestPointOnSegment( m_vertex1, m_vertex2, localP );
+  return b2DistanceSquared( localP, q ) <= m_radius * m_radius;
+}
+
+void b2CapsuleShape::ComputeDistance( const b2Transform& xf, const b2Vec2& p, float* distance, b2Vec2* normal, int32 childIndex ) const {
+  B2_NOT_USED( childIndex );
+
+  b2Vec2 v1 = b2Mul( xf, m_vertex1 );
+  b2Vec2 v2 = b2Mul( xf, m_vertex2 );
+  b2Vec2 d = p - b2ClosestPointOnSegment( v1, v2, p );
+  float d1 = d.Length();
+  *distance = d1 - m_radius;
+  *normal = 1 / d1 * d;
+}
+
+// Ray cast against a disk in the capsule frame. Same as b2CircleShape::RayCast.
+static bool b2RayCastDisk( float* fraction, b2Vec2* normal, const b2Vec2& p1, const b2Vec2& p2,
+    float maxFraction, const b2Vec2& center, float radius ) {
+  b2Vec2 s = p1 - center;
+  float b = b2Dot( s, s ) - radius * radius;
+
+  // Solve quadratic equation.
+  b2Vec2 r = p2 - p1;
+  float c = b2Dot( s, r );
+  float rr = b2Dot( r, r );
+  float sigma = c * c - rr * b;
+
+  // Check for negative discriminant and short segment.
+  if( sigma < 0.0f || rr < b2_epsilon )
+    return false;
+
+  // Find the point of intersection of the line with the circle.
+  float a = -( c + b2Sqrt( sigma ) );
+
+  // Is the intersection point on the segment?
+  if( 0.0f <= a && a <= maxFraction * rr ) {
+    a /= rr;
+    *fraction = a;
+    *normal = s + a * r;
+    normal->Normalize();
+    return true;
+  }
+
+  return false;
+}
+
+// The capsule is the union of the two end disks and the box between them. A ray
+// that starts outside enters the union first through a disk or a side of the box.
+bool b2CapsuleShape::RayCast( b2RayCastOutput* output, const b2RayCastInput& input,
+    const b2Transform& xf, int32 childIndex ) const {
+  B2_NOT_USED( childIndex );
+
+  // Put the ray into the capsule's frame of reference.
+  b2Vec2 p1 = b2MulT( xf.q, input.p1 - xf.p );
+  b2Vec2 p2 = b2MulT( xf.q, input.p2 - xf.p );
+
+  if( b2DistanceSquared( p1, b2ClosestPointOnSegment( m_vertex1, m_vertex2, p1 ) ) <= m_radius * m_radius )
+    return false;
+
+  b2Vec2 d = p2 - p1;
+  b2Vec2 axis = m_vertex2 - m_vertex1;
+  float length = axis.Normalize();
+
+  float maxFraction = input.maxFraction;
+  bool hit = false;
+  b2Vec2 normal;
+
+  // Sides of the box.
+  b2Vec2 sideNormals [ 2 ] = { b2Vec2( axis.y, -axis.x ), b2Vec2( -axis.y, axis.x ) };
+  for( int32 i = 0; i < 2; ++i ) {
+    const b2Vec2& n = sideNormals [ i ];
+    float numerator = m_radius - b2Dot( n, p1 - m_vertex1 );
+    float denominator = b2Dot( n, d );
+    if( numerator >= 0.0f || denominator >= 0.0f )
+      continue;
+
+    float t = numerator / denominator;
+    if( t > maxFraction )
+      continue;
+
+    float s = b2Dot( axis, p1 + t * d - m_vertex1 );
+    if( 0.0f <= s && s <= length ) {
+      maxFraction = t;
+      normal = n;
+      hit = true;
+    }
+  }
+
+  // End disks.
+  float fraction;
+  b2Vec2 diskNormal;
+  if( b2RayCastDisk( &fraction, &diskNormal, p1, p2, maxFraction, m_vertex1, m_radius ) ) {
+    maxFraction = fraction;
+    normal = diskNormal;
+    hit = true;
+  }
+
+  if( b2RayCastDisk( &fraction, &diskNormal, p1, p2, maxFraction, m_vertex2, m_radius ) ) {
+    maxFraction = fraction;
+    normal = diskNormal;
+    hit = true;
+  }
+
+  if( hit ) {
+    output->fraction = maxFraction;
+    output->normal = b2Mul( xf.q, normal );
+  }
+
+  return hit;
+}
+
+void b2CapsuleShape::ComputeAABB( b2AABB* aabb, const b2Transform& xf, int32 childIndex ) const {
+  B2_NOT_USED( childIndex );
+
+  b2Vec2 v1 = b2Mul( xf, m_vertex1 );
+  b2Vec2 v2 = b2Mul( xf, m_vertex2 );
+
+  b2Vec2 r( m_radius, m_radius );
+  aabb->lowerBound = b2Min( v1, v2 ) - r;
+  aabb->upperBound = b2Max( v1, v2 ) + r;
+}
+
+void b2CapsuleShape::ComputeMass( b2MassData* massData, float density ) const {
+  float rr = m_radius * m_radius;
+  float length = b2Distance( m_vertex1, m_vertex2 );
+
+  float circleMass = density * b2_pi * rr;
+  float boxMass = density * 2.0f * m_radius * length;
+
+  massData->mass = circleMass + boxMass;
+  massData->center = 0.5f * ( m_vertex1 + m_vertex2 );
+
+  // The two half disks are offset by half the length. Their centroids are 4r/3pi from
+  // the box ends, so the parallel axis theorem is applied twice:
+  // m * ((h + lc)^2 - lc^2) = m * (h^2 + 2 * h * lc)
+  float lc = 4.0f * m_radius / ( 3.0f * b2_pi );
+  float h = 0.5f * length;
+  float circleInertia = circleMass * ( 0.5f * rr + h * h + 2.0f * h * lc );
+  float boxInertia = boxMass * ( 4.0f * rr + length * length ) / 12.0f;
+
+  // inertia about the local origin
+  massData->I = circleInertia + boxInertia + massData->mass * b2Dot( massData->center, massData->center );
+}
@@ -0,0 +1,74 @@
+// MIT License
+
+// Copyright (c) 2019 Erin Catto
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef B2_CAPSULE_SHAPE_H
+#define B2_CAPSULE_SHAPE_H
+
+#include "box2d/api.h"
+#include "shape.h"
+
+/// A solid capsule: a line segment with a radius. This is cheaper than a polygon
+/// and circles on the same body, and it collides with one contact per pair.
+class B2_API b2CapsuleShape : public b2Shape {
+  public:
+    b2CapsuleShape();
+
+    /// Set the segment centers and the radius. The centers must be further apart
+    /// than b2_linearSlop, use a circle otherwise.
+    void Set( const b2Vec2& v1, const b2Vec2& v2, float radius );
+
+    /// Implement b2Shape.
+    b2Shape* Clone( b2BlockAllocator* allocator ) const override;
+
+    /// @see b2Shape::GetChildCount
+    int32 GetChildCount() const override;
+
+    /// @see b2Shape::TestPoint
+    bool TestPoint( const b2Transform& transform, const b2Vec2& p ) const override;
+
+    // @see b2Shape::ComputeDistance
+    void ComputeDistance( const b2Transform& xf, const b2Vec2& p, float* distance, b2Vec2* normal, int32 childIndex ) const override;
+
+    /// Implement b2Shape.
+    /// @note because the capsule is solid, rays that start inside do not hit because the normal is
+    /// not defined.
+    bool RayCast( b2RayCastOutput* output, const b2RayCastInput& input,
+        const b2Transform& transform, int32 childIndex ) const override;
+
+    /// @see b2Shape::ComputeAABB
+    void ComputeAABB( b2AABB* aabb, const b2Transform& transform, int32 childIndex ) const override;
+
+    /// @see b2Shape::ComputeMass
+    void ComputeMass( b2MassData* massData, float density ) const override;
+
+    /// The segment centers. These must stay adjacent for b2DistanceProxy.
+    b2Vec2 m_vertex1, m_vertex2;
+};
+
+inline b2CapsuleShape::b2CapsuleShape() {
+  m_type = e_capsule;
+  m_radius = 0.0f;
+  m_vertex1.SetZero();
+  m_vertex2.SetZero();
+}
+
+#endif
@@ -28,6 +28,17 @@
 #include <new>
 #include <string.h>
 
+// The most edges in a leaf of the edge tree.
+static const int32 b2_chainLeafEdges = 4;
+
+static int32 b2CountChainNodes( int32 edgeCount ) {
+  if( edgeCount <= b2_chainLeafEdges )
+    return 1;
+
+  int32 half = edgeCount / 2;
+  return 1 + b2CountChainNodes( half ) + b2CountChainNodes( edgeCount - half );
+}
+
 b2ChainShape::~b2ChainShape() {
   Clear();
 }
@@ -36,6 +47,9 @@ void b2ChainShape::Clear() {
   b2Free( m_vertices );
   m_vertices = nullptr;
   m_count = 0;
+  b2Free( m_nodes );
+  m_nodes = nullptr;
+  m_nodeCount = 0;
 }
 
 void b2ChainShape::CreateLoop( const b2Vec2* vertices, int32 count ) {
@@ -57,6 +71,9 @@ void b2ChainShape::CreateLoop( const b2Vec2* vertices, int32 count ) {
   m_vertices [ count ] = m_vertices [ 0 ];
   m_prevVertex = m_vertices [ m_count - 2 ];
   m_nextVertex = m_vertices [ 1 ];
+
+  if( m_singleProxy )
+    BuildTree();
 }
 
 void b2ChainShape::CreateChain( const b2Vec2* vertices, int32 count, const b2Vec2& prevVertex, const b2Vec2& nextVertex ) {
@@ -73,11 +90,65 @@ void b2ChainShape::CreateChain( const b2Vec2* vertices, int32 count, const b2Vec
 
   m_prevVertex = prevVertex;
   m_nextVertex = nextVertex;
+
+  if( m_singleProxy )
+    BuildTree();
+}
+
+void b2ChainShape::SetSingleProxy( bool flag ) {
+  m_singleProxy = flag;
+  b2Free( m_nodes );
+  m_nodes = nullptr;
+  m_nodeCount = 0;
+  if( flag && m_count >= 2 )
+    BuildTree();
+}
+
+void b2ChainShape::BuildTree() {
+  b2Assert( m_nodes == nullptr );
+  int32 edgeCount = m_count - 1;
+  m_nodeCount = b2CountChainNodes( edgeCount );
+  m_nodes = (Node*) b2Alloc( m_nodeCount * sizeof( Node ) );
+  int32 nodeCount = BuildNode( 0, 0, edgeCount );
+  b2Assert( nodeCount == m_nodeCount );
+  B2_NOT_USED( nodeCount );
+}
+
+int32 b2ChainShape::BuildNode( int32 nodeIndex, int32 first, int32 count ) {
+  Node* node = m_nodes + nodeIndex;
+  node->first = first;
+
+  // Consecutive edges are close together, so splitting the run in half gives a good tree.
+  if( count <= b2_chainLeafEdges ) {
+    b2Vec2 lower = m_vertices [ first ];
+    b2Vec2 upper = lower;
+    for( int32 i = first + 1; i <= first + count; ++i ) {
+      lower = b2Min( lower, m_vertices [ i ] );
+      upper = b2Max( upper, m_vertices [ i ] );
+    }
+
+    b2Vec2 r( m_radius, m_radius );
+    node->aabb.lowerBound = lower - r;
+    node->aabb.upperBound = upper + r;
+    node->count = count;
+    node->skip = nodeIndex + 1;
+    return node->skip;
+  }
+
+  int32 half = count / 2;
+  int32 child2 = BuildNode( nodeIndex + 1, first, half );
+  int32 next = BuildNode( child2, first + half, count - half );
+
+  node->aabb.Combine( m_nodes [ nodeIndex + 1 ].aabb, m_nodes [ child2 ].aabb );
+  node->count = 0;
+  node->skip = next;
+  return next;
 }
 
 b2Shape* b2ChainShape::Clone( b2BlockAllocator* allocator ) const {
   void* mem = allocator->Allocate( sizeof( b2ChainShape ) );
   b2ChainShape* clone = new( mem ) b2ChainShape;
+  clone->m_singleProxy = m_singleProxy;
   clone->CreateChain( m_vertices, m_count, m_prevVertex, m_nextVertex );
   return clone;
 }
@@ -87,6 +158,90 @@ int32 b2ChainShape::GetChildCount() const {
   return m_count - 1;
 }
 
+int32 b2ChainShape::GetProxyCount() const {
+  return m_singleProxy ? 1 : m_count - 1;
+}
+
+void b2ChainShape::ComputeProxyAABB( b2AABB* aabb, const b2Transform& xf, int32 proxyIndex ) const {
+  if( m_singleProxy == false ) {
+    ComputeAABB( aabb, xf, proxyIndex );
+    return;
+  }
+
+  // Bounding the rotated root box is much cheaper than visiting every vertex.
+  b2Assert( proxyIndex == 0 );
+  *aabb = b2Mul( xf, m_nodes [ 0 ].aabb );
+}
+
+void b2ChainShape::QueryChildren( b2ShapeChildCallback* callback, const b2AABB& aabb ) const {
+  if( m_nodes == nullptr ) {
+    b2Shape::QueryChildren( callback, aabb );
+    return;
+  }
+
+  b2Vec2 r( m_radius, m_radius );
+  int32 index = 0;
+  while( index < m_nodeCount ) {
+    const Node& node = m_nodes [ index ];
+    if( b2TestOverlap( node.aabb, aabb ) == false ) {
+      index = node.skip;
+      continue;
+    }
+
+    for( int32 i = node.first; i < node.first + node.count; ++i ) {
+      b2AABB edgeAABB;
+      edgeAABB.lowerBound = b2Min( m_vertices [ i ], m_vertices [ i + 1 ] ) - r;
+      edgeAABB.upperBound = b2Max( m_vertices [ i ], m_vertices [ i + 1 ] ) + r;
+      if( b2TestOverlap( edgeAABB, aabb ) && callback->ReportChild( i ) == false )
+        return;
+    }
+
+    ++index;
+  }
+}
+
+bool b2ChainShape::RayCastChildren( b2RayCastOutput* output, int32* childIndex,
+    const b2RayCastInput& input, const b2Transform& xf ) const {
+  if( m_nodes == nullptr )
+    return b2Shape::RayCastChildren( output, childIndex, input, xf );
+
+  // Walk the tree in the chain's frame. Each hit shortens the ray.
+  b2RayCastInput localInput;
+  localInput.p1 = b2MulT( xf, input.p1 );
+  localInput.p2 = b2MulT( xf, input.p2 );
+  localInput.maxFraction = input.maxFraction;
+  b2Vec2 d = localInput.p2 - localInput.p1;
+
+  b2Transform identity;
+  identity.SetIdentity();
+  bool hit = false;
+  int32 index = 0;
+  while( index < m_nodeCount ) {
+    const Node& node = m_nodes [ index ];
+    if( b2TestSegmentOverlap( localInput.p1, d, localInput.maxFraction, node.aabb ) == false ) {
+      index = node.skip;
+      continue;
+    }
+
+    for( int32 i = node.first; i < node.first + node.count; ++i ) {
+      b2RayCastOutput edgeOutput;
+      if( RayCast( &edgeOutput, localInput, identity, i ) ) {
+        *output = edgeOutput;
+        *childIndex = i;
+        localInput.maxFraction = edgeOutput.fraction;
+        hit = true;
+      }
+    }
+
+    ++index;
+  }
+
+  if( hit )
+    output->normal = b2Mul( xf.q, output->normal );
+
+  return hit;
+}
+
 void b2ChainShape::GetChildEdge( b2EdgeShape* edge, int32 index ) const {
   b2Assert( 0 <= index && index < m_count - 1 );
   edge->m_type = b2Shape::e_edge;
@@ -113,6 +268,13 @@ void b2ChainShape::ComputeDistance( const b2Transform& xf, const b2Vec2& p, floa
   edge.ComputeDistance( xf, p, distance, normal, 0 );
 }
 
+void b2ChainShape::ComputeDistances( const b2Transform& xf, const b2Vec2* points, int32 count,
+    float* distances, b2Vec2* normals, int32 childIndex ) const {
+  b2EdgeShape edge;
+  GetChildEdge( &edge, childIndex );
+  edge.b2EdgeShape::ComputeDistances( xf, points, count, distances, normals, 0 );
+}
+
 bool b2ChainShape::TestPoint( const b2Transform& xf, const b2Vec2& p ) const {
   B2_NOT_USED( xf );
   B2_NOT_USED( p );
@@ -136,6 +298,18 @@ bool b2ChainShape::RayCast( b2RayCastOutput* output, const b2RayCastInput& input
   return edgeShape.RayCast( output, input, xf, 0 );
 }
 
+int32 b2ChainShape::RayCasts( b2RayCastOutput* outputs, bool* hits, const b2RayCastInput* inputs, int32 count,
+    const b2Transform& xf, int32 childIndex ) const {
+  b2Assert( childIndex < m_count );
+
+  // Like RayCast, the edge is two-sided.
+  b2EdgeShape edgeShape;
+  edgeShape.m_vertex1 = m_vertices [ childIndex ];
+  edgeShape.m_vertex2 = m_vertices [ childIndex + 1 < m_count ? childIndex + 1 : 0 ];
+
+  return edgeShape.b2EdgeShape::RayCasts( outputs, hits, inputs, count, xf, 0 );
+}
+
 void b2ChainShape::ComputeAABB( b2AABB* aabb, const b2Transform& xf, int32 childIndex ) const {
   b2Assert( childIndex < m_count );
 
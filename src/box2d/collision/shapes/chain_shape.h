@@ -56,12 +56,36 @@ class B2_API b2ChainShape : public b2Shape {
     void CreateChain( const b2Vec2* vertices, int32 count,
         const b2Vec2& prevVertex, const b2Vec2& nextVertex );
 
+    /// Cover the whole chain with a single broad-phase proxy instead of one proxy per
+    /// edge. The chain then keeps a bounding volume tree over its edges to find the
+    /// edges that overlap other shapes. This suits long chains and chains on moving
+    /// bodies. Set this before creating the fixture.
+    void SetSingleProxy( bool flag );
+
+    /// Does a single proxy cover the whole chain?
+    bool IsSingleProxy() const;
+
     /// Implement b2Shape. Vertices are cloned using b2Alloc.
     b2Shape* Clone( b2BlockAllocator* allocator ) const override;
 
     /// @see b2Shape::GetChildCount
     int32 GetChildCount() const override;
 
+    /// @see b2Shape::GetProxyCount
+    int32 GetProxyCount() const override;
+
+    /// @see b2Shape::ComputeProxyAABB
+    void ComputeProxyAABB( b2AABB* aabb, const b2Transform& transform, int32 proxyIndex ) const override;
+
+    /// This uses the edge tree when there is one.
+    /// @see b2Shape::QueryChildren
+    void QueryChildren( b2ShapeChildCallback* callback, const b2AABB& aabb ) const override;
+
+    /// This uses the edge tree when there is one.
+    /// @see b2Shape::RayCastChildren
+    bool RayCastChildren( b2RayCastOutput* output, int32* childIndex,
+        const b2RayCastInput& input, const b2Transform& transform ) const override;
+
     /// Get a child edge.
     void GetChildEdge( b2EdgeShape* edge, int32 index ) const;
 
@@ -76,6 +100,14 @@ class B2_API b2ChainShape : public b2Shape {
     bool RayCast( b2RayCastOutput* output, const b2RayCastInput& input,
         const b2Transform& transform, int32 childIndex ) const override;
 
+    /// @see b2Shape::ComputeDistances
+    void ComputeDistances( const b2Transform& xf, const b2Vec2* points, int32 count,
+        float* distances, b2Vec2* normals, int32 childIndex ) const override;
+
+    /// @see b2Shape::RayCasts
+    int32 RayCasts( b2RayCastOutput* outputs, bool* hits, const b2RayCastInput* inputs, int32 count,
+        const b2Transform& transform, int32 childIndex ) const override;
+
     /// @see b2Shape::ComputeAABB
     void ComputeAABB( b2AABB* aabb, const b2Transform& transform, int32 childIndex ) const override;
 
@@ -90,6 +122,25 @@ class B2_API b2ChainShape : public b2Shape {
     int32 m_count;
 
     b2Vec2 m_prevVertex, m_nextVertex;
+
+  private:
+    // A node of the edge tree. The nodes are stored depth first, so the first child
+    // of a node follows it and skip points past its subtree. Leaves hold a run of
+    // consecutive edges and internal nodes have a zero count.
+    struct Node {
+        b2AABB aabb;
+        int32 skip;
+        int32 first;
+        int32 count;
+    };
+
+    void BuildTree();
+    int32 BuildNode( int32 nodeIndex, int32 first, int32 count );
+
+    // The edge tree, only built for a single proxy.
+    Node* m_nodes;
+    int32 m_nodeCount;
+    bool m_singleProxy;
 };
 
 inline b2ChainShape::b2ChainShape() {
@@ -97,6 +148,13 @@ inline b2ChainShape::b2ChainShape() {
   m_radius = b2_polygonRadius;
   m_vertices = nullptr;
   m_count = 0;
+  m_nodes = nullptr;
+  m_nodeCount = 0;
+  m_singleProxy = false;
+}
+
+inline bool b2ChainShape::IsSingleProxy() const {
+  return m_singleProxy;
 }
 
 #endif
@@ -22,6 +22,7 @@
 
 #include "circle_shape.h"
 
+#include "box2d/collision/simd.h"
 #include "box2d/common/block_allocator.h"
 
 #include <new>
@@ -90,6 +91,92 @@ bool b2CircleShape::RayCast( b2RayCastOutput* output, const b2RayCastInput& inpu
   return false;
 }
 
+void b2CircleShape::TestPoints( const b2Transform& transform, const b2Vec2* points, int32 count, bool* inside ) const {
+  b2Vec2 center = transform.p + b2Mul( transform.q, m_p );
+  float rr = m_radius * m_radius;
+  for( int32 i = 0; i < count; ++i ) {
+    b2Vec2 d = points [ i ] - center;
+    inside [ i ] = b2Dot( d, d ) <= rr;
+  }
+}
+
+void b2CircleShape::ComputeDistances( const b2Transform& transform, const b2Vec2* points, int32 count,
+    float* distances, b2Vec2* normals, int32 childIndex ) const {
+  int32 i = 0;
+
+#if defined(LIQUIDFUN_SIMD_SSE)
+  b2Vec2 center = transform.p + b2Mul( transform.q, m_p );
+  __m128 cx = _mm_set1_ps( center.x );
+  __m128 cy = _mm_set1_ps( center.y );
+  __m128 radius = _mm_set1_ps( m_radius );
+  __m128 one = _mm_set1_ps( 1.0f );
+  for( ; i + 4 <= count; i += 4 ) {
+    __m128 dx, dy;
+    b2LoadPoints( &dx, &dy, points + i );
+    dx = _mm_sub_ps( dx, cx );
+    dy = _mm_sub_ps( dy, cy );
+    __m128 d1 = _mm_sqrt_ps( _mm_add_ps( _mm_mul_ps( dx, dx ), _mm_mul_ps( dy, dy ) ) );
+    __m128 invD1 = _mm_div_ps( one, d1 );
+    _mm_storeu_ps( distances + i, _mm_sub_ps( d1, radius ) );
+    b2StorePoints( normals + i, _mm_mul_ps( invD1, dx ), _mm_mul_ps( invD1, dy ) );
+  }
+#endif // defined(LIQUIDFUN_SIMD_SSE)
+
+  for( ; i < count; ++i )
+    b2CircleShape::ComputeDistance( transform, points [ i ], distances + i, normals + i, childIndex );
+}
+
+int32 b2CircleShape::RayCasts( b2RayCastOutput* outputs, bool* hits, const b2RayCastInput* inputs, int32 count,
+    const b2Transform& transform, int32 childIndex ) const {
+  int32 hitCount = 0;
+  int32 i = 0;
+
+#if defined(LIQUIDFUN_SIMD_SSE)
+  // The same steps as RayCast, with the early outs turned into a hit mask.
+  b2Vec2 position = transform.p + b2Mul( transform.q, m_p );
+  __m128 px = _mm_set1_ps( position.x );
+  __m128 py = _mm_set1_ps( position.y );
+  __m128 radius2 = _mm_set1_ps( m_radius * m_radius );
+  __m128 zero = _mm_setzero_ps();
+  for( ; i + 4 <= count; i += 4 ) {
+    __m128 x1, y1, x2, y2, maxFraction;
+    b2LoadRays( &x1, &y1, &x2, &y2, &maxFraction, inputs + i );
+    __m128 sx = _mm_sub_ps( x1, px );
+    __m128 sy = _mm_sub_ps( y1, py );
+    __m128 b = _mm_sub_ps( _mm_add_ps( _mm_mul_ps( sx, sx ), _mm_mul_ps( sy, sy ) ), radius2 );
+
+    __m128 rx = _mm_sub_ps( x2, x1 );
+    __m128 ry = _mm_sub_ps( y2, y1 );
+    __m128 c = _mm_add_ps( _mm_mul_ps( sx, rx ), _mm_mul_ps( sy, ry ) );
+    __m128 rr = _mm_add_ps( _mm_mul_ps( rx, rx ), _mm_mul_ps( ry, ry ) );
+    __m128 sigma = _mm_sub_ps( _mm_mul_ps( c, c ), _mm_mul_ps( rr, b ) );
+    __m128 hit = _mm_and_ps( _mm_cmpge_ps( sigma, zero ), _mm_cmpge_ps( rr, _mm_set1_ps( b2_epsilon ) ) );
+
+    __m128 a = _mm_sub_ps( zero, _mm_add_ps( c, _mm_sqrt_ps( _mm_max_ps( sigma, zero ) ) ) );
+    hit = _mm_and_ps( hit, _mm_cmpge_ps( a, zero ) );
+    hit = _mm_and_ps( hit, _mm_cmple_ps( a, _mm_mul_ps( maxFraction, rr ) ) );
+    if( _mm_movemask_ps( hit ) == 0 ) {
+      for( int32 j = 0; j < 4; ++j )
+        hits [ i + j ] = false;
+      continue;
+    }
+
+    a = _mm_div_ps( a, rr );
+    __m128 nx = _mm_add_ps( sx, _mm_mul_ps( a, rx ) );
+    __m128 ny = _mm_add_ps( sy, _mm_mul_ps( a, ry ) );
+    b2NormalizeLanes( &nx, &ny );
+    hitCount += b2StoreRayHits( outputs + i, hits + i, hit, a, nx, ny );
+  }
+#endif // defined(LIQUIDFUN_SIMD_SSE)
+
+  for( ; i < count; ++i ) {
+    hits [ i ] = b2CircleShape::RayCast( outputs + i, inputs [ i ], transform, childIndex );
+    hitCount += hits [ i ] ? 1 : 0;
+  }
+
+  return hitCount;
+}
+
 void b2CircleShape::ComputeAABB( b2AABB* aabb, const b2Transform& transform, int32 childIndex ) const {
   B2_NOT_USED( childIndex );
 
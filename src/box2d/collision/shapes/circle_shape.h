@@ -49,6 +49,17 @@ class B2_API b2CircleShape : public b2Shape {
     bool RayCast( b2RayCastOutput* output, const b2RayCastInput& input,
         const b2Transform& transform, int32 childIndex ) const override;
 
+    /// @see b2Shape::TestPoints
+    void TestPoints( const b2Transform& transform, const b2Vec2* points, int32 count, bool* inside ) const override;
+
+    /// @see b2Shape::ComputeDistances
+    void ComputeDistances( const b2Transform& xf, const b2Vec2* points, int32 count,
+        float* distances, b2Vec2* normals, int32 childIndex ) const override;
+
+    /// @see b2Shape::RayCasts
+    int32 RayCasts( b2RayCastOutput* outputs, bool* hits, const b2RayCastInput* inputs, int32 count,
+        const b2Transform& transform, int32 childIndex ) const override;
+
     /// @see b2Shape::ComputeAABB
     void ComputeAABB( b2AABB* aabb, const b2Transform& transform, int32 childIndex ) const override;
 
@@ -0,0 +1,273 @@
+// MIT License
+
+// Copyright (c) 2019 Erin Catto
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include "compound_shape.h"
+
+#include "box2d/common/block_allocator.h"
+#include "capsule_shape.h"
+#include "circle_shape.h"
+#include "polygon_shape.h"
+
+#include <algorithm>
+#include <new>
+
+// Orders children by the center of their box along one axis.
+struct b2CompoundCenterLess {
+  const b2AABB* boxes;
+  bool xAxis;
+
+  bool operator()( int32 a, int32 b ) const {
+    b2Vec2 ca = boxes [ a ].GetCenter();
+    b2Vec2 cb = boxes [ b ].GetCenter();
+    return xAxis ? ca.x < cb.x : ca.y < cb.y;
+  }
+};
+
+static b2Shape* b2CopyChild( const b2Shape* shape ) {
+  switch( shape->GetType() ) {
+    case b2Shape::e_circle:
+      {
+        void* mem = b2Alloc( sizeof( b2CircleShape ) );
+        return new( mem ) b2CircleShape( *(const b2CircleShape*) shape );
+      }
+
+    case b2Shape::e_polygon:
+      {
+        void* mem = b2Alloc( sizeof( b2PolygonShape ) );
+        return new( mem ) b2PolygonShape( *(const b2PolygonShape*) shape );
+      }
+
+    case b2Shape::e_capsule:
+      {
+        void* mem = b2Alloc( sizeof( b2CapsuleShape ) );
+        return new( mem ) b2CapsuleShape( *(const b2CapsuleShape*) shape );
+      }
+
+    default:
+      // Only convex shapes with a single child can be part of a compound.
+      b2Assert( false );
+      return nullptr;
+  }
+}
+
+b2CompoundShape::~b2CompoundShape() {
+  Clear();
+}
+
+void b2CompoundShape::Clear() {
+  for( int32 i = 0; i < m_count; ++i ) {
+    m_children [ i ]->~b2Shape();
+    b2Free( m_children [ i ] );
+  }
+
+  b2Free( m_children );
+  m_children = nullptr;
+  m_count = 0;
+  b2Free( m_nodes );
+  m_nodes = nullptr;
+  m_nodeCount = 0;
+}
+
+void b2CompoundShape::Create( const b2Shape* const* shapes, int32 count ) {
+  b2Assert( m_children == nullptr && m_count == 0 );
+  b2Assert( count >= 1 );
+  if( count < 1 )
+    return;
+
+  b2Transform identity;
+  identity.SetIdentity();
+
+  m_count = count;
+  m_children = (b2Shape**) b2Alloc( count * sizeof( b2Shape* ) );
+  b2AABB* boxes = (b2AABB*) b2Alloc( count * sizeof( b2AABB ) );
+  int32* children = (int32*) b2Alloc( count * sizeof( int32 ) );
+  for( int32 i = 0; i < count; ++i ) {
+    m_children [ i ] = b2CopyChild( shapes [ i ] );
+    m_children [ i ]->ComputeAABB( boxes + i, identity, 0 );
+    children [ i ] = i;
+  }
+
+  m_nodeCount = 2 * count - 1;
+  m_nodes = (Node*) b2Alloc( m_nodeCount * sizeof( Node ) );
+  int32 nodeCount = BuildNode( 0, children, boxes, count );
+  b2Assert( nodeCount == m_nodeCount );
+  B2_NOT_USED( nodeCount );
+
+  b2Free( children );
+  b2Free( boxes );
+}
+
+int32 b2CompoundShape::BuildNode( int32 nodeIndex, int32* children, const b2AABB* boxes, int32 count ) {
+  if( count == 1 ) {
+    Node* node = m_nodes + nodeIndex;
+    node->aabb = boxes [ children [ 0 ] ];
+    node->child = children [ 0 ];
+    node->skip = nodeIndex + 1;
+    return node->skip;
+  }
+
+  // Split at the median center along the axis where the centers spread the most.
+  b2Vec2 lower = boxes [ children [ 0 ] ].GetCenter();
+  b2Vec2 upper = lower;
+  for( int32 i = 1; i < count; ++i ) {
+    b2Vec2 center = boxes [ children [ i ] ].GetCenter();
+    lower = b2Min( lower, center );
+    upper = b2Max( upper, center );
+  }
+
+  b2CompoundCenterLess less;
+  less.boxes = boxes;
+  less.xAxis = upper.x - lower.x >= upper.y - lower.y;
+  int32 half = count / 2;
+  std::nth_element( children, children + half, children + count, less );
+
+  int32 child2 = BuildNode( nodeIndex + 1, children, boxes, half );
+  int32 next = BuildNode( child2, children + half, boxes, count - half );
+
+  Node* node = m_nodes + nodeIndex;
+  node->aabb.Combine( m_nodes [ nodeIndex + 1 ].aabb, m_nodes [ child2 ].aabb );
+  node->child = -1;
+  node->skip = next;
+  return next;
+}
+
+b2Shape* b2CompoundShape::Clone( b2BlockAllocator* allocator ) const {
+  void* mem = allocator->Allocate( sizeof( b2CompoundShape ) );
+  b2CompoundShape* clone = new( mem ) b2CompoundShape;
+  clone->Create( m_children, m_count );
+  return clone;
+}
+
+int32 b2CompoundShape::GetChildCount() const {
+  return m_count;
+}
+
+int32 b2CompoundShape::GetProxyCount() const {
+  return 1;
+}
+
+void b2CompoundShape::ComputeProxyAABB( b2AABB* aabb, const b2Transform& xf, int32 proxyIndex ) const {
+  b2Assert( proxyIndex == 0 );
+  B2_NOT_USED( proxyIndex );
+  *aabb = b2Mul( xf, m_nodes [ 0 ].aabb );
+}
+
+void b2CompoundShape::QueryChildren( b2ShapeChildCallback* callback, const b2AABB& aabb ) const {
+  int32 index = 0;
+  while( index < m_nodeCount ) {
+    const Node& node = m_nodes [ index ];
+    if( b2TestOverlap( node.aabb, aabb ) == false ) {
+      index = node.skip;
+      continue;
+    }
+
+    if( node.child >= 0 && callback->ReportChild( node.child ) == false )
+      return;
+
+    ++index;
+  }
+}
+
+bool b2CompoundShape::RayCastChildren( b2RayCastOutput* output, int32* childIndex,
+    const b2RayCastInput& input, const b2Transform& xf ) const {
+  // Walk the tree in the compound's frame. Each hit shortens the ray.
+  b2RayCastInput localInput;
+  localInput.p1 = b2MulT( xf, input.p1 );
+  localInput.p2 = b2MulT( xf, input.p2 );
+  localInput.maxFraction = input.maxFraction;
+  b2Vec2 d = localInput.p2 - localInput.p1;
+
+  b2Transform identity;
+  identity.SetIdentity();
+  bool hit = false;
+  int32 index = 0;
+  while( index < m_nodeCount ) {
+    const Node& node = m_nodes [ index ];
+    if( b2TestSegmentOverlap( localInput.p1, d, localInput.maxFraction, node.aabb ) == false ) {
+      index = node.skip;
+      continue;
+    }
+
+    b2RayCastOutput childOutput;
+    if( node.child >= 0 && m_children [ node.child ]->RayCast( &childOutput, localInput, identity, 0 ) ) {
+      *output = childOutput;
+      *childIndex = node.child;
+      localInput.maxFraction = childOutput.fraction;
+      hit = true;
+    }
+
+    ++index;
+  }
+
+  if( hit )
+    output->normal = b2Mul( xf.q, output->normal );
+
+  return hit;
+}
+
+float b2CompoundShape::GetChildRadius( int32 childIndex ) const {
+  b2Assert( 0 <= childIndex && childIndex < m_count );
+  return m_children [ childIndex ]->m_radius;
+}
+
+bool b2CompoundShape::TestPoint( const b2Transform& xf, const b2Vec2& p ) const {
+  for( int32 i = 0; i < m_count; ++i ) {
+    if( m_children [ i ]->TestPoint( xf, p ) )
+      return true;
+  }
+
+  return false;
+}
+
+void b2CompoundShape::ComputeDistance( const b2Transform& xf, const b2Vec2& p, float* distance, b2Vec2* normal, int32 childIndex ) const {
+  b2Assert( 0 <= childIndex && childIndex < m_count );
+  m_children [ childIndex ]->ComputeDistance( xf, p, distance, normal, 0 );
+}
+
+bool b2CompoundShape::RayCast( b2RayCastOutput* output, const b2RayCastInput& input,
+    const b2Transform& xf, int32 childIndex ) const {
+  b2Assert( 0 <= childIndex && childIndex < m_count );
+  return m_children [ childIndex ]->RayCast( output, input, xf, 0 );
+}
+
+void b2CompoundShape::ComputeAABB( b2AABB* aabb, const b2Transform& xf, int32 childIndex ) const {
+  b2Assert( 0 <= childIndex && childIndex < m_count );
+  m_children [ childIndex ]->ComputeAABB( aabb, xf, 0 );
+}
+
+void b2CompoundShape::ComputeMass( b2MassData* massData, float density ) const {
+  // The children report their inertia about the shared origin, so it simply adds up.
+  massData->mass = 0.0f;
+  massData->center.SetZero();
+  massData->I = 0.0f;
+  for( int32 i = 0; i < m_count; ++i ) {
+    b2MassData childData;
+    m_children [ i ]->ComputeMass( &childData, density );
+    massData->mass += childData.mass;
+    massData->center += childData.mass * childData.center;
+    massData->I += childData.I;
+  }
+
+  if( massData->mass > 0.0f )
+    massData->center *= 1.0f / massData->mass;
+}
@@ -0,0 +1,130 @@
+// MIT License
+
+// Copyright (c) 2019 Erin Catto
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#ifndef B2_COMPOUND_SHAPE_H
+#define B2_COMPOUND_SHAPE_H
+
+#include "box2d/api.h"
+#include "shape.h"
+
+/// A compound shape holds several convex shapes under one fixture. The children are
+/// circles, polygons or capsules given in the body frame. The whole compound uses a
+/// single broad-phase proxy and keeps a bounding volume tree over its children, so
+/// contacts are only made for the children that overlap. This suits bodies built
+/// from many parts.
+class B2_API b2CompoundShape : public b2Shape {
+  public:
+    b2CompoundShape();
+
+    /// The destructor frees the children using b2Free.
+    ~b2CompoundShape();
+
+    /// Clear all data.
+    void Clear();
+
+    /// Create the compound from copies of the given shapes.
+    /// @param shapes an array of circles, polygons and capsules, these are copied
+    /// @param count the shape count
+    void Create( const b2Shape* const* shapes, int32 count );
+
+    /// Get a child shape.
+    const b2Shape* GetChild( int32 index ) const;
+
+    /// Implement b2Shape. Children are cloned using b2Alloc.
+    b2Shape* Clone( b2BlockAllocator* allocator ) const override;
+
+    /// @see b2Shape::GetChildCount
+    int32 GetChildCount() const override;
+
+    /// A compound always has a single proxy.
+    /// @see b2Shape::GetProxyCount
+    int32 GetProxyCount() const override;
+
+    /// @see b2Shape::ComputeProxyAABB
+    void ComputeProxyAABB( b2AABB* aabb, const b2Transform& transform, int32 proxyIndex ) const override;
+
+    /// @see b2Shape::QueryChildren
+    void QueryChildren( b2ShapeChildCallback* callback, const b2AABB& aabb ) const override;
+
+    /// @see b2Shape::RayCastChildren
+    bool RayCastChildren( b2RayCastOutput* output, int32* childIndex,
+        const b2RayCastInput& input, const b2Transform& transform ) const override;
+
+    /// @see b2Shape::GetChildRadius
+    float GetChildRadius( int32 childIndex ) const override;
+
+    /// Is the point inside any of the children?
+    /// @see b2Shape::TestPoint
+    bool TestPoint( const b2Transform& transform, const b2Vec2& p ) const override;
+
+    // @see b2Shape::ComputeDistance
+    void ComputeDistance( const b2Transform& xf, const b2Vec2& p, float* distance, b2Vec2* normal, int32 childIndex ) const override;
+
+    /// Implement b2Shape.
+    bool RayCast( b2RayCastOutput* output, const b2RayCastInput& input,
+        const b2Transform& transform, int32 childIndex ) const override;
+
+    /// @see b2Shape::ComputeAABB
+    void ComputeAABB( b2AABB* aabb, const b2Transform& transform, int32 childIndex ) const override;
+
+    /// The mass is the sum over the children, all with the same density.
+    /// @see b2Shape::ComputeMass
+    void ComputeMass( b2MassData* massData, float density ) const override;
+
+    /// The children. Owned by this class.
+    b2Shape** m_children;
+
+    /// The child count.
+    int32 m_count;
+
+  private:
+    // A node of the child tree. The nodes are stored depth first, so the first child
+    // of a node follows it and skip points past its subtree. Each leaf holds one
+    // child and internal nodes have a child of -1.
+    struct Node {
+        b2AABB aabb;
+        int32 skip;
+        int32 child;
+    };
+
+    int32 BuildNode( int32 nodeIndex, int32* children, const b2AABB* boxes, int32 count );
+
+    Node* m_nodes;
+    int32 m_nodeCount;
+};
+
+inline b2CompoundShape::b2CompoundShape() {
+  m_type = e_compound;
+  m_radius = 0.0f;
+  m_children = nullptr;
+  m_count = 0;
+  m_nodes = nullptr;
+  m_nodeCount = 0;
+}
+
+inline const b2Shape* b2CompoundShape::GetChild( int32 index ) const {
+  b2Assert( 0 <= index && index < m_count );
+  return m_children [ index ];
+}
+
+#endif
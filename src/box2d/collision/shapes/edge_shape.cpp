@@ -22,6 +22,7 @@
 
 #include "edge_shape.h"
 
+#include "box2d/collision/simd.h"
 #include "box2d/common/block_allocator.h"
 
 #include <new>
@@ -85,6 +86,49 @@ void b2EdgeShape::ComputeDistance( const b2Transform& xf, const b2Vec2& p, float
   *normal = d1 > 0 ? 1 / d1 * d : b2Vec2_zero;
 }
 
+void b2EdgeShape::ComputeDistances( const b2Transform& xf, const b2Vec2* points, int32 count,
+    float* distances, b2Vec2* normals, int32 childIndex ) const {
+  int32 i = 0;
+
+#if defined(LIQUIDFUN_SIMD_SSE)
+  b2Vec2 v1 = b2Mul( xf, m_vertex1 );
+  b2Vec2 v2 = b2Mul( xf, m_vertex2 );
+  b2Vec2 s = v2 - v1;
+  __m128 v1x = _mm_set1_ps( v1.x );
+  __m128 v1y = _mm_set1_ps( v1.y );
+  __m128 v2x = _mm_set1_ps( v2.x );
+  __m128 v2y = _mm_set1_ps( v2.y );
+  __m128 sx = _mm_set1_ps( s.x );
+  __m128 sy = _mm_set1_ps( s.y );
+  __m128 s2 = _mm_set1_ps( b2Dot( s, s ) );
+  __m128 zero = _mm_setzero_ps();
+  for( ; i + 4 <= count; i += 4 ) {
+    __m128 x, y;
+    b2LoadPoints( &x, &y, points + i );
+    __m128 dx = _mm_sub_ps( x, v1x );
+    __m128 dy = _mm_sub_ps( y, v1y );
+    __m128 ds = _mm_add_ps( _mm_mul_ps( dx, sx ), _mm_mul_ps( dy, sy ) );
+
+    // Past v2 the closest point is v2, between the vertices it is on the segment.
+    __m128 beyond = _mm_cmpgt_ps( ds, s2 );
+    __m128 inside = _mm_andnot_ps( beyond, _mm_cmpgt_ps( ds, zero ) );
+    __m128 t = _mm_div_ps( ds, s2 );
+    dx = b2Select( beyond, _mm_sub_ps( x, v2x ), b2Select( inside, _mm_sub_ps( dx, _mm_mul_ps( t, sx ) ), dx ) );
+    dy = b2Select( beyond, _mm_sub_ps( y, v2y ), b2Select( inside, _mm_sub_ps( dy, _mm_mul_ps( t, sy ) ), dy ) );
+
+    __m128 d1 = _mm_sqrt_ps( _mm_add_ps( _mm_mul_ps( dx, dx ), _mm_mul_ps( dy, dy ) ) );
+    __m128 invD1 = _mm_div_ps( _mm_set1_ps( 1.0f ), d1 );
+    __m128 positive = _mm_cmpgt_ps( d1, zero );
+    _mm_storeu_ps( distances + i, d1 );
+    b2StorePoints( normals + i, _mm_and_ps( positive, _mm_mul_ps( invD1, dx ) ),
+        _mm_and_ps( positive, _mm_mul_ps( invD1, dy ) ) );
+  }
+#endif // defined(LIQUIDFUN_SIMD_SSE)
+
+  for( ; i < count; ++i )
+    b2EdgeShape::ComputeDistance( xf, points [ i ], distances + i, normals + i, childIndex );
+}
+
 // p = p1 + t * d
 // v = v1 + s * e
 // p1 + t * d = v1 + s * e
@@ -143,6 +187,67 @@ bool b2EdgeShape::RayCast( b2RayCastOutput* output, const b2RayCastInput& input,
   return true;
 }
 
+int32 b2EdgeShape::RayCasts( b2RayCastOutput* outputs, bool* hits, const b2RayCastInput* inputs, int32 count,
+    const b2Transform& xf, int32 childIndex ) const {
+  int32 hitCount = 0;
+  int32 i = 0;
+
+#if defined(LIQUIDFUN_SIMD_SSE)
+  // The same steps as RayCast, with the early outs turned into a hit mask.
+  b2Vec2 v1 = m_vertex1;
+  b2Vec2 e = m_vertex2 - m_vertex1;
+  b2Vec2 normal( e.y, -e.x );
+  normal.Normalize();
+  b2Vec2 worldNormal = b2Mul( xf.q, normal );
+  float rr = b2Dot( e, e );
+
+  __m128 nx = _mm_set1_ps( normal.x );
+  __m128 ny = _mm_set1_ps( normal.y );
+  __m128 v1x = _mm_set1_ps( v1.x );
+  __m128 v1y = _mm_set1_ps( v1.y );
+  __m128 ex = _mm_set1_ps( e.x );
+  __m128 ey = _mm_set1_ps( e.y );
+  __m128 zero = _mm_setzero_ps();
+  __m128 one = _mm_set1_ps( 1.0f );
+  for( ; rr != 0.0f && i + 4 <= count; i += 4 ) {
+    __m128 x1, y1, x2, y2, maxFraction;
+    b2LoadRays( &x1, &y1, &x2, &y2, &maxFraction, inputs + i );
+    b2MulTLanes( &x1, &y1, xf );
+    b2MulTLanes( &x2, &y2, xf );
+    __m128 dx = _mm_sub_ps( x2, x1 );
+    __m128 dy = _mm_sub_ps( y2, y1 );
+
+    __m128 numerator = _mm_add_ps( _mm_mul_ps( nx, _mm_sub_ps( v1x, x1 ) ), _mm_mul_ps( ny, _mm_sub_ps( v1y, y1 ) ) );
+    __m128 back = _mm_cmpgt_ps( numerator, zero );
+    __m128 denominator = _mm_add_ps( _mm_mul_ps( nx, dx ), _mm_mul_ps( ny, dy ) );
+    __m128 hit = _mm_cmpneq_ps( denominator, zero );
+    if( m_oneSided )
+      hit = _mm_andnot_ps( back, hit );
+
+    __m128 t = _mm_div_ps( numerator, denominator );
+    hit = _mm_and_ps( hit, _mm_and_ps( _mm_cmpge_ps( t, zero ), _mm_cmple_ps( t, maxFraction ) ) );
+
+    __m128 qx = _mm_add_ps( x1, _mm_mul_ps( t, dx ) );
+    __m128 qy = _mm_add_ps( y1, _mm_mul_ps( t, dy ) );
+    __m128 s = _mm_add_ps( _mm_mul_ps( _mm_sub_ps( qx, v1x ), ex ), _mm_mul_ps( _mm_sub_ps( qy, v1y ), ey ) );
+    s = _mm_div_ps( s, _mm_set1_ps( rr ) );
+    hit = _mm_and_ps( hit, _mm_and_ps( _mm_cmpge_ps( s, zero ), _mm_cmple_ps( s, one ) ) );
+
+    // Rays that come from behind the edge see the flipped normal.
+    __m128 outX = b2Select( back, _mm_set1_ps( -worldNormal.x ), _mm_set1_ps( worldNormal.x ) );
+    __m128 outY = b2Select( back, _mm_set1_ps( -worldNormal.y ), _mm_set1_ps( worldNormal.y ) );
+    hitCount += b2StoreRayHits( outputs + i, hits + i, hit, t, outX, outY );
+  }
+#endif // defined(LIQUIDFUN_SIMD_SSE)
+
+  for( ; i < count; ++i ) {
+    hits [ i ] = b2EdgeShape::RayCast( outputs + i, inputs [ i ], xf, childIndex );
+    hitCount += hits [ i ] ? 1 : 0;
+  }
+
+  return hitCount;
+}
+
 void b2EdgeShape::ComputeAABB( b2AABB* aabb, const b2Transform& xf, int32 childIndex ) const {
   B2_NOT_USED( childIndex );
 
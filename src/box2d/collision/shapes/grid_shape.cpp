@@ -0,0 +1,419 @@
+// MIT License
+
+// Copyright (c) 2019 Erin Catto
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "grid_shape.h"
+
+#include "box2d/common/block_allocator.h"
+#include "edge_shape.h"
+#include "polygon_shape.h"
+
+#include <new>
+#include <string.h>
+
+b2GridShape::~b2GridShape() {
+  Clear();
+}
+
+void b2GridShape::Clear() {
+  b2Free( m_heights );
+  b2Free( m_tiles );
+  m_heights = nullptr;
+  m_tiles = nullptr;
+  m_columns = 0;
+  m_rows = 0;
+}
+
+void b2GridShape::CreateHeightField( const float* heights, int32 count, float cellWidth, const b2Vec2& origin ) {
+  b2Assert( m_heights == nullptr && m_tiles == nullptr );
+  b2Assert( count >= 2 );
+  b2Assert( cellWidth > b2_linearSlop );
+
+  m_heights = (float*) b2Alloc( count * sizeof( float ) );
+  memcpy( m_heights, heights, count * sizeof( float ) );
+  m_columns = count - 1;
+  m_rows = 1;
+  m_cellSize = cellWidth;
+  m_origin = origin;
+
+  m_minHeight = heights [ 0 ];
+  m_maxHeight = heights [ 0 ];
+  for( int32 i = 1; i < count; ++i ) {
+    m_minHeight = b2Min( m_minHeight, heights [ i ] );
+    m_maxHeight = b2Max( m_maxHeight, heights [ i ] );
+  }
+}
+
+void b2GridShape::CreateTileMap( const uint8* tiles, int32 columns, int32 rows, float cellSize, const b2Vec2& origin ) {
+  b2Assert( m_heights == nullptr && m_tiles == nullptr );
+  b2Assert( columns > 0 && rows > 0 );
+  b2Assert( cellSize > b2_linearSlop );
+
+  int32 count = columns * rows;
+  m_tiles = (uint8*) b2Alloc( count * sizeof( uint8 ) );
+  memcpy( m_tiles, tiles, count * sizeof( uint8 ) );
+  m_columns = columns;
+  m_rows = rows;
+  m_cellSize = cellSize;
+  m_origin = origin;
+  m_minHeight = 0.0f;
+  m_maxHeight = 0.0f;
+}
+
+b2Shape* b2GridShape::Clone( b2BlockAllocator* allocator ) const {
+  void* mem = allocator->Allocate( sizeof( b2GridShape ) );
+  b2GridShape* clone = new( mem ) b2GridShape;
+  if( IsHeightField() )
+    clone->CreateHeightField( m_heights, m_columns + 1, m_cellSize, m_origin );
+  else
+    clone->CreateTileMap( m_tiles, m_columns, m_rows, m_cellSize, m_origin );
+  clone->m_radius = m_radius;
+  return clone;
+}
+
+int32 b2GridShape::GetChildCount() const {
+  return m_columns * m_rows;
+}
+
+int32 b2GridShape::GetProxyCount() const {
+  return 1;
+}
+
+void b2GridShape::GetChildEdge( b2EdgeShape* edge, int32 index ) const {
+  b2Assert( IsHeightField() );
+  b2Assert( 0 <= index && index < m_columns );
+  edge->m_type = b2Shape::e_edge;
+  edge->m_radius = m_radius;
+
+  // Run the segment right to left so that the normal points up.
+  float w = m_cellSize;
+  b2Vec2 p1 = m_origin + b2Vec2( index * w, m_heights [ index ] );
+  b2Vec2 p2 = m_origin + b2Vec2( ( index + 1 ) * w, m_heights [ index + 1 ] );
+  edge->m_vertex1 = p2;
+  edge->m_vertex2 = p1;
+  edge->m_oneSided = true;
+
+  // The ends continue straight on.
+  if( index + 2 <= m_columns )
+    edge->m_vertex0 = m_origin + b2Vec2( ( index + 2 ) * w, m_heights [ index + 2 ] );
+  else
+    edge->m_vertex0 = 2.0f * p2 - p1;
+
+  if( index > 0 )
+    edge->m_vertex3 = m_origin + b2Vec2( ( index - 1 ) * w, m_heights [ index - 1 ] );
+  else
+    edge->m_vertex3 = 2.0f * p1 - p2;
+}
+
+void b2GridShape::GetChildBox( b2PolygonShape* box, int32 index ) const {
+  b2Assert( IsHeightField() == false );
+  b2Assert( 0 <= index && index < m_columns * m_rows );
+  int32 column = index % m_columns;
+  int32 row = index / m_columns;
+  float h = 0.5f * m_cellSize;
+  b2Vec2 center = m_origin + b2Vec2( column * m_cellSize + h, row * m_cellSize + h );
+  box->SetAsBox( h, h, center, 0.0f );
+  box->m_radius = m_radius;
+}
+
+bool b2GridShape::TestPoint( const b2Transform& xf, const b2Vec2& p ) const {
+  if( IsHeightField() )
+    return false;
+
+  b2Vec2 localP = b2MulT( xf, p ) - m_origin;
+  float x = floorf( localP.x / m_cellSize );
+  float y = floorf( localP.y / m_cellSize );
+  if( x < 0.0f || y < 0.0f || x >= float( m_columns ) || y >= float( m_rows ) )
+    return false;
+
+  return m_tiles [ int32( y ) * m_columns + int32( x ) ] != 0;
+}
+
+void b2GridShape::ComputeDistance( const b2Transform& xf, const b2Vec2& p, float* distance, b2Vec2* normal, int32 childIndex ) const {
+  if( IsHeightField() ) {
+    b2EdgeShape edge;
+    GetChildEdge( &edge, childIndex );
+    edge.ComputeDistance( xf, p, distance, normal, 0 );
+    return;
+  }
+
+  if( m_tiles [ childIndex ] == 0 ) {
+    *distance = b2_maxFloat;
+    normal->SetZero();
+    return;
+  }
+
+  b2PolygonShape box;
+  GetChildBox( &box, childIndex );
+  box.ComputeDistance( xf, p, distance, normal, 0 );
+}
+
+bool b2GridShape::RayCast( b2RayCastOutput* output, const b2RayCastInput& input,
+    const b2Transform& xf, int32 childIndex ) const {
+  if( IsHeightField() ) {
+    b2EdgeShape edge;
+    GetChildEdge( &edge, childIndex );
+    return edge.RayCast( output, input, xf, 0 );
+  }
+
+  if( m_tiles [ childIndex ] == 0 )
+    return false;
+
+  b2PolygonShape box;
+  GetChildBox( &box, childIndex );
+  return box.RayCast( output, input, xf, 0 );
+}
+
+void b2GridShape::ComputeAABB( b2AABB* aabb, const b2Transform& xf, int32 childIndex ) const {
+  b2Vec2 r( m_radius, m_radius );
+  if( IsHeightField() ) {
+    b2Assert( 0 <= childIndex && childIndex < m_columns );
+    float w = m_cellSize;
+    b2Vec2 v1 = b2Mul( xf, m_origin + b2Vec2( childIndex * w, m_heights [ childIndex ] ) );
+    b2Vec2 v2 = b2Mul( xf, m_origin + b2Vec2( ( childIndex + 1 ) * w, m_heights [ childIndex + 1 ] ) );
+    aabb->lowerBound = b2Min( v1, v2 ) - r;
+    aabb->upperBound = b2Max( v1, v2 ) + r;
+    return;
+  }
+
+  b2Assert( 0 <= childIndex && childIndex < m_columns * m_rows );
+  int32 column = childIndex % m_columns;
+  int32 row = childIndex / m_columns;
+  b2AABB cell;
+  cell.lowerBound = m_origin + m_cellSize * b2Vec2( float( column ), float( row ) );
+  cell.upperBound = cell.lowerBound + b2Vec2( m_cellSize, m_cellSize );
+  *aabb = b2Mul( xf, cell );
+  aabb->lowerBound -= r;
+  aabb->upperBound += r;
+}
+
+void b2GridShape::ComputeProxyAABB( b2AABB* aabb, const b2Transform& xf, int32 proxyIndex ) const {
+  B2_NOT_USED( proxyIndex );
+  b2Vec2 r( m_radius, m_radius );
+  *aabb = b2Mul( xf, GetLocalBounds() );
+  aabb->lowerBound -= r;
+  aabb->upperBound += r;
+}
+
+b2AABB b2GridShape::GetLocalBounds() const {
+  b2AABB bounds;
+  if( IsHeightField() ) {
+    bounds.lowerBound = m_origin + b2Vec2( 0.0f, m_minHeight );
+    bounds.upperBound = m_origin + b2Vec2( m_columns * m_cellSize, m_maxHeight );
+  } else {
+    bounds.lowerBound = m_origin;
+    bounds.upperBound = m_origin + m_cellSize * b2Vec2( float( m_columns ), float( m_rows ) );
+  }
+  return bounds;
+}
+
+bool b2GridShape::GetCellRange( const b2AABB& aabb, int32* lowerX, int32* lowerY, int32* upperX, int32* upperY ) const {
+  b2AABB bounds = GetLocalBounds();
+  b2Vec2 r( m_radius, m_radius );
+  bounds.lowerBound -= r;
+  bounds.upperBound += r;
+  if( b2TestOverlap( aabb, bounds ) == false )
+    return false;
+
+  // Clamp in float so that huge boxes cannot overflow the cell indices.
+  float invSize = 1.0f / m_cellSize;
+  b2Vec2 lower = invSize * ( aabb.lowerBound - r - m_origin );
+  b2Vec2 upper = invSize * ( aabb.upperBound + r - m_origin );
+  *lowerX = int32( b2Clamp( floorf( lower.x ), 0.0f, float( m_columns - 1 ) ) );
+  *upperX = int32( b2Clamp( floorf( upper.x ), 0.0f, float( m_columns - 1 ) ) );
+
+  if( IsHeightField() ) {
+    *lowerY = 0;
+    *upperY = 0;
+  } else {
+    *lowerY = int32( b2Clamp( floorf( lower.y ), 0.0f, float( m_rows - 1 ) ) );
+    *upperY = int32( b2Clamp( floorf( upper.y ), 0.0f, float( m_rows - 1 ) ) );
+  }
+
+  return true;
+}
+
+void b2GridShape::QueryChildren( b2ShapeChildCallback* callback, const b2AABB& aabb ) const {
+  int32 lowerX, lowerY, upperX, upperY;
+  if( GetCellRange( aabb, &lowerX, &lowerY, &upperX, &upperY ) == false )
+    return;
+
+  if( IsHeightField() ) {
+    // Skip the segments that pass above or below the box.
+    for( int32 i = lowerX; i <= upperX; ++i ) {
+      float y1 = m_origin.y + m_heights [ i ];
+      float y2 = m_origin.y + m_heights [ i + 1 ];
+      if( b2Max( y1, y2 ) + m_radius < aabb.lowerBound.y || aabb.upperBound.y < b2Min( y1, y2 ) - m_radius )
+        continue;
+
+      if( callback->ReportChild( i ) == false )
+        return;
+    }
+    return;
+  }
+
+  for( int32 j = lowerY; j <= upperY; ++j ) {
+    for( int32 i = lowerX; i <= upperX; ++i ) {
+      int32 index = j * m_columns + i;
+      if( m_tiles [ index ] != 0 && callback->ReportChild( index ) == false )
+        return;
+    }
+  }
+}
+
+bool b2GridShape::RayCastChildren( b2RayCastOutput* output, int32* childIndex,
+    const b2RayCastInput& input, const b2Transform& xf ) const {
+  // Walk the cells in the grid's frame.
+  b2RayCastInput localInput;
+  localInput.p1 = b2MulT( xf, input.p1 );
+  localInput.p2 = b2MulT( xf, input.p2 );
+  localInput.maxFraction = input.maxFraction;
+
+  bool hit;
+  if( IsHeightField() )
+    hit = RayCastHeightField( output, childIndex, localInput );
+  else
+    hit = RayCastTileMap( output, childIndex, localInput );
+
+  if( hit )
+    output->normal = b2Mul( xf.q, output->normal );
+
+  return hit;
+}
+
+bool b2GridShape::RayCastHeightField( b2RayCastOutput* output, int32* childIndex, const b2RayCastInput& input ) const {
+  // The columns are visited in ray order, so the first hit is the closest.
+  float x1 = input.p1.x;
+  float x2 = input.p1.x + input.maxFraction * ( input.p2.x - input.p1.x );
+  float f1 = floorf( ( x1 - m_origin.x ) / m_cellSize );
+  float f2 = floorf( ( x2 - m_origin.x ) / m_cellSize );
+  float lastColumn = float( m_columns - 1 );
+  if( b2Max( f1, f2 ) < 0.0f || lastColumn < b2Min( f1, f2 ) )
+    return false;
+
+  int32 first = int32( b2Clamp( f1, 0.0f, lastColumn ) );
+  int32 last = int32( b2Clamp( f2, 0.0f, lastColumn ) );
+  int32 step = first <= last ? 1 : -1;
+
+  b2Transform identity;
+  identity.SetIdentity();
+  for( int32 i = first;; i += step ) {
+    b2EdgeShape edge;
+    GetChildEdge( &edge, i );
+    if( edge.RayCast( output, input, identity, 0 ) ) {
+      *childIndex = i;
+      return true;
+    }
+
+    if( i == last )
+      break;
+  }
+
+  return false;
+}
+
+bool b2GridShape::RayCastTileMap( b2RayCastOutput* output, int32* childIndex, const b2RayCastInput& input ) const {
+  b2Vec2 p1 = input.p1;
+  b2Vec2 d = input.p2 - input.p1;
+
+  // Clip the ray to the grid.
+  b2AABB bounds = GetLocalBounds();
+  float tMin = 0.0f;
+  float tMax = input.maxFraction;
+  for( int32 axis = 0; axis < 2; ++axis ) {
+    float p = axis == 0 ? p1.x : p1.y;
+    float dp = axis == 0 ? d.x : d.y;
+    float lower = axis == 0 ? bounds.lowerBound.x : bounds.lowerBound.y;
+    float upper = axis == 0 ? bounds.upperBound.x : bounds.upperBound.y;
+    if( dp == 0.0f ) {
+      if( p < lower || upper < p )
+        return false;
+      continue;
+    }
+
+    float t1 = ( lower - p ) / dp;
+    float t2 = ( upper - p ) / dp;
+    tMin = b2Max( tMin, b2Min( t1, t2 ) );
+    tMax = b2Min( tMax, b2Max( t1, t2 ) );
+    if( tMax < tMin )
+      return false;
+  }
+
+  // Step from cell to cell (Amanatides and Woo).
+  float s = m_cellSize;
+  b2Vec2 start = p1 + tMin * d - m_origin;
+  int32 x = int32( b2Clamp( floorf( start.x / s ), 0.0f, float( m_columns - 1 ) ) );
+  int32 y = int32( b2Clamp( floorf( start.y / s ), 0.0f, float( m_rows - 1 ) ) );
+
+  int32 stepX = 0, stepY = 0;
+  float nextX = b2_maxFloat, nextY = b2_maxFloat;
+  float deltaX = 0.0f, deltaY = 0.0f;
+  if( d.x != 0.0f ) {
+    stepX = d.x > 0.0f ? 1 : -1;
+    float boundary = m_origin.x + ( d.x > 0.0f ? x + 1 : x ) * s;
+    nextX = ( boundary - p1.x ) / d.x;
+    deltaX = s / b2Abs( d.x );
+  }
+
+  if( d.y != 0.0f ) {
+    stepY = d.y > 0.0f ? 1 : -1;
+    float boundary = m_origin.y + ( d.y > 0.0f ? y + 1 : y ) * s;
+    nextY = ( boundary - p1.y ) / d.y;
+    deltaY = s / b2Abs( d.y );
+  }
+
+  // The cells are visited in ray order, so the first hit is the closest.
+  b2Transform identity;
+  identity.SetIdentity();
+  for( ;; ) {
+    int32 index = y * m_columns + x;
+    if( m_tiles [ index ] != 0 ) {
+      b2PolygonShape box;
+      GetChildBox( &box, index );
+      if( box.RayCast( output, input, identity, 0 ) ) {
+        *childIndex = index;
+        return true;
+      }
+    }
+
+    if( nextX < nextY ) {
+      x += stepX;
+      if( tMax < nextX || x < 0 || m_columns <= x )
+        break;
+      nextX += deltaX;
+    } else {
+      y += stepY;
+      if( tMax < nextY || stepY == 0 || y < 0 || m_rows <= y )
+        break;
+      nextY += deltaY;
+    }
+  }
+
+  return false;
+}
+
+void b2GridShape::ComputeMass( b2MassData* massData, float density ) const {
+  B2_NOT_USED( density );
+
+  massData->mass = 0.0f;
+  massData->center.SetZero();
+  massData->I = 0.0f;
+}
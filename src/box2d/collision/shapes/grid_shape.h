@@ -0,0 +1,164 @@
+// MIT License
+
+// Copyright (c) 2019 Erin Catto
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef B2_GRID_SHAPE_H
+#define B2_GRID_SHAPE_H
+
+#include "box2d/api.h"
+#include "shape.h"
+
+class b2EdgeShape;
+class b2PolygonShape;
+
+/// A grid shape holds static terrain laid out on a regular grid. The whole grid
+/// uses a single broad-phase proxy and finds its overlapping cells directly.
+/// A height field has one segment per column, joined like a chain with the surface
+/// normal pointing up. A tile map has one square child per cell and only the
+/// solid cells collide.
+class B2_API b2GridShape : public b2Shape {
+  public:
+    b2GridShape();
+
+    /// The destructor frees the cells using b2Free.
+    ~b2GridShape();
+
+    /// Clear all data.
+    void Clear();
+
+    /// Create a height field. Sample i is at origin + (i * cellWidth, heights[i]).
+    /// @param heights an array of heights, these are copied
+    /// @param count the sample count, at least two
+    /// @param cellWidth the horizontal distance between samples
+    /// @param origin the position of the first sample at zero height
+    void CreateHeightField( const float* heights, int32 count, float cellWidth, const b2Vec2& origin );
+
+    /// Create a tile map. The cell in column i and row j covers the square with the
+    /// lower corner at origin + cellSize * (i, j).
+    /// @param tiles the tiles row by row, non-zero tiles are solid. These are copied.
+    /// @param columns the number of columns
+    /// @param rows the number of rows
+    /// @param cellSize the side length of a cell
+    /// @param origin the lower corner of the grid
+    void CreateTileMap( const uint8* tiles, int32 columns, int32 rows, float cellSize, const b2Vec2& origin );
+
+    /// Is this a height field rather than a tile map?
+    bool IsHeightField() const;
+
+    /// Is the child a solid cell? Height field segments are always solid.
+    bool IsSolid( int32 index ) const;
+
+    /// Get a height field segment.
+    void GetChildEdge( b2EdgeShape* edge, int32 index ) const;
+
+    /// Get a solid tile as a box.
+    void GetChildBox( b2PolygonShape* box, int32 index ) const;
+
+    /// Implement b2Shape. Cells are cloned using b2Alloc.
+    b2Shape* Clone( b2BlockAllocator* allocator ) const override;
+
+    /// @see b2Shape::GetChildCount
+    int32 GetChildCount() const override;
+
+    /// The grid always uses a single proxy.
+    /// @see b2Shape::GetProxyCount
+    int32 GetProxyCount() const override;
+
+    /// A height field has no interior, so this only reports points in solid tiles.
+    /// @see b2Shape::TestPoint
+    bool TestPoint( const b2Transform& transform, const b2Vec2& p ) const override;
+
+    // @see b2Shape::ComputeDistance
+    void ComputeDistance( const b2Transform& xf, const b2Vec2& p, float* distance, b2Vec2* normal, int32 childIndex ) const override;
+
+    /// Rays only hit the top of a height field.
+    /// @see b2Shape::RayCast
+    bool RayCast( b2RayCastOutput* output, const b2RayCastInput& input,
+        const b2Transform& transform, int32 childIndex ) const override;
+
+    /// @see b2Shape::ComputeAABB
+    void ComputeAABB( b2AABB* aabb, const b2Transform& transform, int32 childIndex ) const override;
+
+    /// @see b2Shape::ComputeProxyAABB
+    void ComputeProxyAABB( b2AABB* aabb, const b2Transform& transform, int32 proxyIndex ) const override;
+
+    /// This visits only the cells under the box.
+    /// @see b2Shape::QueryChildren
+    void QueryChildren( b2ShapeChildCallback* callback, const b2AABB& aabb ) const override;
+
+    /// This walks the cells along the ray and stops at the first hit.
+    /// @see b2Shape::RayCastChildren
+    bool RayCastChildren( b2RayCastOutput* output, int32* childIndex,
+        const b2RayCastInput& input, const b2Transform& transform ) const override;
+
+    /// Grids have zero mass.
+    /// @see b2Shape::ComputeMass
+    void ComputeMass( b2MassData* massData, float density ) const override;
+
+    /// The height field samples. Owned by this class.
+    float* m_heights;
+
+    /// The tiles. Owned by this class.
+    uint8* m_tiles;
+
+    /// The cell counts. A height field has a single row.
+    int32 m_columns;
+    int32 m_rows;
+
+    float m_cellSize;
+    b2Vec2 m_origin;
+
+    /// The height range of a height field.
+    float m_minHeight, m_maxHeight;
+
+  private:
+    // The local bounds of all cells.
+    b2AABB GetLocalBounds() const;
+
+    // The range of cells under a local box, false if it misses the grid.
+    bool GetCellRange( const b2AABB& aabb, int32* lowerX, int32* lowerY, int32* upperX, int32* upperY ) const;
+
+    bool RayCastHeightField( b2RayCastOutput* output, int32* childIndex, const b2RayCastInput& input ) const;
+    bool RayCastTileMap( b2RayCastOutput* output, int32* childIndex, const b2RayCastInput& input ) const;
+};
+
+inline b2GridShape::b2GridShape() {
+  m_type = e_grid;
+  m_radius = b2_polygonRadius;
+  m_heights = nullptr;
+  m_tiles = nullptr;
+  m_columns = 0;
+  m_rows = 0;
+  m_cellSize = 1.0f;
+  m_origin.SetZero();
+  m_minHeight = 0.0f;
+  m_maxHeight = 0.0f;
+}
+
+inline bool b2GridShape::IsHeightField() const {
+  return m_heights != nullptr;
+}
+
+inline bool b2GridShape::IsSolid( int32 index ) const {
+  return m_tiles == nullptr || m_tiles [ index ] != 0;
+}
+
+#endif
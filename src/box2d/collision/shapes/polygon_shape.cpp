@@ -22,6 +22,7 @@
 
 #include "polygon_shape.h"
 
+#include "box2d/collision/simd.h"
 #include "box2d/common/block_allocator.h"
 
 #include <new>
@@ -31,6 +32,7 @@ b2PolygonShape::b2PolygonShape() {
   m_radius = b2_polygonRadius;
   m_count = 0;
   m_centroid.SetZero();
+  m_isBox = false;
 }
 
 b2Shape* b2PolygonShape::Clone( b2BlockAllocator* allocator ) const {
@@ -51,6 +53,7 @@ void b2PolygonShape::SetAsBox( float hx, float hy ) {
   m_normals [ 2 ].Set( 0.0f, 1.0f );
   m_normals [ 3 ].Set( -1.0f, 0.0f );
   m_centroid.SetZero();
+  m_isBox = true;
 }
 
 void b2PolygonShape::SetAsBox( float hx, float hy, const b2Vec2& center, float angle ) {
@@ -64,6 +67,7 @@ void b2PolygonShape::SetAsBox( float hx, float hy, const b2Vec2& center, float a
   m_normals [ 2 ].Set( 0.0f, 1.0f );
   m_normals [ 3 ].Set( -1.0f, 0.0f );
   m_centroid = center;
+  m_isBox = true;
 
   b2Transform xf;
   xf.p = center;
@@ -131,6 +135,7 @@ void b2PolygonShape::Set( const b2Hull& hull ) {
   b2Assert( hull.count >= 3 );
 
   m_count = hull.count;
+  m_isBox = false;
 
   // Copy vertices
   for( int32 i = 0; i < hull.count; ++i )
@@ -162,6 +167,34 @@ bool b2PolygonShape::TestPoint( const b2Transform& xf, const b2Vec2& p ) const {
   return true;
 }
 
+void b2PolygonShape::TestPoints( const b2Transform& xf, const b2Vec2* points, int32 count, bool* inside ) const {
+  int32 i = 0;
+
+#if defined(LIQUIDFUN_SIMD_SSE)
+  __m128 zero = _mm_setzero_ps();
+  for( ; i + 4 <= count; i += 4 ) {
+    __m128 x, y;
+    b2LoadPoints( &x, &y, points + i );
+    b2MulTLanes( &x, &y, xf );
+
+    __m128 outside = _mm_setzero_ps();
+    for( int32 j = 0; j < m_count; ++j ) {
+      __m128 dx = _mm_sub_ps( x, _mm_set1_ps( m_vertices [ j ].x ) );
+      __m128 dy = _mm_sub_ps( y, _mm_set1_ps( m_vertices [ j ].y ) );
+      __m128 dot = _mm_add_ps( _mm_mul_ps( _mm_set1_ps( m_normals [ j ].x ), dx ), _mm_mul_ps( _mm_set1_ps( m_normals [ j ].y ), dy ) );
+      outside = _mm_or_ps( outside, _mm_cmpgt_ps( dot, zero ) );
+    }
+
+    int32 bits = _mm_movemask_ps( outside );
+    for( int32 j = 0; j < 4; ++j )
+      inside [ i + j ] = ( bits & ( 1 << j ) ) == 0;
+  }
+#endif // defined(LIQUIDFUN_SIMD_SSE)
+
+  for( ; i < count; ++i )
+    inside [ i ] = b2PolygonShape::TestPoint( xf, points [ i ] );
+}
+
 void b2PolygonShape::ComputeDistance( const b2Transform& xf, const b2Vec2& p, float* distance, b2Vec2* normal, int32 childIndex ) const {
   B2_NOT_USED( childIndex );
 
@@ -198,6 +231,62 @@ void b2PolygonShape::ComputeDistance( const b2Transform& xf, const b2Vec2& p, fl
   }
 }
 
+void b2PolygonShape::ComputeDistances( const b2Transform& xf, const b2Vec2* points, int32 count,
+    float* distances, b2Vec2* normals, int32 childIndex ) const {
+  int32 i = 0;
+
+#if defined(LIQUIDFUN_SIMD_SSE)
+  // Four points at a time against every face, keeping both outcomes of
+  // ComputeDistance and picking one per lane at the end.
+  __m128 zero = _mm_setzero_ps();
+  for( ; i + 4 <= count; i += 4 ) {
+    __m128 x, y;
+    b2LoadPoints( &x, &y, points + i );
+    b2MulTLanes( &x, &y, xf );
+
+    __m128 maxDistance = _mm_set1_ps( -FLT_MAX );
+    __m128 faceX = x;
+    __m128 faceY = y;
+    for( int32 j = 0; j < m_count; ++j ) {
+      __m128 normalX = _mm_set1_ps( m_normals [ j ].x );
+      __m128 normalY = _mm_set1_ps( m_normals [ j ].y );
+      __m128 dx = _mm_sub_ps( x, _mm_set1_ps( m_vertices [ j ].x ) );
+      __m128 dy = _mm_sub_ps( y, _mm_set1_ps( m_vertices [ j ].y ) );
+      __m128 dot = _mm_add_ps( _mm_mul_ps( normalX, dx ), _mm_mul_ps( normalY, dy ) );
+      __m128 greater = _mm_cmpgt_ps( dot, maxDistance );
+      maxDistance = b2Select( greater, dot, maxDistance );
+      faceX = b2Select( greater, normalX, faceX );
+      faceY = b2Select( greater, normalY, faceY );
+    }
+
+    // Outside points may be closer to a vertex.
+    __m128 outside = _mm_cmpgt_ps( maxDistance, zero );
+    __m128 minX = faceX;
+    __m128 minY = faceY;
+    __m128 minDistance2 = _mm_mul_ps( maxDistance, maxDistance );
+    for( int32 j = 0; j < m_count; ++j ) {
+      __m128 dx = _mm_sub_ps( x, _mm_set1_ps( m_vertices [ j ].x ) );
+      __m128 dy = _mm_sub_ps( y, _mm_set1_ps( m_vertices [ j ].y ) );
+      __m128 distance2 = _mm_add_ps( _mm_mul_ps( dx, dx ), _mm_mul_ps( dy, dy ) );
+      __m128 closer = _mm_cmpgt_ps( minDistance2, distance2 );
+      minDistance2 = b2Select( closer, distance2, minDistance2 );
+      minX = b2Select( closer, dx, minX );
+      minY = b2Select( closer, dy, minY );
+    }
+
+    b2MulLanes( &minX, &minY, xf.q );
+    b2NormalizeLanes( &minX, &minY );
+    b2MulLanes( &faceX, &faceY, xf.q );
+
+    _mm_storeu_ps( distances + i, b2Select( outside, _mm_sqrt_ps( minDistance2 ), maxDistance ) );
+    b2StorePoints( normals + i, b2Select( outside, minX, faceX ), b2Select( outside, minY, faceY ) );
+  }
+#endif // defined(LIQUIDFUN_SIMD_SSE)
+
+  for( ; i < count; ++i )
+    b2PolygonShape::ComputeDistance( xf, points [ i ], distances + i, normals + i, childIndex );
+}
+
 bool b2PolygonShape::RayCast( b2RayCastOutput* output, const b2RayCastInput& input,
     const b2Transform& xf, int32 childIndex ) const {
   B2_NOT_USED( childIndex );
@@ -257,6 +346,78 @@ bool b2PolygonShape::RayCast( b2RayCastOutput* output, const b2RayCastInput& inp
   return false;
 }
 
+int32 b2PolygonShape::RayCasts( b2RayCastOutput* outputs, bool* hits, const b2RayCastInput* inputs, int32 count,
+    const b2Transform& xf, int32 childIndex ) const {
+  int32 hitCount = 0;
+  int32 i = 0;
+
+#if defined(LIQUIDFUN_SIMD_SSE)
+  // Clip four rays at a time against every face. A lane that misses stops
+  // counting but keeps going with the others.
+  __m128 zero = _mm_setzero_ps();
+  for( ; i + 4 <= count; i += 4 ) {
+    __m128 x1, y1, x2, y2, maxFraction;
+    b2LoadRays( &x1, &y1, &x2, &y2, &maxFraction, inputs + i );
+    b2MulTLanes( &x1, &y1, xf );
+    b2MulTLanes( &x2, &y2, xf );
+    __m128 dx = _mm_sub_ps( x2, x1 );
+    __m128 dy = _mm_sub_ps( y2, y1 );
+
+    __m128 lower = zero;
+    __m128 upper = maxFraction;
+    __m128 index = _mm_set1_ps( -1.0f );
+    __m128 alive = _mm_cmpeq_ps( zero, zero );
+    for( int32 j = 0; j < m_count; ++j ) {
+      __m128 normalX = _mm_set1_ps( m_normals [ j ].x );
+      __m128 normalY = _mm_set1_ps( m_normals [ j ].y );
+      __m128 numerator = _mm_add_ps( _mm_mul_ps( normalX, _mm_sub_ps( _mm_set1_ps( m_vertices [ j ].x ), x1 ) ),
+          _mm_mul_ps( normalY, _mm_sub_ps( _mm_set1_ps( m_vertices [ j ].y ), y1 ) ) );
+      __m128 denominator = _mm_add_ps( _mm_mul_ps( normalX, dx ), _mm_mul_ps( normalY, dy ) );
+
+      __m128 parallel = _mm_cmpeq_ps( denominator, zero );
+      alive = _mm_andnot_ps( _mm_and_ps( parallel, _mm_cmplt_ps( numerator, zero ) ), alive );
+
+      __m128 fraction = _mm_div_ps( numerator, denominator );
+      __m128 enter = _mm_and_ps( _mm_cmplt_ps( denominator, zero ), _mm_cmplt_ps( numerator, _mm_mul_ps( lower, denominator ) ) );
+      __m128 exit = _mm_andnot_ps( enter, _mm_and_ps( _mm_cmpgt_ps( denominator, zero ),
+          _mm_cmplt_ps( numerator, _mm_mul_ps( upper, denominator ) ) ) );
+      lower = b2Select( enter, fraction, lower );
+      index = b2Select( enter, _mm_set1_ps( float( j ) ), index );
+      upper = b2Select( exit, fraction, upper );
+      alive = _mm_andnot_ps( _mm_cmplt_ps( upper, lower ), alive );
+    }
+
+    __m128 hit = _mm_and_ps( alive, _mm_cmpge_ps( index, zero ) );
+    int32 bits = _mm_movemask_ps( hit );
+    float faces [ 4 ];
+    _mm_storeu_ps( faces, index );
+    __m128 nx = zero;
+    __m128 ny = zero;
+    if( bits != 0 ) {
+      float normalX [ 4 ] = { 0.0f, 0.0f, 0.0f, 0.0f };
+      float normalY [ 4 ] = { 0.0f, 0.0f, 0.0f, 0.0f };
+      for( int32 j = 0; j < 4; ++j ) {
+        if( bits & ( 1 << j ) ) {
+          b2Vec2 n = b2Mul( xf.q, m_normals [ int32( faces [ j ] ) ] );
+          normalX [ j ] = n.x;
+          normalY [ j ] = n.y;
+        }
+      }
+      nx = _mm_loadu_ps( normalX );
+      ny = _mm_loadu_ps( normalY );
+    }
+    hitCount += b2StoreRayHits( outputs + i, hits + i, hit, lower, nx, ny );
+  }
+#endif // defined(LIQUIDFUN_SIMD_SSE)
+
+  for( ; i < count; ++i ) {
+    hits [ i ] = b2PolygonShape::RayCast( outputs + i, inputs [ i ], xf, childIndex );
+    hitCount += hits [ i ] ? 1 : 0;
+  }
+
+  return hitCount;
+}
+
 void b2PolygonShape::ComputeAABB( b2AABB* aabb, const b2Transform& xf, int32 childIndex ) const {
   B2_NOT_USED( childIndex );
 
@@ -0,0 +1,91 @@
+// MIT License
+
+// Copyright (c) 2019 Erin Catto
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "shape.h"
+
+int32 b2Shape::GetProxyCount() const {
+  return GetChildCount();
+}
+
+void b2Shape::ComputeProxyAABB( b2AABB* aabb, const b2Transform& xf, int32 proxyIndex ) const {
+  ComputeAABB( aabb, xf, proxyIndex );
+}
+
+void b2Shape::QueryChildren( b2ShapeChildCallback* callback, const b2AABB& aabb ) const {
+  b2Transform identity;
+  identity.SetIdentity();
+
+  int32 childCount = GetChildCount();
+  for( int32 i = 0; i < childCount; ++i ) {
+    b2AABB childAABB;
+    ComputeAABB( &childAABB, identity, i );
+    if( b2TestOverlap( childAABB, aabb ) && callback->ReportChild( i ) == false )
+      return;
+  }
+}
+
+bool b2Shape::RayCastChildren( b2RayCastOutput* output, int32* childIndex,
+    const b2RayCastInput& input, const b2Transform& xf ) const {
+  b2RayCastInput subInput = input;
+  bool hit = false;
+
+  // Each hit shortens the ray for the remaining children.
+  int32 childCount = GetChildCount();
+  for( int32 i = 0; i < childCount; ++i ) {
+    b2RayCastOutput childOutput;
+    if( RayCast( &childOutput, subInput, xf, i ) ) {
+      *output = childOutput;
+      *childIndex = i;
+      subInput.maxFraction = childOutput.fraction;
+      hit = true;
+    }
+  }
+
+  return hit;
+}
+
+float b2Shape::GetChildRadius( int32 childIndex ) const {
+  B2_NOT_USED( childIndex );
+  return m_radius;
+}
+
+void b2Shape::TestPoints( const b2Transform& xf, const b2Vec2* points, int32 count, bool* inside ) const {
+  for( int32 i = 0; i < count; ++i )
+    inside [ i ] = TestPoint( xf, points [ i ] );
+}
+
+void b2Shape::ComputeDistances( const b2Transform& xf, const b2Vec2* points, int32 count,
+    float* distances, b2Vec2* normals, int32 childIndex ) const {
+  for( int32 i = 0; i < count; ++i )
+    ComputeDistance( xf, points [ i ], distances + i, normals + i, childIndex );
+}
+
+int32 b2Shape::RayCasts( b2RayCastOutput* outputs, bool* hits, const b2RayCastInput* inputs, int32 count,
+    const b2Transform& xf, int32 childIndex ) const {
+  int32 hitCount = 0;
+  for( int32 i = 0; i < count; ++i ) {
+    hits [ i ] = RayCast( outputs + i, inputs [ i ], xf, childIndex );
+    hitCount += hits [ i ] ? 1 : 0;
+  }
+
+  return hitCount;
+}
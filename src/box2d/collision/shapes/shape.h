@@ -41,6 +41,16 @@ struct B2_API b2MassData {
     float I;
 };
 
+/// Callback class for b2Shape::QueryChildren.
+class B2_API b2ShapeChildCallback {
+  public:
+    virtual ~b2ShapeChildCallback() {}
+
+    /// Called for each child whose bounds may overlap the query box.
+    /// @return false to terminate the query.
+    virtual bool ReportChild( int32 childIndex ) = 0;
+};
+
 /// A shape is used for collision detection. You can create a shape however you like.
 /// Shapes used for simulation in b2World are created automatically when a b2Fixture
 /// is created. Shapes may encapsulate a one or more child shapes.
@@ -52,7 +62,10 @@ class B2_API b2Shape {
       e_edge = 1,
       e_polygon = 2,
       e_chain = 3,
-      e_typeCount = 4
+      e_capsule = 4,
+      e_grid = 5,
+      e_compound = 6,
+      e_typeCount = 7
     };
 
     virtual ~b2Shape() {}
@@ -67,6 +80,37 @@ class B2_API b2Shape {
     /// Get the number of child primitives.
     virtual int32 GetChildCount() const = 0;
 
+    /// Get the number of broad-phase proxies. By default every child has its own proxy.
+    /// A shape may return one here to cover all of its children with a single proxy, in
+    /// which case the contact manager finds the overlapping children with QueryChildren.
+    virtual int32 GetProxyCount() const;
+
+    /// Does a single broad-phase proxy cover several children?
+    bool SharesProxy() const;
+
+    /// Given a transform, compute the bounding box of a broad-phase proxy.
+    /// @param aabb returns the axis aligned box.
+    /// @param xf the world transform of the shape.
+    /// @param proxyIndex the proxy, less than GetProxyCount
+    virtual void ComputeProxyAABB( b2AABB* aabb, const b2Transform& xf, int32 proxyIndex ) const;
+
+    /// Report the children whose bounds overlap a box. This tests every child unless
+    /// the shape has its own lookup.
+    /// @param callback a callback that is called for each overlapping child.
+    /// @param aabb the query box in shape coordinates.
+    virtual void QueryChildren( b2ShapeChildCallback* callback, const b2AABB& aabb ) const;
+
+    /// Cast a ray against all children and keep the closest hit.
+    /// @param output the ray-cast results.
+    /// @param childIndex returns the child that was hit.
+    /// @param input the ray-cast input parameters.
+    /// @param transform the transform to be applied to the shape.
+    virtual bool RayCastChildren( b2RayCastOutput* output, int32* childIndex,
+        const b2RayCastInput& input, const b2Transform& transform ) const;
+
+    /// Get the radius of a child. This is m_radius unless the children have their own radii.
+    virtual float GetChildRadius( int32 childIndex ) const;
+
     /// Test a point for containment in this shape. This only works for convex shapes.
     /// @param xf the shape world transform.
     /// @param p a point in world coordinates.
@@ -87,6 +131,34 @@ class B2_API b2Shape {
     virtual bool RayCast( b2RayCastOutput* output, const b2RayCastInput& input,
         const b2Transform& transform, int32 childIndex ) const = 0;
 
+    /// Test many points for containment in this shape. This only works for convex shapes.
+    /// @param xf the shape world transform.
+    /// @param points points in world coordinates.
+    /// @param count the number of points.
+    /// @param inside returns whether each point is inside.
+    virtual void TestPoints( const b2Transform& xf, const b2Vec2* points, int32 count, bool* inside ) const;
+
+    /// Compute the distance from a child to many points, like ComputeDistance.
+    /// @param xf the shape world transform.
+    /// @param points points in world coordinates.
+    /// @param count the number of points.
+    /// @param distances returns the distance of each point.
+    /// @param normals returns the direction in which the distance of each point increases.
+    /// @param childIndex the child shape index
+    virtual void ComputeDistances( const b2Transform& xf, const b2Vec2* points, int32 count,
+        float* distances, b2Vec2* normals, int32 childIndex ) const;
+
+    /// Cast many rays against a child shape, like RayCast.
+    /// @param outputs the ray-cast results, only written for the rays that hit.
+    /// @param hits returns whether each ray hit.
+    /// @param inputs the ray-cast input parameters.
+    /// @param count the number of rays.
+    /// @param transform the transform to be applied to the shape.
+    /// @param childIndex the child shape index
+    /// @return the number of rays that hit.
+    virtual int32 RayCasts( b2RayCastOutput* outputs, bool* hits, const b2RayCastInput* inputs, int32 count,
+        const b2Transform& transform, int32 childIndex ) const;
+
     /// Given a transform, compute the associated axis aligned bounding box for a child shape.
     /// @param aabb returns the axis aligned box.
     /// @param xf the world transform of the shape.
@@ -110,4 +182,8 @@ inline b2Shape::Type b2Shape::GetType() const {
   return m_type;
 }
 
+inline bool b2Shape::SharesProxy() const {
+  return GetProxyCount() < GetChildCount();
+}
+
 #endif
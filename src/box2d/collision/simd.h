@@ -0,0 +1,129 @@
+// MIT License
+
+// Copyright (c) 2019 Erin Catto
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#ifndef B2_SIMD_H
+#define B2_SIMD_H
+
+#include "collision.h"
+
+#if defined(LIQUIDFUN_SIMD_SSE)
+#include <emmintrin.h>
+
+// Helpers for the SSE collision kernels. Each lane holds one point, ray or normal.
+
+/// Load four consecutive points and split them into x and y lanes.
+inline void b2LoadPoints(__m128* x, __m128* y, const b2Vec2* points)
+{
+	__m128 a = _mm_loadu_ps(&points[0].x);
+	__m128 b = _mm_loadu_ps(&points[2].x);
+	*x = _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+	*y = _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+}
+
+/// Join x and y lanes and store them as four consecutive points.
+inline void b2StorePoints(b2Vec2* points, __m128 x, __m128 y)
+{
+	_mm_storeu_ps(&points[0].x, _mm_unpacklo_ps(x, y));
+	_mm_storeu_ps(&points[2].x, _mm_unpackhi_ps(x, y));
+}
+
+/// Take a where the mask is set and b elsewhere.
+inline __m128 b2Select(__m128 mask, __m128 a, __m128 b)
+{
+	return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+/// Apply the inverse of a transform to four points, like b2MulT.
+inline void b2MulTLanes(__m128* x, __m128* y, const b2Transform& xf)
+{
+	__m128 c = _mm_set1_ps(xf.q.c);
+	__m128 s = _mm_set1_ps(xf.q.s);
+	__m128 px = _mm_sub_ps(*x, _mm_set1_ps(xf.p.x));
+	__m128 py = _mm_sub_ps(*y, _mm_set1_ps(xf.p.y));
+	*x = _mm_add_ps(_mm_mul_ps(c, px), _mm_mul_ps(s, py));
+	*y = _mm_add_ps(_mm_sub_ps(_mm_setzero_ps(), _mm_mul_ps(s, px)), _mm_mul_ps(c, py));
+}
+
+/// Rotate four vectors, like b2Mul.
+inline void b2MulLanes(__m128* x, __m128* y, const b2Rot& q)
+{
+	__m128 c = _mm_set1_ps(q.c);
+	__m128 s = _mm_set1_ps(q.s);
+	__m128 vx = *x;
+	__m128 vy = *y;
+	*x = _mm_sub_ps(_mm_mul_ps(c, vx), _mm_mul_ps(s, vy));
+	*y = _mm_add_ps(_mm_mul_ps(s, vx), _mm_mul_ps(c, vy));
+}
+
+/// Normalize four vectors. Like b2Vec2::Normalize, vectors shorter than b2_epsilon
+/// are left as they are.
+inline void b2NormalizeLanes(__m128* x, __m128* y)
+{
+	__m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(*x, *x), _mm_mul_ps(*y, *y)));
+	__m128 invLength = _mm_div_ps(_mm_set1_ps(1.0f), length);
+	__m128 mask = _mm_cmpge_ps(length, _mm_set1_ps(b2_epsilon));
+	*x = b2Select(mask, _mm_mul_ps(*x, invLength), *x);
+	*y = b2Select(mask, _mm_mul_ps(*y, invLength), *y);
+}
+
+/// Load four rays into lanes.
+inline void b2LoadRays(__m128* x1, __m128* y1, __m128* x2, __m128* y2, __m128* maxFraction,
+					   const b2RayCastInput* inputs)
+{
+	*x1 = _mm_setr_ps(inputs[0].p1.x, inputs[1].p1.x, inputs[2].p1.x, inputs[3].p1.x);
+	*y1 = _mm_setr_ps(inputs[0].p1.y, inputs[1].p1.y, inputs[2].p1.y, inputs[3].p1.y);
+	*x2 = _mm_setr_ps(inputs[0].p2.x, inputs[1].p2.x, inputs[2].p2.x, inputs[3].p2.x);
+	*y2 = _mm_setr_ps(inputs[0].p2.y, inputs[1].p2.y, inputs[2].p2.y, inputs[3].p2.y);
+	*maxFraction = _mm_setr_ps(inputs[0].maxFraction, inputs[1].maxFraction,
+							   inputs[2].maxFraction, inputs[3].maxFraction);
+}
+
+/// Write the results of four rays. Outputs are only written for the rays that hit.
+/// @return the number of hits.
+inline int32 b2StoreRayHits(b2RayCastOutput* outputs, bool* hits, __m128 hitMask,
+							__m128 fraction, __m128 normalX, __m128 normalY)
+{
+	float f[4], x[4], y[4];
+	_mm_storeu_ps(f, fraction);
+	_mm_storeu_ps(x, normalX);
+	_mm_storeu_ps(y, normalY);
+
+	int32 bits = _mm_movemask_ps(hitMask);
+	int32 hitCount = 0;
+	for (int32 j = 0; j < 4; ++j)
+	{
+		hits[j] = (bits & (1 << j)) != 0;
+		if (hits[j])
+		{
+			outputs[j].fraction = f[j];
+			outputs[j].normal.Set(x[j], y[j]);
+			++hitCount;
+		}
+	}
+
+	return hitCount;
+}
+
+#endif // defined(LIQUIDFUN_SIMD_SSE)
+
+#endif
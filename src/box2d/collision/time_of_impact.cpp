@@ -32,6 +32,7 @@
 B2_API float b2_toiTime, b2_toiMaxTime;
 B2_API int32 b2_toiCalls, b2_toiIters, b2_toiMaxIters;
 B2_API int32 b2_toiRootIters, b2_toiMaxRootIters;
+B2_API int32 b2_toiCircleCalls;
 
 //
 struct b2SeparationFunction
@@ -488,3 +489,231 @@ void b2TimeOfImpact(b2TOIOutput* output, const b2TOIInput* input)
 	b2_toiMaxTime = b2Max(b2_toiMaxTime, time);
 	b2_toiTime += time;
 }
+
+// Does this sweep carry the proxy vertex along a straight line?
+static bool b2IsLinearPath(const b2Sweep& sweep, const b2DistanceProxy* proxy)
+{
+	if (sweep.a0 == sweep.a)
+	{
+		return true;
+	}
+
+	return proxy->m_count == 1 && b2DistanceSquared(proxy->m_vertices[0], sweep.localCenter) < b2_epsilon * b2_epsilon;
+}
+
+// First fraction in [0, 1] at which p + s * d enters the disk. Assumes p starts outside.
+static bool b2RayCastDisk(float* s, const b2Vec2& p, const b2Vec2& d, const b2Vec2& center, float radius)
+{
+	b2Vec2 m = p - center;
+	float dd = b2Dot(d, d);
+	float b = b2Dot(m, d);
+	float c = b2Dot(m, m) - radius * radius;
+	float sigma = b * b - dd * c;
+	if (b >= 0.0f || sigma < 0.0f || dd < b2_epsilon)
+	{
+		return false;
+	}
+
+	float t = -(b + b2Sqrt(sigma)) / dd;
+	if (t < 0.0f || 1.0f < t)
+	{
+		return false;
+	}
+
+	*s = t;
+	return true;
+}
+
+// First fraction in [0, 1] at which p + s * d enters the segment v1-v2 rounded by radius.
+// Assumes p starts outside.
+static bool b2RayCastRoundedSegment(float* s, const b2Vec2& p, const b2Vec2& d,
+									const b2Vec2& v1, const b2Vec2& v2, float radius)
+{
+	bool hit = false;
+	float best = 1.0f;
+
+	b2Vec2 e = v2 - v1;
+	float ee = b2Dot(e, e);
+	if (ee > b2_epsilon * b2_epsilon)
+	{
+		// The flat side facing the start point.
+		b2Vec2 n = b2Cross(e, 1.0f);
+		n *= 1.0f / b2Sqrt(ee);
+		float h = b2Dot(p - v1, n);
+		if (h < 0.0f)
+		{
+			n = -n;
+			h = -h;
+		}
+
+		float approach = b2Dot(d, n);
+		if (h >= radius && approach < 0.0f)
+		{
+			float t = (radius - h) / approach;
+			float u = b2Dot(p + t * d - v1, e);
+			if (t <= best && 0.0f <= u && u <= ee)
+			{
+				best = t;
+				hit = true;
+			}
+		}
+	}
+
+	float t;
+	if (b2RayCastDisk(&t, p, d, v1, radius) && t <= best)
+	{
+		best = t;
+		hit = true;
+	}
+
+	if (b2RayCastDisk(&t, p, d, v2, radius) && t <= best)
+	{
+		best = t;
+		hit = true;
+	}
+
+	*s = best;
+	return hit;
+}
+
+// Distance from a point to the core of a proxy given as a point, segment or CCW polygon.
+static float b2CoreDistance(const b2Vec2& p, const b2Vec2* vertices, int32 count)
+{
+	if (count == 1)
+	{
+		return b2Distance(p, vertices[0]);
+	}
+
+	bool inside = count > 2;
+	float distanceSqr = b2_maxFloat;
+	for (int32 i = 0; i < count; ++i)
+	{
+		b2Vec2 v1 = vertices[i];
+		b2Vec2 v2 = vertices[i + 1 < count ? i + 1 : 0];
+		b2Vec2 e = v2 - v1;
+		b2Vec2 r = p - v1;
+		if (b2Cross(e, r) < 0.0f)
+		{
+			inside = false;
+		}
+
+		float ee = b2Dot(e, e);
+		float u = ee > 0.0f ? b2Clamp(b2Dot(r, e) / ee, 0.0f, 1.0f) : 0.0f;
+		distanceSqr = b2Min(distanceSqr, (r - u * e).LengthSquared());
+
+		if (count == 2)
+		{
+			break;
+		}
+	}
+
+	return inside ? 0.0f : b2Sqrt(distanceSqr);
+}
+
+bool b2TimeOfImpactCircle(b2TOIOutput* output, const b2TOIInput* input)
+{
+	// The point proxy moves, the other one is held still.
+	const b2DistanceProxy* proxyP = &input->proxyA;
+	const b2DistanceProxy* proxyQ = &input->proxyB;
+	const b2Sweep* sweepP = &input->sweepA;
+	const b2Sweep* sweepQ = &input->sweepB;
+	if (proxyP->m_count != 1)
+	{
+		b2Swap(proxyP, proxyQ);
+		b2Swap(sweepP, sweepQ);
+	}
+
+	if (proxyP->m_count != 1 || b2IsLinearPath(*sweepP, proxyP) == false)
+	{
+		return false;
+	}
+
+	float tMax = input->tMax;
+	b2Transform xfP1, xfP2, xfQ1, xfQ2;
+	sweepP->GetTransform(&xfP1, 0.0f);
+	sweepP->GetTransform(&xfP2, tMax);
+	sweepQ->GetTransform(&xfQ1, 0.0f);
+	sweepQ->GetTransform(&xfQ2, tMax);
+	b2Vec2 p1 = b2Mul(xfP1, proxyP->m_vertices[0]);
+	b2Vec2 p2 = b2Mul(xfP2, proxyP->m_vertices[0]);
+
+	// Express the path in the frame of the other proxy. A spinning circle is
+	// tracked by its center instead, since its frame rotates.
+	b2Vec2 r1, r2;
+	const b2Vec2* vertices = proxyQ->m_vertices;
+	int32 count = proxyQ->m_count;
+	if (sweepQ->a0 == sweepQ->a)
+	{
+		r1 = b2MulT(xfQ1, p1);
+		r2 = b2MulT(xfQ2, p2);
+	}
+	else if (b2IsLinearPath(*sweepQ, proxyQ))
+	{
+		r1 = p1 - b2Mul(xfQ1, vertices[0]);
+		r2 = p2 - b2Mul(xfQ2, vertices[0]);
+		vertices = &b2Vec2_zero;
+	}
+	else
+	{
+		return false;
+	}
+
+	++b2_toiCircleCalls;
+
+	// Same targets as the general algorithm.
+	float totalRadius = proxyP->m_radius + proxyQ->m_radius;
+	float target = b2Max(b2_linearSlop, totalRadius - 3.0f * b2_linearSlop);
+	float tolerance = 0.25f * b2_linearSlop;
+
+	float distance = b2CoreDistance(r1, vertices, count);
+	if (distance <= 0.0f)
+	{
+		output->state = b2TOIOutput::e_overlapped;
+		output->t = 0.0f;
+		return true;
+	}
+
+	if (distance < target + tolerance)
+	{
+		output->state = b2TOIOutput::e_touching;
+		output->t = 0.0f;
+		return true;
+	}
+
+	// The path enters the core rounded by the target at the first hit on any
+	// rounded edge.
+	b2Vec2 d = r2 - r1;
+	bool hit = false;
+	float s = 1.0f;
+	if (count == 1)
+	{
+		hit = b2RayCastDisk(&s, r1, d, vertices[0], target);
+	}
+	else
+	{
+		int32 edgeCount = count == 2 ? 1 : count;
+		for (int32 i = 0; i < edgeCount; ++i)
+		{
+			float si;
+			const b2Vec2& v2 = vertices[i + 1 < count ? i + 1 : 0];
+			if (b2RayCastRoundedSegment(&si, r1, d, vertices[i], v2, target) && si <= s)
+			{
+				s = si;
+				hit = true;
+			}
+		}
+	}
+
+	if (hit)
+	{
+		output->state = b2TOIOutput::e_touching;
+		output->t = s * tMax;
+	}
+	else
+	{
+		output->state = b2TOIOutput::e_separated;
+		output->t = tMax;
+	}
+
+	return true;
+}
@@ -60,4 +60,13 @@ struct B2_API b2TOIOutput
 /// Note: use b2Distance to compute the contact point and normal at the time of impact.
 B2_API void b2TimeOfImpact(b2TOIOutput* output, const b2TOIInput* input);
 
+/// Closed form time of impact for a circle against a circle, edge or polygon. One proxy
+/// must be a single point (a circle) and the other a point, segment or convex CCW polygon.
+/// The circle's path relative to the other proxy must be a straight line: neither body
+/// may rotate, unless the rotating proxy is a point at its body's center of mass.
+/// The result matches b2TimeOfImpact, with the exact time at which the cores reach the
+/// target separation.
+/// @returns false, leaving the output untouched, if the pair does not qualify.
+B2_API bool b2TimeOfImpactCircle(b2TOIOutput* output, const b2TOIInput* input);
+
 #endif
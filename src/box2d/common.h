@@ -49,6 +49,13 @@
 #endif // defined(__GNUC__)
 #endif // !defined(b2Inline)
 
+/// SSE2 is part of every x86-64 target, so the SSE collision kernels are on by
+/// default there. Define LIQUIDFUN_SIMD_NO_SSE to use the scalar versions.
+#if !defined(LIQUIDFUN_SIMD_SSE) && !defined(LIQUIDFUN_SIMD_NO_SSE) && \
+	(defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define LIQUIDFUN_SIMD_SSE
+#endif
+
 
 /// @file
 /// Global tuning constants based on meters-kilograms-seconds (MKS) units.
@@ -60,6 +67,10 @@
 /// not change this value.
 #define b2_maxManifoldPoints	2
 
+/// The number of collision layers. Each layer has its own broad-phase structures.
+/// This must be a power of two no larger than 8.
+#define b2_maxCollisionLayers	8
+
 /// This is used to fatten AABBs in the dynamic tree. This allows proxies
 /// to move by a small amount without triggering a tree adjustment.
 /// This is in meters.
@@ -86,6 +97,11 @@
 /// Maximum number of sub-steps per contact in continuous physics simulation.
 #define b2_maxSubSteps			8
 
+/// A contact keeps its manifold while the relative transform of the two bodies stays
+/// within these tolerances of the transform the manifold was computed with.
+#define b2_manifoldLinearTolerance	(0.05f * b2_linearSlop)
+#define b2_manifoldAngularTolerance	(0.05f * b2_angularSlop)
+
 
 // Dynamics
 
@@ -116,6 +132,11 @@
 #define b2_baumgarte				0.2f
 #define b2_toiBaumgarte				0.75f
 
+/// With adaptive iterations, an island stops its velocity iterations once an iteration
+/// changes no body velocity by more than these tolerances.
+#define b2_linearIterationTolerance		(0.01f * b2_linearSleepTolerance)
+#define b2_angularIterationTolerance	(0.01f * b2_angularSleepTolerance)
+
 
 // Particle
 
@@ -0,0 +1,173 @@
+// MIT License
+
+// Copyright (c) 2019 Erin Catto
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include "pair_set.h"
+#include "math.h"
+
+#include <stdint.h>
+#include <string.h>
+
+b2PairSet::b2PairSet()
+{
+	m_capacity = 16;
+	m_count = 0;
+	m_entries = (Entry*)b2Alloc(m_capacity * sizeof(Entry));
+	memset(m_entries, 0, m_capacity * sizeof(Entry));
+}
+
+b2PairSet::~b2PairSet()
+{
+	b2Free(m_entries);
+}
+
+void b2PairSet::Sort(const void*& a, int32& indexA, const void*& b, int32& indexB)
+{
+	if ((uintptr_t)b < (uintptr_t)a || (a == b && indexB < indexA))
+	{
+		b2Swap(a, b);
+		b2Swap(indexA, indexB);
+	}
+}
+
+uint32 b2PairSet::Hash(const void* a, int32 indexA, const void* b, int32 indexB)
+{
+	// Mix the two sides (splitmix64 finalizer).
+	uint64_t keyA = (uint64_t)(uintptr_t)a + (uint64_t)uint32(indexA);
+	uint64_t keyB = (uint64_t)(uintptr_t)b + ((uint64_t)uint32(indexB) << 32);
+	uint64_t key = keyA * 0x9E3779B97F4A7C15ull ^ keyB;
+	key ^= key >> 30;
+	key *= 0xBF58476D1CE4E5B9ull;
+	key ^= key >> 27;
+	key *= 0x94D049BB133111EBull;
+	key ^= key >> 31;
+	return uint32(key);
+}
+
+int32 b2PairSet::Find(const void* a, int32 indexA, const void* b, int32 indexB) const
+{
+	int32 mask = m_capacity - 1;
+	int32 index = int32(Hash(a, indexA, b, indexB) & uint32(mask));
+	while (m_entries[index].a != nullptr)
+	{
+		const Entry& entry = m_entries[index];
+		if (entry.a == a && entry.b == b && entry.indexA == indexA && entry.indexB == indexB)
+		{
+			break;
+		}
+
+		index = (index + 1) & mask;
+	}
+
+	return index;
+}
+
+bool b2PairSet::Add(const void* a, int32 indexA, const void* b, int32 indexB)
+{
+	b2Assert(a != nullptr && b != nullptr);
+	Sort(a, indexA, b, indexB);
+
+	int32 index = Find(a, indexA, b, indexB);
+	if (m_entries[index].a != nullptr)
+	{
+		return false;
+	}
+
+	if (2 * (m_count + 1) > m_capacity)
+	{
+		Grow();
+		index = Find(a, indexA, b, indexB);
+	}
+
+	m_entries[index].a = a;
+	m_entries[index].b = b;
+	m_entries[index].indexA = indexA;
+	m_entries[index].indexB = indexB;
+	++m_count;
+	return true;
+}
+
+bool b2PairSet::Remove(const void* a, int32 indexA, const void* b, int32 indexB)
+{
+	Sort(a, indexA, b, indexB);
+
+	int32 index = Find(a, indexA, b, indexB);
+	if (m_entries[index].a == nullptr)
+	{
+		return false;
+	}
+
+	// Shift later entries of the cluster back so that no probe sequence is broken.
+	int32 mask = m_capacity - 1;
+	int32 hole = index;
+	int32 next = (hole + 1) & mask;
+	while (m_entries[next].a != nullptr)
+	{
+		const Entry& entry = m_entries[next];
+		int32 home = int32(Hash(entry.a, entry.indexA, entry.b, entry.indexB) & uint32(mask));
+
+		// Move the entry if its home slot is not cyclically in (hole, next].
+		bool inRange = hole <= next ? (hole < home && home <= next) : (hole < home || home <= next);
+		if (inRange == false)
+		{
+			m_entries[hole] = m_entries[next];
+			hole = next;
+		}
+
+		next = (next + 1) & mask;
+	}
+
+	m_entries[hole].a = nullptr;
+	m_entries[hole].b = nullptr;
+	--m_count;
+	return true;
+}
+
+bool b2PairSet::Contains(const void* a, int32 indexA, const void* b, int32 indexB) const
+{
+	Sort(a, indexA, b, indexB);
+
+	int32 index = Find(a, indexA, b, indexB);
+	return m_entries[index].a != nullptr;
+}
+
+void b2PairSet::Grow()
+{
+	Entry* oldEntries = m_entries;
+	int32 oldCapacity = m_capacity;
+
+	m_capacity *= 2;
+	m_entries = (Entry*)b2Alloc(m_capacity * sizeof(Entry));
+	memset(m_entries, 0, m_capacity * sizeof(Entry));
+
+	for (int32 i = 0; i < oldCapacity; ++i)
+	{
+		if (oldEntries[i].a != nullptr)
+		{
+			const Entry& entry = oldEntries[i];
+			int32 index = Find(entry.a, entry.indexA, entry.b, entry.indexB);
+			m_entries[index] = oldEntries[i];
+		}
+	}
+
+	b2Free(oldEntries);
+}
@@ -0,0 +1,85 @@
+// MIT License
+
+// Copyright (c) 2019 Erin Catto
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#ifndef B2_PAIR_SET_H
+#define B2_PAIR_SET_H
+
+#include "box2d/api.h"
+#include "settings.h"
+
+/// A hash set of unordered pointer pairs. Each side may carry an index so that the
+/// children of one object can be told apart. This uses open addressing with linear
+/// probing and backward shift deletion, so removals leave no tombstones.
+/// The table is kept at most half full.
+class B2_API b2PairSet
+{
+public:
+	b2PairSet();
+	~b2PairSet();
+
+	/// Add a pair of indexed sides. The order of the sides does not matter.
+	/// @return false if the pair was already in the set.
+	bool Add(const void* a, int32 indexA, const void* b, int32 indexB);
+
+	/// Remove a pair of indexed sides.
+	/// @return false if the pair was not in the set.
+	bool Remove(const void* a, int32 indexA, const void* b, int32 indexB);
+
+	/// Is the pair of indexed sides in the set?
+	bool Contains(const void* a, int32 indexA, const void* b, int32 indexB) const;
+
+	/// Get the number of pairs in the set.
+	int32 GetCount() const;
+
+private:
+
+	// Empty slots have a null first pointer.
+	struct Entry
+	{
+		const void* a;
+		const void* b;
+		int32 indexA;
+		int32 indexB;
+	};
+
+	// Put the sides of a pair in a canonical order.
+	static void Sort(const void*& a, int32& indexA, const void*& b, int32& indexB);
+
+	static uint32 Hash(const void* a, int32 indexA, const void* b, int32 indexB);
+
+	// The slot holding the pair or the empty slot that ends its probe sequence.
+	int32 Find(const void* a, int32 indexA, const void* b, int32 indexB) const;
+
+	void Grow();
+
+	Entry* m_entries;
+	int32 m_capacity;
+	int32 m_count;
+};
+
+inline int32 b2PairSet::GetCount() const
+{
+	return m_count;
+}
+
+#endif
@@ -25,7 +25,8 @@
 #include "box2d/api.h"
 #include "box2d/common/math.h"
 
-/// Profiling data. Times are in milliseconds.
+/// Profiling data. Times are in milliseconds. The velocity counts cover the islands
+/// solved in the last step.
 struct B2_API b2Profile {
     float step;
     float collide;
@@ -35,6 +36,9 @@ struct B2_API b2Profile {
     float solvePosition;
     float broadphase;
     float solveTOI;
+    int32 velocityIslands;       // islands solved
+    int32 velocityIterations;    // velocity iterations summed over the islands
+    int32 maxVelocityIterations; // most velocity iterations taken by one island
 };
 
 /// This is an internal structure.
@@ -43,9 +47,13 @@ struct B2_API b2TimeStep {
     float inv_dt;  // inverse time step (0 if dt == 0).
     float dtRatio; // dt * inv_dt0
     int32 velocityIterations;
+    int32 maxVelocityIterations;
     int32 positionIterations;
     int32 particleIterations;
     bool warmStarting;
+    bool adaptiveIterations;
+    bool batchJoints;
+    bool directJoints;
 };
 
 /// This is an internal structure.
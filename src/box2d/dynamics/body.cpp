@@ -106,8 +106,20 @@ void b2Body::SetType( b2BodyType type ) {
   if( m_type == type )
     return;
 
+  // Static proxies may live in a separate broad-phase tree.
+  b2BroadPhase* broadPhase = &m_world->m_contactManager.m_broadPhase;
+  bool restatic = ( m_type == b2_staticBody ) != ( type == b2_staticBody );
+  restatic = restatic && broadPhase->GetStaticTreeCompression() && ( m_flags & e_enabledFlag );
+  if( restatic ) {
+    for( b2Fixture* f = m_fixtureList; f; f = f->m_next )
+      f->DestroyProxies( broadPhase );
+  }
+
   m_type = type;
 
+  // Joints to this body may now conflict in a batch.
+  m_world->m_newJoints = true;
+
   ResetMassData();
 
   if( m_type == b2_staticBody ) {
@@ -133,8 +145,14 @@ void b2Body::SetType( b2BodyType type ) {
   }
   m_contactList = nullptr;
 
+  // Recreated proxies are already buffered as moved.
+  if( restatic ) {
+    for( b2Fixture* f = m_fixtureList; f; f = f->m_next )
+      f->CreateProxies( broadPhase, m_xf );
+    return;
+  }
+
   // Touch the proxies so that new contacts will be created (when appropriate)
-  b2BroadPhase* broadPhase = &m_world->m_contactManager.m_broadPhase;
   for( b2Fixture* f = m_fixtureList; f; f = f->m_next ) {
     int32 proxyCount = f->m_proxyCount;
     for( int32 i = 0; i < proxyCount; ++i )
@@ -183,6 +201,14 @@ b2Fixture* b2Body::CreateFixture( const b2Shape* shape, float density ) {
   return CreateFixture( &def );
 }
 
+b2Fixture* b2Body::CreateFixture( b2SharedShape* sharedShape, float density ) {
+  b2FixtureDef def;
+  def.sharedShape = sharedShape;
+  def.density = density;
+
+  return CreateFixture( &def );
+}
+
 void b2Body::DestroyFixture( b2Fixture* fixture ) {
   if( fixture == NULL )
     return;
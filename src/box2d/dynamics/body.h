@@ -31,6 +31,7 @@ class b2Fixture;
 class b2Joint;
 class b2Contact;
 class b2Controller;
+class b2SharedShape;
 class b2World;
 struct b2FixtureDef;
 struct b2JointEdge;
@@ -142,6 +143,13 @@ class B2_API b2Body {
     /// @warning This function is locked during callbacks.
     b2Fixture* CreateFixture( const b2Shape* shape, float density );
 
+    /// Creates a fixture from a shared shape and attach it to this body. The fixture
+    /// uses the shape without cloning it.
+    /// @param sharedShape the shape made with b2World::CreateSharedShape.
+    /// @param density the shape density (set to zero for static bodies).
+    /// @warning This function is locked during callbacks.
+    b2Fixture* CreateFixture( b2SharedShape* sharedShape, float density );
+
     /// Destroy a fixture. This removes the fixture from the broad-phase and
     /// destroys all contacts associated with this fixture. This will
     /// automatically adjust the mass of the body if the body is dynamic and the
@@ -388,6 +396,7 @@ class B2_API b2Body {
     friend class b2Island;
     friend class b2ContactManager;
     friend class b2ContactSolver;
+    friend class b2JointSolver;
     friend class b2Contact;
 
     friend class b2DistanceJoint;
@@ -0,0 +1,234 @@
+// MIT License
+
+// Copyright (c) 2019 Erin Catto
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include "compound_contact.h"
+#include "box2d/common/block_allocator.h"
+#include "box2d/dynamics/fixture.h"
+#include "box2d/collision/shapes/capsule_shape.h"
+#include "box2d/collision/shapes/chain_shape.h"
+#include "box2d/collision/shapes/circle_shape.h"
+#include "box2d/collision/shapes/compound_shape.h"
+#include "box2d/collision/shapes/edge_shape.h"
+#include "box2d/collision/shapes/grid_shape.h"
+#include "box2d/collision/shapes/polygon_shape.h"
+
+#include <new>
+
+static void b2CollideCirclePrimitives(b2Manifold* manifold, const b2Shape* shapeA, const b2Transform& xfA, const b2Shape* shapeB, const b2Transform& xfB)
+{
+	b2CollideCircles(manifold, (const b2CircleShape*)shapeA, xfA, (const b2CircleShape*)shapeB, xfB);
+}
+
+static void b2CollidePolygonAndCirclePrimitives(b2Manifold* manifold, const b2Shape* shapeA, const b2Transform& xfA, const b2Shape* shapeB, const b2Transform& xfB)
+{
+	b2CollidePolygonAndCircle(manifold, (const b2PolygonShape*)shapeA, xfA, (const b2CircleShape*)shapeB, xfB);
+}
+
+static void b2CollidePolygonPrimitives(b2Manifold* manifold, const b2Shape* shapeA, const b2Transform& xfA, const b2Shape* shapeB, const b2Transform& xfB)
+{
+	const b2PolygonShape* polygonA = (const b2PolygonShape*)shapeA;
+	const b2PolygonShape* polygonB = (const b2PolygonShape*)shapeB;
+	if (polygonA->m_isBox && polygonB->m_isBox)
+	{
+		b2CollideBoxes(manifold, polygonA, xfA, polygonB, xfB);
+	}
+	else
+	{
+		b2CollidePolygons(manifold, polygonA, xfA, polygonB, xfB);
+	}
+}
+
+static void b2CollideEdgeAndCirclePrimitives(b2Manifold* manifold, const b2Shape* shapeA, const b2Transform& xfA, const b2Shape* shapeB, const b2Transform& xfB)
+{
+	b2CollideEdgeAndCircle(manifold, (const b2EdgeShape*)shapeA, xfA, (const b2CircleShape*)shapeB, xfB);
+}
+
+static void b2CollideEdgeAndPolygonPrimitives(b2Manifold* manifold, const b2Shape* shapeA, const b2Transform& xfA, const b2Shape* shapeB, const b2Transform& xfB)
+{
+	b2CollideEdgeAndPolygon(manifold, (const b2EdgeShape*)shapeA, xfA, (const b2PolygonShape*)shapeB, xfB);
+}
+
+static void b2CollideCapsulePrimitives(b2Manifold* manifold, const b2Shape* shapeA, const b2Transform& xfA, const b2Shape* shapeB, const b2Transform& xfB)
+{
+	b2CollideCapsules(manifold, (const b2CapsuleShape*)shapeA, xfA, (const b2CapsuleShape*)shapeB, xfB);
+}
+
+static void b2CollideCapsuleAndCirclePrimitives(b2Manifold* manifold, const b2Shape* shapeA, const b2Transform& xfA, const b2Shape* shapeB, const b2Transform& xfB)
+{
+	b2CollideCapsuleAndCircle(manifold, (const b2CapsuleShape*)shapeA, xfA, (const b2CircleShape*)shapeB, xfB);
+}
+
+static void b2CollidePolygonAndCapsulePrimitives(b2Manifold* manifold, const b2Shape* shapeA, const b2Transform& xfA, const b2Shape* shapeB, const b2Transform& xfB)
+{
+	b2CollidePolygonAndCapsule(manifold, (const b2PolygonShape*)shapeA, xfA, (const b2CapsuleShape*)shapeB, xfB);
+}
+
+static void b2CollideEdgeAndCapsulePrimitives(b2Manifold* manifold, const b2Shape* shapeA, const b2Transform& xfA, const b2Shape* shapeB, const b2Transform& xfB)
+{
+	b2CollideEdgeAndCapsule(manifold, (const b2EdgeShape*)shapeA, xfA, (const b2CapsuleShape*)shapeB, xfB);
+}
+
+// Get the collide routine for two primitives in this order, or null if the routine
+// takes them the other way around or the pair does not collide.
+static b2CollidePrimitivesFcn* b2GetCollidePrimitivesFcn(b2Shape::Type typeA, b2Shape::Type typeB)
+{
+	switch (typeA)
+	{
+	case b2Shape::e_circle:
+		return typeB == b2Shape::e_circle ? b2CollideCirclePrimitives : nullptr;
+
+	case b2Shape::e_polygon:
+		switch (typeB)
+		{
+		case b2Shape::e_circle:
+			return b2CollidePolygonAndCirclePrimitives;
+		case b2Shape::e_polygon:
+			return b2CollidePolygonPrimitives;
+		case b2Shape::e_capsule:
+			return b2CollidePolygonAndCapsulePrimitives;
+		default:
+			return nullptr;
+		}
+
+	case b2Shape::e_edge:
+		switch (typeB)
+		{
+		case b2Shape::e_circle:
+			return b2CollideEdgeAndCirclePrimitives;
+		case b2Shape::e_polygon:
+			return b2CollideEdgeAndPolygonPrimitives;
+		case b2Shape::e_capsule:
+			return b2CollideEdgeAndCapsulePrimitives;
+		default:
+			return nullptr;
+		}
+
+	case b2Shape::e_capsule:
+		switch (typeB)
+		{
+		case b2Shape::e_circle:
+			return b2CollideCapsuleAndCirclePrimitives;
+		case b2Shape::e_capsule:
+			return b2CollideCapsulePrimitives;
+		default:
+			return nullptr;
+		}
+
+	default:
+		return nullptr;
+	}
+}
+
+// The primitive type that a child collides as.
+static b2Shape::Type b2GetPrimitiveType(const b2Shape* shape, int32 index)
+{
+	switch (shape->GetType())
+	{
+	case b2Shape::e_chain:
+		return b2Shape::e_edge;
+
+	case b2Shape::e_grid:
+		return ((const b2GridShape*)shape)->IsHeightField() ? b2Shape::e_edge : b2Shape::e_polygon;
+
+	case b2Shape::e_compound:
+		return ((const b2CompoundShape*)shape)->GetChild(index)->GetType();
+
+	default:
+		return shape->GetType();
+	}
+}
+
+// Get the primitive for a child. Chain and grid children are built in the buffers.
+static const b2Shape* b2GetPrimitive(const b2Shape* shape, int32 index, b2EdgeShape* edge, b2PolygonShape* box)
+{
+	switch (shape->GetType())
+	{
+	case b2Shape::e_chain:
+		((const b2ChainShape*)shape)->GetChildEdge(edge, index);
+		return edge;
+
+	case b2Shape::e_grid:
+		{
+			const b2GridShape* grid = (const b2GridShape*)shape;
+			if (grid->IsHeightField())
+			{
+				grid->GetChildEdge(edge, index);
+				return edge;
+			}
+
+			grid->GetChildBox(box, index);
+			return box;
+		}
+
+	case b2Shape::e_compound:
+		return ((const b2CompoundShape*)shape)->GetChild(index);
+
+	default:
+		return shape;
+	}
+}
+
+b2Contact* b2CompoundContact::Create(b2Fixture* fixtureA, int32 indexA, b2Fixture* fixtureB, int32 indexB, b2BlockAllocator* allocator)
+{
+	b2Shape::Type typeA = b2GetPrimitiveType(fixtureA->GetShape(), indexA);
+	b2Shape::Type typeB = b2GetPrimitiveType(fixtureB->GetShape(), indexB);
+
+	b2CollidePrimitivesFcn* collideFcn = b2GetCollidePrimitivesFcn(typeA, typeB);
+	if (collideFcn == nullptr)
+	{
+		collideFcn = b2GetCollidePrimitivesFcn(typeB, typeA);
+		if (collideFcn == nullptr)
+		{
+			return nullptr;
+		}
+
+		b2Swap(fixtureA, fixtureB);
+		b2Swap(indexA, indexB);
+	}
+
+	void* mem = allocator->Allocate(sizeof(b2CompoundContact));
+	return new (mem) b2CompoundContact(fixtureA, indexA, fixtureB, indexB, collideFcn);
+}
+
+void b2CompoundContact::Destroy(b2Contact* contact, b2BlockAllocator* allocator)
+{
+	((b2CompoundContact*)contact)->~b2CompoundContact();
+	allocator->Free(contact, sizeof(b2CompoundContact));
+}
+
+b2CompoundContact::b2CompoundContact(b2Fixture* fixtureA, int32 indexA, b2Fixture* fixtureB, int32 indexB,
+									 b2CollidePrimitivesFcn* collideFcn)
+: b2Contact(fixtureA, indexA, fixtureB, indexB)
+{
+	b2Assert(m_fixtureA->GetType() == b2Shape::e_compound || m_fixtureB->GetType() == b2Shape::e_compound);
+	m_collideFcn = collideFcn;
+}
+
+void b2CompoundContact::Evaluate(b2Manifold* manifold, const b2Transform& xfA, const b2Transform& xfB)
+{
+	b2EdgeShape edgeA, edgeB;
+	b2PolygonShape boxA, boxB;
+	const b2Shape* shapeA = b2GetPrimitive(m_fixtureA->GetShape(), m_indexA, &edgeA, &boxA);
+	const b2Shape* shapeB = b2GetPrimitive(m_fixtureB->GetShape(), m_indexB, &edgeB, &boxB);
+	m_collideFcn(manifold, shapeA, xfA, shapeB, xfB);
+}
@@ -20,12 +20,21 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 // SOFTWARE.
 
+#include "capsule_circle_contact.h"
+#include "capsule_contact.h"
+#include "chain_capsule_contact.h"
 #include "chain_circle_contact.h"
 #include "chain_polygon_contact.h"
 #include "circle_contact.h"
+#include "compound_contact.h"
 #include "box2d/dynamics/contact_solver.h"
+#include "edge_capsule_contact.h"
 #include "edge_circle_contact.h"
 #include "edge_polygon_contact.h"
+#include "grid_capsule_contact.h"
+#include "grid_circle_contact.h"
+#include "grid_polygon_contact.h"
+#include "polygon_capsule_contact.h"
 #include "polygon_circle_contact.h"
 #include "polygon_contact.h"
 
@@ -50,6 +59,21 @@ void b2Contact::InitializeRegisters()
 	AddType(b2EdgeAndPolygonContact::Create, b2EdgeAndPolygonContact::Destroy, b2Shape::e_edge, b2Shape::e_polygon);
 	AddType(b2ChainAndCircleContact::Create, b2ChainAndCircleContact::Destroy, b2Shape::e_chain, b2Shape::e_circle);
 	AddType(b2ChainAndPolygonContact::Create, b2ChainAndPolygonContact::Destroy, b2Shape::e_chain, b2Shape::e_polygon);
+	AddType(b2CapsuleContact::Create, b2CapsuleContact::Destroy, b2Shape::e_capsule, b2Shape::e_capsule);
+	AddType(b2CapsuleAndCircleContact::Create, b2CapsuleAndCircleContact::Destroy, b2Shape::e_capsule, b2Shape::e_circle);
+	AddType(b2PolygonAndCapsuleContact::Create, b2PolygonAndCapsuleContact::Destroy, b2Shape::e_polygon, b2Shape::e_capsule);
+	AddType(b2EdgeAndCapsuleContact::Create, b2EdgeAndCapsuleContact::Destroy, b2Shape::e_edge, b2Shape::e_capsule);
+	AddType(b2ChainAndCapsuleContact::Create, b2ChainAndCapsuleContact::Destroy, b2Shape::e_chain, b2Shape::e_capsule);
+	AddType(b2GridAndCircleContact::Create, b2GridAndCircleContact::Destroy, b2Shape::e_grid, b2Shape::e_circle);
+	AddType(b2GridAndPolygonContact::Create, b2GridAndPolygonContact::Destroy, b2Shape::e_grid, b2Shape::e_polygon);
+	AddType(b2GridAndCapsuleContact::Create, b2GridAndCapsuleContact::Destroy, b2Shape::e_grid, b2Shape::e_capsule);
+	AddType(b2CompoundContact::Create, b2CompoundContact::Destroy, b2Shape::e_compound, b2Shape::e_circle);
+	AddType(b2CompoundContact::Create, b2CompoundContact::Destroy, b2Shape::e_compound, b2Shape::e_edge);
+	AddType(b2CompoundContact::Create, b2CompoundContact::Destroy, b2Shape::e_compound, b2Shape::e_polygon);
+	AddType(b2CompoundContact::Create, b2CompoundContact::Destroy, b2Shape::e_compound, b2Shape::e_chain);
+	AddType(b2CompoundContact::Create, b2CompoundContact::Destroy, b2Shape::e_compound, b2Shape::e_capsule);
+	AddType(b2CompoundContact::Create, b2CompoundContact::Destroy, b2Shape::e_compound, b2Shape::e_grid);
+	AddType(b2CompoundContact::Create, b2CompoundContact::Destroy, b2Shape::e_compound, b2Shape::e_compound);
 }
 
 void b2Contact::AddType(b2ContactCreateFcn* createFcn, b2ContactDestroyFcn* destoryFcn,
@@ -191,34 +215,54 @@ void b2Contact::Update(b2ContactListener* listener)
 
 		// Sensors don't generate manifolds.
 		m_manifold.pointCount = 0;
+		m_flags &= ~e_manifoldFlag;
 	}
 	else
 	{
-		Evaluate(&m_manifold, xfA, xfB);
-		touching = m_manifold.pointCount > 0;
+		// The manifold is stored in the body frames, so it stays valid for as long as
+		// the bodies don't move relative to each other. This is common in piles that
+		// have come to rest but are not yet asleep.
+		b2Transform relativeXf = b2MulT(xfA, xfB);
+		bool reuse = false;
+		if (m_flags & e_manifoldFlag)
+		{
+			b2Vec2 dp = relativeXf.p - m_relativeXf.p;
+			b2Rot dq = b2MulT(m_relativeXf.q, relativeXf.q);
+			reuse = b2Dot(dp, dp) < b2_manifoldLinearTolerance * b2_manifoldLinearTolerance &&
+					b2Abs(dq.s) < b2_manifoldAngularTolerance && dq.c > 0.0f;
+		}
 
-		// Match old contact ids to new contact ids and copy the
-		// stored impulses to warm start the solver.
-		for (int32 i = 0; i < m_manifold.pointCount; ++i)
+		if (reuse == false)
 		{
-			b2ManifoldPoint* mp2 = m_manifold.points + i;
-			mp2->normalImpulse = 0.0f;
-			mp2->tangentImpulse = 0.0f;
-			b2ContactID id2 = mp2->id;
+			Evaluate(&m_manifold, xfA, xfB);
+			m_relativeXf = relativeXf;
+			m_flags |= e_manifoldFlag;
 
-			for (int32 j = 0; j < oldManifold.pointCount; ++j)
+			// Match old contact ids to new contact ids and copy the
+			// stored impulses to warm start the solver.
+			for (int32 i = 0; i < m_manifold.pointCount; ++i)
 			{
-				b2ManifoldPoint* mp1 = oldManifold.points + j;
+				b2ManifoldPoint* mp2 = m_manifold.points + i;
+				mp2->normalImpulse = 0.0f;
+				mp2->tangentImpulse = 0.0f;
+				b2ContactID id2 = mp2->id;
 
-				if (mp1->id.key == id2.key)
+				for (int32 j = 0; j < oldManifold.pointCount; ++j)
 				{
-					mp2->normalImpulse = mp1->normalImpulse;
-					mp2->tangentImpulse = mp1->tangentImpulse;
-					break;
+					b2ManifoldPoint* mp1 = oldManifold.points + j;
+
+					if (mp1->id.key == id2.key)
+					{
+						mp2->normalImpulse = mp1->normalImpulse;
+						mp2->tangentImpulse = mp1->tangentImpulse;
+						break;
+					}
 				}
 			}
 		}
 
+		touching = m_manifold.pointCount > 0;
+
 		if (touching != wasTouching)
 		{
 			bodyA->SetAwake(true);
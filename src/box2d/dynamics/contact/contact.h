@@ -191,7 +191,10 @@ protected:
 		e_bulletHitFlag		= 0x0010,
 
 		// This contact has a valid TOI in m_toi
-		e_toiFlag			= 0x0020
+		e_toiFlag			= 0x0020,
+
+		// The manifold was computed at m_relativeXf
+		e_manifoldFlag		= 0x0040
 	};
 
 	/// Flag this contact for filtering. Filtering will occur the next time step.
@@ -231,6 +234,9 @@ protected:
 
 	b2Manifold m_manifold;
 
+	// Transform of body B relative to body A when the manifold was computed.
+	b2Transform m_relativeXf;
+
 	int32 m_toiCount;
 	float m_toi;
 
@@ -258,7 +264,8 @@ inline void b2Contact::GetWorldManifold(b2WorldManifold* worldManifold) const
 	const b2Shape* shapeA = m_fixtureA->GetShape();
 	const b2Shape* shapeB = m_fixtureB->GetShape();
 
-	worldManifold->Initialize(&m_manifold, bodyA->GetTransform(), shapeA->m_radius, bodyB->GetTransform(), shapeB->m_radius);
+	worldManifold->Initialize(&m_manifold, bodyA->GetTransform(), shapeA->GetChildRadius(m_indexA),
+							  bodyB->GetTransform(), shapeB->GetChildRadius(m_indexB));
 }
 
 inline void b2Contact::SetEnabled(bool flag)
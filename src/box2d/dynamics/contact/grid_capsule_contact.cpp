@@ -0,0 +1,68 @@
+// MIT License
+
+// Copyright (c) 2019 Erin Catto
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "grid_capsule_contact.h"
+#include "box2d/common/block_allocator.h"
+#include "box2d/dynamics/fixture.h"
+#include "box2d/collision/shapes/capsule_shape.h"
+#include "box2d/collision/shapes/edge_shape.h"
+#include "box2d/collision/shapes/grid_shape.h"
+#include "box2d/collision/shapes/polygon_shape.h"
+
+#include <new>
+
+b2Contact* b2GridAndCapsuleContact::Create(b2Fixture* fixtureA, int32 indexA, b2Fixture* fixtureB, int32 indexB, b2BlockAllocator* allocator)
+{
+	void* mem = allocator->Allocate(sizeof(b2GridAndCapsuleContact));
+	return new (mem) b2GridAndCapsuleContact(fixtureA, indexA, fixtureB, indexB);
+}
+
+void b2GridAndCapsuleContact::Destroy(b2Contact* contact, b2BlockAllocator* allocator)
+{
+	((b2GridAndCapsuleContact*)contact)->~b2GridAndCapsuleContact();
+	allocator->Free(contact, sizeof(b2GridAndCapsuleContact));
+}
+
+b2GridAndCapsuleContact::b2GridAndCapsuleContact(b2Fixture* fixtureA, int32 indexA, b2Fixture* fixtureB, int32 indexB)
+: b2Contact(fixtureA, indexA, fixtureB, indexB)
+{
+	b2Assert(m_fixtureA->GetType() == b2Shape::e_grid);
+	b2Assert(m_fixtureB->GetType() == b2Shape::e_capsule);
+}
+
+void b2GridAndCapsuleContact::Evaluate(b2Manifold* manifold, const b2Transform& xfA, const b2Transform& xfB)
+{
+	b2GridShape* grid = (b2GridShape*)m_fixtureA->GetShape();
+	b2CapsuleShape* capsule = (b2CapsuleShape*)m_fixtureB->GetShape();
+	if (grid->IsHeightField())
+	{
+		b2EdgeShape edge;
+		grid->GetChildEdge(&edge, m_indexA);
+		b2CollideEdgeAndCapsule(manifold, &edge, xfA, capsule, xfB);
+	}
+	else
+	{
+		b2PolygonShape box;
+		grid->GetChildBox(&box, m_indexA);
+		b2CollidePolygonAndCapsule(manifold, &box, xfA, capsule, xfB);
+	}
+}
@@ -25,6 +25,7 @@
 #include "box2d/common/block_allocator.h"
 #include "box2d/dynamics/body.h"
 #include "box2d/dynamics/fixture.h"
+#include "box2d/collision/shapes/polygon_shape.h"
 #include "box2d/collision/time_of_impact.h"
 #include "box2d/dynamics/world_callbacks.h"
 
@@ -51,7 +52,15 @@ b2PolygonContact::b2PolygonContact(b2Fixture* fixtureA, b2Fixture* fixtureB)
 
 void b2PolygonContact::Evaluate(b2Manifold* manifold, const b2Transform& xfA, const b2Transform& xfB)
 {
-	b2CollidePolygons(	manifold,
-						(b2PolygonShape*)m_fixtureA->GetShape(), xfA,
-						(b2PolygonShape*)m_fixtureB->GetShape(), xfB);
+	b2PolygonShape* polygonA = (b2PolygonShape*)m_fixtureA->GetShape();
+	b2PolygonShape* polygonB = (b2PolygonShape*)m_fixtureB->GetShape();
+
+	if (polygonA->m_isBox && polygonB->m_isBox)
+	{
+		b2CollideBoxes(manifold, polygonA, xfA, polygonB, xfB);
+	}
+	else
+	{
+		b2CollidePolygons(manifold, polygonA, xfA, polygonB, xfB);
+	}
 }
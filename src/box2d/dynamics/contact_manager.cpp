@@ -50,6 +50,10 @@ void b2ContactManager::Destroy(b2Contact* c)
 		m_contactListener->EndContact(c);
 	}
 
+	bool removed = m_pairSet.Remove(fixtureA, c->GetChildIndexA(), fixtureB, c->GetChildIndexB());
+	b2Assert(removed);
+	B2_NOT_USED(removed);
+
 	// Remove from the world.
 	if (c->m_prev)
 	{
@@ -140,6 +144,15 @@ void b2ContactManager::Collide()
 				continue;
 			}
 
+			// Do the collision layers still interact?
+			if (m_broadPhase.GetLayerCollision(fixtureA->m_filter.layer, fixtureB->m_filter.layer) == false)
+			{
+				b2Contact* cNuke = c;
+				c = cNuke->GetNext();
+				Destroy(cNuke);
+				continue;
+			}
+
 			// Clear the filtering flag.
 			c->m_flags &= ~b2Contact::e_filterFlag;
 		}
@@ -154,10 +167,18 @@ void b2ContactManager::Collide()
 			continue;
 		}
 
-		int32 proxyIdA = fixtureA->m_proxies[indexA].proxyId;
-		int32 proxyIdB = fixtureB->m_proxies[indexB].proxyId;
+		int32 proxyIdA = fixtureA->m_proxies[fixtureA->GetProxyIndex(indexA)].proxyId;
+		int32 proxyIdB = fixtureB->m_proxies[fixtureB->GetProxyIndex(indexB)].proxyId;
 		bool overlap = m_broadPhase.TestOverlap(proxyIdA, proxyIdB);
 
+		// Children under a shared proxy must overlap on their own.
+		if (overlap && (fixtureA->m_sharedProxy || fixtureB->m_sharedProxy))
+		{
+			b2AABB boundsA = GetChildBounds(fixtureA, indexA);
+			b2AABB boundsB = GetChildBounds(fixtureB, indexB);
+			overlap = b2TestOverlap(boundsA, boundsB);
+		}
+
 		// Here we destroy contacts that cease to overlap in the broad-phase.
 		if (overlap == false)
 		{
@@ -178,6 +199,61 @@ void b2ContactManager::FindNewContacts()
 	m_broadPhase.UpdatePairs(this);
 }
 
+b2AABB b2ContactManager::GetChildBounds(const b2Fixture* fixture, int32 childIndex) const
+{
+	if (fixture->m_sharedProxy == false)
+	{
+		return m_broadPhase.GetFatAABB(fixture->m_proxies[childIndex].proxyId);
+	}
+
+	b2AABB aabb;
+	fixture->m_shape->ComputeAABB(&aabb, fixture->m_body->GetTransform(), childIndex);
+	return aabb;
+}
+
+// Collects the children of a shared proxy that overlap a box.
+class b2ChildPairCallback : public b2ShapeChildCallback
+{
+public:
+	bool ReportChild(int32 childIndex) override
+	{
+		b2AABB childBounds = manager->GetChildBounds(fixture, childIndex);
+		if (b2TestOverlap(childBounds, bounds) == false)
+		{
+			return true;
+		}
+
+		if (other != nullptr)
+		{
+			// Both sides share a proxy, so look up the children on the other side.
+			b2ChildPairCallback callback;
+			callback.manager = manager;
+			callback.fixture = other;
+			callback.other = nullptr;
+			callback.otherIndex = childIndex;
+			callback.otherFixture = fixture;
+			callback.bounds = childBounds;
+			b2AABB localBounds = b2MulT(other->GetBody()->GetTransform(), childBounds);
+			other->GetShape()->QueryChildren(&callback, localBounds);
+			return true;
+		}
+
+		manager->AddChildPair(fixture, childIndex, otherFixture, otherIndex);
+		return true;
+	}
+
+	b2ContactManager* manager;
+	b2Fixture* fixture;
+	b2AABB bounds;
+
+	// The shared side still to be queried, if any.
+	b2Fixture* other;
+
+	// The side that is already resolved to a child.
+	b2Fixture* otherFixture;
+	int32 otherIndex;
+};
+
 void b2ContactManager::AddPair(void* proxyUserDataA, void* proxyUserDataB)
 {
 	b2FixtureProxy* proxyA = (b2FixtureProxy*)proxyUserDataA;
@@ -198,35 +274,46 @@ void b2ContactManager::AddPair(void* proxyUserDataA, void* proxyUserDataB)
 		return;
 	}
 
-	// TODO_ERIN use a hash table to remove a potential bottleneck when both
-	// bodies have a lot of contacts.
+	if (fixtureA->m_sharedProxy || fixtureB->m_sharedProxy)
+	{
+		AddSharedPair(proxyA, proxyB);
+		return;
+	}
+
 	// Does a contact already exist?
-	b2ContactEdge* edge = bodyB->GetContactList();
-	while (edge)
+	if (m_pairSet.Contains(fixtureA, indexA, fixtureB, indexB))
 	{
-		if (edge->other == bodyA)
-		{
-			b2Fixture* fA = edge->contact->GetFixtureA();
-			b2Fixture* fB = edge->contact->GetFixtureB();
-			int32 iA = edge->contact->GetChildIndexA();
-			int32 iB = edge->contact->GetChildIndexB();
+		return;
+	}
 
-			if (fA == fixtureA && fB == fixtureB && iA == indexA && iB == indexB)
-			{
-				// A contact already exists.
-				return;
-			}
+	// Does a joint override collision? Is at least one body dynamic?
+	if (bodyB->ShouldCollide(bodyA) == false)
+	{
+		return;
+	}
 
-			if (fA == fixtureB && fB == fixtureA && iA == indexB && iB == indexA)
-			{
-				// A contact already exists.
-				return;
-			}
-		}
+	// Check user filtering.
+	if (m_contactFilter && m_contactFilter->ShouldCollide(fixtureA, fixtureB) == false)
+	{
+		return;
+	}
 
-		edge = edge->next;
+	AddContact(fixtureA, indexA, fixtureB, indexB);
+}
+
+void b2ContactManager::AddSharedPair(b2FixtureProxy* proxyA, b2FixtureProxy* proxyB)
+{
+	// Put a shared proxy on side A.
+	if (proxyA->fixture->m_sharedProxy == false)
+	{
+		b2Swap(proxyA, proxyB);
 	}
 
+	b2Fixture* fixtureA = proxyA->fixture;
+	b2Fixture* fixtureB = proxyB->fixture;
+	b2Body* bodyA = fixtureA->GetBody();
+	b2Body* bodyB = fixtureB->GetBody();
+
 	// Does a joint override collision? Is at least one body dynamic?
 	if (bodyB->ShouldCollide(bodyA) == false)
 	{
@@ -239,6 +326,40 @@ void b2ContactManager::AddPair(void* proxyUserDataA, void* proxyUserDataB)
 		return;
 	}
 
+	b2ChildPairCallback callback;
+	callback.manager = this;
+	callback.fixture = fixtureA;
+	if (fixtureB->m_sharedProxy)
+	{
+		callback.bounds = m_broadPhase.GetFatAABB(proxyB->proxyId);
+		callback.other = fixtureB;
+		callback.otherFixture = nullptr;
+		callback.otherIndex = 0;
+	}
+	else
+	{
+		callback.bounds = GetChildBounds(fixtureB, proxyB->childIndex);
+		callback.other = nullptr;
+		callback.otherFixture = fixtureB;
+		callback.otherIndex = proxyB->childIndex;
+	}
+
+	b2AABB localBounds = b2MulT(bodyA->GetTransform(), callback.bounds);
+	fixtureA->m_shape->QueryChildren(&callback, localBounds);
+}
+
+void b2ContactManager::AddChildPair(b2Fixture* fixtureA, int32 indexA, b2Fixture* fixtureB, int32 indexB)
+{
+	if (m_pairSet.Contains(fixtureA, indexA, fixtureB, indexB))
+	{
+		return;
+	}
+
+	AddContact(fixtureA, indexA, fixtureB, indexB);
+}
+
+void b2ContactManager::AddContact(b2Fixture* fixtureA, int32 indexA, b2Fixture* fixtureB, int32 indexB)
+{
 	// Call the factory.
 	b2Contact* c = b2Contact::Create(fixtureA, indexA, fixtureB, indexB, m_allocator);
 	if (c == nullptr)
@@ -246,13 +367,15 @@ void b2ContactManager::AddPair(void* proxyUserDataA, void* proxyUserDataB)
 		return;
 	}
 
+	m_pairSet.Add(fixtureA, indexA, fixtureB, indexB);
+
 	// Contact creation may swap fixtures.
 	fixtureA = c->GetFixtureA();
 	fixtureB = c->GetFixtureB();
 	indexA = c->GetChildIndexA();
 	indexB = c->GetChildIndexB();
-	bodyA = fixtureA->GetBody();
-	bodyB = fixtureB->GetBody();
+	b2Body* bodyA = fixtureA->GetBody();
+	b2Body* bodyB = fixtureB->GetBody();
 
 	// Insert into the world.
 	c->m_prev = nullptr;
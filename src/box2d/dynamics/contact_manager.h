@@ -25,8 +25,11 @@
 
 #include "box2d/api.h"
 #include "box2d/collision/broad_phase.h"
+#include "box2d/common/pair_set.h"
 
 class b2Contact;
+class b2Fixture;
+struct b2FixtureProxy;
 class b2ContactFilter;
 class b2ContactListener;
 class b2BlockAllocator;
@@ -40,6 +43,18 @@ public:
 	// Broad-phase callback.
 	void AddPair(void* proxyUserDataA, void* proxyUserDataB);
 
+	// Pair the overlapping children when a proxy is shared by several children.
+	void AddSharedPair(b2FixtureProxy* proxyA, b2FixtureProxy* proxyB);
+
+	// Create the contact for a child pair unless it already exists.
+	void AddChildPair(b2Fixture* fixtureA, int32 indexA, b2Fixture* fixtureB, int32 indexB);
+
+	void AddContact(b2Fixture* fixtureA, int32 indexA, b2Fixture* fixtureB, int32 indexB);
+
+	// The bounds used to pair a child: its own AABB under a shared proxy and the
+	// fat proxy AABB otherwise.
+	b2AABB GetChildBounds(const b2Fixture* fixture, int32 childIndex) const;
+
 	void FindNewContacts();
 
 	void Destroy(b2Contact* c);
@@ -47,6 +62,10 @@ public:
 	void Collide();
 
 	b2BroadPhase m_broadPhase;
+
+	// The fixture child pairs that have a contact.
+	b2PairSet m_pairSet;
+
 	b2Contact* m_contactList;
 	int32 m_contactCount;
 	b2ContactFilter* m_contactFilter;
@@ -59,7 +59,21 @@ b2ContactSolver::b2ContactSolver(b2ContactSolverDef* def)
 	m_velocities = def->velocities;
 	m_contacts = def->contacts;
 
+	// Contacts with a static or kinematic body go after the others so they can be solved
+	// without writing the velocity of that body.
+	m_twoBodyCount = 0;
+	for (int32 i = 0; i < m_count; ++i)
+	{
+		b2Contact* contact = m_contacts[i];
+		if (contact->m_fixtureA->GetBody()->m_invMass > 0.0f && contact->m_fixtureB->GetBody()->m_invMass > 0.0f)
+		{
+			++m_twoBodyCount;
+		}
+	}
+
 	// Initialize position independent portions of the constraints.
+	int32 twoBodyIndex = 0;
+	int32 oneBodyIndex = m_twoBodyCount;
 	for (int32 i = 0; i < m_count; ++i)
 	{
 		b2Contact* contact = m_contacts[i];
@@ -68,8 +82,8 @@ b2ContactSolver::b2ContactSolver(b2ContactSolverDef* def)
 		b2Fixture* fixtureB = contact->m_fixtureB;
 		b2Shape* shapeA = fixtureA->GetShape();
 		b2Shape* shapeB = fixtureB->GetShape();
-		float radiusA = shapeA->m_radius;
-		float radiusB = shapeB->m_radius;
+		float radiusA = shapeA->GetChildRadius(contact->m_indexA);
+		float radiusB = shapeB->GetChildRadius(contact->m_indexB);
 		b2Body* bodyA = fixtureA->GetBody();
 		b2Body* bodyB = fixtureB->GetBody();
 		b2Manifold* manifold = contact->GetManifold();
@@ -77,7 +91,10 @@ b2ContactSolver::b2ContactSolver(b2ContactSolverDef* def)
 		int32 pointCount = manifold->pointCount;
 		b2Assert(pointCount > 0);
 
-		b2ContactVelocityConstraint* vc = m_velocityConstraints + i;
+		bool oneBody = bodyA->m_invMass == 0.0f || bodyB->m_invMass == 0.0f;
+		int32 index = oneBody ? oneBodyIndex++ : twoBodyIndex++;
+
+		b2ContactVelocityConstraint* vc = m_velocityConstraints + index;
 		vc->friction = contact->m_friction;
 		vc->restitution = contact->m_restitution;
 		vc->threshold = contact->m_restitutionThreshold;
@@ -93,7 +110,16 @@ b2ContactSolver::b2ContactSolver(b2ContactSolverDef* def)
 		vc->K.SetZero();
 		vc->normalMass.SetZero();
 
-		b2ContactPositionConstraint* pc = m_positionConstraints + i;
+		// The dynamic body of a one-body constraint is always body B. Swapping the bodies
+		// flips the normal and the tangent, which leaves both impulses as they are.
+		if (bodyB->m_invMass == 0.0f)
+		{
+			b2Swap(vc->indexA, vc->indexB);
+			b2Swap(vc->invMassA, vc->invMassB);
+			b2Swap(vc->invIA, vc->invIB);
+		}
+
+		b2ContactPositionConstraint* pc = m_positionConstraints + index;
 		pc->indexA = bodyA->m_islandIndex;
 		pc->indexB = bodyB->m_islandIndex;
 		pc->invMassA = bodyA->m_invMass;
@@ -154,8 +180,9 @@ void b2ContactSolver::InitializeVelocityConstraints()
 		float radiusB = pc->radiusB;
 		b2Manifold* manifold = m_contacts[vc->contactIndex]->GetManifold();
 
-		int32 indexA = vc->indexA;
-		int32 indexB = vc->indexB;
+		// The position constraint keeps the bodies in contact order.
+		int32 indexA = pc->indexA;
+		int32 indexB = pc->indexB;
 
 		float mA = vc->invMassA;
 		float mB = vc->invMassB;
@@ -166,13 +193,9 @@ void b2ContactSolver::InitializeVelocityConstraints()
 
 		b2Vec2 cA = m_positions[indexA].c;
 		float aA = m_positions[indexA].a;
-		b2Vec2 vA = m_velocities[indexA].v;
-		float wA = m_velocities[indexA].w;
 
 		b2Vec2 cB = m_positions[indexB].c;
 		float aB = m_positions[indexB].a;
-		b2Vec2 vB = m_velocities[indexB].v;
-		float wB = m_velocities[indexB].w;
 
 		b2Assert(manifold->pointCount > 0);
 
@@ -186,6 +209,17 @@ void b2ContactSolver::InitializeVelocityConstraints()
 		worldManifold.Initialize(manifold, xfA, radiusA, xfB, radiusB);
 
 		vc->normal = worldManifold.normal;
+		if (vc->indexA != indexA)
+		{
+			// A one-body constraint with swapped bodies.
+			vc->normal = -vc->normal;
+			b2Swap(cA, cB);
+		}
+
+		b2Vec2 vA = m_velocities[vc->indexA].v;
+		float wA = m_velocities[vc->indexA].w;
+		b2Vec2 vB = m_velocities[vc->indexB].v;
+		float wB = m_velocities[vc->indexB].w;
 
 		int32 pointCount = vc->pointCount;
 		for (int32 j = 0; j < pointCount; ++j)
@@ -257,7 +291,7 @@ void b2ContactSolver::InitializeVelocityConstraints()
 void b2ContactSolver::WarmStart()
 {
 	// Warm start.
-	for (int32 i = 0; i < m_count; ++i)
+	for (int32 i = 0; i < m_twoBodyCount; ++i)
 	{
 		b2ContactVelocityConstraint* vc = m_velocityConstraints + i;
 
@@ -292,11 +326,38 @@ void b2ContactSolver::WarmStart()
 		m_velocities[indexB].v = vB;
 		m_velocities[indexB].w = wB;
 	}
+
+	for (int32 i = m_twoBodyCount; i < m_count; ++i)
+	{
+		b2ContactVelocityConstraint* vc = m_velocityConstraints + i;
+
+		int32 indexB = vc->indexB;
+		float mB = vc->invMassB;
+		float iB = vc->invIB;
+		int32 pointCount = vc->pointCount;
+
+		b2Vec2 vB = m_velocities[indexB].v;
+		float wB = m_velocities[indexB].w;
+
+		b2Vec2 normal = vc->normal;
+		b2Vec2 tangent = b2Cross(normal, 1.0f);
+
+		for (int32 j = 0; j < pointCount; ++j)
+		{
+			b2VelocityConstraintPoint* vcp = vc->points + j;
+			b2Vec2 P = vcp->normalImpulse * normal + vcp->tangentImpulse * tangent;
+			wB += iB * b2Cross(vcp->rB, P);
+			vB += mB * P;
+		}
+
+		m_velocities[indexB].v = vB;
+		m_velocities[indexB].w = wB;
+	}
 }
 
 void b2ContactSolver::SolveVelocityConstraints()
 {
-	for (int32 i = 0; i < m_count; ++i)
+	for (int32 i = 0; i < m_twoBodyCount; ++i)
 	{
 		b2ContactVelocityConstraint* vc = m_velocityConstraints + i;
 
@@ -604,6 +665,141 @@ void b2ContactSolver::SolveVelocityConstraints()
 		m_velocities[indexB].v = vB;
 		m_velocities[indexB].w = wB;
 	}
+
+	SolveOneBodyVelocityConstraints();
+}
+
+// Body A of these constraints is static or kinematic. Its velocity is read but never written.
+void b2ContactSolver::SolveOneBodyVelocityConstraints()
+{
+	for (int32 i = m_twoBodyCount; i < m_count; ++i)
+	{
+		b2ContactVelocityConstraint* vc = m_velocityConstraints + i;
+
+		int32 indexB = vc->indexB;
+		float mB = vc->invMassB;
+		float iB = vc->invIB;
+		int32 pointCount = vc->pointCount;
+
+		b2Vec2 vA = m_velocities[vc->indexA].v;
+		float wA = m_velocities[vc->indexA].w;
+		b2Vec2 vB = m_velocities[indexB].v;
+		float wB = m_velocities[indexB].w;
+
+		b2Vec2 normal = vc->normal;
+		b2Vec2 tangent = b2Cross(normal, 1.0f);
+		float friction = vc->friction;
+
+		b2Assert(pointCount == 1 || pointCount == 2);
+
+		// Solve tangent constraints first because non-penetration is more important
+		// than friction.
+		for (int32 j = 0; j < pointCount; ++j)
+		{
+			b2VelocityConstraintPoint* vcp = vc->points + j;
+
+			// Relative velocity at contact
+			b2Vec2 dv = vB + b2Cross(wB, vcp->rB) - vA - b2Cross(wA, vcp->rA);
+
+			// Compute tangent force
+			float vt = b2Dot(dv, tangent) - vc->tangentSpeed;
+			float lambda = vcp->tangentMass * (-vt);
+
+			// b2Clamp the accumulated force
+			float maxFriction = friction * vcp->normalImpulse;
+			float newImpulse = b2Clamp(vcp->tangentImpulse + lambda, -maxFriction, maxFriction);
+			lambda = newImpulse - vcp->tangentImpulse;
+			vcp->tangentImpulse = newImpulse;
+
+			// Apply contact impulse
+			b2Vec2 P = lambda * tangent;
+			vB += mB * P;
+			wB += iB * b2Cross(vcp->rB, P);
+		}
+
+		// Solve normal constraints
+		if (pointCount == 1 || g_blockSolve == false)
+		{
+			for (int32 j = 0; j < pointCount; ++j)
+			{
+				b2VelocityConstraintPoint* vcp = vc->points + j;
+
+				// Relative velocity at contact
+				b2Vec2 dv = vB + b2Cross(wB, vcp->rB) - vA - b2Cross(wA, vcp->rA);
+
+				// Compute normal impulse
+				float vn = b2Dot(dv, normal);
+				float lambda = -vcp->normalMass * (vn - vcp->velocityBias);
+
+				// b2Clamp the accumulated impulse
+				float newImpulse = b2Max(vcp->normalImpulse + lambda, 0.0f);
+				lambda = newImpulse - vcp->normalImpulse;
+				vcp->normalImpulse = newImpulse;
+
+				// Apply contact impulse
+				b2Vec2 P = lambda * normal;
+				vB += mB * P;
+				wB += iB * b2Cross(vcp->rB, P);
+			}
+		}
+		else
+		{
+			// The block solver of SolveVelocityConstraints. Each case only picks the new
+			// total impulse, which is then applied once.
+			b2VelocityConstraintPoint* cp1 = vc->points + 0;
+			b2VelocityConstraintPoint* cp2 = vc->points + 1;
+
+			b2Vec2 a(cp1->normalImpulse, cp2->normalImpulse);
+			b2Assert(a.x >= 0.0f && a.y >= 0.0f);
+
+			// Relative velocity at contact
+			b2Vec2 dv1 = vB + b2Cross(wB, cp1->rB) - vA - b2Cross(wA, cp1->rA);
+			b2Vec2 dv2 = vB + b2Cross(wB, cp2->rB) - vA - b2Cross(wA, cp2->rA);
+
+			// Compute b'
+			b2Vec2 b;
+			b.x = b2Dot(dv1, normal) - cp1->velocityBias;
+			b.y = b2Dot(dv2, normal) - cp2->velocityBias;
+			b -= b2Mul(vc->K, a);
+
+			// Case 1: vn = 0
+			b2Vec2 x = - b2Mul(vc->normalMass, b);
+			if (x.x < 0.0f || x.y < 0.0f)
+			{
+				// Case 2: vn1 = 0 and x2 = 0
+				x.Set(- cp1->normalMass * b.x, 0.0f);
+				if (x.x < 0.0f || vc->K.ex.y * x.x + b.y < 0.0f)
+				{
+					// Case 3: vn2 = 0 and x1 = 0
+					x.Set(0.0f, - cp2->normalMass * b.y);
+					if (x.y < 0.0f || vc->K.ey.x * x.y + b.x < 0.0f)
+					{
+						// Case 4: x1 = 0 and x2 = 0
+						x.SetZero();
+						if (b.x < 0.0f || b.y < 0.0f)
+						{
+							// No solution, give up.
+							x = a;
+						}
+					}
+				}
+			}
+
+			// Apply incremental impulse
+			b2Vec2 d = x - a;
+			b2Vec2 P1 = d.x * normal;
+			b2Vec2 P2 = d.y * normal;
+			vB += mB * (P1 + P2);
+			wB += iB * (b2Cross(cp1->rB, P1) + b2Cross(cp2->rB, P2));
+
+			// Accumulate
+			cp1->normalImpulse = x.x;
+			cp2->normalImpulse = x.y;
+		}
+
+		m_velocities[indexB].v = vB;
+		m_velocities[indexB].w = wB;
+	}
 }
 
 void b2ContactSolver::StoreImpulses()
@@ -81,6 +81,7 @@ public:
 
 	void WarmStart();
 	void SolveVelocityConstraints();
+	void SolveOneBodyVelocityConstraints();
 	void StoreImpulses();
 
 	bool SolvePositionConstraints();
@@ -94,6 +95,10 @@ public:
 	b2ContactVelocityConstraint* m_velocityConstraints;
 	b2Contact** m_contacts;
 	int m_count;
+
+	// The constraints with a static or kinematic body come after the first m_twoBodyCount.
+	// Their dynamic body is always body B.
+	int32 m_twoBodyCount;
 };
 
 #endif
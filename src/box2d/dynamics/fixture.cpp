@@ -23,11 +23,14 @@
 #include "fixture.h"
 #include "box2d/common/block_allocator.h"
 #include "box2d/collision/broad_phase.h"
+#include "box2d/collision/shapes/capsule_shape.h"
 #include "box2d/collision/shapes/chain_shape.h"
 #include "box2d/collision/shapes/circle_shape.h"
+#include "box2d/collision/shapes/compound_shape.h"
 #include "box2d/collision/collision.h"
 #include "contact/contact.h"
 #include "box2d/collision/shapes/edge_shape.h"
+#include "box2d/collision/shapes/grid_shape.h"
 #include "box2d/collision/shapes/polygon_shape.h"
 #include "world.h"
 
@@ -37,7 +40,9 @@ b2Fixture::b2Fixture()
 	m_next = nullptr;
 	m_proxies = nullptr;
 	m_proxyCount = 0;
+	m_sharedProxy = false;
 	m_shape = nullptr;
+	m_sharedShape = nullptr;
 	m_density = 0.0f;
 }
 
@@ -51,21 +56,33 @@ void b2Fixture::Create(b2BlockAllocator* allocator, b2Body* body, const b2Fixtur
 	m_body = body;
 	m_next = nullptr;
 
+	b2Assert(def->filter.layer < b2_maxCollisionLayers);
 	m_filter = def->filter;
 
 	m_isSensor = def->isSensor;
 
-	m_shape = def->shape->Clone(allocator);
+	if (def->sharedShape)
+	{
+		// Fixtures share the shape instead of cloning it.
+		m_sharedShape = def->sharedShape;
+		++m_sharedShape->m_refCount;
+		m_shape = m_sharedShape->m_shape;
+	}
+	else
+	{
+		m_shape = def->shape->Clone(allocator);
+	}
 
 	// Reserve proxy space
-	int32 childCount = m_shape->GetChildCount();
-	m_proxies = (b2FixtureProxy*)allocator->Allocate(childCount * sizeof(b2FixtureProxy));
-	for (int32 i = 0; i < childCount; ++i)
+	int32 proxyCount = m_shape->GetProxyCount();
+	m_proxies = (b2FixtureProxy*)allocator->Allocate(proxyCount * sizeof(b2FixtureProxy));
+	for (int32 i = 0; i < proxyCount; ++i)
 	{
 		m_proxies[i].fixture = nullptr;
 		m_proxies[i].proxyId = b2BroadPhase::e_nullProxy;
 	}
 	m_proxyCount = 0;
+	m_sharedProxy = m_shape->SharesProxy();
 
 	m_density = def->density;
 }
@@ -76,16 +93,31 @@ void b2Fixture::Destroy(b2BlockAllocator* allocator)
 	b2Assert(m_proxyCount == 0);
 
 	// Free the proxy array.
-	int32 childCount = m_shape->GetChildCount();
-	allocator->Free(m_proxies, childCount * sizeof(b2FixtureProxy));
+	int32 proxyCount = m_shape->GetProxyCount();
+	allocator->Free(m_proxies, proxyCount * sizeof(b2FixtureProxy));
 	m_proxies = nullptr;
 
 	// Free the child shape.
-	switch (m_shape->m_type)
+	if (m_sharedShape)
+	{
+		ReleaseSharedShape(allocator, m_sharedShape);
+		m_sharedShape = nullptr;
+	}
+	else
+	{
+		DestroyShape(allocator, m_shape);
+	}
+
+	m_shape = nullptr;
+}
+
+void b2Fixture::DestroyShape(b2BlockAllocator* allocator, b2Shape* shape)
+{
+	switch (shape->m_type)
 	{
 	case b2Shape::e_circle:
 		{
-			b2CircleShape* s = (b2CircleShape*)m_shape;
+			b2CircleShape* s = (b2CircleShape*)shape;
 			s->~b2CircleShape();
 			allocator->Free(s, sizeof(b2CircleShape));
 		}
@@ -93,7 +125,7 @@ void b2Fixture::Destroy(b2BlockAllocator* allocator)
 
 	case b2Shape::e_edge:
 		{
-			b2EdgeShape* s = (b2EdgeShape*)m_shape;
+			b2EdgeShape* s = (b2EdgeShape*)shape;
 			s->~b2EdgeShape();
 			allocator->Free(s, sizeof(b2EdgeShape));
 		}
@@ -101,7 +133,7 @@ void b2Fixture::Destroy(b2BlockAllocator* allocator)
 
 	case b2Shape::e_polygon:
 		{
-			b2PolygonShape* s = (b2PolygonShape*)m_shape;
+			b2PolygonShape* s = (b2PolygonShape*)shape;
 			s->~b2PolygonShape();
 			allocator->Free(s, sizeof(b2PolygonShape));
 		}
@@ -109,18 +141,53 @@ void b2Fixture::Destroy(b2BlockAllocator* allocator)
 
 	case b2Shape::e_chain:
 		{
-			b2ChainShape* s = (b2ChainShape*)m_shape;
+			b2ChainShape* s = (b2ChainShape*)shape;
 			s->~b2ChainShape();
 			allocator->Free(s, sizeof(b2ChainShape));
 		}
 		break;
 
+	case b2Shape::e_capsule:
+		{
+			b2CapsuleShape* s = (b2CapsuleShape*)shape;
+			s->~b2CapsuleShape();
+			allocator->Free(s, sizeof(b2CapsuleShape));
+		}
+		break;
+
+	case b2Shape::e_grid:
+		{
+			b2GridShape* s = (b2GridShape*)shape;
+			s->~b2GridShape();
+			allocator->Free(s, sizeof(b2GridShape));
+		}
+		break;
+
+	case b2Shape::e_compound:
+		{
+			b2CompoundShape* s = (b2CompoundShape*)shape;
+			s->~b2CompoundShape();
+			allocator->Free(s, sizeof(b2CompoundShape));
+		}
+		break;
+
 	default:
 		b2Assert(false);
 		break;
 	}
+}
 
-	m_shape = nullptr;
+void b2Fixture::ReleaseSharedShape(b2BlockAllocator* allocator, b2SharedShape* sharedShape)
+{
+	b2Assert(sharedShape->m_refCount > 0);
+	if (--sharedShape->m_refCount > 0)
+	{
+		return;
+	}
+
+	DestroyShape(allocator, sharedShape->m_shape);
+	sharedShape->~b2SharedShape();
+	allocator->Free(sharedShape, sizeof(b2SharedShape));
 }
 
 void b2Fixture::CreateProxies(b2BroadPhase* broadPhase, const b2Transform& xf)
@@ -128,13 +195,14 @@ void b2Fixture::CreateProxies(b2BroadPhase* broadPhase, const b2Transform& xf)
 	b2Assert(m_proxyCount == 0);
 
 	// Create proxies in the broad-phase.
-	m_proxyCount = m_shape->GetChildCount();
+	m_proxyCount = m_shape->GetProxyCount();
+	bool isStatic = m_body->GetType() == b2_staticBody;
 
 	for (int32 i = 0; i < m_proxyCount; ++i)
 	{
 		b2FixtureProxy* proxy = m_proxies + i;
-		m_shape->ComputeAABB(&proxy->aabb, xf, i);
-		proxy->proxyId = broadPhase->CreateProxy(proxy->aabb, proxy);
+		m_shape->ComputeProxyAABB(&proxy->aabb, xf, i);
+		proxy->proxyId = broadPhase->CreateProxy(proxy->aabb, proxy, isStatic, m_filter.layer);
 		proxy->fixture = this;
 		proxy->childIndex = i;
 	}
@@ -166,21 +234,39 @@ void b2Fixture::Synchronize(b2BroadPhase* broadPhase, const b2Transform& transfo
 
 		// Compute an AABB that covers the swept shape (may miss some rotation effect).
 		b2AABB aabb1, aabb2;
-		m_shape->ComputeAABB(&aabb1, transform1, proxy->childIndex);
-		m_shape->ComputeAABB(&aabb2, transform2, proxy->childIndex);
+		m_shape->ComputeProxyAABB(&aabb1, transform1, i);
+		m_shape->ComputeProxyAABB(&aabb2, transform2, i);
 	
 		proxy->aabb.Combine(aabb1, aabb2);
 
 		b2Vec2 displacement = aabb2.GetCenter() - aabb1.GetCenter();
 
 		broadPhase->MoveProxy(proxy->proxyId, proxy->aabb, displacement);
+
+		// Children can move into a neighbor while the proxy stays inside its fat AABB,
+		// so shared proxies look for new child pairs whenever the body moves.
+		if (m_sharedProxy)
+		{
+			broadPhase->TouchProxy(proxy->proxyId);
+		}
 	}
 }
 
 void b2Fixture::SetFilterData(const b2Filter& filter)
 {
+	b2Assert(filter.layer < b2_maxCollisionLayers);
+	bool relayer = filter.layer != m_filter.layer;
+
 	m_filter = filter;
 
+	// Proxies live in the structures of their layer.
+	if (relayer && m_proxyCount > 0)
+	{
+		b2BroadPhase* broadPhase = &m_body->GetWorld()->m_contactManager.m_broadPhase;
+		DestroyProxies(broadPhase);
+		CreateProxies(broadPhase, m_body->GetTransform());
+	}
+
 	Refilter();
 }
 
@@ -241,6 +327,7 @@ void b2Fixture::Dump(int32 bodyIndex)
 	b2Dump("    fd.filter.categoryBits = uint16(%d);\n", m_filter.categoryBits);
 	b2Dump("    fd.filter.maskBits = uint16(%d);\n", m_filter.maskBits);
 	b2Dump("    fd.filter.groupIndex = int16(%d);\n", m_filter.groupIndex);
+	b2Dump("    fd.filter.layer = uint16(%d);\n", m_filter.layer);
 
 	switch (m_shape->m_type)
 	{
@@ -291,6 +378,87 @@ void b2Fixture::Dump(int32 bodyIndex)
 			b2Dump("    shape.CreateChain(vs, %d);\n", s->m_count);
 			b2Dump("    shape.m_prevVertex.Set(%.9g, %.9g);\n", s->m_prevVertex.x, s->m_prevVertex.y);
 			b2Dump("    shape.m_nextVertex.Set(%.9g, %.9g);\n", s->m_nextVertex.x, s->m_nextVertex.y);
+			if (s->IsSingleProxy())
+			{
+				b2Dump("    shape.SetSingleProxy(true);\n");
+			}
+		}
+		break;
+
+	case b2Shape::e_capsule:
+		{
+			b2CapsuleShape* s = (b2CapsuleShape*)m_shape;
+			b2Dump("    b2CapsuleShape shape;\n");
+			b2Dump("    shape.m_radius = %.9g;\n", s->m_radius);
+			b2Dump("    shape.m_vertex1.Set(%.9g, %.9g);\n", s->m_vertex1.x, s->m_vertex1.y);
+			b2Dump("    shape.m_vertex2.Set(%.9g, %.9g);\n", s->m_vertex2.x, s->m_vertex2.y);
+		}
+		break;
+
+	case b2Shape::e_grid:
+		{
+			b2GridShape* s = (b2GridShape*)m_shape;
+			b2Dump("    b2GridShape shape;\n");
+			b2Vec2 origin = s->m_origin;
+			if (s->IsHeightField())
+			{
+				int32 count = s->m_columns + 1;
+				b2Dump("    float heights[%d];\n", count);
+				for (int32 i = 0; i < count; ++i)
+				{
+					b2Dump("    heights[%d] = %.9g;\n", i, s->m_heights[i]);
+				}
+				b2Dump("    shape.CreateHeightField(heights, %d, %.9g, b2Vec2(%.9g, %.9g));\n", count, s->m_cellSize, origin.x, origin.y);
+			}
+			else
+			{
+				int32 count = s->m_columns * s->m_rows;
+				b2Dump("    uint8 tiles[%d];\n", count);
+				for (int32 i = 0; i < count; ++i)
+				{
+					b2Dump("    tiles[%d] = %d;\n", i, s->m_tiles[i]);
+				}
+				b2Dump("    shape.CreateTileMap(tiles, %d, %d, %.9g, b2Vec2(%.9g, %.9g));\n", s->m_columns, s->m_rows, s->m_cellSize, origin.x, origin.y);
+			}
+		}
+		break;
+
+	case b2Shape::e_compound:
+		{
+			b2CompoundShape* s = (b2CompoundShape*)m_shape;
+			b2Dump("    b2CompoundShape shape;\n");
+			b2Dump("    const b2Shape* children[%d];\n", s->m_count);
+			for (int32 i = 0; i < s->m_count; ++i)
+			{
+				const b2Shape* child = s->GetChild(i);
+				if (child->m_type == b2Shape::e_circle)
+				{
+					const b2CircleShape* c = (const b2CircleShape*)child;
+					b2Dump("    b2CircleShape child%d;\n", i);
+					b2Dump("    child%d.m_radius = %.9g;\n", i, c->m_radius);
+					b2Dump("    child%d.m_p.Set(%.9g, %.9g);\n", i, c->m_p.x, c->m_p.y);
+				}
+				else if (child->m_type == b2Shape::e_polygon)
+				{
+					const b2PolygonShape* c = (const b2PolygonShape*)child;
+					b2Dump("    b2PolygonShape child%d;\n", i);
+					b2Dump("    b2Vec2 vs%d[%d];\n", i, b2_maxPolygonVertices);
+					for (int32 j = 0; j < c->m_count; ++j)
+					{
+						b2Dump("    vs%d[%d].Set(%.9g, %.9g);\n", i, j, c->m_vertices[j].x, c->m_vertices[j].y);
+					}
+					b2Dump("    child%d.Set(vs%d, %d);\n", i, i, c->m_count);
+				}
+				else
+				{
+					const b2CapsuleShape* c = (const b2CapsuleShape*)child;
+					b2Dump("    b2CapsuleShape child%d;\n", i);
+					b2Dump("    child%d.Set(b2Vec2(%.9g, %.9g), b2Vec2(%.9g, %.9g), %.9g);\n", i,
+						c->m_vertex1.x, c->m_vertex1.y, c->m_vertex2.x, c->m_vertex2.y, c->m_radius);
+				}
+				b2Dump("    children[%d] = &child%d;\n", i, i);
+			}
+			b2Dump("    shape.Create(children, %d);\n", s->m_count);
 		}
 		break;
 
@@ -32,6 +32,34 @@ class b2BlockAllocator;
 class b2Body;
 class b2BroadPhase;
 class b2Fixture;
+class b2World;
+
+/// A shape that many fixtures can use without a copy each. Create it with
+/// b2World::CreateSharedShape and put it in b2FixtureDef::sharedShape. The shape
+/// is freed once the world has released it and no fixture uses it.
+/// @warning the shape must not be changed while it is shared.
+class B2_API b2SharedShape {
+  public:
+    /// Get the shape.
+    const b2Shape* GetShape() const;
+
+    /// Get the number of fixtures that use the shape.
+    int32 GetFixtureCount() const;
+
+  protected:
+    friend class b2World;
+    friend class b2Fixture;
+
+    b2Shape* m_shape;
+
+    // The fixtures plus one while the world holds the shape.
+    int32 m_refCount;
+
+    // The world list, only while the world holds the shape.
+    b2SharedShape* m_prev;
+    b2SharedShape* m_next;
+    bool m_worldOwned;
+};
 
 /// This holds contact filtering data.
 struct B2_API b2Filter {
@@ -39,6 +67,7 @@ struct B2_API b2Filter {
       categoryBits = 0x0001;
       maskBits = 0xFFFF;
       groupIndex = 0;
+      layer = 0;
     }
 
     /// The collision category bits. Normally you would just set one bit.
@@ -52,6 +81,11 @@ struct B2_API b2Filter {
     /// or always collide (positive). Zero means no collision group. Non-zero group
     /// filtering always wins against the mask bits.
     int16 groupIndex;
+
+    /// The collision layer, less than b2_maxCollisionLayers. Each layer has its own
+    /// broad-phase structures and layers that don't collide (see b2World::SetLayerCollision)
+    /// are never paired.
+    uint16 layer;
 };
 
 /// A fixture definition is used to create a fixture. This class defines an
@@ -60,6 +94,7 @@ struct B2_API b2FixtureDef {
     /// The constructor sets the default fixture definition values.
     b2FixtureDef() {
       shape = nullptr;
+      sharedShape = nullptr;
       friction = 0.2f;
       restitution = 0.0f;
       restitutionThreshold = 1.0f * b2_lengthUnitsPerMeter;
@@ -67,10 +102,13 @@ struct B2_API b2FixtureDef {
       isSensor = false;
     }
 
-    /// The shape, this must be set. The shape will be cloned, so you
-    /// can create the shape on the stack.
+    /// The shape, this must be set unless there is a shared shape. The shape
+    /// will be cloned, so you can create the shape on the stack.
     const b2Shape* shape;
 
+    /// A shared shape to use instead of cloning the shape.
+    b2SharedShape* sharedShape;
+
     /// Use this to store application specific fixture data.
     b2FixtureUserData userData;
 
@@ -117,9 +155,13 @@ class B2_API b2Fixture {
     /// Get the child shape. You can modify the child shape, however you should not change the
     /// number of vertices because this will crash some collision caching mechanisms.
     /// Manipulating the shape may lead to non-physical behavior.
+    /// @warning a shared shape changes for all fixtures that use it.
     b2Shape* GetShape();
     const b2Shape* GetShape() const;
 
+    /// Get the shared shape, or nullptr if the fixture has its own copy of the shape.
+    b2SharedShape* GetSharedShape();
+
     /// Set if this fixture is a sensor.
     void SetSensor( bool sensor );
 
@@ -167,6 +209,14 @@ class B2_API b2Fixture {
     /// @param childIndex the child shape index (e.g. edge index)
     bool RayCast( b2RayCastOutput* output, const b2RayCastInput& input, int32 childIndex ) const;
 
+    /// Compute the distance from this fixture to many points.
+    /// @see b2Shape::ComputeDistances
+    void ComputeDistances( const b2Vec2* points, int32 count, float* distances, b2Vec2* normals, int32 childIndex ) const;
+
+    /// Cast many rays against this shape.
+    /// @see b2Shape::RayCasts
+    int32 RayCasts( b2RayCastOutput* outputs, bool* hits, const b2RayCastInput* inputs, int32 count, int32 childIndex ) const;
+
     /// Get the mass data for this fixture. The mass data is based on the density and
     /// the shape. The rotational inertia is about the shape's origin. This operation
     /// may be expensive.
@@ -202,7 +252,8 @@ class B2_API b2Fixture {
 
     /// Get the fixture's AABB. This AABB may be enlarge and/or stale.
     /// If you need a more accurate AABB, compute it using the shape and
-    /// the body transform.
+    /// the body transform. When one proxy covers all children this is the
+    /// AABB of the whole shape.
     const b2AABB& GetAABB( int32 childIndex ) const;
 
     /// Dump this fixture to the log file.
@@ -222,18 +273,28 @@ class B2_API b2Fixture {
     void Create( b2BlockAllocator* allocator, b2Body* body, const b2FixtureDef* def );
     void Destroy( b2BlockAllocator* allocator );
 
+    // Free a shape made with b2Shape::Clone.
+    static void DestroyShape( b2BlockAllocator* allocator, b2Shape* shape );
+
+    // Drop a reference to a shared shape and free it with the last one.
+    static void ReleaseSharedShape( b2BlockAllocator* allocator, b2SharedShape* sharedShape );
+
     // These support body activation/deactivation.
     void CreateProxies( b2BroadPhase* broadPhase, const b2Transform& xf );
     void DestroyProxies( b2BroadPhase* broadPhase );
 
     void Synchronize( b2BroadPhase* broadPhase, const b2Transform& xf1, const b2Transform& xf2 );
 
+    // Get the proxy that covers a child.
+    int32 GetProxyIndex( int32 childIndex ) const;
+
     float m_density;
 
     b2Fixture* m_next;
     b2Body* m_body;
 
     b2Shape* m_shape;
+    b2SharedShape* m_sharedShape;
 
     float m_friction;
     float m_restitution;
@@ -242,6 +303,9 @@ class B2_API b2Fixture {
     b2FixtureProxy* m_proxies;
     int32 m_proxyCount;
 
+    // Does a single proxy cover all children of the shape?
+    bool m_sharedProxy;
+
     b2Filter m_filter;
 
     bool m_isSensor;
@@ -249,6 +313,14 @@ class B2_API b2Fixture {
     b2FixtureUserData m_userData;
 };
 
+inline const b2Shape* b2SharedShape::GetShape() const {
+  return m_shape;
+}
+
+inline int32 b2SharedShape::GetFixtureCount() const {
+  return m_worldOwned ? m_refCount - 1 : m_refCount;
+}
+
 inline b2Shape::Type b2Fixture::GetType() const {
   return m_shape->GetType();
 }
@@ -261,6 +333,10 @@ inline const b2Shape* b2Fixture::GetShape() const {
   return m_shape;
 }
 
+inline b2SharedShape* b2Fixture::GetSharedShape() {
+  return m_sharedShape;
+}
+
 inline bool b2Fixture::IsSensor() const {
   return m_isSensor;
 }
@@ -338,13 +414,26 @@ inline bool b2Fixture::RayCast( b2RayCastOutput* output, const b2RayCastInput& i
   return m_shape->RayCast( output, input, m_body->GetTransform(), childIndex );
 }
 
+inline void b2Fixture::ComputeDistances( const b2Vec2* points, int32 count, float* distances, b2Vec2* normals, int32 childIndex ) const {
+  m_shape->ComputeDistances( m_body->GetTransform(), points, count, distances, normals, childIndex );
+}
+
+inline int32 b2Fixture::RayCasts( b2RayCastOutput* outputs, bool* hits, const b2RayCastInput* inputs, int32 count, int32 childIndex ) const {
+  return m_shape->RayCasts( outputs, hits, inputs, count, m_body->GetTransform(), childIndex );
+}
+
 inline void b2Fixture::GetMassData( b2MassData* massData ) const {
   m_shape->ComputeMass( massData, m_density );
 }
 
 inline const b2AABB& b2Fixture::GetAABB( int32 childIndex ) const {
-  b2Assert( 0 <= childIndex && childIndex < m_proxyCount );
-  return m_proxies [ childIndex ].aabb;
+  int32 proxyIndex = GetProxyIndex( childIndex );
+  b2Assert( 0 <= proxyIndex && proxyIndex < m_proxyCount );
+  return m_proxies [ proxyIndex ].aabb;
+}
+
+inline int32 b2Fixture::GetProxyIndex( int32 childIndex ) const {
+  return m_sharedProxy ? 0 : childIndex;
 }
 
 #endif
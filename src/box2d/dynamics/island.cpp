@@ -31,6 +31,7 @@
 
 #include "contact_solver.h"
 #include "island.h"
+#include "joint_solver.h"
 
 /*
 Position Correction Notes
@@ -150,6 +151,28 @@ This might be faster than computing sin+cos.
 However, we can compute sin+cos of the same angle fast.
 */
 
+B2_API int32 b2_velocityCalls, b2_velocityIters, b2_velocityMaxIters;
+
+// True if no velocity changed by more than the iteration tolerances.
+static bool b2VelocitiesConverged(const b2Velocity* before, const b2Velocity* after, int32 count)
+{
+	for (int32 i = 0; i < count; ++i)
+	{
+		b2Vec2 dv = after[i].v - before[i].v;
+		if (b2Dot(dv, dv) > b2_linearIterationTolerance * b2_linearIterationTolerance)
+		{
+			return false;
+		}
+
+		if (b2Abs(after[i].w - before[i].w) > b2_angularIterationTolerance)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
 b2Island::b2Island(
 	int32 bodyCapacity,
 	int32 contactCapacity,
@@ -230,12 +253,6 @@ void b2Island::Solve(b2Profile* profile, const b2TimeStep& step, const b2Vec2& g
 
 	timer.Reset();
 
-	// Solver data
-	b2SolverData solverData;
-	solverData.step = step;
-	solverData.positions = m_positions;
-	solverData.velocities = m_velocities;
-
 	// Initialize velocity constraints.
 	b2ContactSolverDef contactSolverDef;
 	contactSolverDef.step = step;
@@ -253,26 +270,62 @@ void b2Island::Solve(b2Profile* profile, const b2TimeStep& step, const b2Vec2& g
 		contactSolver.WarmStart();
 	}
 	
-	for (int32 i = 0; i < m_jointCount; ++i)
-	{
-		m_joints[i]->InitVelocityConstraints(solverData);
-	}
+	b2JointSolverDef jointSolverDef;
+	jointSolverDef.step = step;
+	jointSolverDef.joints = m_joints;
+	jointSolverDef.count = m_jointCount;
+	jointSolverDef.bodyCount = m_bodyCount;
+	jointSolverDef.positions = m_positions;
+	jointSolverDef.velocities = m_velocities;
+	jointSolverDef.allocator = m_allocator;
+
+	b2JointSolver jointSolver(&jointSolverDef);
+	jointSolver.InitVelocityConstraints();
 
 	profile->solveInit = timer.GetMilliseconds();
 
 	// Solve velocity constraints
 	timer.Reset();
-	for (int32 i = 0; i < step.velocityIterations; ++i)
+	int32 velocityIterations = 0;
+	if (step.adaptiveIterations == false)
 	{
-		for (int32 j = 0; j < m_jointCount; ++j)
+		for (; velocityIterations < step.velocityIterations; ++velocityIterations)
 		{
-			m_joints[j]->SolveVelocityConstraints(solverData);
+			jointSolver.SolveVelocityConstraints();
+
+			contactSolver.SolveVelocityConstraints();
 		}
+	}
+	else if (m_contactCount + m_jointCount > 0)
+	{
+		// Exit early once an iteration leaves the velocities where they were.
+		b2Velocity* velocities = (b2Velocity*)m_allocator->Allocate(m_bodyCount * sizeof(b2Velocity));
+		while (velocityIterations < step.maxVelocityIterations)
+		{
+			memcpy(velocities, m_velocities, m_bodyCount * sizeof(b2Velocity));
 
-		contactSolver.SolveVelocityConstraints();
+			jointSolver.SolveVelocityConstraints();
+
+			contactSolver.SolveVelocityConstraints();
+
+			++velocityIterations;
+			if (b2VelocitiesConverged(velocities, m_velocities, m_bodyCount))
+			{
+				break;
+			}
+		}
+
+		m_allocator->Free(velocities);
 	}
 
+	profile->velocityIterations = velocityIterations;
+
+	++b2_velocityCalls;
+	b2_velocityIters += velocityIterations;
+	b2_velocityMaxIters = b2Max(b2_velocityMaxIters, velocityIterations);
+
 	// Store impulses for warm starting
+	jointSolver.StoreImpulses();
 	contactSolver.StoreImpulses();
 	profile->solveVelocity = timer.GetMilliseconds();
 
@@ -316,12 +369,7 @@ void b2Island::Solve(b2Profile* profile, const b2TimeStep& step, const b2Vec2& g
 	{
 		bool contactsOkay = contactSolver.SolvePositionConstraints();
 
-		bool jointsOkay = true;
-		for (int32 j = 0; j < m_jointCount; ++j)
-		{
-			bool jointOkay = m_joints[j]->SolvePositionConstraints(solverData);
-			jointsOkay = jointsOkay && jointOkay;
-		}
+		bool jointsOkay = jointSolver.SolvePositionConstraints();
 
 		if (contactsOkay && jointsOkay)
 		{
@@ -527,9 +575,9 @@ void b2Island::Report(const b2ContactVelocityConstraint* constraints)
 
 	for (int32 i = 0; i < m_contactCount; ++i)
 	{
-		b2Contact* c = m_contacts[i];
-
 		const b2ContactVelocityConstraint* vc = constraints + i;
+
+		b2Contact* c = m_contacts[vc->contactIndex];
 		
 		b2ContactImpulse impulse;
 		impulse.count = vc->pointCount;
@@ -232,6 +232,7 @@ b2Joint::b2Joint(const b2JointDef* def)
 	m_bodyA = def->bodyA;
 	m_bodyB = def->bodyB;
 	m_index = 0;
+	m_color = -1;
 	m_collideConnected = def->collideConnected;
 	m_islandFlag = false;
 	m_userData = def->userData;
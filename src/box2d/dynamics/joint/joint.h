@@ -160,6 +160,7 @@ protected:
 	friend class b2World;
 	friend class b2Body;
 	friend class b2Island;
+	friend class b2JointSolver;
 	friend class b2GearJoint;
 
 	static b2Joint* Create(const b2JointDef* def, b2BlockAllocator* allocator);
@@ -184,6 +185,9 @@ protected:
 
 	int32 m_index;
 
+	// The batch color, see b2JointSolver::ColorJoints. -1 if the joint has none.
+	int32 m_color;
+
 	bool m_islandFlag;
 	bool m_collideConnected;
 
@@ -158,6 +158,7 @@ public:
 protected:
 	friend class b2Joint;
 	friend class b2GearJoint;
+	friend class b2JointSolver;
 	b2PrismaticJoint(const b2PrismaticJointDef* def);
 
 	void InitVelocityConstraints(const b2SolverData& data) override;
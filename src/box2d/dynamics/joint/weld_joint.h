@@ -98,6 +98,7 @@ public:
 protected:
 
 	friend class b2Joint;
+	friend class b2JointSolver;
 
 	b2WeldJoint(const b2WeldJointDef* def);
 
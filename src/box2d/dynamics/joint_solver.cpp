@@ -0,0 +1,1812 @@
+// MIT License
+
+// Copyright (c) 2019 Erin Catto
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include "joint_solver.h"
+
+#include "body.h"
+#include "joint/distance_joint.h"
+#include "joint/prismatic_joint.h"
+#include "joint/revolute_joint.h"
+#include "joint/weld_joint.h"
+#include "box2d/collision/simd.h"
+#include "box2d/common/stack_allocator.h"
+
+#include <stddef.h>
+#include <string.h>
+
+B2_API int32 b2_batchedJoints;
+B2_API int32 b2_directJoints;
+
+// A joint that finds no free color is solved through the b2Joint interface.
+const int32 b2_jointColorCount = 8;
+
+// The joint types that are solved in lanes.
+enum b2LaneSlot
+{
+	b2_revoluteSlot,
+	b2_weldSlot,
+	b2_prismaticSlot,
+	b2_distanceSlot,
+	b2_laneSlotCount
+};
+
+// Returns -1 if joints of this type are not solved in lanes.
+static int32 b2GetLaneSlot(b2JointType type)
+{
+	switch (type)
+	{
+	case e_revoluteJoint:
+		return b2_revoluteSlot;
+
+	case e_weldJoint:
+		return b2_weldSlot;
+
+	case e_prismaticJoint:
+		return b2_prismaticSlot;
+
+	case e_distanceJoint:
+		return b2_distanceSlot;
+
+	default:
+		return -1;
+	}
+}
+
+#if defined(LIQUIDFUN_SIMD_SSE)
+
+// Below this many candidates a group is mostly padding.
+const int32 b2_minBatchedJoints = 4;
+
+// Four revolute joints, one per lane. Padding lanes have zero mass and leave the
+// velocities alone.
+struct b2RevoluteLanes
+{
+	b2RevoluteJoint* joints[4];
+	int32 indexA[4];
+	int32 indexB[4];
+	int32 count;
+	float rAx[4], rAy[4], rBx[4], rBy[4];
+	float mA[4], mB[4], iA[4], iB[4];
+	float k11[4], k12[4], k22[4], invDet[4];
+	float axialMass[4];
+	float motorSpeed[4], maxMotorImpulse[4];
+	float lowerBias[4], upperBias[4];
+	uint32 motorMask[4], limitMask[4];
+	float impulseX[4], impulseY[4];
+	float motorImpulse[4], lowerImpulse[4], upperImpulse[4];
+};
+
+// Four weld joints. The point and angle are solved with one symmetric mass matrix. For
+// soft joints the angle terms of that matrix are zero and the angle is solved first
+// with angularMass, as in b2WeldJoint.
+struct b2WeldLanes
+{
+	b2WeldJoint* joints[4];
+	int32 indexA[4];
+	int32 indexB[4];
+	int32 count;
+	float rAx[4], rAy[4], rBx[4], rBy[4];
+	float mA[4], mB[4], iA[4], iB[4];
+	float m11[4], m12[4], m13[4], m22[4], m23[4], m33[4];
+	float angularMass[4], bias[4], gamma[4];
+	float impulseX[4], impulseY[4], impulseZ[4];
+};
+
+// Four prismatic joints. The axis terms serve the motor and the limits, the perpendicular
+// terms and the angle the block constraint.
+struct b2PrismaticLanes
+{
+	b2PrismaticJoint* joints[4];
+	int32 indexA[4];
+	int32 indexB[4];
+	int32 count;
+	float axisX[4], axisY[4], a1[4], a2[4];
+	float perpX[4], perpY[4], s1[4], s2[4];
+	float mA[4], mB[4], iA[4], iB[4];
+	float k11[4], k12[4], k22[4], invDet[4];
+	float axialMass[4];
+	float motorSpeed[4], maxMotorImpulse[4];
+	float lowerBias[4], upperBias[4];
+	uint32 motorMask[4], limitMask[4];
+	float impulseX[4], impulseY[4];
+	float motorImpulse[4], lowerImpulse[4], upperImpulse[4];
+};
+
+// Four distance joints. Rigid joints have no bias or gamma and their soft mass is the
+// full mass, so one soft solve covers both the spring and the rigid length.
+struct b2DistanceLanes
+{
+	b2DistanceJoint* joints[4];
+	int32 indexA[4];
+	int32 indexB[4];
+	int32 count;
+	float ux[4], uy[4], crA[4], crB[4];
+	float mA[4], mB[4], iA[4], iB[4];
+	float mass[4], softMass[4], bias[4], gamma[4];
+	float lowerBias[4], upperBias[4];
+	uint32 softMask[4], limitMask[4];
+	float impulse[4], lowerImpulse[4], upperImpulse[4];
+};
+
+void b2JointSolver::LoadRevoluteLanes(b2RevoluteLanes* lanes)
+{
+	const b2TimeStep& step = m_data.step;
+	int32 count = lanes->count;
+	memset(&lanes->rAx, 0, sizeof(b2RevoluteLanes) - offsetof(b2RevoluteLanes, rAx));
+	for (int32 j = 0; j < 4; ++j)
+	{
+		if (j >= count)
+		{
+			lanes->indexA[j] = lanes->indexA[0];
+			lanes->indexB[j] = lanes->indexB[0];
+			continue;
+		}
+
+		const b2RevoluteJoint* joint = lanes->joints[j];
+		lanes->indexA[j] = joint->m_indexA;
+		lanes->indexB[j] = joint->m_indexB;
+		lanes->rAx[j] = joint->m_rA.x;
+		lanes->rAy[j] = joint->m_rA.y;
+		lanes->rBx[j] = joint->m_rB.x;
+		lanes->rBy[j] = joint->m_rB.y;
+		lanes->mA[j] = joint->m_invMassA;
+		lanes->mB[j] = joint->m_invMassB;
+		lanes->iA[j] = joint->m_invIA;
+		lanes->iB[j] = joint->m_invIB;
+
+		const b2Mat22& K = joint->m_K;
+		float det = K.ex.x * K.ey.y - K.ey.x * K.ex.y;
+		lanes->k11[j] = K.ex.x;
+		lanes->k12[j] = K.ey.x;
+		lanes->k22[j] = K.ey.y;
+		lanes->invDet[j] = det != 0.0f ? 1.0f / det : 0.0f;
+		lanes->axialMass[j] = joint->m_axialMass;
+
+		bool fixedRotation = (joint->m_invIA + joint->m_invIB == 0.0f);
+		lanes->motorMask[j] = joint->m_enableMotor && fixedRotation == false ? 0xFFFFFFFF : 0;
+		lanes->limitMask[j] = joint->m_enableLimit && fixedRotation == false ? 0xFFFFFFFF : 0;
+		lanes->motorSpeed[j] = joint->m_motorSpeed;
+		lanes->maxMotorImpulse[j] = step.dt * joint->m_maxMotorTorque;
+		lanes->lowerBias[j] = b2Max(joint->m_angle - joint->m_lowerAngle, 0.0f) * step.inv_dt;
+		lanes->upperBias[j] = b2Max(joint->m_upperAngle - joint->m_angle, 0.0f) * step.inv_dt;
+
+		lanes->impulseX[j] = joint->m_impulse.x;
+		lanes->impulseY[j] = joint->m_impulse.y;
+		lanes->motorImpulse[j] = joint->m_motorImpulse;
+		lanes->lowerImpulse[j] = joint->m_lowerImpulse;
+		lanes->upperImpulse[j] = joint->m_upperImpulse;
+	}
+}
+
+void b2JointSolver::LoadWeldLanes(b2WeldLanes* lanes)
+{
+	int32 count = lanes->count;
+	memset(&lanes->rAx, 0, sizeof(b2WeldLanes) - offsetof(b2WeldLanes, rAx));
+	for (int32 j = 0; j < 4; ++j)
+	{
+		if (j >= count)
+		{
+			lanes->indexA[j] = lanes->indexA[0];
+			lanes->indexB[j] = lanes->indexB[0];
+			continue;
+		}
+
+		const b2WeldJoint* joint = lanes->joints[j];
+		lanes->indexA[j] = joint->m_indexA;
+		lanes->indexB[j] = joint->m_indexB;
+		lanes->rAx[j] = joint->m_rA.x;
+		lanes->rAy[j] = joint->m_rA.y;
+		lanes->rBx[j] = joint->m_rB.x;
+		lanes->rBy[j] = joint->m_rB.y;
+		lanes->mA[j] = joint->m_invMassA;
+		lanes->mB[j] = joint->m_invMassB;
+		lanes->iA[j] = joint->m_invIA;
+		lanes->iB[j] = joint->m_invIB;
+
+		const b2Mat33& M = joint->m_mass;
+		lanes->m11[j] = M.ex.x;
+		lanes->m12[j] = M.ey.x;
+		lanes->m22[j] = M.ey.y;
+		if (joint->m_stiffness > 0.0f)
+		{
+			lanes->angularMass[j] = M.ez.z;
+			lanes->bias[j] = joint->m_bias;
+			lanes->gamma[j] = joint->m_gamma;
+		}
+		else
+		{
+			lanes->m13[j] = M.ez.x;
+			lanes->m23[j] = M.ez.y;
+			lanes->m33[j] = M.ez.z;
+		}
+
+		lanes->impulseX[j] = joint->m_impulse.x;
+		lanes->impulseY[j] = joint->m_impulse.y;
+		lanes->impulseZ[j] = joint->m_impulse.z;
+	}
+}
+
+void b2JointSolver::LoadPrismaticLanes(b2PrismaticLanes* lanes)
+{
+	const b2TimeStep& step = m_data.step;
+	int32 count = lanes->count;
+	memset(&lanes->axisX, 0, sizeof(b2PrismaticLanes) - offsetof(b2PrismaticLanes, axisX));
+	for (int32 j = 0; j < 4; ++j)
+	{
+		if (j >= count)
+		{
+			lanes->indexA[j] = lanes->indexA[0];
+			lanes->indexB[j] = lanes->indexB[0];
+			continue;
+		}
+
+		const b2PrismaticJoint* joint = lanes->joints[j];
+		lanes->indexA[j] = joint->m_indexA;
+		lanes->indexB[j] = joint->m_indexB;
+		lanes->axisX[j] = joint->m_axis.x;
+		lanes->axisY[j] = joint->m_axis.y;
+		lanes->a1[j] = joint->m_a1;
+		lanes->a2[j] = joint->m_a2;
+		lanes->perpX[j] = joint->m_perp.x;
+		lanes->perpY[j] = joint->m_perp.y;
+		lanes->s1[j] = joint->m_s1;
+		lanes->s2[j] = joint->m_s2;
+		lanes->mA[j] = joint->m_invMassA;
+		lanes->mB[j] = joint->m_invMassB;
+		lanes->iA[j] = joint->m_invIA;
+		lanes->iB[j] = joint->m_invIB;
+
+		const b2Mat22& K = joint->m_K;
+		float det = K.ex.x * K.ey.y - K.ey.x * K.ex.y;
+		lanes->k11[j] = K.ex.x;
+		lanes->k12[j] = K.ey.x;
+		lanes->k22[j] = K.ey.y;
+		lanes->invDet[j] = det != 0.0f ? 1.0f / det : 0.0f;
+		lanes->axialMass[j] = joint->m_axialMass;
+
+		lanes->motorMask[j] = joint->m_enableMotor ? 0xFFFFFFFF : 0;
+		lanes->limitMask[j] = joint->m_enableLimit ? 0xFFFFFFFF : 0;
+		lanes->motorSpeed[j] = joint->m_motorSpeed;
+		lanes->maxMotorImpulse[j] = step.dt * joint->m_maxMotorForce;
+		lanes->lowerBias[j] = b2Max(joint->m_translation - joint->m_lowerTranslation, 0.0f) * step.inv_dt;
+		lanes->upperBias[j] = b2Max(joint->m_upperTranslation - joint->m_translation, 0.0f) * step.inv_dt;
+
+		lanes->impulseX[j] = joint->m_impulse.x;
+		lanes->impulseY[j] = joint->m_impulse.y;
+		lanes->motorImpulse[j] = joint->m_motorImpulse;
+		lanes->lowerImpulse[j] = joint->m_lowerImpulse;
+		lanes->upperImpulse[j] = joint->m_upperImpulse;
+	}
+}
+
+void b2JointSolver::LoadDistanceLanes(b2DistanceLanes* lanes)
+{
+	const b2TimeStep& step = m_data.step;
+	int32 count = lanes->count;
+	memset(&lanes->ux, 0, sizeof(b2DistanceLanes) - offsetof(b2DistanceLanes, ux));
+	for (int32 j = 0; j < 4; ++j)
+	{
+		if (j >= count)
+		{
+			lanes->indexA[j] = lanes->indexA[0];
+			lanes->indexB[j] = lanes->indexB[0];
+			continue;
+		}
+
+		const b2DistanceJoint* joint = lanes->joints[j];
+		lanes->indexA[j] = joint->m_indexA;
+		lanes->indexB[j] = joint->m_indexB;
+		lanes->ux[j] = joint->m_u.x;
+		lanes->uy[j] = joint->m_u.y;
+		lanes->crA[j] = b2Cross(joint->m_rA, joint->m_u);
+		lanes->crB[j] = b2Cross(joint->m_rB, joint->m_u);
+		lanes->mA[j] = joint->m_invMassA;
+		lanes->mB[j] = joint->m_invMassB;
+		lanes->iA[j] = joint->m_invIA;
+		lanes->iB[j] = joint->m_invIB;
+		lanes->mass[j] = joint->m_mass;
+		lanes->softMass[j] = joint->m_softMass;
+		lanes->bias[j] = joint->m_bias;
+		lanes->gamma[j] = joint->m_gamma;
+
+		bool range = joint->m_minLength < joint->m_maxLength;
+		lanes->softMask[j] = range == false || joint->m_stiffness > 0.0f ? 0xFFFFFFFF : 0;
+		lanes->limitMask[j] = range ? 0xFFFFFFFF : 0;
+		lanes->lowerBias[j] = b2Max(0.0f, joint->m_currentLength - joint->m_minLength) * step.inv_dt;
+		lanes->upperBias[j] = b2Max(0.0f, joint->m_maxLength - joint->m_currentLength) * step.inv_dt;
+
+		lanes->impulse[j] = joint->m_impulse;
+		lanes->lowerImpulse[j] = joint->m_lowerImpulse;
+		lanes->upperImpulse[j] = joint->m_upperImpulse;
+	}
+}
+
+static inline void b2GatherVelocities(__m128* vx, __m128* vy, __m128* w,
+									  const b2Velocity* velocities, const int32* index)
+{
+	const b2Velocity& v0 = velocities[index[0]];
+	const b2Velocity& v1 = velocities[index[1]];
+	const b2Velocity& v2 = velocities[index[2]];
+	const b2Velocity& v3 = velocities[index[3]];
+	*vx = _mm_setr_ps(v0.v.x, v1.v.x, v2.v.x, v3.v.x);
+	*vy = _mm_setr_ps(v0.v.y, v1.v.y, v2.v.y, v3.v.y);
+	*w = _mm_setr_ps(v0.w, v1.w, v2.w, v3.w);
+}
+
+static inline void b2ScatterVelocities(b2Velocity* velocities, const int32* index, int32 count,
+									   __m128 vx, __m128 vy, __m128 w)
+{
+	float x[4], y[4], z[4];
+	_mm_storeu_ps(x, vx);
+	_mm_storeu_ps(y, vy);
+	_mm_storeu_ps(z, w);
+	for (int32 j = 0; j < count; ++j)
+	{
+		b2Velocity& v = velocities[index[j]];
+		v.v.Set(x[j], y[j]);
+		v.w = z[j];
+	}
+}
+
+// Same steps as b2RevoluteJoint::SolveVelocityConstraints. Motor and limit lanes that are
+// switched off keep their impulse, so they apply nothing.
+static void b2SolveRevoluteLanes(b2RevoluteLanes* lanes, b2Velocity* velocities)
+{
+	__m128 vAx, vAy, wA, vBx, vBy, wB;
+	b2GatherVelocities(&vAx, &vAy, &wA, velocities, lanes->indexA);
+	b2GatherVelocities(&vBx, &vBy, &wB, velocities, lanes->indexB);
+
+	__m128 zero = _mm_setzero_ps();
+	__m128 mA = _mm_loadu_ps(lanes->mA);
+	__m128 mB = _mm_loadu_ps(lanes->mB);
+	__m128 iA = _mm_loadu_ps(lanes->iA);
+	__m128 iB = _mm_loadu_ps(lanes->iB);
+	__m128 negAxialMass = _mm_sub_ps(zero, _mm_loadu_ps(lanes->axialMass));
+
+	// Solve motor constraint.
+	__m128 motorMask = _mm_castsi128_ps(_mm_loadu_si128((const __m128i*)lanes->motorMask));
+	if (_mm_movemask_ps(motorMask) != 0)
+	{
+		__m128 Cdot = _mm_sub_ps(_mm_sub_ps(wB, wA), _mm_loadu_ps(lanes->motorSpeed));
+		__m128 impulse = _mm_mul_ps(negAxialMass, Cdot);
+		__m128 oldImpulse = _mm_loadu_ps(lanes->motorImpulse);
+		__m128 maxImpulse = _mm_loadu_ps(lanes->maxMotorImpulse);
+		__m128 newImpulse = _mm_min_ps(_mm_add_ps(oldImpulse, impulse), maxImpulse);
+		newImpulse = _mm_max_ps(_mm_sub_ps(zero, maxImpulse), newImpulse);
+		newImpulse = b2Select(motorMask, newImpulse, oldImpulse);
+		_mm_storeu_ps(lanes->motorImpulse, newImpulse);
+		impulse = _mm_sub_ps(newImpulse, oldImpulse);
+
+		wA = _mm_sub_ps(wA, _mm_mul_ps(iA, impulse));
+		wB = _mm_add_ps(wB, _mm_mul_ps(iB, impulse));
+	}
+
+	__m128 limitMask = _mm_castsi128_ps(_mm_loadu_si128((const __m128i*)lanes->limitMask));
+	if (_mm_movemask_ps(limitMask) != 0)
+	{
+		// Lower limit
+		{
+			__m128 Cdot = _mm_sub_ps(wB, wA);
+			__m128 impulse = _mm_mul_ps(negAxialMass, _mm_add_ps(Cdot, _mm_loadu_ps(lanes->lowerBias)));
+			__m128 oldImpulse = _mm_loadu_ps(lanes->lowerImpulse);
+			__m128 newImpulse = _mm_max_ps(_mm_add_ps(oldImpulse, impulse), zero);
+			newImpulse = b2Select(limitMask, newImpulse, oldImpulse);
+			_mm_storeu_ps(lanes->lowerImpulse, newImpulse);
+			impulse = _mm_sub_ps(newImpulse, oldImpulse);
+
+			wA = _mm_sub_ps(wA, _mm_mul_ps(iA, impulse));
+			wB = _mm_add_ps(wB, _mm_mul_ps(iB, impulse));
+		}
+
+		// Upper limit
+		{
+			__m128 Cdot = _mm_sub_ps(wA, wB);
+			__m128 impulse = _mm_mul_ps(negAxialMass, _mm_add_ps(Cdot, _mm_loadu_ps(lanes->upperBias)));
+			__m128 oldImpulse = _mm_loadu_ps(lanes->upperImpulse);
+			__m128 newImpulse = _mm_max_ps(_mm_add_ps(oldImpulse, impulse), zero);
+			newImpulse = b2Select(limitMask, newImpulse, oldImpulse);
+			_mm_storeu_ps(lanes->upperImpulse, newImpulse);
+			impulse = _mm_sub_ps(newImpulse, oldImpulse);
+
+			wA = _mm_add_ps(wA, _mm_mul_ps(iA, impulse));
+			wB = _mm_sub_ps(wB, _mm_mul_ps(iB, impulse));
+		}
+	}
+
+	// Solve point-to-point constraint
+	{
+		__m128 rAx = _mm_loadu_ps(lanes->rAx);
+		__m128 rAy = _mm_loadu_ps(lanes->rAy);
+		__m128 rBx = _mm_loadu_ps(lanes->rBx);
+		__m128 rBy = _mm_loadu_ps(lanes->rBy);
+
+		// Cdot = vB + b2Cross(wB, rB) - vA - b2Cross(wA, rA)
+		__m128 Cdotx = _mm_sub_ps(_mm_sub_ps(vBx, _mm_mul_ps(wB, rBy)), _mm_sub_ps(vAx, _mm_mul_ps(wA, rAy)));
+		__m128 Cdoty = _mm_sub_ps(_mm_add_ps(vBy, _mm_mul_ps(wB, rBx)), _mm_add_ps(vAy, _mm_mul_ps(wA, rAx)));
+
+		// impulse = K.Solve(-Cdot)
+		__m128 bx = _mm_sub_ps(zero, Cdotx);
+		__m128 by = _mm_sub_ps(zero, Cdoty);
+		__m128 k11 = _mm_loadu_ps(lanes->k11);
+		__m128 k12 = _mm_loadu_ps(lanes->k12);
+		__m128 k22 = _mm_loadu_ps(lanes->k22);
+		__m128 invDet = _mm_loadu_ps(lanes->invDet);
+		__m128 Px = _mm_mul_ps(invDet, _mm_sub_ps(_mm_mul_ps(k22, bx), _mm_mul_ps(k12, by)));
+		__m128 Py = _mm_mul_ps(invDet, _mm_sub_ps(_mm_mul_ps(k11, by), _mm_mul_ps(k12, bx)));
+
+		_mm_storeu_ps(lanes->impulseX, _mm_add_ps(_mm_loadu_ps(lanes->impulseX), Px));
+		_mm_storeu_ps(lanes->impulseY, _mm_add_ps(_mm_loadu_ps(lanes->impulseY), Py));
+
+		vAx = _mm_sub_ps(vAx, _mm_mul_ps(mA, Px));
+		vAy = _mm_sub_ps(vAy, _mm_mul_ps(mA, Py));
+		wA = _mm_sub_ps(wA, _mm_mul_ps(iA, _mm_sub_ps(_mm_mul_ps(rAx, Py), _mm_mul_ps(rAy, Px))));
+
+		vBx = _mm_add_ps(vBx, _mm_mul_ps(mB, Px));
+		vBy = _mm_add_ps(vBy, _mm_mul_ps(mB, Py));
+		wB = _mm_add_ps(wB, _mm_mul_ps(iB, _mm_sub_ps(_mm_mul_ps(rBx, Py), _mm_mul_ps(rBy, Px))));
+	}
+
+	b2ScatterVelocities(velocities, lanes->indexA, lanes->count, vAx, vAy, wA);
+	b2ScatterVelocities(velocities, lanes->indexB, lanes->count, vBx, vBy, wB);
+}
+
+// Same steps as b2WeldJoint::SolveVelocityConstraints for both soft and rigid joints.
+static void b2SolveWeldLanes(b2WeldLanes* lanes, b2Velocity* velocities)
+{
+	__m128 vAx, vAy, wA, vBx, vBy, wB;
+	b2GatherVelocities(&vAx, &vAy, &wA, velocities, lanes->indexA);
+	b2GatherVelocities(&vBx, &vBy, &wB, velocities, lanes->indexB);
+
+	__m128 zero = _mm_setzero_ps();
+	__m128 mA = _mm_loadu_ps(lanes->mA);
+	__m128 mB = _mm_loadu_ps(lanes->mB);
+	__m128 iA = _mm_loadu_ps(lanes->iA);
+	__m128 iB = _mm_loadu_ps(lanes->iB);
+	__m128 impulseZ = _mm_loadu_ps(lanes->impulseZ);
+
+	// Soft angular constraint. The angular mass is zero for rigid lanes.
+	{
+		__m128 Cdot2 = _mm_sub_ps(wB, wA);
+		__m128 bias = _mm_add_ps(_mm_loadu_ps(lanes->bias), _mm_mul_ps(_mm_loadu_ps(lanes->gamma), impulseZ));
+		__m128 impulse2 = _mm_mul_ps(_mm_sub_ps(zero, _mm_loadu_ps(lanes->angularMass)), _mm_add_ps(Cdot2, bias));
+		impulseZ = _mm_add_ps(impulseZ, impulse2);
+
+		wA = _mm_sub_ps(wA, _mm_mul_ps(iA, impulse2));
+		wB = _mm_add_ps(wB, _mm_mul_ps(iB, impulse2));
+	}
+
+	__m128 rAx = _mm_loadu_ps(lanes->rAx);
+	__m128 rAy = _mm_loadu_ps(lanes->rAy);
+	__m128 rBx = _mm_loadu_ps(lanes->rBx);
+	__m128 rBy = _mm_loadu_ps(lanes->rBy);
+
+	__m128 Cdotx = _mm_sub_ps(_mm_sub_ps(vBx, _mm_mul_ps(wB, rBy)), _mm_sub_ps(vAx, _mm_mul_ps(wA, rAy)));
+	__m128 Cdoty = _mm_sub_ps(_mm_add_ps(vBy, _mm_mul_ps(wB, rBx)), _mm_add_ps(vAy, _mm_mul_ps(wA, rAx)));
+	__m128 Cdotz = _mm_sub_ps(wB, wA);
+
+	// impulse = -b2Mul(mass, Cdot)
+	__m128 m11 = _mm_loadu_ps(lanes->m11);
+	__m128 m12 = _mm_loadu_ps(lanes->m12);
+	__m128 m13 = _mm_loadu_ps(lanes->m13);
+	__m128 m22 = _mm_loadu_ps(lanes->m22);
+	__m128 m23 = _mm_loadu_ps(lanes->m23);
+	__m128 m33 = _mm_loadu_ps(lanes->m33);
+	__m128 Px = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m11, Cdotx), _mm_mul_ps(m12, Cdoty)), _mm_mul_ps(m13, Cdotz));
+	__m128 Py = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m12, Cdotx), _mm_mul_ps(m22, Cdoty)), _mm_mul_ps(m23, Cdotz));
+	__m128 Pz = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m13, Cdotx), _mm_mul_ps(m23, Cdoty)), _mm_mul_ps(m33, Cdotz));
+	Px = _mm_sub_ps(zero, Px);
+	Py = _mm_sub_ps(zero, Py);
+	Pz = _mm_sub_ps(zero, Pz);
+
+	_mm_storeu_ps(lanes->impulseX, _mm_add_ps(_mm_loadu_ps(lanes->impulseX), Px));
+	_mm_storeu_ps(lanes->impulseY, _mm_add_ps(_mm_loadu_ps(lanes->impulseY), Py));
+	_mm_storeu_ps(lanes->impulseZ, _mm_add_ps(impulseZ, Pz));
+
+	vAx = _mm_sub_ps(vAx, _mm_mul_ps(mA, Px));
+	vAy = _mm_sub_ps(vAy, _mm_mul_ps(mA, Py));
+	wA = _mm_sub_ps(wA, _mm_mul_ps(iA, _mm_add_ps(_mm_sub_ps(_mm_mul_ps(rAx, Py), _mm_mul_ps(rAy, Px)), Pz)));
+
+	vBx = _mm_add_ps(vBx, _mm_mul_ps(mB, Px));
+	vBy = _mm_add_ps(vBy, _mm_mul_ps(mB, Py));
+	wB = _mm_add_ps(wB, _mm_mul_ps(iB, _mm_add_ps(_mm_sub_ps(_mm_mul_ps(rBx, Py), _mm_mul_ps(rBy, Px)), Pz)));
+
+	b2ScatterVelocities(velocities, lanes->indexA, lanes->count, vAx, vAy, wA);
+	b2ScatterVelocities(velocities, lanes->indexB, lanes->count, vBx, vBy, wB);
+}
+
+// Same steps as b2PrismaticJoint::SolveVelocityConstraints. Motor and limit lanes that are
+// switched off keep their impulse, so they apply nothing.
+static void b2SolvePrismaticLanes(b2PrismaticLanes* lanes, b2Velocity* velocities)
+{
+	__m128 vAx, vAy, wA, vBx, vBy, wB;
+	b2GatherVelocities(&vAx, &vAy, &wA, velocities, lanes->indexA);
+	b2GatherVelocities(&vBx, &vBy, &wB, velocities, lanes->indexB);
+
+	__m128 zero = _mm_setzero_ps();
+	__m128 mA = _mm_loadu_ps(lanes->mA);
+	__m128 mB = _mm_loadu_ps(lanes->mB);
+	__m128 iA = _mm_loadu_ps(lanes->iA);
+	__m128 iB = _mm_loadu_ps(lanes->iB);
+	__m128 axisX = _mm_loadu_ps(lanes->axisX);
+	__m128 axisY = _mm_loadu_ps(lanes->axisY);
+	__m128 a1 = _mm_loadu_ps(lanes->a1);
+	__m128 a2 = _mm_loadu_ps(lanes->a2);
+	__m128 axialMass = _mm_loadu_ps(lanes->axialMass);
+
+	// Solve linear motor constraint
+	__m128 motorMask = _mm_castsi128_ps(_mm_loadu_si128((const __m128i*)lanes->motorMask));
+	if (_mm_movemask_ps(motorMask) != 0)
+	{
+		__m128 Cdot = _mm_add_ps(_mm_mul_ps(axisX, _mm_sub_ps(vBx, vAx)), _mm_mul_ps(axisY, _mm_sub_ps(vBy, vAy)));
+		Cdot = _mm_add_ps(Cdot, _mm_sub_ps(_mm_mul_ps(a2, wB), _mm_mul_ps(a1, wA)));
+		__m128 impulse = _mm_mul_ps(axialMass, _mm_sub_ps(_mm_loadu_ps(lanes->motorSpeed), Cdot));
+		__m128 oldImpulse = _mm_loadu_ps(lanes->motorImpulse);
+		__m128 maxImpulse = _mm_loadu_ps(lanes->maxMotorImpulse);
+		__m128 newImpulse = _mm_min_ps(_mm_add_ps(oldImpulse, impulse), maxImpulse);
+		newImpulse = _mm_max_ps(_mm_sub_ps(zero, maxImpulse), newImpulse);
+		newImpulse = b2Select(motorMask, newImpulse, oldImpulse);
+		_mm_storeu_ps(lanes->motorImpulse, newImpulse);
+		impulse = _mm_sub_ps(newImpulse, oldImpulse);
+
+		vAx = _mm_sub_ps(vAx, _mm_mul_ps(mA, _mm_mul_ps(impulse, axisX)));
+		vAy = _mm_sub_ps(vAy, _mm_mul_ps(mA, _mm_mul_ps(impulse, axisY)));
+		wA = _mm_sub_ps(wA, _mm_mul_ps(iA, _mm_mul_ps(impulse, a1)));
+		vBx = _mm_add_ps(vBx, _mm_mul_ps(mB, _mm_mul_ps(impulse, axisX)));
+		vBy = _mm_add_ps(vBy, _mm_mul_ps(mB, _mm_mul_ps(impulse, axisY)));
+		wB = _mm_add_ps(wB, _mm_mul_ps(iB, _mm_mul_ps(impulse, a2)));
+	}
+
+	__m128 limitMask = _mm_castsi128_ps(_mm_loadu_si128((const __m128i*)lanes->limitMask));
+	if (_mm_movemask_ps(limitMask) != 0)
+	{
+		__m128 negAxialMass = _mm_sub_ps(zero, axialMass);
+
+		// Lower limit
+		{
+			__m128 Cdot = _mm_add_ps(_mm_mul_ps(axisX, _mm_sub_ps(vBx, vAx)), _mm_mul_ps(axisY, _mm_sub_ps(vBy, vAy)));
+			Cdot = _mm_add_ps(Cdot, _mm_sub_ps(_mm_mul_ps(a2, wB), _mm_mul_ps(a1, wA)));
+			__m128 impulse = _mm_mul_ps(negAxialMass, _mm_add_ps(Cdot, _mm_loadu_ps(lanes->lowerBias)));
+			__m128 oldImpulse = _mm_loadu_ps(lanes->lowerImpulse);
+			__m128 newImpulse = _mm_max_ps(_mm_add_ps(oldImpulse, impulse), zero);
+			newImpulse = b2Select(limitMask, newImpulse, oldImpulse);
+			_mm_storeu_ps(lanes->lowerImpulse, newImpulse);
+			impulse = _mm_sub_ps(newImpulse, oldImpulse);
+
+			vAx = _mm_sub_ps(vAx, _mm_mul_ps(mA, _mm_mul_ps(impulse, axisX)));
+			vAy = _mm_sub_ps(vAy, _mm_mul_ps(mA, _mm_mul_ps(impulse, axisY)));
+			wA = _mm_sub_ps(wA, _mm_mul_ps(iA, _mm_mul_ps(impulse, a1)));
+			vBx = _mm_add_ps(vBx, _mm_mul_ps(mB, _mm_mul_ps(impulse, axisX)));
+			vBy = _mm_add_ps(vBy, _mm_mul_ps(mB, _mm_mul_ps(impulse, axisY)));
+			wB = _mm_add_ps(wB, _mm_mul_ps(iB, _mm_mul_ps(impulse, a2)));
+		}
+
+		// Upper limit
+		{
+			__m128 Cdot = _mm_add_ps(_mm_mul_ps(axisX, _mm_sub_ps(vAx, vBx)), _mm_mul_ps(axisY, _mm_sub_ps(vAy, vBy)));
+			Cdot = _mm_add_ps(Cdot, _mm_sub_ps(_mm_mul_ps(a1, wA), _mm_mul_ps(a2, wB)));
+			__m128 impulse = _mm_mul_ps(negAxialMass, _mm_add_ps(Cdot, _mm_loadu_ps(lanes->upperBias)));
+			__m128 oldImpulse = _mm_loadu_ps(lanes->upperImpulse);
+			__m128 newImpulse = _mm_max_ps(_mm_add_ps(oldImpulse, impulse), zero);
+			newImpulse = b2Select(limitMask, newImpulse, oldImpulse);
+			_mm_storeu_ps(lanes->upperImpulse, newImpulse);
+			impulse = _mm_sub_ps(newImpulse, oldImpulse);
+
+			vAx = _mm_add_ps(vAx, _mm_mul_ps(mA, _mm_mul_ps(impulse, axisX)));
+			vAy = _mm_add_ps(vAy, _mm_mul_ps(mA, _mm_mul_ps(impulse, axisY)));
+			wA = _mm_add_ps(wA, _mm_mul_ps(iA, _mm_mul_ps(impulse, a1)));
+			vBx = _mm_sub_ps(vBx, _mm_mul_ps(mB, _mm_mul_ps(impulse, axisX)));
+			vBy = _mm_sub_ps(vBy, _mm_mul_ps(mB, _mm_mul_ps(impulse, axisY)));
+			wB = _mm_sub_ps(wB, _mm_mul_ps(iB, _mm_mul_ps(impulse, a2)));
+		}
+	}
+
+	// Solve the prismatic constraint in block form.
+	{
+		__m128 perpX = _mm_loadu_ps(lanes->perpX);
+		__m128 perpY = _mm_loadu_ps(lanes->perpY);
+		__m128 s1 = _mm_loadu_ps(lanes->s1);
+		__m128 s2 = _mm_loadu_ps(lanes->s2);
+
+		__m128 Cdotx = _mm_add_ps(_mm_mul_ps(perpX, _mm_sub_ps(vBx, vAx)), _mm_mul_ps(perpY, _mm_sub_ps(vBy, vAy)));
+		Cdotx = _mm_add_ps(Cdotx, _mm_sub_ps(_mm_mul_ps(s2, wB), _mm_mul_ps(s1, wA)));
+		__m128 Cdoty = _mm_sub_ps(wB, wA);
+
+		// df = K.Solve(-Cdot)
+		__m128 bx = _mm_sub_ps(zero, Cdotx);
+		__m128 by = _mm_sub_ps(zero, Cdoty);
+		__m128 k11 = _mm_loadu_ps(lanes->k11);
+		__m128 k12 = _mm_loadu_ps(lanes->k12);
+		__m128 k22 = _mm_loadu_ps(lanes->k22);
+		__m128 invDet = _mm_loadu_ps(lanes->invDet);
+		__m128 dfx = _mm_mul_ps(invDet, _mm_sub_ps(_mm_mul_ps(k22, bx), _mm_mul_ps(k12, by)));
+		__m128 dfy = _mm_mul_ps(invDet, _mm_sub_ps(_mm_mul_ps(k11, by), _mm_mul_ps(k12, bx)));
+
+		_mm_storeu_ps(lanes->impulseX, _mm_add_ps(_mm_loadu_ps(lanes->impulseX), dfx));
+		_mm_storeu_ps(lanes->impulseY, _mm_add_ps(_mm_loadu_ps(lanes->impulseY), dfy));
+
+		__m128 Px = _mm_mul_ps(dfx, perpX);
+		__m128 Py = _mm_mul_ps(dfx, perpY);
+		__m128 LA = _mm_add_ps(_mm_mul_ps(dfx, s1), dfy);
+		__m128 LB = _mm_add_ps(_mm_mul_ps(dfx, s2), dfy);
+
+		vAx = _mm_sub_ps(vAx, _mm_mul_ps(mA, Px));
+		vAy = _mm_sub_ps(vAy, _mm_mul_ps(mA, Py));
+		wA = _mm_sub_ps(wA, _mm_mul_ps(iA, LA));
+		vBx = _mm_add_ps(vBx, _mm_mul_ps(mB, Px));
+		vBy = _mm_add_ps(vBy, _mm_mul_ps(mB, Py));
+		wB = _mm_add_ps(wB, _mm_mul_ps(iB, LB));
+	}
+
+	b2ScatterVelocities(velocities, lanes->indexA, lanes->count, vAx, vAy, wA);
+	b2ScatterVelocities(velocities, lanes->indexB, lanes->count, vBx, vBy, wB);
+}
+
+// Applies an impulse along the axis of each distance lane.
+static inline void b2ApplyDistanceImpulse(__m128* vAx, __m128* vAy, __m128* wA, __m128* vBx, __m128* vBy, __m128* wB,
+										  const b2DistanceLanes* lanes, __m128 impulse)
+{
+	__m128 Px = _mm_mul_ps(impulse, _mm_loadu_ps(lanes->ux));
+	__m128 Py = _mm_mul_ps(impulse, _mm_loadu_ps(lanes->uy));
+	__m128 mA = _mm_loadu_ps(lanes->mA);
+	__m128 mB = _mm_loadu_ps(lanes->mB);
+	*vAx = _mm_sub_ps(*vAx, _mm_mul_ps(mA, Px));
+	*vAy = _mm_sub_ps(*vAy, _mm_mul_ps(mA, Py));
+	*wA = _mm_sub_ps(*wA, _mm_mul_ps(_mm_loadu_ps(lanes->iA), _mm_mul_ps(_mm_loadu_ps(lanes->crA), impulse)));
+	*vBx = _mm_add_ps(*vBx, _mm_mul_ps(mB, Px));
+	*vBy = _mm_add_ps(*vBy, _mm_mul_ps(mB, Py));
+	*wB = _mm_add_ps(*wB, _mm_mul_ps(_mm_loadu_ps(lanes->iB), _mm_mul_ps(_mm_loadu_ps(lanes->crB), impulse)));
+}
+
+// Cdot = dot(u, vB + cross(wB, rB) - vA - cross(wA, rA))
+static inline __m128 b2DistanceCdot(__m128 vAx, __m128 vAy, __m128 wA, __m128 vBx, __m128 vBy, __m128 wB,
+									const b2DistanceLanes* lanes)
+{
+	__m128 Cdot = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(lanes->ux), _mm_sub_ps(vBx, vAx)),
+							 _mm_mul_ps(_mm_loadu_ps(lanes->uy), _mm_sub_ps(vBy, vAy)));
+	return _mm_add_ps(Cdot, _mm_sub_ps(_mm_mul_ps(_mm_loadu_ps(lanes->crB), wB), _mm_mul_ps(_mm_loadu_ps(lanes->crA), wA)));
+}
+
+// Same steps as b2DistanceJoint::SolveVelocityConstraints. Lanes that are switched off keep
+// their impulse, so they apply nothing.
+static void b2SolveDistanceLanes(b2DistanceLanes* lanes, b2Velocity* velocities)
+{
+	__m128 vAx, vAy, wA, vBx, vBy, wB;
+	b2GatherVelocities(&vAx, &vAy, &wA, velocities, lanes->indexA);
+	b2GatherVelocities(&vBx, &vBy, &wB, velocities, lanes->indexB);
+
+	__m128 zero = _mm_setzero_ps();
+
+	// The spring, or the length of a rigid joint.
+	__m128 softMask = _mm_castsi128_ps(_mm_loadu_si128((const __m128i*)lanes->softMask));
+	if (_mm_movemask_ps(softMask) != 0)
+	{
+		__m128 Cdot = b2DistanceCdot(vAx, vAy, wA, vBx, vBy, wB, lanes);
+		__m128 oldImpulse = _mm_loadu_ps(lanes->impulse);
+		__m128 bias = _mm_add_ps(_mm_loadu_ps(lanes->bias), _mm_mul_ps(_mm_loadu_ps(lanes->gamma), oldImpulse));
+		__m128 impulse = _mm_mul_ps(_mm_sub_ps(zero, _mm_loadu_ps(lanes->softMass)), _mm_add_ps(Cdot, bias));
+		impulse = b2Select(softMask, impulse, zero);
+		_mm_storeu_ps(lanes->impulse, _mm_add_ps(oldImpulse, impulse));
+		b2ApplyDistanceImpulse(&vAx, &vAy, &wA, &vBx, &vBy, &wB, lanes, impulse);
+	}
+
+	__m128 limitMask = _mm_castsi128_ps(_mm_loadu_si128((const __m128i*)lanes->limitMask));
+	if (_mm_movemask_ps(limitMask) != 0)
+	{
+		__m128 negMass = _mm_sub_ps(zero, _mm_loadu_ps(lanes->mass));
+
+		// lower
+		{
+			__m128 Cdot = b2DistanceCdot(vAx, vAy, wA, vBx, vBy, wB, lanes);
+			__m128 impulse = _mm_mul_ps(negMass, _mm_add_ps(Cdot, _mm_loadu_ps(lanes->lowerBias)));
+			__m128 oldImpulse = _mm_loadu_ps(lanes->lowerImpulse);
+			__m128 newImpulse = _mm_max_ps(_mm_add_ps(oldImpulse, impulse), zero);
+			newImpulse = b2Select(limitMask, newImpulse, oldImpulse);
+			_mm_storeu_ps(lanes->lowerImpulse, newImpulse);
+			b2ApplyDistanceImpulse(&vAx, &vAy, &wA, &vBx, &vBy, &wB, lanes, _mm_sub_ps(newImpulse, oldImpulse));
+		}
+
+		// upper
+		{
+			__m128 Cdot = _mm_sub_ps(zero, b2DistanceCdot(vAx, vAy, wA, vBx, vBy, wB, lanes));
+			__m128 impulse = _mm_mul_ps(negMass, _mm_add_ps(Cdot, _mm_loadu_ps(lanes->upperBias)));
+			__m128 oldImpulse = _mm_loadu_ps(lanes->upperImpulse);
+			__m128 newImpulse = _mm_max_ps(_mm_add_ps(oldImpulse, impulse), zero);
+			newImpulse = b2Select(limitMask, newImpulse, oldImpulse);
+			_mm_storeu_ps(lanes->upperImpulse, newImpulse);
+			b2ApplyDistanceImpulse(&vAx, &vAy, &wA, &vBx, &vBy, &wB, lanes, _mm_sub_ps(oldImpulse, newImpulse));
+		}
+	}
+
+	b2ScatterVelocities(velocities, lanes->indexA, lanes->count, vAx, vAy, wA);
+	b2ScatterVelocities(velocities, lanes->indexB, lanes->count, vBx, vBy, wB);
+}
+
+#endif // defined(LIQUIDFUN_SIMD_SSE)
+
+// Joint states while the solver is built. A joint that may be batched holds its lane,
+// slot * b2_jointColorCount + color, which is zero or more.
+const int32 b2_scalarJoint = -1;
+const int32 b2_directJoint = -2;
+
+// One joint of the direct solver, in elimination order. A joint has up to three rows.
+// Unused rows have a zero Jacobian and a unit pivot so their impulse stays zero.
+struct b2DirectRow
+{
+	b2Joint* joint;
+	int32 indexA;
+	int32 indexB;
+	b2Vec3 JA[3];
+	b2Vec3 JB[3];
+	b2Vec3 invMassA;
+	b2Vec3 invMassB;
+	b2Mat33 diagonal;
+	b2Mat33 invDiagonal;
+	b2Vec3 impulse;
+	b2Vec3 y;
+	int32 firstEntry;
+	int32 entryCount;
+};
+
+// The block of a later joint that shares a body with the row that owns the entry. Holds
+// the coupling J_i M^-1 J_k^T until the owning row is eliminated, then the factor L.
+struct b2DirectEntry
+{
+	int32 row;
+	b2Mat33 block;
+};
+
+// A * B
+static b2Mat33 b2MulBlocks(const b2Mat33& A, const b2Mat33& B)
+{
+	return b2Mat33(b2Mul(A, B.ex), b2Mul(A, B.ey), b2Mul(A, B.ez));
+}
+
+// A^T * v
+static b2Vec3 b2MulTBlock(const b2Mat33& A, const b2Vec3& v)
+{
+	return b2Vec3(b2Dot(A.ex, v), b2Dot(A.ey, v), b2Dot(A.ez, v));
+}
+
+static b2Mat33 b2TransposeBlock(const b2Mat33& A)
+{
+	return b2Mat33(b2Vec3(A.ex.x, A.ey.x, A.ez.x), b2Vec3(A.ex.y, A.ey.y, A.ez.y), b2Vec3(A.ex.z, A.ey.z, A.ez.z));
+}
+
+static b2Mat33 b2SubBlocks(const b2Mat33& A, const b2Mat33& B)
+{
+	return b2Mat33(A.ex - B.ex, A.ey - B.ey, A.ez - B.ez);
+}
+
+// Ji * M^-1 * Jk^T for two joints on the same body.
+static b2Mat33 b2CouplingBlock(const b2Vec3* Ji, const b2Vec3* Jk, const b2Vec3& invMass)
+{
+	b2Vec3 columns[3];
+	for (int32 c = 0; c < 3; ++c)
+	{
+		b2Vec3 w(invMass.x * Jk[c].x, invMass.y * Jk[c].y, invMass.z * Jk[c].z);
+		columns[c].Set(b2Dot(Ji[0], w), b2Dot(Ji[1], w), b2Dot(Ji[2], w));
+	}
+
+	return b2Mat33(columns[0], columns[1], columns[2]);
+}
+
+static const b2Vec3* b2GetJacobian(const b2DirectRow* row, int32 bodyIndex)
+{
+	return row->indexA == bodyIndex ? row->JA : row->JB;
+}
+
+static const b2Vec3& b2GetInvMass(const b2DirectRow* row, int32 bodyIndex)
+{
+	return row->indexA == bodyIndex ? row->invMassA : row->invMassB;
+}
+
+// The body two rows share. Rows that share a body share exactly one.
+static int32 b2SharedBody(const b2DirectRow* a, const b2DirectRow* b)
+{
+	if (a->indexA >= 0 && (a->indexA == b->indexA || a->indexA == b->indexB))
+	{
+		return a->indexA;
+	}
+
+	return a->indexB;
+}
+
+static int32 b2FindRoot(int32* parents, int32 i)
+{
+	while (parents[i] != i)
+	{
+		parents[i] = parents[parents[i]];
+		i = parents[i];
+	}
+
+	return i;
+}
+
+b2JointSolver::b2JointSolver(b2JointSolverDef* def)
+{
+	m_data.step = def->step;
+	m_data.positions = def->positions;
+	m_data.velocities = def->velocities;
+	m_allocator = def->allocator;
+	m_joints = def->joints;
+	m_count = def->count;
+
+	m_states = nullptr;
+	m_scalarJoints = m_joints;
+	m_scalarCount = m_count;
+	m_directRows = nullptr;
+	m_directCount = 0;
+	m_directEntries = nullptr;
+	m_directEntryCount = 0;
+	m_revoluteLanes = nullptr;
+	m_revoluteLaneCount = 0;
+	m_weldLanes = nullptr;
+	m_weldLaneCount = 0;
+	m_prismaticLanes = nullptr;
+	m_prismaticLaneCount = 0;
+	m_distanceLanes = nullptr;
+	m_distanceLaneCount = 0;
+
+	bool direct = def->step.directJoints;
+	bool batch = false;
+#if defined(LIQUIDFUN_SIMD_SSE)
+	batch = def->step.batchJoints;
+#endif
+
+	if (direct == false && batch == false)
+	{
+		return;
+	}
+
+	// The colors were found by ColorJoints. Joints without one stay scalar. The states
+	// outlive the other allocations, so they are freed with the solver.
+	m_states = (int32*)m_allocator->Allocate(m_count * sizeof(int32));
+	int32 directCount = 0;
+	int32 batchCount = 0;
+	int32 colorCounts[b2_laneSlotCount * b2_jointColorCount] = {};
+	for (int32 i = 0; i < m_count; ++i)
+	{
+		b2Joint* joint = m_joints[i];
+		if (direct && IsDirectCandidate(joint))
+		{
+			++directCount;
+		}
+
+		m_states[i] = b2_scalarJoint;
+		if (batch && joint->m_color >= 0)
+		{
+			int32 lane = b2GetLaneSlot(joint->m_type) * b2_jointColorCount + joint->m_color;
+			++colorCounts[lane];
+			++batchCount;
+			m_states[i] = lane;
+		}
+	}
+
+	direct = direct && directCount > 0;
+#if defined(LIQUIDFUN_SIMD_SSE)
+	batch = batch && batchCount >= b2_minBatchedJoints;
+#endif
+
+	if (direct == false && batch == false)
+	{
+		m_allocator->Free(m_states);
+		m_states = nullptr;
+		return;
+	}
+
+	m_scalarJoints = (b2Joint**)m_allocator->Allocate(m_count * sizeof(b2Joint*));
+	m_scalarCount = 0;
+
+	int32 bodyCount = def->bodyCount;
+	if (direct)
+	{
+		// Each pair of joints on a body needs at most one entry.
+		int32* degrees = (int32*)m_allocator->Allocate(bodyCount * sizeof(int32));
+		memset(degrees, 0, bodyCount * sizeof(int32));
+		for (int32 i = 0; i < m_count; ++i)
+		{
+			b2Joint* joint = m_joints[i];
+			if (IsDirectCandidate(joint))
+			{
+				int32 indexA = GetDirectIndex(joint->m_bodyA);
+				int32 indexB = GetDirectIndex(joint->m_bodyB);
+				if (indexA >= 0)
+				{
+					++degrees[indexA];
+				}
+				if (indexB >= 0)
+				{
+					++degrees[indexB];
+				}
+			}
+		}
+
+		int32 entryCapacity = 0;
+		for (int32 i = 0; i < bodyCount; ++i)
+		{
+			entryCapacity += degrees[i] * (degrees[i] - 1) / 2;
+		}
+		m_allocator->Free(degrees);
+
+		m_directRows = (b2DirectRow*)m_allocator->Allocate(directCount * sizeof(b2DirectRow));
+		m_directEntries = (b2DirectEntry*)m_allocator->Allocate(b2Max(entryCapacity, 1) * sizeof(b2DirectEntry));
+		BuildDirectRows(m_states, bodyCount);
+	}
+
+#if defined(LIQUIDFUN_SIMD_SSE)
+	if (batch)
+	{
+		// Direct rows only take joints away, so the counts bound the groups.
+		int32 capacities[b2_laneSlotCount] = {};
+		for (int32 t = 0; t < b2_laneSlotCount; ++t)
+		{
+			for (int32 c = 0; c < b2_jointColorCount; ++c)
+			{
+				capacities[t] += (colorCounts[t * b2_jointColorCount + c] + 3) / 4;
+			}
+		}
+
+		m_revoluteLanes = (b2RevoluteLanes*)m_allocator->Allocate(b2Max(capacities[b2_revoluteSlot], 1) * sizeof(b2RevoluteLanes));
+		m_weldLanes = (b2WeldLanes*)m_allocator->Allocate(b2Max(capacities[b2_weldSlot], 1) * sizeof(b2WeldLanes));
+		m_prismaticLanes = (b2PrismaticLanes*)m_allocator->Allocate(b2Max(capacities[b2_prismaticSlot], 1) * sizeof(b2PrismaticLanes));
+		m_distanceLanes = (b2DistanceLanes*)m_allocator->Allocate(b2Max(capacities[b2_distanceSlot], 1) * sizeof(b2DistanceLanes));
+
+		PackJoints(m_states);
+		b2Assert(m_revoluteLaneCount <= capacities[b2_revoluteSlot]);
+		b2Assert(m_weldLaneCount <= capacities[b2_weldSlot]);
+		b2Assert(m_prismaticLaneCount <= capacities[b2_prismaticSlot]);
+		b2Assert(m_distanceLaneCount <= capacities[b2_distanceSlot]);
+	}
+#endif
+
+	// Too few lanes to batch are solved as scalar joints.
+	for (int32 i = 0; i < m_count; ++i)
+	{
+		if (m_states[i] == b2_scalarJoint || (batch == false && m_states[i] >= 0))
+		{
+			m_scalarJoints[m_scalarCount++] = m_joints[i];
+		}
+	}
+
+	b2_directJoints += m_directCount;
+	b2_batchedJoints += m_count - m_scalarCount - m_directCount;
+}
+
+b2JointSolver::~b2JointSolver()
+{
+	if (m_weldLanes)
+	{
+		m_allocator->Free(m_distanceLanes);
+		m_allocator->Free(m_prismaticLanes);
+		m_allocator->Free(m_weldLanes);
+		m_allocator->Free(m_revoluteLanes);
+	}
+
+	if (m_directRows)
+	{
+		m_allocator->Free(m_directEntries);
+		m_allocator->Free(m_directRows);
+	}
+
+	if (m_scalarJoints != m_joints)
+	{
+		m_allocator->Free(m_scalarJoints);
+	}
+
+	if (m_states)
+	{
+		m_allocator->Free(m_states);
+	}
+}
+
+bool b2JointSolver::IsDirectCandidate(const b2Joint* joint)
+{
+	// The direct rows treat every other body as static, so a joint to a moving
+	// kinematic body stays iterative.
+	if (joint->m_bodyA->m_type == b2_kinematicBody || joint->m_bodyB->m_type == b2_kinematicBody)
+	{
+		return false;
+	}
+
+	switch (joint->m_type)
+	{
+	case e_revoluteJoint:
+		{
+			const b2RevoluteJoint* revolute = (const b2RevoluteJoint*)joint;
+			return revolute->m_enableMotor == false && revolute->m_enableLimit == false;
+		}
+
+	case e_weldJoint:
+		return ((const b2WeldJoint*)joint)->m_stiffness == 0.0f;
+
+	case e_distanceJoint:
+		{
+			const b2DistanceJoint* distance = (const b2DistanceJoint*)joint;
+			return distance->m_minLength == distance->m_maxLength;
+		}
+
+	default:
+		return false;
+	}
+}
+
+int32 b2JointSolver::GetDirectIndex(const b2Body* body)
+{
+	return body->m_type == b2_dynamicBody ? body->m_islandIndex : -1;
+}
+
+void b2JointSolver::BuildDirectRows(int32* states, int32 bodyCount)
+{
+	// A joint that closes a loop stays iterative, so the direct joints form a forest.
+	// Each tree may also hold one joint to a static body. A second anchor closes a loop
+	// through the ground, which over-constrains the tree and makes it singular.
+	int32* parents = (int32*)m_allocator->Allocate(2 * bodyCount * sizeof(int32));
+	int32* anchored = parents + bodyCount;
+	for (int32 i = 0; i < bodyCount; ++i)
+	{
+		parents[i] = i;
+		anchored[i] = 0;
+	}
+
+	int32* offsets = (int32*)m_allocator->Allocate((bodyCount + 1) * sizeof(int32));
+	memset(offsets, 0, (bodyCount + 1) * sizeof(int32));
+	int32 directCount = 0;
+	for (int32 i = 0; i < m_count; ++i)
+	{
+		b2Joint* joint = m_joints[i];
+		if (IsDirectCandidate(joint) == false)
+		{
+			continue;
+		}
+
+		int32 indexA = GetDirectIndex(joint->m_bodyA);
+		int32 indexB = GetDirectIndex(joint->m_bodyB);
+		if (indexA >= 0 && indexB >= 0)
+		{
+			int32 rootA = b2FindRoot(parents, indexA);
+			int32 rootB = b2FindRoot(parents, indexB);
+			if (rootA == rootB || (anchored[rootA] && anchored[rootB]))
+			{
+				continue;
+			}
+
+			parents[rootA] = rootB;
+			anchored[rootB] |= anchored[rootA];
+		}
+		else
+		{
+			int32 root = b2FindRoot(parents, indexA >= 0 ? indexA : indexB);
+			if (anchored[root])
+			{
+				continue;
+			}
+
+			anchored[root] = 1;
+		}
+
+		states[i] = b2_directJoint;
+		offsets[indexA + 1] += indexA >= 0 ? 1 : 0;
+		offsets[indexB + 1] += indexB >= 0 ? 1 : 0;
+		++directCount;
+	}
+
+	// The direct joints of each body.
+	for (int32 i = 0; i < bodyCount; ++i)
+	{
+		offsets[i + 1] += offsets[i];
+	}
+
+	int32* bodyJoints = (int32*)m_allocator->Allocate(b2Max(offsets[bodyCount], 1) * sizeof(int32));
+	int32* fill = parents;
+	memcpy(fill, offsets, bodyCount * sizeof(int32));
+	for (int32 i = 0; i < m_count; ++i)
+	{
+		if (states[i] != b2_directJoint)
+		{
+			continue;
+		}
+
+		int32 indexA = GetDirectIndex(m_joints[i]->m_bodyA);
+		int32 indexB = GetDirectIndex(m_joints[i]->m_bodyB);
+		if (indexA >= 0)
+		{
+			bodyJoints[fill[indexA]++] = i;
+		}
+
+		if (indexB >= 0)
+		{
+			bodyJoints[fill[indexB]++] = i;
+		}
+	}
+
+	// Order the joints so that the later neighbors of every joint share one body. Then
+	// the factorization has no fill-in. Walk each tree depth first and emit a body's
+	// joints to static bodies, then the joint to its parent, after all of its children.
+	// The walk stack holds a body and the joint that reached it.
+	int32* stack = (int32*)m_allocator->Allocate(2 * bodyCount * sizeof(int32));
+	int32* rowIndices = (int32*)m_allocator->Allocate(m_count * sizeof(int32));
+	int32* visited = fill;
+	memset(visited, 0, bodyCount * sizeof(int32));
+	for (int32 root = 0; root < bodyCount; ++root)
+	{
+		if (visited[root] || offsets[root] == offsets[root + 1])
+		{
+			continue;
+		}
+
+		// Children are pushed after their parent and emitted when popped the second time.
+		int32 stackCount = 0;
+		stack[stackCount++] = root;
+		stack[stackCount++] = -1;
+		visited[root] = 1;
+		while (stackCount > 0)
+		{
+			int32 parentJoint = stack[stackCount - 1];
+			int32 body = stack[stackCount - 2];
+			if (visited[body] == 1)
+			{
+				visited[body] = 2;
+				for (int32 j = offsets[body]; j < offsets[body + 1]; ++j)
+				{
+					int32 jointIndex = bodyJoints[j];
+					const b2Joint* joint = m_joints[jointIndex];
+					int32 other = GetDirectIndex(joint->m_bodyA);
+					other = other == body ? GetDirectIndex(joint->m_bodyB) : other;
+					if (jointIndex == parentJoint || other < 0)
+					{
+						continue;
+					}
+
+					b2Assert(visited[other] == 0);
+					visited[other] = 1;
+					stack[stackCount++] = other;
+					stack[stackCount++] = jointIndex;
+				}
+
+				continue;
+			}
+
+			stackCount -= 2;
+			for (int32 j = offsets[body]; j < offsets[body + 1]; ++j)
+			{
+				int32 jointIndex = bodyJoints[j];
+				const b2Joint* joint = m_joints[jointIndex];
+				if (GetDirectIndex(joint->m_bodyA) < 0 || GetDirectIndex(joint->m_bodyB) < 0)
+				{
+					rowIndices[jointIndex] = m_directCount;
+					m_directRows[m_directCount++].joint = m_joints[jointIndex];
+				}
+			}
+
+			if (parentJoint >= 0)
+			{
+				rowIndices[parentJoint] = m_directCount;
+				m_directRows[m_directCount++].joint = m_joints[parentJoint];
+			}
+		}
+	}
+
+	b2Assert(m_directCount == directCount);
+
+	// Link each row to the later rows that share one of its bodies.
+	for (int32 k = 0; k < m_directCount; ++k)
+	{
+		b2DirectRow* row = m_directRows + k;
+		row->indexA = GetDirectIndex(row->joint->m_bodyA);
+		row->indexB = GetDirectIndex(row->joint->m_bodyB);
+		row->firstEntry = m_directEntryCount;
+		int32 bodies[2] = { row->indexA, row->indexB };
+		for (int32 b = 0; b < 2; ++b)
+		{
+			int32 body = bodies[b];
+			if (body < 0)
+			{
+				continue;
+			}
+
+			for (int32 j = offsets[body]; j < offsets[body + 1]; ++j)
+			{
+				int32 other = rowIndices[bodyJoints[j]];
+				if (other > k)
+				{
+					m_directEntries[m_directEntryCount++].row = other;
+				}
+			}
+		}
+
+		row->entryCount = m_directEntryCount - row->firstEntry;
+	}
+
+	m_allocator->Free(rowIndices);
+	m_allocator->Free(stack);
+	m_allocator->Free(bodyJoints);
+	m_allocator->Free(offsets);
+	m_allocator->Free(parents);
+}
+
+void b2JointSolver::FactorDirectRows()
+{
+	b2Vec3 zero(0.0f, 0.0f, 0.0f);
+
+	// The Jacobians come from the temporaries of InitVelocityConstraints.
+	for (int32 k = 0; k < m_directCount; ++k)
+	{
+		b2DirectRow* row = m_directRows + k;
+		b2Joint* joint = row->joint;
+		row->invMassA.Set(joint->m_bodyA->m_invMass, joint->m_bodyA->m_invMass, joint->m_bodyA->m_invI);
+		row->invMassB.Set(joint->m_bodyB->m_invMass, joint->m_bodyB->m_invMass, joint->m_bodyB->m_invI);
+		for (int32 r = 0; r < 3; ++r)
+		{
+			row->JA[r] = zero;
+			row->JB[r] = zero;
+		}
+
+		b2Vec2 rA, rB;
+		switch (joint->m_type)
+		{
+		case e_revoluteJoint:
+			{
+				b2RevoluteJoint* revolute = (b2RevoluteJoint*)joint;
+				rA = revolute->m_rA;
+				rB = revolute->m_rB;
+				row->impulse.Set(revolute->m_impulse.x, revolute->m_impulse.y, 0.0f);
+			}
+			break;
+
+		case e_weldJoint:
+			{
+				b2WeldJoint* weld = (b2WeldJoint*)joint;
+				rA = weld->m_rA;
+				rB = weld->m_rB;
+				row->impulse = weld->m_impulse;
+				row->JA[2].Set(0.0f, 0.0f, -1.0f);
+				row->JB[2].Set(0.0f, 0.0f, 1.0f);
+			}
+			break;
+
+		default:
+			{
+				b2DistanceJoint* distance = (b2DistanceJoint*)joint;
+				b2Vec2 u = distance->m_u;
+				row->impulse.Set(distance->m_impulse, 0.0f, 0.0f);
+				row->JA[0].Set(-u.x, -u.y, -b2Cross(distance->m_rA, u));
+				row->JB[0].Set(u.x, u.y, b2Cross(distance->m_rB, u));
+			}
+			break;
+		}
+
+		// Cdot = vB + cross(wB, rB) - vA - cross(wA, rA)
+		if (joint->m_type != e_distanceJoint)
+		{
+			row->JA[0].Set(-1.0f, 0.0f, rA.y);
+			row->JA[1].Set(0.0f, -1.0f, -rA.x);
+			row->JB[0].Set(1.0f, 0.0f, -rB.y);
+			row->JB[1].Set(0.0f, 1.0f, rB.x);
+		}
+
+		row->diagonal.SetZero();
+		if (row->indexA >= 0)
+		{
+			row->diagonal = b2CouplingBlock(row->JA, row->JA, row->invMassA);
+		}
+
+		if (row->indexB >= 0)
+		{
+			b2Mat33 K = b2CouplingBlock(row->JB, row->JB, row->invMassB);
+			row->diagonal = b2Mat33(row->diagonal.ex + K.ex, row->diagonal.ey + K.ey, row->diagonal.ez + K.ez);
+		}
+	}
+
+	// The coupling blocks need the Jacobians of the later rows as well.
+	for (int32 k = 0; k < m_directCount; ++k)
+	{
+		const b2DirectRow* row = m_directRows + k;
+		for (int32 e = 0; e < row->entryCount; ++e)
+		{
+			b2DirectEntry* entry = m_directEntries + row->firstEntry + e;
+			const b2DirectRow* other = m_directRows + entry->row;
+			int32 body = b2SharedBody(row, other);
+			entry->block = b2CouplingBlock(b2GetJacobian(other, body), b2GetJacobian(row, body), b2GetInvMass(row, body));
+		}
+	}
+
+	// Block LDL^T in elimination order. The later neighbors of a row share one body, so
+	// every update lands on a block that already exists.
+	for (int32 k = 0; k < m_directCount; ++k)
+	{
+		b2DirectRow* row = m_directRows + k;
+
+		// Unused rows get a unit pivot.
+		b2Mat33& D = row->diagonal;
+		D.ex.x = D.ex.x != 0.0f ? D.ex.x : 1.0f;
+		D.ey.y = D.ey.y != 0.0f ? D.ey.y : 1.0f;
+		D.ez.z = D.ez.z != 0.0f ? D.ez.z : 1.0f;
+		D.GetSymInverse33(&row->invDiagonal);
+
+		b2DirectEntry* entries = m_directEntries + row->firstEntry;
+		for (int32 a = 0; a < row->entryCount; ++a)
+		{
+			// A_lk D_k^-1
+			b2Mat33 L = b2MulBlocks(entries[a].block, row->invDiagonal);
+			for (int32 b = 0; b < row->entryCount; ++b)
+			{
+				int32 l = entries[a].row;
+				int32 i = entries[b].row;
+				if (l < i)
+				{
+					continue;
+				}
+
+				// A_li -= A_lk D_k^-1 A_ik^T
+				b2Mat33 update = b2MulBlocks(L, b2TransposeBlock(entries[b].block));
+				if (l == i)
+				{
+					b2DirectRow* target = m_directRows + l;
+					target->diagonal = b2SubBlocks(target->diagonal, update);
+					continue;
+				}
+
+				const b2DirectRow* owner = m_directRows + i;
+				b2DirectEntry* target = m_directEntries + owner->firstEntry;
+				int32 e = 0;
+				while (e < owner->entryCount && target[e].row != l)
+				{
+					++e;
+				}
+
+				b2Assert(e < owner->entryCount);
+				target[e].block = b2SubBlocks(target[e].block, update);
+			}
+		}
+
+		for (int32 a = 0; a < row->entryCount; ++a)
+		{
+			entries[a].block = b2MulBlocks(entries[a].block, row->invDiagonal);
+		}
+	}
+}
+
+void b2JointSolver::SolveDirectRows()
+{
+	b2Velocity* velocities = m_data.velocities;
+
+	// y = -J * v
+	for (int32 k = 0; k < m_directCount; ++k)
+	{
+		b2DirectRow* row = m_directRows + k;
+		b2Vec3 Cdot(0.0f, 0.0f, 0.0f);
+		if (row->indexA >= 0)
+		{
+			const b2Velocity& v = velocities[row->indexA];
+			b2Vec3 vA(v.v.x, v.v.y, v.w);
+			Cdot += b2Vec3(b2Dot(row->JA[0], vA), b2Dot(row->JA[1], vA), b2Dot(row->JA[2], vA));
+		}
+
+		if (row->indexB >= 0)
+		{
+			const b2Velocity& v = velocities[row->indexB];
+			b2Vec3 vB(v.v.x, v.v.y, v.w);
+			Cdot += b2Vec3(b2Dot(row->JB[0], vB), b2Dot(row->JB[1], vB), b2Dot(row->JB[2], vB));
+		}
+
+		row->y = -Cdot;
+	}
+
+	// Solve L * D * L^T * impulse = y.
+	for (int32 k = 0; k < m_directCount; ++k)
+	{
+		const b2DirectRow* row = m_directRows + k;
+		const b2DirectEntry* entries = m_directEntries + row->firstEntry;
+		for (int32 e = 0; e < row->entryCount; ++e)
+		{
+			m_directRows[entries[e].row].y -= b2Mul(entries[e].block, row->y);
+		}
+	}
+
+	for (int32 k = 0; k < m_directCount; ++k)
+	{
+		b2DirectRow* row = m_directRows + k;
+		row->y = b2Mul(row->invDiagonal, row->y);
+	}
+
+	for (int32 k = m_directCount - 1; k >= 0; --k)
+	{
+		b2DirectRow* row = m_directRows + k;
+		const b2DirectEntry* entries = m_directEntries + row->firstEntry;
+		for (int32 e = 0; e < row->entryCount; ++e)
+		{
+			row->y -= b2MulTBlock(entries[e].block, m_directRows[entries[e].row].y);
+		}
+	}
+
+	// v += M^-1 * J^T * impulse
+	for (int32 k = 0; k < m_directCount; ++k)
+	{
+		b2DirectRow* row = m_directRows + k;
+		b2Vec3 impulse = row->y;
+		row->impulse += impulse;
+
+		if (row->indexA >= 0)
+		{
+			b2Vec3 P = impulse.x * row->JA[0] + impulse.y * row->JA[1] + impulse.z * row->JA[2];
+			b2Velocity& v = velocities[row->indexA];
+			v.v.x += row->invMassA.x * P.x;
+			v.v.y += row->invMassA.y * P.y;
+			v.w += row->invMassA.z * P.z;
+		}
+
+		if (row->indexB >= 0)
+		{
+			b2Vec3 P = impulse.x * row->JB[0] + impulse.y * row->JB[1] + impulse.z * row->JB[2];
+			b2Velocity& v = velocities[row->indexB];
+			v.v.x += row->invMassB.x * P.x;
+			v.v.y += row->invMassB.y * P.y;
+			v.w += row->invMassB.z * P.z;
+		}
+	}
+}
+
+void b2JointSolver::ColorJoints(b2Joint* jointList, b2Body* bodyList, int32 bodyCount, b2StackAllocator* allocator)
+{
+	// Greedy coloring over the whole joint graph. Each body remembers the colors of its
+	// joints in a bit set. The island indices are free until the islands are built.
+	uint8* bodyColors = (uint8*)allocator->Allocate(b2Max(bodyCount, 1) * sizeof(uint8));
+	int32 index = 0;
+	for (b2Body* b = bodyList; b; b = b->m_next)
+	{
+		bodyColors[index] = 0;
+		b->m_islandIndex = index++;
+	}
+
+	for (b2Joint* joint = jointList; joint; joint = joint->m_next)
+	{
+		joint->m_color = -1;
+		if (b2GetLaneSlot(joint->m_type) < 0)
+		{
+			continue;
+		}
+
+		// Static and kinematic bodies are never written by a joint, so any number of
+		// lanes may share them.
+		int32 indexA = GetDirectIndex(joint->m_bodyA);
+		int32 indexB = GetDirectIndex(joint->m_bodyB);
+		uint32 used = (indexA >= 0 ? bodyColors[indexA] : 0) | (indexB >= 0 ? bodyColors[indexB] : 0);
+		for (int32 c = 0; c < b2_jointColorCount; ++c)
+		{
+			if ((used & (1u << c)) != 0)
+			{
+				continue;
+			}
+
+			if (indexA >= 0)
+			{
+				bodyColors[indexA] |= (uint8)(1u << c);
+			}
+
+			if (indexB >= 0)
+			{
+				bodyColors[indexB] |= (uint8)(1u << c);
+			}
+
+			joint->m_color = c;
+			break;
+		}
+	}
+
+	allocator->Free(bodyColors);
+}
+
+#if defined(LIQUIDFUN_SIMD_SSE)
+
+// The joints of a group are scattered in memory. Fetching the next group while this one
+// is set up hides most of the misses.
+template <typename T>
+static void b2PrefetchLanes(const T* lanes)
+{
+	for (int32 j = 0; j < lanes->count; ++j)
+	{
+		const char* joint = (const char*)lanes->joints[j];
+		for (int32 offset = 0; offset < (int32)sizeof(*lanes->joints[j]); offset += 64)
+		{
+			_mm_prefetch(joint + offset, _MM_HINT_T0);
+		}
+	}
+}
+
+// Puts a joint in the next free lane of its color.
+template <typename T, typename J>
+static void b2AddLane(T* lanes, int32* fill, J* joint)
+{
+	int32 k = (*fill)++;
+	T* group = lanes + k / 4;
+	group->joints[k % 4] = joint;
+	group->count = k % 4 + 1;
+}
+
+void b2JointSolver::PackJoints(const int32* states)
+{
+	// Counting sort by lane. Each color is packed into groups of four and the colors
+	// follow each other, so a group rarely touches the bodies of the one before it. The
+	// direct rows may have taken some joints, so the lanes are counted again.
+	int32 fills[b2_laneSlotCount * b2_jointColorCount] = {};
+	for (int32 i = 0; i < m_count; ++i)
+	{
+		if (states[i] >= 0)
+		{
+			++fills[states[i]];
+		}
+	}
+
+	// The fill of a lane counts joints from the first group of the type.
+	int32 groupCounts[b2_laneSlotCount];
+	for (int32 t = 0; t < b2_laneSlotCount; ++t)
+	{
+		int32 groupCount = 0;
+		for (int32 c = 0; c < b2_jointColorCount; ++c)
+		{
+			int32* fill = fills + t * b2_jointColorCount + c;
+			int32 count = *fill;
+			*fill = 4 * groupCount;
+			groupCount += (count + 3) / 4;
+		}
+
+		groupCounts[t] = groupCount;
+	}
+
+	m_revoluteLaneCount = groupCounts[b2_revoluteSlot];
+	m_weldLaneCount = groupCounts[b2_weldSlot];
+	m_prismaticLaneCount = groupCounts[b2_prismaticSlot];
+	m_distanceLaneCount = groupCounts[b2_distanceSlot];
+
+	for (int32 i = 0; i < m_count; ++i)
+	{
+		int32 lane = states[i];
+		if (lane < 0)
+		{
+			continue;
+		}
+
+		b2Joint* joint = m_joints[i];
+		switch (lane / b2_jointColorCount)
+		{
+		case b2_revoluteSlot:
+			b2AddLane(m_revoluteLanes, fills + lane, (b2RevoluteJoint*)joint);
+			break;
+
+		case b2_weldSlot:
+			b2AddLane(m_weldLanes, fills + lane, (b2WeldJoint*)joint);
+			break;
+
+		case b2_prismaticSlot:
+			b2AddLane(m_prismaticLanes, fills + lane, (b2PrismaticJoint*)joint);
+			break;
+
+		default:
+			b2AddLane(m_distanceLanes, fills + lane, (b2DistanceJoint*)joint);
+			break;
+		}
+	}
+}
+
+#endif // defined(LIQUIDFUN_SIMD_SSE)
+
+void b2JointSolver::InitVelocityConstraints()
+{
+	// The joints compute their solver temporaries and warm start as usual.
+	for (int32 i = 0; i < m_scalarCount; ++i)
+	{
+		m_scalarJoints[i]->InitVelocityConstraints(m_data);
+	}
+
+	for (int32 k = 0; k < m_directCount; ++k)
+	{
+		m_directRows[k].joint->InitVelocityConstraints(m_data);
+	}
+
+	FactorDirectRows();
+
+#if defined(LIQUIDFUN_SIMD_SSE)
+	// The joints of a group compute their temporaries right before the group loads them,
+	// while they are still in cache.
+	for (int32 i = 0; i < m_revoluteLaneCount; ++i)
+	{
+		b2RevoluteLanes* lanes = m_revoluteLanes + i;
+		if (i + 1 < m_revoluteLaneCount)
+		{
+			b2PrefetchLanes(lanes + 1);
+		}
+
+		for (int32 j = 0; j < lanes->count; ++j)
+		{
+			((b2Joint*)lanes->joints[j])->InitVelocityConstraints(m_data);
+		}
+
+		LoadRevoluteLanes(lanes);
+	}
+
+	for (int32 i = 0; i < m_weldLaneCount; ++i)
+	{
+		b2WeldLanes* lanes = m_weldLanes + i;
+		if (i + 1 < m_weldLaneCount)
+		{
+			b2PrefetchLanes(lanes + 1);
+		}
+
+		for (int32 j = 0; j < lanes->count; ++j)
+		{
+			((b2Joint*)lanes->joints[j])->InitVelocityConstraints(m_data);
+		}
+
+		LoadWeldLanes(lanes);
+	}
+
+	for (int32 i = 0; i < m_prismaticLaneCount; ++i)
+	{
+		b2PrismaticLanes* lanes = m_prismaticLanes + i;
+		if (i + 1 < m_prismaticLaneCount)
+		{
+			b2PrefetchLanes(lanes + 1);
+		}
+
+		for (int32 j = 0; j < lanes->count; ++j)
+		{
+			((b2Joint*)lanes->joints[j])->InitVelocityConstraints(m_data);
+		}
+
+		LoadPrismaticLanes(lanes);
+	}
+
+	for (int32 i = 0; i < m_distanceLaneCount; ++i)
+	{
+		b2DistanceLanes* lanes = m_distanceLanes + i;
+		if (i + 1 < m_distanceLaneCount)
+		{
+			b2PrefetchLanes(lanes + 1);
+		}
+
+		for (int32 j = 0; j < lanes->count; ++j)
+		{
+			((b2Joint*)lanes->joints[j])->InitVelocityConstraints(m_data);
+		}
+
+		LoadDistanceLanes(lanes);
+	}
+#endif
+}
+
+void b2JointSolver::SolveVelocityConstraints()
+{
+	for (int32 i = 0; i < m_scalarCount; ++i)
+	{
+		m_scalarJoints[i]->SolveVelocityConstraints(m_data);
+	}
+
+#if defined(LIQUIDFUN_SIMD_SSE)
+	for (int32 i = 0; i < m_revoluteLaneCount; ++i)
+	{
+		b2SolveRevoluteLanes(m_revoluteLanes + i, m_data.velocities);
+	}
+
+	for (int32 i = 0; i < m_weldLaneCount; ++i)
+	{
+		b2SolveWeldLanes(m_weldLanes + i, m_data.velocities);
+	}
+
+	for (int32 i = 0; i < m_prismaticLaneCount; ++i)
+	{
+		b2SolvePrismaticLanes(m_prismaticLanes + i, m_data.velocities);
+	}
+
+	for (int32 i = 0; i < m_distanceLaneCount; ++i)
+	{
+		b2SolveDistanceLanes(m_distanceLanes + i, m_data.velocities);
+	}
+#endif
+
+	// The direct joints go last so they are exact for the velocities the iteration ends with.
+	SolveDirectRows();
+}
+
+void b2JointSolver::StoreImpulses()
+{
+	for (int32 k = 0; k < m_directCount; ++k)
+	{
+		const b2DirectRow* row = m_directRows + k;
+		b2Joint* joint = row->joint;
+		switch (joint->m_type)
+		{
+		case e_revoluteJoint:
+			((b2RevoluteJoint*)joint)->m_impulse.Set(row->impulse.x, row->impulse.y);
+			break;
+
+		case e_weldJoint:
+			((b2WeldJoint*)joint)->m_impulse = row->impulse;
+			break;
+
+		default:
+			((b2DistanceJoint*)joint)->m_impulse = row->impulse.x;
+			break;
+		}
+	}
+
+#if defined(LIQUIDFUN_SIMD_SSE)
+	for (int32 i = 0; i < m_revoluteLaneCount; ++i)
+	{
+		const b2RevoluteLanes* lanes = m_revoluteLanes + i;
+		for (int32 j = 0; j < lanes->count; ++j)
+		{
+			b2RevoluteJoint* joint = lanes->joints[j];
+			joint->m_impulse.Set(lanes->impulseX[j], lanes->impulseY[j]);
+			joint->m_motorImpulse = lanes->motorImpulse[j];
+			joint->m_lowerImpulse = lanes->lowerImpulse[j];
+			joint->m_upperImpulse = lanes->upperImpulse[j];
+		}
+	}
+
+	for (int32 i = 0; i < m_weldLaneCount; ++i)
+	{
+		const b2WeldLanes* lanes = m_weldLanes + i;
+		for (int32 j = 0; j < lanes->count; ++j)
+		{
+			lanes->joints[j]->m_impulse.Set(lanes->impulseX[j], lanes->impulseY[j], lanes->impulseZ[j]);
+		}
+	}
+
+	for (int32 i = 0; i < m_prismaticLaneCount; ++i)
+	{
+		const b2PrismaticLanes* lanes = m_prismaticLanes + i;
+		for (int32 j = 0; j < lanes->count; ++j)
+		{
+			b2PrismaticJoint* joint = lanes->joints[j];
+			joint->m_impulse.Set(lanes->impulseX[j], lanes->impulseY[j]);
+			joint->m_motorImpulse = lanes->motorImpulse[j];
+			joint->m_lowerImpulse = lanes->lowerImpulse[j];
+			joint->m_upperImpulse = lanes->upperImpulse[j];
+		}
+	}
+
+	for (int32 i = 0; i < m_distanceLaneCount; ++i)
+	{
+		const b2DistanceLanes* lanes = m_distanceLanes + i;
+		for (int32 j = 0; j < lanes->count; ++j)
+		{
+			b2DistanceJoint* joint = lanes->joints[j];
+			joint->m_impulse = lanes->impulse[j];
+			joint->m_lowerImpulse = lanes->lowerImpulse[j];
+			joint->m_upperImpulse = lanes->upperImpulse[j];
+		}
+	}
+#endif
+}
+
+bool b2JointSolver::SolvePositionConstraints()
+{
+	bool jointsOkay = true;
+	for (int32 i = 0; i < m_count; ++i)
+	{
+		bool jointOkay = m_joints[i]->SolvePositionConstraints(m_data);
+		jointsOkay = jointsOkay && jointOkay;
+	}
+
+	return jointsOkay;
+}
@@ -0,0 +1,113 @@
+// MIT License
+
+// Copyright (c) 2019 Erin Catto
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#ifndef B2_JOINT_SOLVER_H
+#define B2_JOINT_SOLVER_H
+
+#include "box2d/common/math.h"
+#include "box2d/common/time_step.h"
+
+class b2Body;
+class b2Joint;
+class b2StackAllocator;
+struct b2DirectEntry;
+struct b2DirectRow;
+struct b2DistanceLanes;
+struct b2PrismaticLanes;
+struct b2RevoluteLanes;
+struct b2WeldLanes;
+
+struct b2JointSolverDef
+{
+	b2TimeStep step;
+	b2Joint** joints;
+	int32 count;
+	int32 bodyCount;
+	b2Position* positions;
+	b2Velocity* velocities;
+	b2StackAllocator* allocator;
+};
+
+/// Solves the joints of an island.
+/// With b2TimeStep::directJoints, rigid revolute, weld and distance joints that form a
+/// forest over the dynamic bodies are solved exactly with a sparse block LDL^T in linear
+/// time. The factorization is done once per step and reused by every velocity iteration.
+/// Revolute, weld, prismatic and distance joints are colored over the whole world so that
+/// no two joints of a color share a dynamic body. The colors are kept until the joint graph
+/// changes. The joints left in an island are packed four of a color to a group and the
+/// velocity constraints of a group are solved together with SSE. All other joints go
+/// through the b2Joint interface.
+class b2JointSolver
+{
+public:
+	b2JointSolver(b2JointSolverDef* def);
+	~b2JointSolver();
+
+	void InitVelocityConstraints();
+	void SolveVelocityConstraints();
+	void StoreImpulses();
+
+	bool SolvePositionConstraints();
+
+	static bool IsDirectCandidate(const b2Joint* joint);
+	static int32 GetDirectIndex(const b2Body* body);
+	void BuildDirectRows(int32* states, int32 bodyCount);
+	void FactorDirectRows();
+	void SolveDirectRows();
+
+	static void ColorJoints(b2Joint* jointList, b2Body* bodyList, int32 bodyCount, b2StackAllocator* allocator);
+	void PackJoints(const int32* states);
+	void LoadRevoluteLanes(b2RevoluteLanes* lanes);
+	void LoadWeldLanes(b2WeldLanes* lanes);
+	void LoadPrismaticLanes(b2PrismaticLanes* lanes);
+	void LoadDistanceLanes(b2DistanceLanes* lanes);
+
+	b2SolverData m_data;
+	b2StackAllocator* m_allocator;
+	b2Joint** m_joints;
+	int32 m_count;
+
+	// How each joint is solved, see b2_scalarJoint.
+	int32* m_states;
+
+	// Joints that are not in a group.
+	b2Joint** m_scalarJoints;
+	int32 m_scalarCount;
+
+	// Joints of the direct solver in elimination order.
+	b2DirectRow* m_directRows;
+	int32 m_directCount;
+	b2DirectEntry* m_directEntries;
+	int32 m_directEntryCount;
+
+	b2RevoluteLanes* m_revoluteLanes;
+	int32 m_revoluteLaneCount;
+	b2WeldLanes* m_weldLanes;
+	int32 m_weldLaneCount;
+	b2PrismaticLanes* m_prismaticLanes;
+	int32 m_prismaticLaneCount;
+	b2DistanceLanes* m_distanceLanes;
+	int32 m_distanceLaneCount;
+};
+
+#endif
@@ -25,9 +25,13 @@
 #include "body.h"
 #include "box2d/collision/broad_phase.h"
 #include "box2d/collision/collision.h"
+#include "box2d/collision/distance.h"
+#include "box2d/collision/shapes/capsule_shape.h"
 #include "box2d/collision/shapes/chain_shape.h"
 #include "box2d/collision/shapes/circle_shape.h"
+#include "box2d/collision/shapes/compound_shape.h"
 #include "box2d/collision/shapes/edge_shape.h"
+#include "box2d/collision/shapes/grid_shape.h"
 #include "box2d/collision/shapes/polygon_shape.h"
 #include "box2d/collision/time_of_impact.h"
 #include "box2d/common/draw.h"
@@ -36,8 +40,10 @@
 #include "contact_solver.h"
 #include "fixture.h"
 #include "island.h"
+#include "joint_solver.h"
 #include "joint/pulley_joint.h"
 
+#include <algorithm>
 #include <new>
 
 b2World::b2World( const b2Vec2& gravity ) {
@@ -47,6 +53,7 @@ b2World::b2World( const b2Vec2& gravity ) {
   m_bodyList = nullptr;
   m_jointList = nullptr;
   m_particleSystemList = nullptr;
+  m_sharedShapeList = nullptr;
 
   m_bodyCount = 0;
   m_jointCount = 0;
@@ -54,13 +61,23 @@ b2World::b2World( const b2Vec2& gravity ) {
   m_warmStarting = true;
   m_continuousPhysics = true;
   m_subStepping = false;
+  m_jointBatching = false;
+  m_directJointSolver = false;
+  m_adaptiveIterations = false;
+  m_maxVelocityIterations = 0;
 
   m_stepComplete = true;
 
+  m_snapshots [ 0 ] = nullptr;
+  m_snapshots [ 1 ] = nullptr;
+  m_publishedSnapshot = nullptr;
+  m_stepCount = 0;
+
   m_allowSleep = true;
   m_gravity = gravity;
 
   m_newContacts = false;
+  m_newJoints = false;
   m_locked = false;
   m_clearForces = true;
 
@@ -71,7 +88,14 @@ b2World::b2World( const b2Vec2& gravity ) {
   memset( &m_profile, 0, sizeof( b2Profile ) );
 }
 
+b2World::b2World( const b2Vec2& gravity, b2BroadPhaseType broadPhaseType, float gridCellSize ) : b2World( gravity ) {
+  m_contactManager.m_broadPhase.SetType( broadPhaseType );
+  m_contactManager.m_broadPhase.SetGridCellSize( gridCellSize );
+}
+
 b2World::~b2World() {
+  SetSnapshotsEnabled( false );
+
   // Some shapes allocate using b2Alloc.
   b2Body* b = m_bodyList;
   while( b ) {
@@ -91,6 +115,10 @@ b2World::~b2World() {
   while( m_particleSystemList )
     DestroyParticleSystem( m_particleSystemList );
 
+  // The fixtures are gone, so the world holds the last reference to these.
+  while( m_sharedShapeList )
+    DestroySharedShape( m_sharedShapeList );
+
   // Even though the block allocator frees them for us, for safety,
   // we should ensure that all buffers have been freed.
   b2Assert( m_blockAllocator.GetNumGiantAllocations() == 0 );
@@ -210,6 +238,7 @@ b2Joint* b2World::CreateJoint( const b2JointDef* def ) {
     m_jointList->m_prev = j;
   m_jointList = j;
   ++m_jointCount;
+  m_newJoints = true;
 
   // Connect to the bodies' doubly linked lists.
   j->m_edgeA.joint = j;
@@ -265,6 +294,8 @@ void b2World::DestroyJoint( b2Joint* j ) {
   if( j == m_jointList )
     m_jointList = j->m_next;
 
+  m_newJoints = true;
+
   // Disconnect from island graph.
   b2Body* bodyA = j->m_bodyA;
   b2Body* bodyB = j->m_bodyB;
@@ -319,6 +350,48 @@ void b2World::DestroyJoint( b2Joint* j ) {
   }
 }
 
+b2SharedShape* b2World::CreateSharedShape( const b2Shape* shape ) {
+  b2Assert( IsLocked() == false );
+  if( IsLocked() )
+    return nullptr;
+
+  void* mem = m_blockAllocator.Allocate( sizeof( b2SharedShape ) );
+  b2SharedShape* sharedShape = new( mem ) b2SharedShape;
+  sharedShape->m_shape = shape->Clone( &m_blockAllocator );
+  sharedShape->m_refCount = 1;
+  sharedShape->m_worldOwned = true;
+
+  // Add to world doubly linked list.
+  sharedShape->m_prev = nullptr;
+  sharedShape->m_next = m_sharedShapeList;
+  if( m_sharedShapeList )
+    m_sharedShapeList->m_prev = sharedShape;
+  m_sharedShapeList = sharedShape;
+
+  return sharedShape;
+}
+
+void b2World::DestroySharedShape( b2SharedShape* sharedShape ) {
+  b2Assert( IsLocked() == false );
+  if( IsLocked() )
+    return;
+
+  b2Assert( sharedShape->m_worldOwned );
+
+  // Remove from the doubly linked list.
+  if( sharedShape->m_prev )
+    sharedShape->m_prev->m_next = sharedShape->m_next;
+
+  if( sharedShape->m_next )
+    sharedShape->m_next->m_prev = sharedShape->m_prev;
+
+  if( sharedShape == m_sharedShapeList )
+    m_sharedShapeList = sharedShape->m_next;
+
+  sharedShape->m_worldOwned = false;
+  b2Fixture::ReleaseSharedShape( &m_blockAllocator, sharedShape );
+}
+
 b2ParticleSystem* b2World::CreateParticleSystem( const b2ParticleSystemDef* def ) {
   b2Assert( IsLocked() == false );
   if( IsLocked() )
@@ -377,6 +450,15 @@ void b2World::Solve( const b2TimeStep& step ) {
   m_profile.solveInit = 0.0f;
   m_profile.solveVelocity = 0.0f;
   m_profile.solvePosition = 0.0f;
+  m_profile.velocityIslands = 0;
+  m_profile.velocityIterations = 0;
+  m_profile.maxVelocityIterations = 0;
+
+  // Batch colors hold across steps until the joint graph changes.
+  if( step.batchJoints && m_newJoints ) {
+    b2JointSolver::ColorJoints( m_jointList, m_bodyList, m_bodyCount, &m_stackAllocator );
+    m_newJoints = false;
+  }
 
   // Size the island for the worst case.
   b2Island island( m_bodyCount,
@@ -489,6 +571,9 @@ void b2World::Solve( const b2TimeStep& step ) {
     m_profile.solveInit += profile.solveInit;
     m_profile.solveVelocity += profile.solveVelocity;
     m_profile.solvePosition += profile.solvePosition;
+    ++m_profile.velocityIslands;
+    m_profile.velocityIterations += profile.velocityIterations;
+    m_profile.maxVelocityIterations = b2Max( m_profile.maxVelocityIterations, profile.velocityIterations );
 
     // Post solve cleanup.
     for( int32 i = 0; i < island.m_bodyCount; ++i ) {
@@ -613,8 +698,18 @@ void b2World::SolveTOI( const b2TimeStep& step ) {
         input.sweepB = bB->m_sweep;
         input.tMax = 1.0f;
 
+        // Circles against circles, edges and polygons have a closed form TOI when
+        // their relative path is straight. Everything else takes the general route.
         b2TOIOutput output;
-        b2TimeOfImpact( &output, &input );
+        b2Shape::Type shapeTypeA = fA->GetType();
+        b2Shape::Type shapeTypeB = fB->GetType();
+        bool circlePair = ( shapeTypeA == b2Shape::e_circle &&
+                            ( shapeTypeB == b2Shape::e_circle || shapeTypeB == b2Shape::e_edge ||
+                              shapeTypeB == b2Shape::e_polygon ) ) ||
+                          ( shapeTypeB == b2Shape::e_circle &&
+                            ( shapeTypeA == b2Shape::e_edge || shapeTypeA == b2Shape::e_polygon ) );
+        if( circlePair == false || b2TimeOfImpactCircle( &output, &input ) == false )
+          b2TimeOfImpact( &output, &input );
 
         // Beta is the fraction of the remaining portion of the .
         float beta = output.t;
@@ -758,7 +853,11 @@ void b2World::SolveTOI( const b2TimeStep& step ) {
     subStep.dtRatio = 1.0f;
     subStep.positionIterations = 20;
     subStep.velocityIterations = step.velocityIterations;
+    subStep.maxVelocityIterations = step.velocityIterations;
     subStep.warmStarting = false;
+    subStep.adaptiveIterations = false;
+    subStep.batchJoints = false;
+    subStep.directJoints = false;
     island.SolveTOI( subStep, bA->m_islandIndex, bB->m_islandIndex );
 
     // Reset island flags and synchronize broad-phase proxies.
@@ -801,6 +900,7 @@ void b2World::Step( float dt, int32 velocityIterations, int32 positionIterations
   b2TimeStep step;
   step.dt = dt;
   step.velocityIterations = velocityIterations;
+  step.maxVelocityIterations = b2Max( velocityIterations, m_maxVelocityIterations );
   step.positionIterations = positionIterations;
   step.particleIterations = particleIterations;
   if( dt > 0.0f )
@@ -811,6 +911,9 @@ void b2World::Step( float dt, int32 velocityIterations, int32 positionIterations
   step.dtRatio = m_inv_dt0 * dt;
 
   step.warmStarting = m_warmStarting;
+  step.adaptiveIterations = m_adaptiveIterations;
+  step.batchJoints = m_jointBatching;
+  step.directJoints = m_directJointSolver;
 
   // Update contacts. This is where some contacts are destroyed.
   {
@@ -843,9 +946,73 @@ void b2World::Step( float dt, int32 velocityIterations, int32 positionIterations
 
   m_locked = false;
 
+  ++m_stepCount;
+  if( m_snapshots [ 0 ] )
+    PublishSnapshot();
+
   m_profile.step = stepTimer.GetMilliseconds();
 }
 
+void b2World::SetSnapshotsEnabled( bool flag ) {
+  if( flag == GetSnapshotsEnabled() )
+    return;
+
+  if( flag ) {
+    for( int32 i = 0; i < 2; ++i ) {
+      void* mem = b2Alloc( sizeof( b2WorldSnapshot ) );
+      m_snapshots [ i ] = new( mem ) b2WorldSnapshot;
+    }
+
+    // Readers see the world as it is now until the next step.
+    PublishSnapshot();
+  } else {
+    m_publishedSnapshot = nullptr;
+    for( int32 i = 0; i < 2; ++i ) {
+      b2Assert( m_snapshots [ i ]->m_readers == 0 );
+      m_snapshots [ i ]->~b2WorldSnapshot();
+      b2Free( m_snapshots [ i ] );
+      m_snapshots [ i ] = nullptr;
+    }
+  }
+}
+
+bool b2World::GetSnapshotsEnabled() const {
+  return m_snapshots [ 0 ] != nullptr;
+}
+
+void b2World::PublishSnapshot() {
+  // Write the snapshot readers are not being handed. A reader that loaded it just
+  // before it was replaced registers itself and then sees that it is no longer
+  // published, so a zero count means nobody can be reading it.
+  b2WorldSnapshot* published = m_publishedSnapshot;
+  b2WorldSnapshot* snapshot = published == m_snapshots [ 0 ] ? m_snapshots [ 1 ] : m_snapshots [ 0 ];
+  if( snapshot->m_readers != 0 )
+    return;
+
+  snapshot->Capture( this, m_stepCount );
+  m_publishedSnapshot = snapshot;
+}
+
+const b2WorldSnapshot* b2World::AcquireSnapshot() const {
+  for( ;; ) {
+    b2WorldSnapshot* snapshot = m_publishedSnapshot;
+    if( snapshot == nullptr )
+      return nullptr;
+
+    ++snapshot->m_readers;
+    if( m_publishedSnapshot == snapshot )
+      return snapshot;
+
+    // A step replaced it in the meantime. Try the new one.
+    --snapshot->m_readers;
+  }
+}
+
+void b2World::ReleaseSnapshot( const b2WorldSnapshot* snapshot ) const {
+  b2Assert( snapshot->m_readers > 0 );
+  --snapshot->m_readers;
+}
+
 void b2World::ClearForces() {
   for( b2Body* body = m_bodyList; body; body = body->GetNext() ) {
     body->m_force.SetZero();
@@ -880,7 +1047,11 @@ struct b2WorldRayCastWrapper {
       b2Fixture* fixture = proxy->fixture;
       int32 index = proxy->childIndex;
       b2RayCastOutput output;
-      bool hit = fixture->RayCast( &output, input, index );
+      bool hit;
+      if( fixture->GetShape()->SharesProxy() )
+        hit = fixture->GetShape()->RayCastChildren( &output, &index, input, fixture->GetBody()->GetTransform() );
+      else
+        hit = fixture->RayCast( &output, input, index );
 
       if( hit ) {
         float fraction = output.fraction;
@@ -909,11 +1080,314 @@ void b2World::RayCast( b2RayCastCallback* callback, const b2Vec2& point1, const
       p->RayCast( callback, point1, point2 );
 }
 
-void b2World::DrawShape( b2Fixture* fixture, const b2Transform& xf, const b2Color& color ) {
-  switch( fixture->GetType() ) {
+// Bounding circle of a distance proxy in world coordinates.
+static void b2ComputeProxyBound( b2Vec2* center, float* radius, const b2DistanceProxy& proxy, const b2Transform& xf ) {
+  b2Vec2 c = proxy.m_vertices [ 0 ];
+  for( int32 i = 1; i < proxy.m_count; ++i )
+    c += proxy.m_vertices [ i ];
+  c *= 1.0f / proxy.m_count;
+
+  float radiusSqr = 0.0f;
+  for( int32 i = 0; i < proxy.m_count; ++i )
+    radiusSqr = b2Max( radiusSqr, b2DistanceSquared( proxy.m_vertices [ i ], c ) );
+
+  *center = b2Mul( xf, c );
+  *radius = b2Sqrt( radiusSqr ) + proxy.m_radius;
+}
+
+// Largest separation of the vertices of B along the face normals of the CCW polygon A.
+static float b2FindProxySeparation( const b2DistanceProxy& proxyA, const b2Transform& xfA,
+    const b2DistanceProxy& proxyB, const b2Transform& xfB ) {
+  b2Transform xf = b2MulT( xfA, xfB );
+  b2Vec2 vertices [ b2_maxPolygonVertices ];
+  for( int32 i = 0; i < proxyB.m_count; ++i )
+    vertices [ i ] = b2Mul( xf, proxyB.m_vertices [ i ] );
+
+  float maxSeparation = -b2_maxFloat;
+  for( int32 i = 0; i < proxyA.m_count; ++i ) {
+    b2Vec2 v1 = proxyA.m_vertices [ i ];
+    b2Vec2 v2 = proxyA.m_vertices [ i + 1 < proxyA.m_count ? i + 1 : 0 ];
+    b2Vec2 n = b2Cross( v2 - v1, 1.0f );
+    n.Normalize();
+
+    float si = b2_maxFloat;
+    for( int32 j = 0; j < proxyB.m_count; ++j )
+      si = b2Min( si, b2Dot( n, vertices [ j ] - v1 ) );
+
+    maxSeparation = b2Max( maxSeparation, si );
+  }
+
+  return maxSeparation;
+}
+
+// Exact overlap of two proxies, the same as b2TestOverlap. Bounding circles reject
+// distant pairs and polygon pairs are settled by their face normals when the
+// answer is clear of the radii. GJK only runs for what remains.
+static bool b2TestProxyOverlap( const b2DistanceProxy& proxyA, const b2Transform& xfA, const b2Vec2& centerA,
+    float radiusA, const b2DistanceProxy& proxyB, const b2Transform& xfB ) {
+  b2Vec2 centerB;
+  float radiusB;
+  b2ComputeProxyBound( &centerB, &radiusB, proxyB, xfB );
+  if( b2DistanceSquared( centerA, centerB ) > ( radiusA + radiusB ) * ( radiusA + radiusB ) )
+    return false;
+
+  if( proxyA.m_count >= 3 && proxyB.m_count >= 3 ) {
+    float separation = b2Max( b2FindProxySeparation( proxyA, xfA, proxyB, xfB ),
+        b2FindProxySeparation( proxyB, xfB, proxyA, xfA ) );
+    if( separation > proxyA.m_radius + proxyB.m_radius )
+      return false;
+
+    // The cores overlap.
+    if( separation <= 0.0f )
+      return true;
+  }
+
+  b2DistanceInput input;
+  input.proxyA = proxyA;
+  input.proxyB = proxyB;
+  input.transformA = xfA;
+  input.transformB = xfB;
+  input.useRadii = true;
+
+  b2SimplexCache cache;
+  cache.count = 0;
+  b2DistanceOutput output;
+  b2Distance( &output, &cache, &input );
+  return output.distance < 10.0f * b2_epsilon;
+}
+
+// Tests the children of a shared-proxy shape under a world query box and stops at
+// the first one that overlaps.
+class b2ShapeQueryChildren : public b2ShapeChildCallback {
+  public:
+    bool ReportChild( int32 childIndex ) override {
+      b2DistanceProxy fixtureProxy;
+      fixtureProxy.Set( shape, childIndex );
+      overlap = b2TestProxyOverlap( *shapeProxy, *transform, center, radius, fixtureProxy, *xf );
+      return overlap == false;
+    }
+
+    const b2DistanceProxy* shapeProxy;
+    const b2Transform* transform;
+    b2Vec2 center;
+    float radius;
+    const b2Shape* shape;
+    const b2Transform* xf;
+    bool overlap = false;
+};
+
+// Runs the exact test on each broad-phase candidate of b2World::QueryShape.
+struct b2WorldShapeQueryWrapper {
+    bool QueryCallback( int32 proxyId ) {
+      b2FixtureProxy* proxy = (b2FixtureProxy*) broadPhase->GetUserData( proxyId );
+      b2Fixture* fixture = proxy->fixture;
+      const b2Shape* fixtureShape = fixture->GetShape();
+      const b2Transform& xf = fixture->GetBody()->GetTransform();
+
+      if( fixtureShape->SharesProxy() ) {
+        // Test the children under the query shape until one overlaps.
+        b2ShapeQueryChildren children;
+        children.shapeProxy = shapeProxy;
+        children.transform = transform;
+        children.center = center;
+        children.radius = radius;
+        children.shape = fixtureShape;
+        children.xf = &xf;
+        fixtureShape->QueryChildren( &children, b2MulT( xf, aabb ) );
+        if( children.overlap == false )
+          return true;
+      } else {
+        b2DistanceProxy fixtureProxy;
+        fixtureProxy.Set( fixtureShape, proxy->childIndex );
+        if( b2TestProxyOverlap( *shapeProxy, *transform, center, radius, fixtureProxy, xf ) == false )
+          return true;
+      }
+
+      return callback->ReportFixture( fixture );
+    }
+
+    const b2BroadPhase* broadPhase;
+    b2QueryCallback* callback;
+    const b2DistanceProxy* shapeProxy;
+    const b2Transform* transform;
+    b2AABB aabb;
+    b2Vec2 center;
+    float radius;
+};
+
+void b2World::QueryShape( b2QueryCallback* callback, const b2Shape* shape, const b2Transform& transform ) const {
+  b2Assert( shape->GetChildCount() == 1 );
+
+  b2DistanceProxy shapeProxy;
+  shapeProxy.Set( shape, 0 );
+
+  b2WorldShapeQueryWrapper wrapper;
+  wrapper.broadPhase = &m_contactManager.m_broadPhase;
+  wrapper.callback = callback;
+  wrapper.shapeProxy = &shapeProxy;
+  wrapper.transform = &transform;
+  shape->ComputeAABB( &wrapper.aabb, transform, 0 );
+  b2ComputeProxyBound( &wrapper.center, &wrapper.radius, shapeProxy, transform );
+  m_contactManager.m_broadPhase.Query( &wrapper, wrapper.aabb );
+}
+
+// Keeps the first fixture reported by b2World::QueryShape.
+class b2FirstFixtureQuery : public b2QueryCallback {
+  public:
+    bool ReportFixture( b2Fixture* fixture ) override {
+      this->fixture = fixture;
+      return false;
+    }
+
+    b2Fixture* fixture = nullptr;
+};
+
+b2Fixture* b2World::QueryShape( const b2Shape* shape, const b2Transform& transform ) const {
+  b2FirstFixtureQuery query;
+  QueryShape( &query, shape, transform );
+  return query.fixture;
+}
+
+// Casts against each child of a fixture and keeps the closest hit.
+class b2ShapeCastChildren : public b2ShapeChildCallback {
+  public:
+    bool ReportChild( int32 childIndex ) override {
+      input->proxyA.Set( shape, childIndex );
+      b2ShapeCastOutput output;
+      if( b2ShapeCast( &output, input ) && output.lambda <= best.lambda ) {
+        best = output;
+        hitChild = childIndex;
+        hit = true;
+      }
+
+      return true;
+    }
+
+    const b2Shape* shape;
+    b2ShapeCastInput* input;
+    b2ShapeCastOutput best;
+    int32 hitChild = 0;
+    bool hit = false;
+};
+
+// A broad-phase proxy reached by a shape cast and the fraction of the translation
+// at which the swept bounds enter its fat AABB.
+struct b2ShapeCastCandidate {
+    float fraction;
+    int32 proxyId;
+
+    bool operator<( const b2ShapeCastCandidate& other ) const {
+      return fraction < other.fraction;
+    }
+};
+
+// Gathers the proxies whose fat AABB the swept bounds of the cast shape enter.
+struct b2WorldShapeCastGather {
+    bool QueryCallback( int32 proxyId ) {
+      // Sweep the center of the shape's box against the fat AABB grown by its extents.
+      b2AABB aabb = broadPhase->GetFatAABB( proxyId );
+      aabb.lowerBound -= extents;
+      aabb.upperBound += extents;
+      float fraction;
+      if( b2TestSegmentOverlap( center, translation, 1.0f, aabb, &fraction ) == false )
+        return true;
+
+      if( count == capacity ) {
+        b2ShapeCastCandidate* old = candidates;
+        capacity *= 2;
+        candidates = (b2ShapeCastCandidate*) b2Alloc( capacity * sizeof( b2ShapeCastCandidate ) );
+        memcpy( candidates, old, count * sizeof( b2ShapeCastCandidate ) );
+        if( old != array )
+          b2Free( old );
+      }
+
+      candidates [ count ].fraction = fraction;
+      candidates [ count ].proxyId = proxyId;
+      ++count;
+      return true;
+    }
+
+    const b2BroadPhase* broadPhase;
+    b2Vec2 center, extents, translation;
+    b2ShapeCastCandidate array [ 64 ];
+    b2ShapeCastCandidate* candidates;
+    int32 count, capacity;
+};
+
+void b2World::ShapeCast( b2ShapeCastCallback* callback, const b2Shape* shape, const b2Transform& transform,
+    const b2Vec2& translation ) const {
+  b2Assert( shape->GetChildCount() == 1 );
+
+  b2AABB aabb;
+  shape->ComputeAABB( &aabb, transform, 0 );
+  b2AABB sweptAABB;
+  sweptAABB.lowerBound = b2Min( aabb.lowerBound, aabb.lowerBound + translation );
+  sweptAABB.upperBound = b2Max( aabb.upperBound, aabb.upperBound + translation );
+
+  b2WorldShapeCastGather gather;
+  gather.broadPhase = &m_contactManager.m_broadPhase;
+  gather.center = aabb.GetCenter();
+  gather.extents = aabb.GetExtents();
+  gather.translation = translation;
+  gather.candidates = gather.array;
+  gather.count = 0;
+  gather.capacity = 64;
+  m_contactManager.m_broadPhase.Query( &gather, sweptAABB );
+
+  // Visit the candidates in the order the sweep reaches them. Once the cast is
+  // clipped short of a candidate's bounds, nothing further along can be hit.
+  std::sort( gather.candidates, gather.candidates + gather.count );
+
+  b2ShapeCastInput input;
+  input.proxyB.Set( shape, 0 );
+  input.transformB = transform;
+  input.translationB = translation;
+
+  float maxFraction = 1.0f;
+  for( int32 i = 0; i < gather.count; ++i ) {
+    const b2ShapeCastCandidate& candidate = gather.candidates [ i ];
+    if( candidate.fraction > maxFraction )
+      break;
+
+    b2FixtureProxy* proxy = (b2FixtureProxy*) m_contactManager.m_broadPhase.GetUserData( candidate.proxyId );
+    b2Fixture* fixture = proxy->fixture;
+    if( callback->ShouldCastFixture( fixture ) == false )
+      continue;
+
+    const b2Shape* fixtureShape = fixture->GetShape();
+    input.transformA = fixture->GetBody()->GetTransform();
+
+    // A shared proxy covers many children. Only cast against those in the sweep.
+    b2ShapeCastChildren children;
+    children.shape = fixtureShape;
+    children.input = &input;
+    children.best.lambda = maxFraction;
+    if( fixtureShape->SharesProxy() )
+      fixtureShape->QueryChildren( &children, b2MulT( input.transformA, sweptAABB ) );
+    else
+      children.ReportChild( proxy->childIndex );
+
+    if( children.hit == false )
+      continue;
+
+    const b2ShapeCastOutput& best = children.best;
+    float value = callback->ReportFixture( fixture, children.hitChild, best.point, best.normal, best.lambda );
+    if( value == 0.0f )
+      break;
+
+    if( value > 0.0f )
+      maxFraction = value;
+  }
+
+  if( gather.candidates != gather.array )
+    b2Free( gather.candidates );
+}
+
+void b2World::DrawShape( const b2Shape* shape, const b2Transform& xf, const b2Color& color ) {
+  switch( shape->GetType() ) {
     case b2Shape::e_circle:
       {
-        b2CircleShape* circle = (b2CircleShape*) fixture->GetShape();
+        const b2CircleShape* circle = (const b2CircleShape*) shape;
 
         b2Vec2 center = b2Mul( xf, circle->m_p );
         float radius = circle->m_radius;
@@ -925,7 +1399,7 @@ void b2World::DrawShape( b2Fixture* fixture, const b2Transform& xf, const b2Colo
 
     case b2Shape::e_edge:
       {
-        b2EdgeShape* edge = (b2EdgeShape*) fixture->GetShape();
+        const b2EdgeShape* edge = (const b2EdgeShape*) shape;
         b2Vec2 v1 = b2Mul( xf, edge->m_vertex1 );
         b2Vec2 v2 = b2Mul( xf, edge->m_vertex2 );
         m_debugDraw->DrawSegment( v1, v2, color );
@@ -939,7 +1413,7 @@ void b2World::DrawShape( b2Fixture* fixture, const b2Transform& xf, const b2Colo
 
     case b2Shape::e_chain:
       {
-        b2ChainShape* chain = (b2ChainShape*) fixture->GetShape();
+        const b2ChainShape* chain = (const b2ChainShape*) shape;
         int32 count = chain->m_count;
         const b2Vec2* vertices = chain->m_vertices;
 
@@ -954,7 +1428,7 @@ void b2World::DrawShape( b2Fixture* fixture, const b2Transform& xf, const b2Colo
 
     case b2Shape::e_polygon:
       {
-        b2PolygonShape* poly = (b2PolygonShape*) fixture->GetShape();
+        const b2PolygonShape* poly = (const b2PolygonShape*) shape;
         int32 vertexCount = poly->m_count;
         b2Assert( vertexCount <= b2_maxPolygonVertices );
         b2Vec2 vertices [ b2_maxPolygonVertices ];
@@ -966,6 +1440,53 @@ void b2World::DrawShape( b2Fixture* fixture, const b2Transform& xf, const b2Colo
       }
       break;
 
+    case b2Shape::e_capsule:
+      {
+        const b2CapsuleShape* capsule = (const b2CapsuleShape*) shape;
+        b2Vec2 v1 = b2Mul( xf, capsule->m_vertex1 );
+        b2Vec2 v2 = b2Mul( xf, capsule->m_vertex2 );
+        float radius = capsule->m_radius;
+
+        b2Vec2 axis = v2 - v1;
+        axis.Normalize();
+        b2Vec2 side = radius * b2Cross( 1.0f, axis );
+        b2Vec2 vertices [ 4 ] = { v1 - side, v2 - side, v2 + side, v1 + side };
+
+        m_debugDraw->DrawSolidPolygon( vertices, 4, color );
+        m_debugDraw->DrawSolidCircle( v1, radius, -axis, color );
+        m_debugDraw->DrawSolidCircle( v2, radius, axis, color );
+      }
+      break;
+
+    case b2Shape::e_grid:
+      {
+        const b2GridShape* grid = (const b2GridShape*) shape;
+        int32 childCount = grid->GetChildCount();
+        for( int32 i = 0; i < childCount; ++i ) {
+          if( grid->IsHeightField() ) {
+            b2EdgeShape edge;
+            grid->GetChildEdge( &edge, i );
+            m_debugDraw->DrawSegment( b2Mul( xf, edge.m_vertex1 ), b2Mul( xf, edge.m_vertex2 ), color );
+          } else if( grid->IsSolid( i ) ) {
+            b2PolygonShape box;
+            grid->GetChildBox( &box, i );
+            b2Vec2 vertices [ 4 ];
+            for( int32 j = 0; j < 4; ++j )
+              vertices [ j ] = b2Mul( xf, box.m_vertices [ j ] );
+            m_debugDraw->DrawSolidPolygon( vertices, 4, color );
+          }
+        }
+      }
+      break;
+
+    case b2Shape::e_compound:
+      {
+        const b2CompoundShape* compound = (const b2CompoundShape*) shape;
+        for( int32 i = 0; i < compound->m_count; ++i )
+          DrawShape( compound->GetChild( i ), xf, color );
+      }
+      break;
+
     default:
       break;
   }
@@ -1036,17 +1557,17 @@ void b2World::DebugDraw() {
       for( b2Fixture* f = b->GetFixtureList(); f; f = f->GetNext() ) {
         if( b->GetType() == b2_dynamicBody && b->m_mass == 0.0f ) {
           // Bad body
-          DrawShape( f, xf, b2Color( 1.0f, 0.0f, 0.0f ) );
+          DrawShape( f->GetShape(), xf, b2Color( 1.0f, 0.0f, 0.0f ) );
         } else if( b->IsEnabled() == false ) {
-          DrawShape( f, xf, b2Color( 0.5f, 0.5f, 0.3f ) );
+          DrawShape( f->GetShape(), xf, b2Color( 0.5f, 0.5f, 0.3f ) );
         } else if( b->GetType() == b2_staticBody ) {
-          DrawShape( f, xf, b2Color( 0.5f, 0.9f, 0.5f ) );
+          DrawShape( f->GetShape(), xf, b2Color( 0.5f, 0.9f, 0.5f ) );
         } else if( b->GetType() == b2_kinematicBody ) {
-          DrawShape( f, xf, b2Color( 0.5f, 0.5f, 0.9f ) );
+          DrawShape( f->GetShape(), xf, b2Color( 0.5f, 0.5f, 0.9f ) );
         } else if( b->IsAwake() == false ) {
-          DrawShape( f, xf, b2Color( 0.6f, 0.6f, 0.6f ) );
+          DrawShape( f->GetShape(), xf, b2Color( 0.6f, 0.6f, 0.6f ) );
         } else {
-          DrawShape( f, xf, b2Color( 0.9f, 0.7f, 0.7f ) );
+          DrawShape( f->GetShape(), xf, b2Color( 0.9f, 0.7f, 0.7f ) );
         }
       }
     }
@@ -1142,6 +1663,66 @@ float b2World::GetTreeQuality() const {
   return m_contactManager.m_broadPhase.GetTreeQuality();
 }
 
+void b2World::CompactTree() {
+  b2Assert( m_locked == false );
+  if( m_locked )
+    return;
+
+  m_contactManager.m_broadPhase.CompactTree();
+}
+
+void b2World::SetStaticTreeCompression( bool flag ) {
+  b2Assert( m_locked == false );
+  if( m_locked )
+    return;
+
+  b2BroadPhase* broadPhase = &m_contactManager.m_broadPhase;
+  if( broadPhase->GetStaticTreeCompression() == flag )
+    return;
+
+  broadPhase->SetStaticTreeCompression( flag );
+
+  // Move the existing static proxies into the right tree.
+  for( b2Body* b = m_bodyList; b; b = b->m_next ) {
+    if( b->m_type != b2_staticBody || b->IsEnabled() == false )
+      continue;
+
+    for( b2Fixture* f = b->m_fixtureList; f; f = f->m_next ) {
+      f->DestroyProxies( broadPhase );
+      f->CreateProxies( broadPhase, b->m_xf );
+    }
+  }
+
+  m_newContacts = true;
+}
+
+bool b2World::GetStaticTreeCompression() const {
+  return m_contactManager.m_broadPhase.GetStaticTreeCompression();
+}
+
+void b2World::SetLayerCollision( int32 layerA, int32 layerB, bool flag ) {
+  b2Assert( m_locked == false );
+  if( m_locked )
+    return;
+
+  if( m_contactManager.m_broadPhase.GetLayerCollision( layerA, layerB ) == flag )
+    return;
+
+  m_contactManager.m_broadPhase.SetLayerCollision( layerA, layerB, flag );
+
+  // Drop contacts between the layers or look for new pairs.
+  for( b2Body* b = m_bodyList; b; b = b->m_next ) {
+    for( b2Fixture* f = b->m_fixtureList; f; f = f->m_next ) {
+      if( f->m_filter.layer == layerA || f->m_filter.layer == layerB )
+        f->Refilter();
+    }
+  }
+}
+
+bool b2World::GetLayerCollision( int32 layerA, int32 layerB ) const {
+  return m_contactManager.m_broadPhase.GetLayerCollision( layerA, layerB );
+}
+
 void b2World::ShiftOrigin( const b2Vec2& newOrigin ) {
   b2Assert( m_locked == false );
   if( m_locked )
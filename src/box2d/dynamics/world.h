@@ -30,7 +30,12 @@
 #include "box2d/common/time_step.h"
 #include "box2d/particle/particle_system.h"
 #include "contact_manager.h"
+#include "fixture.h"
 #include "world_callbacks.h"
+#include "world_snapshot.h"
+
+#include <atomic>
+#include <type_traits>
 
 struct b2AABB;
 struct b2BodyDef;
@@ -41,6 +46,8 @@ class b2Draw;
 class b2Fixture;
 class b2Joint;
 class b2ParticleGroup;
+class b2Shape;
+class b2SharedShape;
 
 /// The world class manages all physics entities, dynamic simulation,
 /// and asynchronous queries. The world also contains efficient memory
@@ -51,6 +58,12 @@ class B2_API b2World {
     /// @param gravity the world gravity vector.
     b2World( const b2Vec2& gravity );
 
+    /// Construct a world object with a choice of broad-phase structure.
+    /// @param gravity the world gravity vector.
+    /// @param broadPhaseType the structure that holds the fixture proxies.
+    /// @param gridCellSize the finest cell size of the hashed grid, about the size of the common objects.
+    b2World( const b2Vec2& gravity, b2BroadPhaseType broadPhaseType, float gridCellSize = 1.0f );
+
     /// Destruct the world. All physics entities are destroyed and all heap memory is released.
     ~b2World();
 
@@ -92,6 +105,16 @@ class B2_API b2World {
     /// @warning This function is locked during callbacks.
     void DestroyJoint( b2Joint* joint );
 
+    /// Create a shape that fixtures can share through b2FixtureDef::sharedShape. The
+    /// shape is cloned once here and the fixtures that use it take no copy.
+    /// @warning This function is locked during callbacks.
+    b2SharedShape* CreateSharedShape( const b2Shape* shape );
+
+    /// Release the world's hold on a shared shape. The shape stays alive until the
+    /// last fixture using it is destroyed. Call this once per shared shape.
+    /// @warning This function is locked during callbacks.
+    void DestroySharedShape( b2SharedShape* sharedShape );
+
     /// Create a particle system given a definition. No reference to the
     /// definition is retained.
     /// @warning This function is locked during callbacks.
@@ -104,7 +127,8 @@ class B2_API b2World {
     /// Take a time step. This performs collision detection, integration,
     /// and constraint solution.
     /// @param timeStep the amount of time to simulate, this should not vary.
-    /// @param velocityIterations for the velocity constraint solver.
+    /// @param velocityIterations for the velocity constraint solver. With adaptive iterations
+    /// an island may take fewer or more, see SetAdaptiveIterations.
     /// @param positionIterations for the position constraint solver.
     /// @param particleIterations for the particle simulation.
     void Step( float timeStep,
@@ -115,7 +139,8 @@ class B2_API b2World {
     /// Take a time step. This performs collision detection, integration,
     /// and constraint solution.
     /// @param timeStep the amount of time to simulate, this should not vary.
-    /// @param velocityIterations for the velocity constraint solver.
+    /// @param velocityIterations for the velocity constraint solver. With adaptive iterations
+    /// an island may take fewer or more, see SetAdaptiveIterations.
     /// @param positionIterations for the position constraint solver.
     void Step( float timeStep,
         int32 velocityIterations,
@@ -156,6 +181,54 @@ class B2_API b2World {
     /// @param point2 the ray ending point
     void RayCast( b2RayCastCallback* callback, const b2Vec2& point1, const b2Vec2& point2 ) const;
 
+    /// Query the world for all fixtures that potentially overlap the provided AABB,
+    /// calling fcn( b2Fixture* fixture ) for each. fcn may be any callable, such as a
+    /// lambda or a functor. It is called directly from the broad-phase traversal, so
+    /// it can be inlined. Return false from it to terminate the query. Particles are
+    /// not reported.
+    /// @param fcn the callable.
+    /// @param aabb the query box.
+    template <typename F, typename = typename std::enable_if<
+        !std::is_pointer<typename std::decay<F>::type>::value>::type>
+    void QueryAABB( F&& fcn, const b2AABB& aabb ) const;
+
+    /// Ray-cast the world for all fixtures in the path of the ray, calling
+    /// fcn( b2Fixture* fixture, const b2Vec2& point, const b2Vec2& normal, float fraction )
+    /// for each hit. fcn may be any callable and returns a float with the same meaning
+    /// as b2RayCastCallback::ReportFixture. Particles are not reported.
+    /// @param fcn the callable.
+    /// @param point1 the ray starting point
+    /// @param point2 the ray ending point
+    template <typename F, typename = typename std::enable_if<
+        !std::is_pointer<typename std::decay<F>::type>::value>::type>
+    void RayCast( F&& fcn, const b2Vec2& point1, const b2Vec2& point2 ) const;
+
+    /// Query the world for all fixtures that overlap a shape. Unlike QueryAABB this
+    /// tests the exact shapes, rejecting most candidates with bounding circle and
+    /// separating axis tests before falling back to GJK. Return false from the
+    /// callback to stop at the first hit. A fixture with several broad-phase proxies
+    /// is reported once per overlapping child. Particles are not tested.
+    /// @param callback a user implemented callback class.
+    /// @param shape the query shape: a circle, capsule, edge or polygon.
+    /// @param transform the transform of the query shape.
+    void QueryShape( b2QueryCallback* callback, const b2Shape* shape, const b2Transform& transform ) const;
+
+    /// Find any one fixture that overlaps a shape.
+    /// @return the first overlapping fixture found, or nullptr if there is none.
+    b2Fixture* QueryShape( const b2Shape* shape, const b2Transform& transform ) const;
+
+    /// Sweep a shape through the world and report the fixtures it hits. Candidates
+    /// are visited in the order the swept bounds reach them, so a callback that clips
+    /// to the closest hit ends the cast early. Your callback controls whether you get
+    /// the closest hit, any hit, or all hits, as with RayCast. Fixtures that already
+    /// overlap the shape at the start are not reported. Particles are not tested.
+    /// @param callback a user implemented callback class.
+    /// @param shape the shape to sweep: a circle, capsule, edge or polygon.
+    /// @param transform the starting transform of the shape.
+    /// @param translation the sweep translation.
+    void ShapeCast( b2ShapeCastCallback* callback, const b2Shape* shape, const b2Transform& transform,
+        const b2Vec2& translation ) const;
+
     /// Get the world body list. With the returned body, use b2Body::GetNext to get
     /// the next body in the world list. A nullptr body indicates the end of the list.
     /// @return the head of the world body list.
@@ -203,6 +276,38 @@ class B2_API b2World {
 
     bool GetSubStepping() const { return m_subStepping; }
 
+    /// Enable/disable solving revolute, weld, prismatic and distance joints in SIMD batches.
+    /// Off by default.
+    /// Batched joints are solved in a different order, so results differ slightly.
+    void SetJointBatching( bool flag ) { m_jointBatching = flag; }
+
+    bool GetJointBatching() const { return m_jointBatching; }
+
+    /// Enable/disable the direct solver for rigid revolute, weld and distance joints. Off by
+    /// default. Chains and trees of these joints are solved exactly in every velocity
+    /// iteration, so they do not stretch at low iteration counts. Joints that close a loop,
+    /// joints with a motor, limit or spring, and joints to kinematic bodies are still solved
+    /// iteratively.
+    void SetDirectJointSolver( bool flag ) { m_directJointSolver = flag; }
+
+    bool GetDirectJointSolver() const { return m_directJointSolver; }
+
+    /// Enable/disable adaptive velocity iterations. Off by default. An island stops iterating
+    /// once an iteration barely changes its velocities, so small and resting islands take
+    /// fewer than the velocity iterations passed to Step. An island that is still changing
+    /// keeps iterating up to the maximum set below. The iterations taken in the last step
+    /// are reported in the profile.
+    void SetAdaptiveIterations( bool flag ) { m_adaptiveIterations = flag; }
+
+    bool GetAdaptiveIterations() const { return m_adaptiveIterations; }
+
+    /// Set the most velocity iterations an island may take with adaptive iterations. Values
+    /// below the velocity iterations passed to Step, including the default of zero, mean no
+    /// extra iterations.
+    void SetMaxVelocityIterations( int32 iterations ) { m_maxVelocityIterations = iterations; }
+
+    int32 GetMaxVelocityIterations() const { return m_maxVelocityIterations; }
+
     /// Get the number of broad-phase proxies.
     int32 GetProxyCount() const;
 
@@ -225,6 +330,48 @@ class B2_API b2World {
     /// The minimum is 1.
     float GetTreeQuality() const;
 
+    /// Reorder the dynamic tree nodes depth-first so that queries touch fewer
+    /// cache lines. Useful after many bodies have been created, destroyed or moved.
+    /// @warning This function is locked during callbacks.
+    void CompactTree();
+
+    /// Keep the proxies of static bodies in a quantized tree. The static bodies
+    /// already in the world are moved over. Static proxies then cost about half
+    /// the memory and never test against each other.
+    /// @warning This function is locked during callbacks.
+    void SetStaticTreeCompression( bool flag );
+
+    /// Are static proxies kept in the quantized tree?
+    bool GetStaticTreeCompression() const;
+
+    /// Enable or disable collision between two collision layers (see b2Filter::layer).
+    /// Fixtures on layers that don't collide are never paired by the broad-phase.
+    /// All layers collide by default.
+    /// @warning This function is locked during callbacks.
+    void SetLayerCollision( int32 layerA, int32 layerB, bool flag );
+
+    /// Do fixtures on these collision layers collide?
+    bool GetLayerCollision( int32 layerA, int32 layerB ) const;
+
+    /// Publish a read-only snapshot of the broad-phase at the end of every step, for
+    /// queries from other threads. Two snapshots are kept: one that readers hold and
+    /// one the next step writes. If a reader still holds the older snapshot when a
+    /// step ends, that step is not published and readers keep the previous one.
+    /// @warning This must not be called while another thread holds a snapshot.
+    void SetSnapshotsEnabled( bool flag );
+
+    /// Are snapshots published after each step?
+    bool GetSnapshotsEnabled() const;
+
+    /// Take the latest published snapshot. This is lock-free and may be called from
+    /// any thread, also while the world steps. The snapshot stays valid and unchanged
+    /// until it is given back with ReleaseSnapshot. See b2WorldSnapshotReader.
+    /// @return the snapshot, or nullptr if none has been published.
+    const b2WorldSnapshot* AcquireSnapshot() const;
+
+    /// Give back a snapshot taken with AcquireSnapshot.
+    void ReleaseSnapshot( const b2WorldSnapshot* snapshot ) const;
+
     /// Change the global gravity vector.
     void SetGravity( const b2Vec2& gravity );
 
@@ -274,13 +421,16 @@ class B2_API b2World {
     void Solve( const b2TimeStep& step );
     void SolveTOI( const b2TimeStep& step );
 
+    void PublishSnapshot();
+
     void DrawJoint( b2Joint* joint );
-    void DrawShape( b2Fixture* shape, const b2Transform& xf, const b2Color& color );
+    void DrawShape( const b2Shape* shape, const b2Transform& xf, const b2Color& color );
     void DrawParticleSystem( const b2ParticleSystem& system );
 
     b2Body* m_bodyList;
     b2Joint* m_jointList;
     b2ParticleSystem* m_particleSystemList;
+    b2SharedShape* m_sharedShapeList;
 
     int32 m_bodyCount;
     int32 m_jointCount;
@@ -295,6 +445,10 @@ class B2_API b2World {
     float m_inv_dt0;
 
     bool m_newContacts;
+
+    // The joint graph changed since the joints were last colored for batching.
+    bool m_newJoints;
+
     bool m_locked;
     bool m_clearForces;
 
@@ -302,9 +456,19 @@ class B2_API b2World {
     bool m_warmStarting;
     bool m_continuousPhysics;
     bool m_subStepping;
+    bool m_jointBatching;
+    bool m_directJointSolver;
+    bool m_adaptiveIterations;
+    int32 m_maxVelocityIterations;
 
     bool m_stepComplete;
 
+    // Double-buffered broad-phase snapshots, null unless enabled. Readers take the
+    // published one, the other is rewritten by the next step.
+    b2WorldSnapshot* m_snapshots [ 2 ];
+    std::atomic< b2WorldSnapshot* > m_publishedSnapshot;
+    uint32 m_stepCount;
+
     b2Profile m_profile;
 };
 
@@ -381,4 +545,63 @@ inline const b2Profile& b2World::GetProfile() const {
   return m_profile;
 }
 
+// Adapts a callable to b2BroadPhase::Query for b2World::QueryAABB.
+template <typename F>
+struct b2WorldQueryFcnWrapper {
+    bool QueryCallback( int32 proxyId ) {
+      b2FixtureProxy* proxy = (b2FixtureProxy*) broadPhase->GetUserData( proxyId );
+      return ( *fcn )( proxy->fixture );
+    }
+
+    const b2BroadPhase* broadPhase;
+    F* fcn;
+};
+
+// Adapts a callable to b2BroadPhase::RayCast for b2World::RayCast.
+template <typename F>
+struct b2WorldRayCastFcnWrapper {
+    float RayCastCallback( const b2RayCastInput& input, int32 proxyId ) {
+      b2FixtureProxy* proxy = (b2FixtureProxy*) broadPhase->GetUserData( proxyId );
+      b2Fixture* fixture = proxy->fixture;
+      int32 index = proxy->childIndex;
+      b2RayCastOutput output;
+      bool hit;
+      if( fixture->GetShape()->SharesProxy() )
+        hit = fixture->GetShape()->RayCastChildren( &output, &index, input, fixture->GetBody()->GetTransform() );
+      else
+        hit = fixture->RayCast( &output, input, index );
+
+      if( hit ) {
+        float fraction = output.fraction;
+        b2Vec2 point = ( 1.0f - fraction ) * input.p1 + fraction * input.p2;
+        return ( *fcn )( fixture, point, output.normal, fraction );
+      }
+
+      return input.maxFraction;
+    }
+
+    const b2BroadPhase* broadPhase;
+    F* fcn;
+};
+
+template <typename F, typename>
+inline void b2World::QueryAABB( F&& fcn, const b2AABB& aabb ) const {
+  b2WorldQueryFcnWrapper< typename std::remove_reference<F>::type > wrapper;
+  wrapper.broadPhase = &m_contactManager.m_broadPhase;
+  wrapper.fcn = &fcn;
+  m_contactManager.m_broadPhase.Query( &wrapper, aabb );
+}
+
+template <typename F, typename>
+inline void b2World::RayCast( F&& fcn, const b2Vec2& point1, const b2Vec2& point2 ) const {
+  b2WorldRayCastFcnWrapper< typename std::remove_reference<F>::type > wrapper;
+  wrapper.broadPhase = &m_contactManager.m_broadPhase;
+  wrapper.fcn = &fcn;
+  b2RayCastInput input;
+  input.maxFraction = 1.0f;
+  input.p1 = point1;
+  input.p2 = point2;
+  m_contactManager.m_broadPhase.RayCast( &wrapper, input );
+}
+
 #endif
@@ -281,4 +281,35 @@ class B2_API b2RayCastCallback {
     }
 };
 
+/// Callback class for shape casts.
+/// See b2World::ShapeCast
+class B2_API b2ShapeCastCallback {
+  public:
+    virtual ~b2ShapeCastCallback() {}
+
+    /// Called for each fixture whose bounds the swept shape may touch, before
+    /// the exact cast is run.
+    /// @return false to skip this fixture.
+    virtual bool ShouldCastFixture( b2Fixture* fixture ) {
+      B2_NOT_USED( fixture );
+      return true;
+    }
+
+    /// Called for each fixture hit by the shape. The return value works as in
+    /// b2RayCastCallback::ReportFixture:
+    /// return -1: ignore this fixture and continue
+    /// return 0: terminate the shape cast
+    /// return fraction: clip the translation to this point
+    /// return 1: don't clip the translation and continue
+    /// @param fixture the fixture hit by the shape
+    /// @param childIndex the child of the fixture's shape that was hit
+    /// @param point the point of first contact
+    /// @param normal the surface normal of the fixture at the point
+    /// @param fraction the fraction of the translation at the point of contact
+    /// @return -1 to filter, 0 to terminate, fraction to clip the cast for
+    /// closest hit, 1 to continue
+    virtual float ReportFixture( b2Fixture* fixture, int32 childIndex, const b2Vec2& point,
+        const b2Vec2& normal, float fraction ) = 0;
+};
+
 #endif
@@ -0,0 +1,225 @@
+// MIT License
+
+// Copyright (c) 2019 Erin Catto
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include "world_snapshot.h"
+
+#include "body.h"
+#include "box2d/collision/distance.h"
+#include "box2d/collision/shapes/shape.h"
+#include "world.h"
+
+b2WorldSnapshot::b2WorldSnapshot() {
+  m_fixtureCapacity = 16;
+  m_fixtureCount = 0;
+  m_fixtures = (b2SnapshotFixture*) b2Alloc( m_fixtureCapacity * sizeof( b2SnapshotFixture ) );
+  m_stepCount = 0;
+  m_readers = 0;
+}
+
+b2WorldSnapshot::~b2WorldSnapshot() {
+  b2Free( m_fixtures );
+}
+
+void b2WorldSnapshot::Capture( const b2World* world, uint32 stepCount ) {
+  m_fixtureCount = 0;
+  for( const b2Body* b = world->GetBodyList(); b; b = b->GetNext() ) {
+    if( b->IsEnabled() == false )
+      continue;
+
+    for( const b2Fixture* f = b->GetFixtureList(); f; f = f->GetNext() ) {
+      const b2Shape* shape = f->GetShape();
+      int32 proxyCount = shape->GetProxyCount();
+      for( int32 i = 0; i < proxyCount; ++i ) {
+        if( m_fixtureCount == m_fixtureCapacity ) {
+          b2SnapshotFixture* old = m_fixtures;
+          m_fixtureCapacity *= 2;
+          m_fixtures = (b2SnapshotFixture*) b2Alloc( m_fixtureCapacity * sizeof( b2SnapshotFixture ) );
+          memcpy( m_fixtures, old, m_fixtureCount * sizeof( b2SnapshotFixture ) );
+          b2Free( old );
+        }
+
+        b2SnapshotFixture* entry = m_fixtures + m_fixtureCount;
+        entry->fixture = const_cast< b2Fixture* >( f );
+        entry->body = const_cast< b2Body* >( b );
+        entry->shape = shape;
+        entry->childIndex = i;
+        entry->transform = b->GetTransform();
+        entry->aabb = f->GetAABB( i );
+        entry->filter = f->GetFilterData();
+        entry->userData = f->GetUserData();
+        entry->isSensor = f->IsSensor();
+        ++m_fixtureCount;
+      }
+    }
+  }
+
+  // The entries no longer move, so the tree can point at them.
+  m_tree.Clear();
+  for( int32 i = 0; i < m_fixtureCount; ++i )
+    m_tree.CreateProxy( m_fixtures [ i ].aabb, m_fixtures + i );
+  m_tree.Rebuild();
+
+  m_stepCount = stepCount;
+}
+
+struct b2SnapshotQueryWrapper {
+    bool QueryCallback( int32 proxyId ) {
+      const b2SnapshotFixture* entry = (const b2SnapshotFixture*) tree->GetUserData( proxyId );
+      if( b2TestOverlap( entry->aabb, aabb ) == false )
+        return true;
+      return callback->ReportFixture( *entry );
+    }
+
+    const b2QuantizedTree* tree;
+    b2SnapshotQueryCallback* callback;
+    b2AABB aabb;
+};
+
+void b2WorldSnapshot::QueryAABB( b2SnapshotQueryCallback* callback, const b2AABB& aabb ) const {
+  b2SnapshotQueryWrapper wrapper;
+  wrapper.tree = &m_tree;
+  wrapper.callback = callback;
+  wrapper.aabb = aabb;
+  m_tree.Query( &wrapper, aabb );
+}
+
+struct b2SnapshotRayCastWrapper {
+    float RayCastCallback( const b2RayCastInput& input, int32 proxyId ) {
+      const b2SnapshotFixture* entry = (const b2SnapshotFixture*) tree->GetUserData( proxyId );
+      int32 index = entry->childIndex;
+      b2RayCastOutput output;
+      bool hit;
+      if( entry->shape->SharesProxy() )
+        hit = entry->shape->RayCastChildren( &output, &index, input, entry->transform );
+      else
+        hit = entry->shape->RayCast( &output, input, entry->transform, index );
+
+      if( hit ) {
+        float fraction = output.fraction;
+        b2Vec2 point = ( 1.0f - fraction ) * input.p1 + fraction * input.p2;
+        return callback->ReportFixture( *entry, index, point, output.normal, fraction );
+      }
+
+      return input.maxFraction;
+    }
+
+    const b2QuantizedTree* tree;
+    b2SnapshotRayCastCallback* callback;
+};
+
+void b2WorldSnapshot::RayCast( b2SnapshotRayCastCallback* callback, const b2Vec2& point1,
+    const b2Vec2& point2 ) const {
+  b2SnapshotRayCastWrapper wrapper;
+  wrapper.tree = &m_tree;
+  wrapper.callback = callback;
+  b2RayCastInput input;
+  input.maxFraction = 1.0f;
+  input.p1 = point1;
+  input.p2 = point2;
+  m_tree.RayCast( &wrapper, input );
+}
+
+// The same as b2TestOverlap without touching the GJK counters, which Step updates
+// while readers query the snapshot.
+static bool b2SnapshotTestOverlap( const b2Shape* shapeA, int32 indexA, const b2Shape* shapeB, int32 indexB,
+    const b2Transform& xfA, const b2Transform& xfB ) {
+  b2DistanceInput input;
+  input.proxyA.Set( shapeA, indexA );
+  input.proxyB.Set( shapeB, indexB );
+  input.transformA = xfA;
+  input.transformB = xfB;
+  input.useRadii = true;
+
+  b2SimplexCache cache;
+  cache.count = 0;
+  b2DistanceOutput output;
+  b2DistanceUncounted( &output, &cache, &input );
+  return output.distance < 10.0f * b2_epsilon;
+}
+
+// Finds the first child of a shared-proxy shape that overlaps the query shape.
+class b2SnapshotChildOverlap : public b2ShapeChildCallback {
+  public:
+    bool ReportChild( int32 childIndex ) override {
+      overlap = b2SnapshotTestOverlap( shape, 0, entry->shape, childIndex, *transform, entry->transform );
+      return overlap == false;
+    }
+
+    const b2Shape* shape;
+    const b2Transform* transform;
+    const b2SnapshotFixture* entry;
+    bool overlap = false;
+};
+
+struct b2SnapshotShapeQueryWrapper {
+    bool QueryCallback( int32 proxyId ) {
+      const b2SnapshotFixture* entry = (const b2SnapshotFixture*) tree->GetUserData( proxyId );
+      if( b2TestOverlap( entry->aabb, aabb ) == false )
+        return true;
+
+      bool overlap;
+      if( entry->shape->SharesProxy() ) {
+        b2SnapshotChildOverlap children;
+        children.shape = shape;
+        children.transform = transform;
+        children.entry = entry;
+        entry->shape->QueryChildren( &children, b2MulT( entry->transform, aabb ) );
+        overlap = children.overlap;
+      } else {
+        overlap = b2SnapshotTestOverlap( shape, 0, entry->shape, entry->childIndex, *transform, entry->transform );
+      }
+
+      if( overlap == false )
+        return true;
+      return callback->ReportFixture( *entry );
+    }
+
+    const b2QuantizedTree* tree;
+    b2SnapshotQueryCallback* callback;
+    const b2Shape* shape;
+    const b2Transform* transform;
+    b2AABB aabb;
+};
+
+void b2WorldSnapshot::QueryShape( b2SnapshotQueryCallback* callback, const b2Shape* shape,
+    const b2Transform& transform ) const {
+  b2Assert( shape->GetChildCount() == 1 );
+
+  b2SnapshotShapeQueryWrapper wrapper;
+  wrapper.tree = &m_tree;
+  wrapper.callback = callback;
+  wrapper.shape = shape;
+  wrapper.transform = &transform;
+  shape->ComputeAABB( &wrapper.aabb, transform, 0 );
+  m_tree.Query( &wrapper, wrapper.aabb );
+}
+
+b2WorldSnapshotReader::b2WorldSnapshotReader( const b2World* world ) {
+  m_world = world;
+  m_snapshot = world->AcquireSnapshot();
+}
+
+b2WorldSnapshotReader::~b2WorldSnapshotReader() {
+  if( m_snapshot )
+    m_world->ReleaseSnapshot( m_snapshot );
+}
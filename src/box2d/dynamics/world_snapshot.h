@@ -0,0 +1,178 @@
+// MIT License
+
+// Copyright (c) 2019 Erin Catto
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#ifndef B2_WORLD_SNAPSHOT_H
+#define B2_WORLD_SNAPSHOT_H
+
+#include "box2d/api.h"
+#include "box2d/collision/collision.h"
+#include "box2d/collision/quantized_tree.h"
+#include "box2d/common/math.h"
+#include "fixture.h"
+
+#include <atomic>
+
+class b2Shape;
+class b2World;
+
+/// A fixture proxy as it was at the end of a time step. Everything here is a copy,
+/// so it can be read while the world steps. The fixture and body pointers identify
+/// the objects, but their members must not be read from another thread while the
+/// world is stepping.
+struct B2_API b2SnapshotFixture {
+    b2Fixture* fixture;
+    b2Body* body;
+
+    /// The fixture's shape. Shapes do not change during a step.
+    const b2Shape* shape;
+
+    /// The child of the shape covered by this proxy. This is 0 for shapes whose
+    /// children share one proxy.
+    int32 childIndex;
+
+    /// The body transform at the end of the step.
+    b2Transform transform;
+
+    /// The tight AABB of the proxy.
+    b2AABB aabb;
+
+    b2Filter filter;
+    b2FixtureUserData userData;
+    bool isSensor;
+};
+
+/// Callback class for AABB and shape queries on a snapshot.
+class B2_API b2SnapshotQueryCallback {
+  public:
+    virtual ~b2SnapshotQueryCallback() {}
+
+    /// Called for each fixture found in the query.
+    /// @return false to terminate the query.
+    virtual bool ReportFixture( const b2SnapshotFixture& fixture ) = 0;
+};
+
+/// Callback class for ray casts on a snapshot. The return value works as in
+/// b2RayCastCallback::ReportFixture.
+class B2_API b2SnapshotRayCastCallback {
+  public:
+    virtual ~b2SnapshotRayCastCallback() {}
+
+    /// Called for each fixture hit by the ray.
+    /// @param fixture the fixture hit by the ray
+    /// @param childIndex the child of the fixture's shape that was hit
+    /// @param point the point of initial intersection
+    /// @param normal the normal vector at the point of intersection
+    /// @param fraction the fraction along the ray at the point of intersection
+    /// @return -1 to filter, 0 to terminate, fraction to clip the ray for
+    /// closest hit, 1 to continue
+    virtual float ReportFixture( const b2SnapshotFixture& fixture, int32 childIndex,
+        const b2Vec2& point, const b2Vec2& normal, float fraction ) = 0;
+};
+
+/// A read-only copy of the world's broad-phase taken at the end of a time step.
+/// The world keeps two of these and publishes one after each step (see
+/// b2World::SetSnapshotsEnabled). Any number of threads may query a snapshot they
+/// hold, without locks, while the world steps. All queries see the transforms of
+/// the same completed step.
+/// @warning Fixtures and shared shapes must not be destroyed while another thread
+/// may still hold a snapshot that contains them.
+class B2_API b2WorldSnapshot {
+  public:
+    b2WorldSnapshot();
+    ~b2WorldSnapshot();
+
+    /// The number of world steps completed when this snapshot was taken.
+    uint32 GetStepCount() const;
+
+    /// Get the number of fixture proxies in the snapshot.
+    int32 GetFixtureCount() const;
+
+    /// Get a fixture proxy by index.
+    const b2SnapshotFixture& GetFixture( int32 index ) const;
+
+    /// Query for all fixtures whose AABBs potentially overlap the box.
+    void QueryAABB( b2SnapshotQueryCallback* callback, const b2AABB& aabb ) const;
+
+    /// Ray-cast against the fixtures in the snapshot. See b2World::RayCast.
+    void RayCast( b2SnapshotRayCastCallback* callback, const b2Vec2& point1, const b2Vec2& point2 ) const;
+
+    /// Query for all fixtures that overlap a shape exactly. See b2World::QueryShape.
+    void QueryShape( b2SnapshotQueryCallback* callback, const b2Shape* shape, const b2Transform& transform ) const;
+
+  private:
+    friend class b2World;
+
+    b2WorldSnapshot( const b2WorldSnapshot& ) = delete;
+    void operator=( const b2WorldSnapshot& ) = delete;
+
+    /// Copy the proxies of the world and rebuild the tree.
+    void Capture( const b2World* world, uint32 stepCount );
+
+    b2QuantizedTree m_tree;
+    b2SnapshotFixture* m_fixtures;
+    int32 m_fixtureCount;
+    int32 m_fixtureCapacity;
+    uint32 m_stepCount;
+
+    // Threads currently holding this snapshot.
+    mutable std::atomic< int32 > m_readers;
+};
+
+/// Holds the latest snapshot of a world for the lifetime of the reader. A reader
+/// never blocks and never blocks the world. The snapshot may be null if none has
+/// been published yet.
+class B2_API b2WorldSnapshotReader {
+  public:
+    explicit b2WorldSnapshotReader( const b2World* world );
+    ~b2WorldSnapshotReader();
+
+    const b2WorldSnapshot* Get() const {
+      return m_snapshot;
+    }
+
+    const b2WorldSnapshot* operator->() const {
+      return m_snapshot;
+    }
+
+  private:
+    b2WorldSnapshotReader( const b2WorldSnapshotReader& ) = delete;
+    void operator=( const b2WorldSnapshotReader& ) = delete;
+
+    const b2World* m_world;
+    const b2WorldSnapshot* m_snapshot;
+};
+
+inline uint32 b2WorldSnapshot::GetStepCount() const {
+  return m_stepCount;
+}
+
+inline int32 b2WorldSnapshot::GetFixtureCount() const {
+  return m_fixtureCount;
+}
+
+inline const b2SnapshotFixture& b2WorldSnapshot::GetFixture( int32 index ) const {
+  b2Assert( 0 <= index && index < m_fixtureCount );
+  return m_fixtures [ index ];
+}
+
+#endif
@@ -838,6 +838,7 @@ void b2ParticleSystem::CreateParticlesWithShapeForGroup(
       break;
     case b2Shape::e_polygon:
     case b2Shape::e_circle:
+    case b2Shape::e_capsule:
       CreateParticlesFillShapeForGroup( shape, groupDef, xf );
       break;
     default:
@@ -2142,43 +2143,90 @@ int32 b2ParticlePairSet::Find( const ParticlePair& pair ) const {
 }
 
 /// Callback class to receive pairs of fixtures and particles which may be
-/// overlapping. Used as an argument of b2World::QueryAABB.
-class b2FixtureParticleQueryCallback : public b2QueryCallback {
+/// overlapping. A functor for the template b2World::QueryAABB, so that the
+/// broad-phase traversal calls it without virtual dispatch.
+class b2FixtureParticleQueryCallback {
   public:
     explicit b2FixtureParticleQueryCallback( b2ParticleSystem* system ) {
       m_system = system;
     }
 
-  private:
-    // Skip reporting particles.
-    bool ShouldQueryParticleSystem( const b2ParticleSystem* system ) {
-      B2_NOT_USED( system );
-      return false;
-    }
+    virtual ~b2FixtureParticleQueryCallback() {}
 
-    // Receive a fixture and call ReportFixtureAndParticle() for each particle
-    // inside aabb of the fixture.
-    bool ReportFixture( b2Fixture* fixture ) {
+    // Receive a fixture and call ReportFixtureAndParticles() for the particles
+    // inside aabb of the fixture, a batch at a time.
+    bool operator()( b2Fixture* fixture ) {
       if( fixture->IsSensor() )
         return true;
       const b2Shape* shape = fixture->GetShape();
+      if( shape->SharesProxy() ) {
+        ReportSharedFixture( fixture );
+        return true;
+      }
       int32 childCount = shape->GetChildCount();
       for( int32 childIndex = 0; childIndex < childCount; childIndex++ ) {
         b2AABB aabb = fixture->GetAABB( childIndex );
         b2ParticleSystem::InsideBoundsEnumerator enumerator =
             m_system->GetInsideBoundsEnumerator( aabb );
+        int32 indices [ k_batchSize ];
+        int32 count = 0;
         int32 index;
-        while( ( index = enumerator.GetNext() ) >= 0 )
-          ReportFixtureAndParticle( fixture, childIndex, index );
+        while( ( index = enumerator.GetNext() ) >= 0 ) {
+          indices [ count++ ] = index;
+          if( count == k_batchSize ) {
+            ReportFixtureAndParticles( fixture, childIndex, indices, count );
+            count = 0;
+          }
+        }
+        if( count > 0 )
+          ReportFixtureAndParticles( fixture, childIndex, indices, count );
       }
       return true;
     }
 
-    // Receive a fixture and a particle which may be overlapping.
-    virtual void ReportFixtureAndParticle(
-        b2Fixture* fixture, int32 childIndex, int32 index ) = 0;
+  private:
+    // The children of a shared proxy are looked up around each particle in the
+    // proxy, so that only the nearby cells or edges are reported.
+    void ReportSharedFixture( b2Fixture* fixture ) {
+      class ChildCallback : public b2ShapeChildCallback {
+        public:
+          bool ReportChild( int32 childIndex ) override {
+            m_query->ReportFixtureAndParticles( m_fixture, childIndex, &m_index, 1 );
+            return true;
+          }
+
+          b2FixtureParticleQueryCallback* m_query;
+          b2Fixture* m_fixture;
+          int32 m_index;
+      } callback;
+      callback.m_query = this;
+      callback.m_fixture = fixture;
+
+      const b2Transform& xf = fixture->GetBody()->GetTransform();
+      b2Vec2 extents( m_system->m_particleDiameter, m_system->m_particleDiameter );
+      b2ParticleSystem::InsideBoundsEnumerator enumerator =
+          m_system->GetInsideBoundsEnumerator( fixture->GetAABB( 0 ) );
+      int32 index;
+      while( ( index = enumerator.GetNext() ) >= 0 ) {
+        b2Vec2 p = b2MulT( xf, m_system->m_positionBuffer.data [ index ] );
+        b2AABB aabb;
+        aabb.lowerBound = p - extents;
+        aabb.upperBound = p + extents;
+        callback.m_index = index;
+        fixture->GetShape()->QueryChildren( &callback, aabb );
+      }
+    }
+
+    // Receive a fixture and up to k_batchSize particles which may be
+    // overlapping it.
+    virtual void ReportFixtureAndParticles(
+        b2Fixture* fixture, int32 childIndex, const int32* indices, int32 count ) = 0;
 
   protected:
+    // The most particles passed to ReportFixtureAndParticles at once. The
+    // batch queries on the shape test these together.
+    static const int32 k_batchSize = 64;
+
     b2ParticleSystem* m_system;
 };
 
@@ -2269,38 +2317,47 @@ void b2ParticleSystem::UpdateBodyContacts() {
         return true;
       }
 
-      void ReportFixtureAndParticle(
-          b2Fixture* fixture, int32 childIndex, int32 a ) {
-        b2Vec2 ap = m_system->m_positionBuffer.data [ a ];
-        float d;
-        b2Vec2 n;
-        fixture->ComputeDistance( ap, &d, &n, childIndex );
-        if( d < m_system->m_particleDiameter && ShouldCollide( fixture, a ) ) {
-          b2Body* b = fixture->GetBody();
-          b2Vec2 bp = b->GetWorldCenter();
-          float bm = b->GetMass();
-          float bI =
-              b->GetInertia() - bm * b->GetLocalCenter().LengthSquared();
-          float invBm = bm > 0 ? 1 / bm : 0;
-          float invBI = bI > 0 ? 1 / bI : 0;
-          float invAm =
-              m_system->m_flagsBuffer.data [ a ] &
-                      b2_wallParticle
-                  ? 0
-                  : m_system->GetParticleInvMass();
-          b2Vec2 rp = ap - bp;
-          float rpn = b2Cross( rp, n );
-          float invM = invAm + invBm + invBI * rpn * rpn;
-
-          b2ParticleBodyContact& contact =
-              m_system->m_bodyContactBuffer.Append();
-          contact.index = a;
-          contact.body = b;
-          contact.fixture = fixture;
-          contact.weight = 1 - d * m_system->m_inverseDiameter;
-          contact.normal = -n;
-          contact.mass = invM > 0 ? 1 / invM : 0;
-          m_system->DetectStuckParticle( a );
+      void ReportFixtureAndParticles(
+          b2Fixture* fixture, int32 childIndex, const int32* indices, int32 count ) {
+        b2Vec2 points [ k_batchSize ];
+        float distances [ k_batchSize ];
+        b2Vec2 normals [ k_batchSize ];
+        for( int32 i = 0; i < count; ++i )
+          points [ i ] = m_system->m_positionBuffer.data [ indices [ i ] ];
+        fixture->ComputeDistances( points, count, distances, normals, childIndex );
+
+        for( int32 i = 0; i < count; ++i ) {
+          int32 a = indices [ i ];
+          b2Vec2 ap = points [ i ];
+          float d = distances [ i ];
+          b2Vec2 n = normals [ i ];
+          if( d < m_system->m_particleDiameter && ShouldCollide( fixture, a ) ) {
+            b2Body* b = fixture->GetBody();
+            b2Vec2 bp = b->GetWorldCenter();
+            float bm = b->GetMass();
+            float bI =
+                b->GetInertia() - bm * b->GetLocalCenter().LengthSquared();
+            float invBm = bm > 0 ? 1 / bm : 0;
+            float invBI = bI > 0 ? 1 / bI : 0;
+            float invAm =
+                m_system->m_flagsBuffer.data [ a ] &
+                        b2_wallParticle
+                    ? 0
+                    : m_system->GetParticleInvMass();
+            b2Vec2 rp = ap - bp;
+            float rpn = b2Cross( rp, n );
+            float invM = invAm + invBm + invBI * rpn * rpn;
+
+            b2ParticleBodyContact& contact =
+                m_system->m_bodyContactBuffer.Append();
+            contact.index = a;
+            contact.body = b;
+            contact.fixture = fixture;
+            contact.weight = 1 - d * m_system->m_inverseDiameter;
+            contact.normal = -n;
+            contact.mass = invM > 0 ? 1 / invM : 0;
+            m_system->DetectStuckParticle( a );
+          }
         }
       }
 
@@ -2316,7 +2373,7 @@ void b2ParticleSystem::UpdateBodyContacts() {
 
   b2AABB aabb;
   ComputeAABB( &aabb );
-  m_world->QueryAABB( &callback, aabb );
+  m_world->QueryAABB( callback, aabb );
 
   if( m_def.strictContactCheck )
     RemoveSpuriousBodyContacts();
@@ -2395,18 +2452,24 @@ void b2ParticleSystem::SolveCollision( const b2TimeStep& step ) {
         return true;
       }
 
-      void ReportFixtureAndParticle(
-          b2Fixture* fixture, int32 childIndex, int32 a ) {
-        if( ShouldCollide( fixture, a ) ) {
-          b2Body* body = fixture->GetBody();
+      void ReportFixtureAndParticles(
+          b2Fixture* fixture, int32 childIndex, const int32* indices, int32 count ) {
+        b2Body* body = fixture->GetBody();
+        bool isCircle = fixture->GetShape()->GetType() == b2Shape::e_circle;
+        int32 particles [ k_batchSize ];
+        b2RayCastInput inputs [ k_batchSize ];
+        int32 rayCount = 0;
+        for( int32 i = 0; i < count; ++i ) {
+          int32 a = indices [ i ];
+          if( ShouldCollide( fixture, a ) == false )
+            continue;
           b2Vec2 ap = m_system->m_positionBuffer.data [ a ];
           b2Vec2 av = m_system->m_velocityBuffer.data [ a ];
-          b2RayCastOutput output;
-          b2RayCastInput input;
+          b2RayCastInput& input = inputs [ rayCount ];
           if( m_system->m_iterationIndex == 0 ) {
             // Put 'ap' in the local space of the previous frame
             b2Vec2 p1 = b2MulT( body->m_xf0, ap );
-            if( fixture->GetShape()->GetType() == b2Shape::e_circle ) {
+            if( isCircle ) {
               // Make relative to the center of the circle
               p1 -= body->GetLocalCenter();
               // Re-apply rotation about the center of the
@@ -2424,18 +2487,32 @@ void b2ParticleSystem::SolveCollision( const b2TimeStep& step ) {
           }
           input.p2 = ap + m_step.dt * av;
           input.maxFraction = 1;
-          if( fixture->RayCast( &output, input, childIndex ) ) {
-            b2Vec2 n = output.normal;
-            b2Vec2 p =
-                ( 1 - output.fraction ) * input.p1 +
-                output.fraction * input.p2 +
-                b2_linearSlop * n;
-            b2Vec2 v = m_step.inv_dt * ( p - ap );
-            m_system->m_velocityBuffer.data [ a ] = v;
-            b2Vec2 f = m_step.inv_dt *
-                       m_system->GetParticleMass() * ( av - v );
-            m_system->ParticleApplyForce( a, f );
-          }
+          particles [ rayCount++ ] = a;
+        }
+
+        b2RayCastOutput outputs [ k_batchSize ];
+        bool hits [ k_batchSize ];
+        if( rayCount == 0 || fixture->RayCasts( outputs, hits, inputs, rayCount, childIndex ) == 0 )
+          return;
+
+        for( int32 i = 0; i < rayCount; ++i ) {
+          if( hits [ i ] == false )
+            continue;
+          int32 a = particles [ i ];
+          const b2RayCastInput& input = inputs [ i ];
+          const b2RayCastOutput& output = outputs [ i ];
+          b2Vec2 ap = m_system->m_positionBuffer.data [ a ];
+          b2Vec2 av = m_system->m_velocityBuffer.data [ a ];
+          b2Vec2 n = output.normal;
+          b2Vec2 p =
+              ( 1 - output.fraction ) * input.p1 +
+              output.fraction * input.p2 +
+              b2_linearSlop * n;
+          b2Vec2 v = m_step.inv_dt * ( p - ap );
+          m_system->m_velocityBuffer.data [ a ] = v;
+          b2Vec2 f = m_step.inv_dt *
+                     m_system->GetParticleMass() * ( av - v );
+          m_system->ParticleApplyForce( a, f );
         }
       }
 
@@ -2451,7 +2528,7 @@ void b2ParticleSystem::SolveCollision( const b2TimeStep& step ) {
       }
   } callback( this, step, GetFixtureContactFilter() );
 
-  m_world->QueryAABB( &callback, aabb );
+  m_world->QueryAABB( callback, aabb );
 }
 
 void b2ParticleSystem::SolveBarrier( const b2TimeStep& step ) {
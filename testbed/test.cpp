@@ -401,6 +401,8 @@ void Test::Step( Settings& settings ) {
     m_textLine += m_textIncrement;
     g_debugDraw.DrawString( 5, m_textLine, "broad-phase [ave] (max) = %5.2f [%6.2f] (%6.2f)", p.broadphase, aveProfile.broadphase, m_maxProfile.broadphase );
     m_textLine += m_textIncrement;
+    g_debugDraw.DrawString( 5, m_textLine, "velocity islands/iterations/max = %d/%d/%d", p.velocityIslands, p.velocityIterations, p.maxVelocityIterations );
+    m_textLine += m_textIncrement;
   }
 
   if( m_bombSpawning ) {
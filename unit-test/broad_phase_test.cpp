@@ -0,0 +1,610 @@
+// MIT License
+
+// Copyright (c) 2020 Erin Catto
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include "box2d/box2d.h"
+#include "doctest.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+namespace
+{
+
+struct TreeQuery
+{
+	bool QueryCallback(int32 proxyId)
+	{
+		hits[proxyId] = true;
+		++hitCount;
+		return true;
+	}
+
+	bool hits[512];
+	int32 hitCount;
+};
+
+struct RayCastCounter
+{
+	float RayCastCallback(const b2RayCastInput& input, int32 proxyId)
+	{
+		B2_NOT_USED(input);
+		hits[proxyId] = true;
+		++hitCount;
+		return input.maxFraction;
+	}
+
+	bool hits[512];
+	int32 hitCount;
+};
+
+struct BroadPhaseQuery
+{
+	bool QueryCallback(int32 proxyId)
+	{
+		CHECK(broadPhase->GetUserData(proxyId) != nullptr);
+		++hitCount;
+		return true;
+	}
+
+	b2BroadPhase* broadPhase;
+	int32 hitCount;
+};
+
+struct PairCollector
+{
+	void AddPair(void* userDataA, void* userDataB)
+	{
+		int32 a = *(int32*)userDataA;
+		int32 b = *(int32*)userDataB;
+		if (a > b)
+		{
+			b2Swap(a, b);
+		}
+
+		++pairs[a][b];
+		++pairCount;
+	}
+
+	int32 pairs[128][128];
+	int32 pairCount;
+};
+
+float RandomFloat(float lo, float hi)
+{
+	float r = (float)(rand() & RAND_MAX) / (float)RAND_MAX;
+	return (hi - lo) * r + lo;
+}
+
+b2AABB RandomAABB()
+{
+	b2Vec2 p(RandomFloat(-50.0f, 50.0f), RandomFloat(-50.0f, 50.0f));
+	b2Vec2 w(RandomFloat(0.1f, 2.0f), RandomFloat(0.1f, 2.0f));
+	b2AABB aabb;
+	aabb.lowerBound = p;
+	aabb.upperBound = p + w;
+	return aabb;
+}
+
+}
+
+DOCTEST_TEST_CASE("broad-phase test")
+{
+	SUBCASE("dynamic tree compact")
+	{
+		srand(42);
+
+		const int32 count = 400;
+		b2DynamicTree tree;
+		int32 proxies[count];
+		int32 tags[count];
+
+		for (int32 i = 0; i < count; ++i)
+		{
+			tags[i] = i;
+			proxies[i] = tree.CreateProxy(RandomAABB(), tags + i);
+		}
+
+		// Churn the tree so nodes are scattered over the pool.
+		for (int32 i = 0; i < count; i += 3)
+		{
+			tree.DestroyProxy(proxies[i]);
+			proxies[i] = b2_nullNode;
+		}
+
+		for (int32 i = 1; i < count; i += 3)
+		{
+			b2AABB aabb = RandomAABB();
+			tree.MoveProxy(proxies[i], aabb, b2Vec2(1.0f, 0.0f));
+		}
+
+		b2AABB fatAABBs[count];
+		for (int32 i = 0; i < count; ++i)
+		{
+			if (proxies[i] != b2_nullNode)
+			{
+				fatAABBs[i] = tree.GetFatAABB(proxies[i]);
+			}
+		}
+
+		b2AABB queryAABB;
+		queryAABB.lowerBound.Set(-20.0f, -10.0f);
+		queryAABB.upperBound.Set(15.0f, 25.0f);
+
+		TreeQuery before = {};
+		tree.Query(&before, queryAABB);
+
+		int32 height = tree.GetHeight();
+		tree.Compact();
+		tree.Validate();
+
+		CHECK(tree.GetHeight() == height);
+
+		TreeQuery after = {};
+		tree.Query(&after, queryAABB);
+		CHECK(after.hitCount == before.hitCount);
+
+		for (int32 i = 0; i < count; ++i)
+		{
+			if (proxies[i] == b2_nullNode)
+			{
+				continue;
+			}
+
+			// Proxy ids survive the reordering.
+			CHECK(tree.GetUserData(proxies[i]) == tags + i);
+			CHECK(tree.GetFatAABB(proxies[i]).lowerBound == fatAABBs[i].lowerBound);
+			CHECK(tree.GetFatAABB(proxies[i]).upperBound == fatAABBs[i].upperBound);
+			CHECK(after.hits[proxies[i]] == b2TestOverlap(queryAABB, fatAABBs[i]));
+		}
+
+		// The tree keeps working after compaction.
+		for (int32 i = 0; i < count; i += 3)
+		{
+			proxies[i] = tree.CreateProxy(RandomAABB(), tags + i);
+		}
+		tree.Validate();
+	}
+
+	SUBCASE("quantized tree")
+	{
+		srand(7);
+
+		const int32 count = 400;
+		b2QuantizedTree tree;
+		int32 proxies[count];
+		int32 tags[count];
+
+		for (int32 i = 0; i < count; ++i)
+		{
+			tags[i] = i;
+			proxies[i] = tree.CreateProxy(RandomAABB(), tags + i);
+		}
+
+		tree.Rebuild();
+		CHECK(tree.ShouldRebuild() == false);
+
+		// Leave some proxies pending and some leaves stale.
+		for (int32 i = 0; i < count; i += 5)
+		{
+			tree.DestroyProxy(proxies[i]);
+			proxies[i] = b2_nullNode;
+		}
+
+		for (int32 i = 2; i < count; i += 7)
+		{
+			if (proxies[i] == b2_nullNode)
+			{
+				continue;
+			}
+
+			tree.MoveProxy(proxies[i], RandomAABB(), b2Vec2(0.0f, 1.0f));
+		}
+
+		b2AABB queryAABB;
+		queryAABB.lowerBound.Set(-30.0f, -20.0f);
+		queryAABB.upperBound.Set(10.0f, 5.0f);
+
+		for (int32 pass = 0; pass < 2; ++pass)
+		{
+			TreeQuery query = {};
+			tree.Query(&query, queryAABB);
+
+			int32 expected = 0;
+			for (int32 i = 0; i < count; ++i)
+			{
+				if (proxies[i] == b2_nullNode)
+				{
+					continue;
+				}
+
+				bool overlap = b2TestOverlap(queryAABB, tree.GetFatAABB(proxies[i]));
+				CHECK(query.hits[proxies[i]] == overlap);
+				CHECK(tree.GetUserData(proxies[i]) == tags + i);
+				expected += overlap ? 1 : 0;
+			}
+
+			CHECK(query.hitCount == expected);
+
+			// Same answers once everything is folded into the nodes.
+			tree.Rebuild();
+		}
+	}
+
+	SUBCASE("static tree compression")
+	{
+		int32 contactCounts[2];
+		for (int32 pass = 0; pass < 2; ++pass)
+		{
+			b2World world(b2Vec2(0.0f, -10.0f));
+			world.SetStaticTreeCompression(pass == 1);
+
+			b2PolygonShape box;
+			box.SetAsBox(0.5f, 0.5f);
+
+			b2BodyDef bd;
+			for (int32 i = 0; i < 40; ++i)
+			{
+				bd.position.Set(-20.0f + 1.0f * i, 0.0f);
+				world.CreateBody(&bd)->CreateFixture(&box, 0.0f);
+			}
+
+			bd.type = b2_dynamicBody;
+			for (int32 i = 0; i < 20; ++i)
+			{
+				bd.position.Set(-10.0f + 1.1f * i, 1.5f);
+				world.CreateBody(&bd)->CreateFixture(&box, 1.0f);
+			}
+
+			for (int32 i = 0; i < 10; ++i)
+			{
+				world.Step(1.0f / 60.0f, 8, 3);
+			}
+
+			CHECK(world.GetProxyCount() == 60);
+			contactCounts[pass] = world.GetContactCount();
+		}
+
+		// Static bodies never collide, so compression must not change the contacts.
+		CHECK(contactCounts[0] > 0);
+		CHECK(contactCounts[1] == contactCounts[0]);
+	}
+
+	SUBCASE("update pairs")
+	{
+		srand(11);
+
+		const int32 count = 128;
+		int32 tags[count];
+		b2AABB aabbs[count];
+
+		// Move few proxies, then all of them, so both pair finding paths run.
+		int32 moveCounts[2] = { 5, count };
+		for (int32 pass = 0; pass < 4; ++pass)
+		{
+			b2BroadPhase broadPhase;
+			broadPhase.SetStaticTreeCompression(pass >= 2);
+
+			int32 proxies[count];
+			for (int32 i = 0; i < count; ++i)
+			{
+				tags[i] = i;
+				aabbs[i] = RandomAABB();
+				aabbs[i].lowerBound *= 0.2f;
+				aabbs[i].upperBound *= 0.2f;
+				proxies[i] = broadPhase.CreateProxy(aabbs[i], tags + i, i % 4 == 0);
+			}
+
+			PairCollector* first = new PairCollector();
+			broadPhase.UpdatePairs(first);
+			delete first;
+
+			int32 moveCount = moveCounts[pass & 1];
+			for (int32 i = 0; i < moveCount; ++i)
+			{
+				b2Vec2 d(RandomFloat(-1.0f, 1.0f), 1.0f);
+				aabbs[i].lowerBound += d;
+				aabbs[i].upperBound += d;
+				broadPhase.MoveProxy(proxies[i], aabbs[i], d);
+			}
+
+			PairCollector* collector = new PairCollector();
+			broadPhase.UpdatePairs(collector);
+
+			int32 expected = 0;
+			for (int32 i = 0; i < count; ++i)
+			{
+				for (int32 j = i + 1; j < count; ++j)
+				{
+					bool moved = i < moveCount || j < moveCount;
+					bool staticPair = pass >= 2 && i % 4 == 0 && j % 4 == 0;
+					bool overlap = b2TestOverlap(broadPhase.GetFatAABB(proxies[i]), broadPhase.GetFatAABB(proxies[j]));
+					int32 pairCount = moved && overlap && staticPair == false ? 1 : 0;
+					CHECK(collector->pairs[i][j] == pairCount);
+					expected += pairCount;
+				}
+			}
+
+			CHECK(collector->pairCount == expected);
+			delete collector;
+		}
+	}
+
+	SUBCASE("hashed grid")
+	{
+		srand(5);
+
+		const int32 count = 300;
+		b2HashedGrid grid;
+		grid.SetCellSize(0.5f);
+		b2DynamicTree tree;
+		int32 gridProxies[count];
+		int32 treeProxies[count];
+		int32 tags[count];
+
+		for (int32 i = 0; i < count; ++i)
+		{
+			b2AABB aabb = RandomAABB();
+
+			// A few large proxies land on coarse levels or outside the grid.
+			if (i % 50 == 0)
+			{
+				aabb.upperBound += b2Vec2(40000.0f * (i / 150), 20.0f);
+			}
+
+			tags[i] = i;
+			gridProxies[i] = grid.CreateProxy(aabb, tags + i);
+			treeProxies[i] = tree.CreateProxy(aabb, tags + i);
+		}
+
+		for (int32 i = 0; i < count; i += 4)
+		{
+			grid.DestroyProxy(gridProxies[i]);
+			tree.DestroyProxy(treeProxies[i]);
+			gridProxies[i] = b2_nullNode;
+		}
+
+		for (int32 i = 1; i < count; i += 3)
+		{
+			if (gridProxies[i] == b2_nullNode)
+			{
+				continue;
+			}
+
+			b2AABB aabb = RandomAABB();
+			b2Vec2 d(-1.0f, 2.0f);
+			CHECK(grid.MoveProxy(gridProxies[i], aabb, d) == tree.MoveProxy(treeProxies[i], aabb, d));
+		}
+
+		grid.ShiftOrigin(b2Vec2(3.0f, -2.0f));
+		tree.ShiftOrigin(b2Vec2(3.0f, -2.0f));
+		CHECK(grid.GetProxyCount() == count - count / 4);
+
+		b2AABB queryAABBs[3];
+		queryAABBs[0].lowerBound.Set(-5.0f, -5.0f);
+		queryAABBs[0].upperBound.Set(5.0f, 5.0f);
+		queryAABBs[1].lowerBound.Set(-20.0f, -40.0f);
+		queryAABBs[1].upperBound.Set(35.0f, 10.0f);
+		queryAABBs[2].lowerBound.Set(-1000.0f, -1000.0f);
+		queryAABBs[2].upperBound.Set(1000.0f, 1000.0f);
+
+		for (int32 k = 0; k < 3; ++k)
+		{
+			TreeQuery gridQuery = {};
+			grid.Query(&gridQuery, queryAABBs[k]);
+
+			int32 expected = 0;
+			for (int32 i = 0; i < count; ++i)
+			{
+				if (gridProxies[i] == b2_nullNode)
+				{
+					continue;
+				}
+
+				CHECK(grid.GetUserData(gridProxies[i]) == tags + i);
+				bool overlap = b2TestOverlap(queryAABBs[k], grid.GetFatAABB(gridProxies[i]));
+				CHECK(gridQuery.hits[gridProxies[i]] == overlap);
+				expected += overlap ? 1 : 0;
+			}
+
+			CHECK(gridQuery.hitCount == expected);
+		}
+
+		b2RayCastInput input;
+		input.p1.Set(-60.0f, -3.0f);
+		input.p2.Set(60.0f, 4.0f);
+		input.maxFraction = 1.0f;
+
+		RayCastCounter gridCast = {};
+		grid.RayCast(&gridCast, input);
+
+		RayCastCounter treeCast = {};
+		tree.RayCast(&treeCast, input);
+
+		CHECK(gridCast.hitCount > 0);
+		CHECK(gridCast.hitCount == treeCast.hitCount);
+	}
+
+	SUBCASE("hashed grid world")
+	{
+		int32 contactCounts[2];
+		for (int32 pass = 0; pass < 2; ++pass)
+		{
+			b2BroadPhaseType type = pass == 0 ? b2_dynamicTreeBroadPhase : b2_hashedGridBroadPhase;
+			b2World world(b2Vec2(0.0f, -10.0f), type, 1.0f);
+
+			b2BodyDef bd;
+			b2Body* ground = world.CreateBody(&bd);
+			b2EdgeShape edge;
+			edge.SetTwoSided(b2Vec2(-40.0f, 0.0f), b2Vec2(40.0f, 0.0f));
+			ground->CreateFixture(&edge, 0.0f);
+
+			b2PolygonShape box;
+			box.SetAsBox(0.5f, 0.5f);
+
+			bd.type = b2_dynamicBody;
+			for (int32 i = 0; i < 10; ++i)
+			{
+				for (int32 j = 0; j < 10; ++j)
+				{
+					bd.position.Set(-5.0f + 1.0f * i, 0.5f + 1.0f * j);
+					world.CreateBody(&bd)->CreateFixture(&box, 1.0f);
+				}
+			}
+
+			world.Step(1.0f / 60.0f, 8, 3);
+
+			CHECK(world.GetProxyCount() == 101);
+			contactCounts[pass] = world.GetContactCount();
+		}
+
+		CHECK(contactCounts[0] > 0);
+		CHECK(contactCounts[1] == contactCounts[0]);
+	}
+
+	SUBCASE("collision layers")
+	{
+		srand(13);
+
+		const int32 count = 128;
+		int32 tags[count];
+
+		int32 moveCounts[2] = { 6, count };
+		for (int32 pass = 0; pass < 4; ++pass)
+		{
+			b2BroadPhase broadPhase;
+			broadPhase.SetType(pass < 2 ? b2_dynamicTreeBroadPhase : b2_hashedGridBroadPhase);
+			broadPhase.SetStaticTreeCompression(true);
+			broadPhase.SetLayerCollision(0, 1, false);
+			broadPhase.SetLayerCollision(2, 2, false);
+			CHECK(broadPhase.GetLayerCollision(1, 0) == false);
+			CHECK(broadPhase.GetLayerCollision(1, 2));
+
+			int32 proxies[count];
+			int32 layers[count];
+			for (int32 i = 0; i < count; ++i)
+			{
+				tags[i] = i;
+				layers[i] = i % 3;
+				b2AABB aabb = RandomAABB();
+				aabb.lowerBound *= 0.2f;
+				aabb.upperBound *= 0.2f;
+				proxies[i] = broadPhase.CreateProxy(aabb, tags + i, i % 5 == 0, layers[i]);
+			}
+
+			PairCollector* first = new PairCollector();
+			broadPhase.UpdatePairs(first);
+			delete first;
+
+			int32 moveCount = moveCounts[pass & 1];
+			for (int32 i = 0; i < moveCount; ++i)
+			{
+				b2AABB aabb = broadPhase.GetFatAABB(proxies[i]);
+				b2Vec2 d(1.0f, RandomFloat(-1.0f, 1.0f));
+				aabb.lowerBound += d;
+				aabb.upperBound += d;
+				broadPhase.MoveProxy(proxies[i], aabb, d);
+			}
+
+			PairCollector* collector = new PairCollector();
+			broadPhase.UpdatePairs(collector);
+
+			for (int32 i = 0; i < count; ++i)
+			{
+				for (int32 j = i + 1; j < count; ++j)
+				{
+					bool moved = i < moveCount || j < moveCount;
+					bool staticPair = i % 5 == 0 && j % 5 == 0;
+					bool layerPair = broadPhase.GetLayerCollision(layers[i], layers[j]);
+					bool overlap = b2TestOverlap(broadPhase.GetFatAABB(proxies[i]), broadPhase.GetFatAABB(proxies[j]));
+					CHECK(collector->pairs[i][j] == (moved && overlap && layerPair && staticPair == false ? 1 : 0));
+				}
+			}
+
+			delete collector;
+
+			// Queries see all layers.
+			b2AABB queryAABB;
+			queryAABB.lowerBound.Set(-4.0f, -4.0f);
+			queryAABB.upperBound.Set(4.0f, 4.0f);
+
+			int32 expected = 0;
+			for (int32 i = 0; i < count; ++i)
+			{
+				expected += b2TestOverlap(queryAABB, broadPhase.GetFatAABB(proxies[i])) ? 1 : 0;
+			}
+
+			BroadPhaseQuery query = {};
+			query.broadPhase = &broadPhase;
+			broadPhase.Query(&query, queryAABB);
+			CHECK(query.hitCount == expected);
+		}
+	}
+
+	SUBCASE("collision layers world")
+	{
+		b2World world(b2Vec2(0.0f, -10.0f));
+
+		b2BodyDef bd;
+		b2Body* ground = world.CreateBody(&bd);
+		b2EdgeShape edge;
+		edge.SetTwoSided(b2Vec2(-10.0f, 0.0f), b2Vec2(10.0f, 0.0f));
+		ground->CreateFixture(&edge, 0.0f);
+
+		b2PolygonShape box;
+		box.SetAsBox(0.5f, 0.5f);
+
+		b2FixtureDef fd;
+		fd.shape = &box;
+		fd.density = 1.0f;
+
+		bd.type = b2_dynamicBody;
+		bd.position.Set(-2.0f, 0.5f);
+		b2Body* body0 = world.CreateBody(&bd);
+		body0->CreateFixture(&fd);
+
+		fd.filter.layer = 1;
+		bd.position.Set(2.0f, 0.5f);
+		b2Body* body1 = world.CreateBody(&bd);
+		body1->CreateFixture(&fd);
+
+		world.Step(1.0f / 60.0f, 8, 3);
+		CHECK(world.GetContactCount() == 2);
+
+		// Layer 1 no longer touches the ground on layer 0.
+		world.SetLayerCollision(0, 1, false);
+		for (int32 i = 0; i < 60; ++i)
+		{
+			world.Step(1.0f / 60.0f, 8, 3);
+		}
+
+		CHECK(world.GetContactCount() == 1);
+		CHECK(body0->GetPosition().y > 0.4f);
+		CHECK(body1->GetPosition().y < -1.0f);
+
+		// Moving a fixture to another layer moves its proxies.
+		b2Filter filter = body0->GetFixtureList()->GetFilterData();
+		filter.layer = 1;
+		body0->GetFixtureList()->SetFilterData(filter);
+		world.Step(1.0f / 60.0f, 8, 3);
+		CHECK(world.GetContactCount() == 0);
+	}
+}
@@ -21,10 +21,47 @@
 // SOFTWARE.
 
 #include "box2d/box2d.h"
+#include "box2d/collision/distance.h"
+#include "box2d/collision/time_of_impact.h"
 #include "doctest.h"
 #include <stdio.h>
 
+// Records the children reported by b2Shape::QueryChildren.
+class ChildRecorder : public b2ShapeChildCallback
+{
+public:
+	bool ReportChild(int32 childIndex) override
+	{
+		if (count < 4096)
+		{
+			children[count] = childIndex;
+		}
+		++count;
+		return true;
+	}
+
+	int32 children[4096];
+	int32 count = 0;
+};
+
 // Unit tests for collision algorithms
+// Core distance between two TOI proxies at time t.
+static float CoreDistance(const b2TOIInput& input, float t)
+{
+	b2DistanceInput distanceInput;
+	distanceInput.proxyA = input.proxyA;
+	distanceInput.proxyB = input.proxyB;
+	input.sweepA.GetTransform(&distanceInput.transformA, t);
+	input.sweepB.GetTransform(&distanceInput.transformB, t);
+	distanceInput.useRadii = false;
+
+	b2SimplexCache cache;
+	cache.count = 0;
+	b2DistanceOutput output;
+	b2Distance(&output, &cache, &distanceInput);
+	return output.distance;
+}
+
 DOCTEST_TEST_CASE("collision test")
 {
 	SUBCASE("polygon mass data")
@@ -78,4 +115,851 @@ DOCTEST_TEST_CASE("collision test")
 		CHECK(b2Abs(massData2.mass - mass) < 20.0f * (absTol + relTol * mass));
 		CHECK(b2Abs(massData2.I - inertia) < 40.0f * (absTol + relTol * inertia));
 	}
+
+	SUBCASE("polygon collision")
+	{
+		b2PolygonShape boxA;
+		boxA.SetAsBox(1.0f, 1.0f);
+		b2PolygonShape boxB;
+		boxB.SetAsBox(0.5f, 0.5f);
+
+		b2Transform xfA;
+		xfA.SetIdentity();
+		b2Transform xfB(b2Vec2(0.25f, 1.4f), b2Rot(0.0f));
+
+		b2Manifold manifold;
+		b2CollidePolygons(&manifold, &boxA, xfA, &boxB, xfB);
+		CHECK(manifold.type == b2Manifold::e_faceA);
+		CHECK(manifold.pointCount == 2);
+		CHECK(manifold.localNormal == b2Vec2(0.0f, 1.0f));
+
+		b2WorldManifold worldManifold;
+		worldManifold.Initialize(&manifold, xfA, boxA.m_radius, xfB, boxB.m_radius);
+		float separation = -0.1f - boxA.m_radius - boxB.m_radius;
+		CHECK(b2Abs(worldManifold.separations[0] - separation) < 0.001f);
+		CHECK(b2Abs(worldManifold.separations[1] - separation) < 0.001f);
+
+		// Random convex polygons of every vertex count, compared against GJK.
+		srand(7);
+		for (int32 k = 0; k < 2000; ++k)
+		{
+			b2PolygonShape polygons[2];
+			b2Transform xfs[2];
+			for (int32 i = 0; i < 2; ++i)
+			{
+				b2Vec2 points[b2_maxPolygonVertices];
+				int32 count = 3 + k % (b2_maxPolygonVertices - 2);
+				for (int32 j = 0; j < count; ++j)
+				{
+					float angle = 2.0f * b2_pi * (j + 0.5f * rand() / float(RAND_MAX)) / count;
+					points[j].Set(cosf(angle), sinf(angle));
+				}
+
+				polygons[i].Set(points, count);
+				xfs[i].Set(b2Vec2(2.0f * rand() / float(RAND_MAX), 2.0f * rand() / float(RAND_MAX)),
+						   2.0f * b2_pi * rand() / float(RAND_MAX));
+			}
+
+			b2CollidePolygons(&manifold, polygons + 0, xfs[0], polygons + 1, xfs[1]);
+
+			b2DistanceInput input;
+			input.proxyA.Set(polygons + 0, 0);
+			input.proxyB.Set(polygons + 1, 0);
+			input.transformA = xfs[0];
+			input.transformB = xfs[1];
+			input.useRadii = false;
+			b2SimplexCache cache;
+			cache.count = 0;
+			b2DistanceOutput output;
+			b2Distance(&output, &cache, &input);
+
+			float totalRadius = polygons[0].m_radius + polygons[1].m_radius;
+			if (output.distance > totalRadius + b2_linearSlop)
+			{
+				CHECK(manifold.pointCount == 0);
+			}
+			else if (output.distance == 0.0f)
+			{
+				CHECK(manifold.pointCount > 0);
+			}
+		}
+	}
+
+	SUBCASE("box collision")
+	{
+		// The box collider must agree with the general collider so warm starting
+		// works when a contact switches between them.
+		srand(11);
+		int32 touching = 0;
+		for (int32 k = 0; k < 5000; ++k)
+		{
+			b2PolygonShape boxes[2];
+			b2Transform xfs[2];
+			for (int32 i = 0; i < 2; ++i)
+			{
+				float hx = 0.1f + rand() / float(RAND_MAX);
+				float hy = 0.1f + rand() / float(RAND_MAX);
+				if (k % 2 == 0)
+				{
+					boxes[i].SetAsBox(hx, hy);
+				}
+				else
+				{
+					b2Vec2 center(rand() / float(RAND_MAX) - 0.5f, rand() / float(RAND_MAX) - 0.5f);
+					boxes[i].SetAsBox(hx, hy, center, 2.0f * b2_pi * rand() / float(RAND_MAX));
+				}
+
+				xfs[i].Set(b2Vec2(2.0f * rand() / float(RAND_MAX), 2.0f * rand() / float(RAND_MAX)),
+						   k % 4 < 2 ? 0.0f : 2.0f * b2_pi * rand() / float(RAND_MAX));
+			}
+
+			b2Manifold manifold1, manifold2;
+			b2CollidePolygons(&manifold1, boxes + 0, xfs[0], boxes + 1, xfs[1]);
+			b2CollideBoxes(&manifold2, boxes + 0, xfs[0], boxes + 1, xfs[1]);
+
+			REQUIRE(manifold1.pointCount == manifold2.pointCount);
+			if (manifold1.pointCount == 0)
+			{
+				continue;
+			}
+
+			++touching;
+			CHECK(manifold1.type == manifold2.type);
+			CHECK(b2Distance(manifold1.localNormal, manifold2.localNormal) < 1e-5f);
+			CHECK(b2Distance(manifold1.localPoint, manifold2.localPoint) < 1e-5f);
+			for (int32 i = 0; i < manifold1.pointCount; ++i)
+			{
+				CHECK(manifold1.points[i].id.key == manifold2.points[i].id.key);
+				CHECK(b2Distance(manifold1.points[i].localPoint, manifold2.points[i].localPoint) < 1e-4f);
+			}
+		}
+
+		CHECK(touching > 1000);
+
+		b2PolygonShape polygon;
+		polygon.SetAsBox(1.0f, 1.0f);
+		CHECK(polygon.m_isBox);
+		b2Vec2 points[3] = { b2Vec2(0.0f, 0.0f), b2Vec2(1.0f, 0.0f), b2Vec2(0.0f, 1.0f) };
+		polygon.Set(points, 3);
+		CHECK(polygon.m_isBox == false);
+	}
+
+	SUBCASE("capsule shape")
+	{
+		b2CapsuleShape capsule;
+		capsule.Set(b2Vec2(-1.0f, 0.0f), b2Vec2(1.0f, 0.0f), 0.5f);
+
+		b2MassData massData;
+		capsule.ComputeMass(&massData, 2.0f);
+		CHECK(b2Abs(massData.mass - 2.0f * (b2_pi * 0.25f + 2.0f)) < 1e-5f);
+		CHECK(massData.center == b2Vec2(0.0f, 0.0f));
+
+		// Integrate the inertia numerically.
+		b2Transform identity;
+		identity.SetIdentity();
+		const float h = 0.005f;
+		float inertia = 0.0f;
+		for (float x = -1.5f + 0.5f * h; x < 1.5f; x += h)
+		{
+			for (float y = -0.5f + 0.5f * h; y < 0.5f; y += h)
+			{
+				if (capsule.TestPoint(identity, b2Vec2(x, y)))
+				{
+					inertia += 2.0f * (x * x + y * y) * h * h;
+				}
+			}
+		}
+		CHECK(b2Abs(massData.I - inertia) < 0.005f * inertia);
+
+		b2Transform xf(b2Vec2(1.0f, 2.0f), b2Rot(0.5f * b2_pi));
+		b2RayCastInput input;
+		input.p1.Set(1.0f, -2.0f);
+		input.p2.Set(1.0f, 6.0f);
+		input.maxFraction = 1.0f;
+		b2RayCastOutput output;
+		REQUIRE(capsule.RayCast(&output, input, xf, 0));
+		CHECK(b2Abs(output.fraction - 2.5f / 8.0f) < 1e-5f);
+		CHECK(b2Distance(output.normal, b2Vec2(0.0f, -1.0f)) < 1e-5f);
+
+		input.p1.Set(-2.0f, 2.5f);
+		input.p2.Set(2.0f, 2.5f);
+		REQUIRE(capsule.RayCast(&output, input, xf, 0));
+		CHECK(b2Abs(output.fraction - 2.5f / 4.0f) < 1e-5f);
+		CHECK(b2Distance(output.normal, b2Vec2(-1.0f, 0.0f)) < 1e-5f);
+
+		input.p1.Set(1.0f, 2.0f);
+		CHECK(capsule.RayCast(&output, input, xf, 0) == false);
+		input.p1.Set(-2.0f, 3.6f);
+		input.p2.Set(2.0f, 3.6f);
+		CHECK(capsule.RayCast(&output, input, xf, 0) == false);
+
+		b2AABB aabb;
+		capsule.ComputeAABB(&aabb, xf, 0);
+		CHECK(b2Distance(aabb.lowerBound, b2Vec2(0.5f, 0.5f)) < 1e-5f);
+		CHECK(b2Distance(aabb.upperBound, b2Vec2(1.5f, 3.5f)) < 1e-5f);
+	}
+
+	SUBCASE("capsule collision")
+	{
+		// Compare the contact depth against the exact distance between the shapes.
+		srand(5);
+		int32 touching = 0;
+		for (int32 k = 0; k < 4000; ++k)
+		{
+			b2CapsuleShape capsule;
+			capsule.Set(b2Vec2(-0.5f, 0.1f), b2Vec2(0.6f, -0.2f), 0.1f + 0.4f * rand() / float(RAND_MAX));
+
+			b2CapsuleShape capsule2;
+			capsule2.Set(b2Vec2(0.0f, -0.4f), b2Vec2(0.1f, 0.5f), 0.05f + 0.3f * rand() / float(RAND_MAX));
+			b2CircleShape circle;
+			circle.m_radius = 0.5f;
+			b2PolygonShape box;
+			box.SetAsBox(0.5f, 0.3f);
+			b2EdgeShape edge;
+			edge.SetTwoSided(b2Vec2(-0.5f, 0.0f), b2Vec2(0.5f, 0.0f));
+
+			const b2Shape* shapes[4] = { &capsule2, &circle, &box, &edge };
+			const b2Shape* other = shapes[k % 4];
+
+			b2Transform xfA(b2Vec2(2.0f * rand() / float(RAND_MAX), 2.0f * rand() / float(RAND_MAX)),
+							b2Rot(2.0f * b2_pi * rand() / float(RAND_MAX)));
+			b2Transform xfB(b2Vec2(2.0f * rand() / float(RAND_MAX), 2.0f * rand() / float(RAND_MAX)),
+							b2Rot(2.0f * b2_pi * rand() / float(RAND_MAX)));
+
+			b2Manifold manifold;
+			const b2Shape* shapeA;
+			const b2Shape* shapeB;
+			switch (other->GetType())
+			{
+			case b2Shape::e_capsule:
+				shapeA = &capsule;
+				shapeB = other;
+				b2CollideCapsules(&manifold, &capsule, xfA, &capsule2, xfB);
+				break;
+
+			case b2Shape::e_circle:
+				shapeA = &capsule;
+				shapeB = other;
+				b2CollideCapsuleAndCircle(&manifold, &capsule, xfA, &circle, xfB);
+				break;
+
+			case b2Shape::e_polygon:
+				shapeA = other;
+				shapeB = &capsule;
+				b2CollidePolygonAndCapsule(&manifold, &box, xfA, &capsule, xfB);
+				break;
+
+			default:
+				shapeA = other;
+				shapeB = &capsule;
+				b2CollideEdgeAndCapsule(&manifold, &edge, xfA, &capsule, xfB);
+				break;
+			}
+
+			b2DistanceInput input;
+			input.proxyA.Set(shapeA, 0);
+			input.proxyB.Set(shapeB, 0);
+			input.transformA = xfA;
+			input.transformB = xfB;
+			input.useRadii = false;
+			b2SimplexCache cache;
+			cache.count = 0;
+			b2DistanceOutput output;
+			b2Distance(&output, &cache, &input);
+
+			float separation = output.distance - shapeA->m_radius - shapeB->m_radius;
+			if (separation > b2_linearSlop)
+			{
+				CHECK(manifold.pointCount == 0);
+				continue;
+			}
+
+			if (separation < -b2_linearSlop)
+			{
+				REQUIRE(manifold.pointCount > 0);
+			}
+
+			if (manifold.pointCount == 0)
+			{
+				continue;
+			}
+
+			++touching;
+			b2WorldManifold worldManifold;
+			worldManifold.Initialize(&manifold, xfA, shapeA->m_radius, xfB, shapeB->m_radius);
+			float minSeparation = b2_maxFloat;
+			for (int32 i = 0; i < manifold.pointCount; ++i)
+			{
+				minSeparation = b2Min(minSeparation, worldManifold.separations[i]);
+			}
+
+			// Only meaningful while the cores are apart.
+			if (output.distance > 0.0f)
+			{
+				CHECK(b2Abs(minSeparation - separation) < 0.001f);
+			}
+		}
+
+		CHECK(touching > 500);
+	}
+
+	SUBCASE("grid shape")
+	{
+		srand(7);
+		float heights[201];
+		for (int32 i = 0; i < 201; ++i)
+		{
+			heights[i] = 2.0f * rand() / float(RAND_MAX);
+		}
+		b2GridShape heightField;
+		heightField.CreateHeightField(heights, 201, 0.5f, b2Vec2(-50.0f, -1.0f));
+		CHECK(heightField.GetChildCount() == 200);
+		CHECK(heightField.GetProxyCount() == 1);
+		CHECK(heightField.SharesProxy());
+
+		uint8 tiles[40 * 30];
+		for (int32 i = 0; i < 40 * 30; ++i)
+		{
+			tiles[i] = rand() % 10 < 3 ? 1 : 0;
+		}
+		b2GridShape tileMap;
+		tileMap.CreateTileMap(tiles, 40, 30, 0.75f, b2Vec2(-15.0f, -10.0f));
+		CHECK(tileMap.GetChildCount() == 1200);
+
+		b2Transform identity;
+		identity.SetIdentity();
+		b2Transform xf(b2Vec2(1.0f, -2.0f), b2Rot(0.3f));
+
+		const b2GridShape* grids[2] = { &heightField, &tileMap };
+		for (int32 g = 0; g < 2; ++g)
+		{
+			const b2GridShape* grid = grids[g];
+			int32 childCount = grid->GetChildCount();
+
+			// Allow for round-off between the two ways of bounding the cells.
+			b2AABB bounds;
+			grid->ComputeProxyAABB(&bounds, xf, 0);
+			bounds.lowerBound -= b2Vec2(1e-4f, 1e-4f);
+			bounds.upperBound += b2Vec2(1e-4f, 1e-4f);
+
+			int32 hits = 0;
+			for (int32 k = 0; k < 500; ++k)
+			{
+				// The cell lookup must report exactly the solid children under the box.
+				b2Vec2 p(-60.0f + 120.0f * rand() / float(RAND_MAX), -20.0f + 40.0f * rand() / float(RAND_MAX));
+				b2Vec2 h(0.1f + 5.0f * rand() / float(RAND_MAX), 0.1f + 5.0f * rand() / float(RAND_MAX));
+				b2AABB box;
+				box.lowerBound = p - h;
+				box.upperBound = p + h;
+
+				ChildRecorder recorder;
+				grid->QueryChildren(&recorder, box);
+				ChildRecorder expected;
+				grid->b2Shape::QueryChildren(&expected, box);
+				int32 solidCount = 0;
+				for (int32 i = 0; i < expected.count; ++i)
+				{
+					if (grid->IsSolid(expected.children[i]))
+					{
+						expected.children[solidCount++] = expected.children[i];
+					}
+				}
+				REQUIRE(recorder.count == solidCount);
+				for (int32 i = 0; i < solidCount; ++i)
+				{
+					CHECK(recorder.children[i] == expected.children[i]);
+				}
+
+				// The cell walk must find the same hit as casting against every child.
+				b2RayCastInput input;
+				input.p1.Set(-60.0f + 120.0f * rand() / float(RAND_MAX), -20.0f + 40.0f * rand() / float(RAND_MAX));
+				input.p2.Set(-60.0f + 120.0f * rand() / float(RAND_MAX), -20.0f + 40.0f * rand() / float(RAND_MAX));
+				input.maxFraction = 0.5f + 0.5f * rand() / float(RAND_MAX);
+				b2RayCastOutput output, expectedOutput;
+				int32 child = -1, expectedChild = -1;
+				bool hit = grid->RayCastChildren(&output, &child, input, xf);
+				bool expectedHit = grid->b2Shape::RayCastChildren(&expectedOutput, &expectedChild, input, xf);
+				REQUIRE(hit == expectedHit);
+				if (hit)
+				{
+					++hits;
+					CHECK(b2Abs(output.fraction - expectedOutput.fraction) < 1e-5f);
+					CHECK(b2Distance(output.normal, expectedOutput.normal) < 1e-4f);
+				}
+			}
+			CHECK(hits > 100);
+
+			for (int32 i = 0; i < childCount; ++i)
+			{
+				b2AABB aabb;
+				grid->ComputeAABB(&aabb, xf, i);
+				CHECK(bounds.Contains(aabb));
+			}
+		}
+
+		// Tiles are solid inside and height fields have no interior.
+		b2Vec2 inside = b2Vec2(-15.0f, -10.0f) + 0.75f * b2Vec2(3.5f, 2.5f);
+		CHECK(tileMap.TestPoint(identity, inside) == (tiles[2 * 40 + 3] != 0));
+		CHECK(tileMap.TestPoint(identity, b2Vec2(-16.0f, 0.0f)) == false);
+		CHECK(heightField.TestPoint(identity, b2Vec2(0.0f, -5.0f)) == false);
+
+		// The height field surface faces up.
+		b2EdgeShape edge;
+		heightField.GetChildEdge(&edge, 10);
+		b2Vec2 e = edge.m_vertex2 - edge.m_vertex1;
+		CHECK(e.x < 0.0f);
+		CHECK(edge.m_oneSided);
+	}
+
+	SUBCASE("chain edge tree")
+	{
+		// A wandering chain with a thousand edges.
+		srand(11);
+		b2Vec2 vertices[1001];
+		b2Vec2 p(0.0f, 0.0f);
+		float angle = 0.0f;
+		for (int32 i = 0; i < 1001; ++i)
+		{
+			vertices[i] = p;
+			angle += -0.5f + 1.0f * rand() / float(RAND_MAX);
+			p += (0.1f + 0.4f * rand() / float(RAND_MAX)) * b2Vec2(cosf(angle), sinf(angle));
+		}
+
+		b2ChainShape chain;
+		chain.CreateChain(vertices, 1001, b2Vec2(-1.0f, 0.0f), p);
+		CHECK(chain.GetProxyCount() == 1000);
+		CHECK(chain.SharesProxy() == false);
+
+		chain.SetSingleProxy(true);
+		CHECK(chain.GetProxyCount() == 1);
+		CHECK(chain.SharesProxy());
+
+		b2Transform xf(b2Vec2(-3.0f, 2.0f), b2Rot(1.2f));
+		b2AABB bounds;
+		chain.ComputeProxyAABB(&bounds, xf, 0);
+		for (int32 i = 0; i < 1000; ++i)
+		{
+			b2AABB aabb;
+			chain.ComputeAABB(&aabb, xf, i);
+			CHECK(bounds.Contains(aabb));
+		}
+
+		b2AABB localBounds;
+		b2Transform identity;
+		identity.SetIdentity();
+		chain.ComputeProxyAABB(&localBounds, identity, 0);
+		b2Vec2 lower = localBounds.lowerBound;
+		b2Vec2 size = localBounds.upperBound - lower;
+
+		int32 hits = 0;
+		for (int32 k = 0; k < 500; ++k)
+		{
+			// The tree must report exactly the edges whose boxes overlap.
+			b2Vec2 c = lower + b2Vec2(size.x * rand() / float(RAND_MAX), size.y * rand() / float(RAND_MAX));
+			b2Vec2 h(0.1f + 3.0f * rand() / float(RAND_MAX), 0.1f + 3.0f * rand() / float(RAND_MAX));
+			b2AABB box;
+			box.lowerBound = c - h;
+			box.upperBound = c + h;
+
+			ChildRecorder recorder;
+			chain.QueryChildren(&recorder, box);
+			ChildRecorder expected;
+			chain.b2Shape::QueryChildren(&expected, box);
+			REQUIRE(recorder.count == expected.count);
+			for (int32 i = 0; i < expected.count; ++i)
+			{
+				CHECK(recorder.children[i] == expected.children[i]);
+			}
+
+			// The tree must find the same hit as casting against every edge.
+			b2RayCastInput input;
+			input.p1 = b2Mul(xf, lower + b2Vec2(size.x * rand() / float(RAND_MAX), size.y * rand() / float(RAND_MAX)));
+			input.p2 = b2Mul(xf, lower + b2Vec2(size.x * rand() / float(RAND_MAX), size.y * rand() / float(RAND_MAX)));
+			input.maxFraction = 1.0f;
+			b2RayCastOutput output, expectedOutput;
+			int32 child = -1, expectedChild = -1;
+			bool hit = chain.RayCastChildren(&output, &child, input, xf);
+			bool expectedHit = chain.b2Shape::RayCastChildren(&expectedOutput, &expectedChild, input, xf);
+			REQUIRE(hit == expectedHit);
+			if (hit)
+			{
+				++hits;
+				CHECK(b2Abs(output.fraction - expectedOutput.fraction) < 1e-5f);
+				CHECK(b2Distance(output.normal, expectedOutput.normal) < 1e-4f);
+			}
+		}
+		CHECK(hits > 100);
+	}
+
+	SUBCASE("compound shape")
+	{
+		// A cluster of boxes, circles and capsules.
+		srand(17);
+		b2PolygonShape boxes[20];
+		b2CircleShape circles[10];
+		b2CapsuleShape capsules[10];
+		const b2Shape* shapes[40];
+		for (int32 i = 0; i < 20; ++i)
+		{
+			b2Vec2 c(20.0f * rand() / float(RAND_MAX), 10.0f * rand() / float(RAND_MAX));
+			boxes[i].SetAsBox(0.2f + 0.5f * rand() / float(RAND_MAX), 0.2f + 0.5f * rand() / float(RAND_MAX), c, 0.3f * i);
+			shapes[i] = boxes + i;
+		}
+		for (int32 i = 0; i < 10; ++i)
+		{
+			b2Vec2 c(20.0f * rand() / float(RAND_MAX), 10.0f * rand() / float(RAND_MAX));
+			circles[i].m_p = c;
+			circles[i].m_radius = 0.1f + 0.4f * rand() / float(RAND_MAX);
+			capsules[i].Set(c + b2Vec2(0.5f, 0.2f), c - b2Vec2(0.3f, 0.6f), 0.25f);
+			shapes[20 + i] = circles + i;
+			shapes[30 + i] = capsules + i;
+		}
+
+		b2CompoundShape compound;
+		compound.Create(shapes, 40);
+		CHECK(compound.GetChildCount() == 40);
+		CHECK(compound.GetProxyCount() == 1);
+		CHECK(compound.SharesProxy());
+		CHECK(compound.GetChildRadius(3) == b2_polygonRadius);
+		CHECK(compound.GetChildRadius(25) == circles[5].m_radius);
+
+		// The mass adds up over the children.
+		b2MassData massData;
+		compound.ComputeMass(&massData, 2.0f);
+		float mass = 0.0f, inertia = 0.0f;
+		b2Vec2 center(0.0f, 0.0f);
+		for (int32 i = 0; i < 40; ++i)
+		{
+			b2MassData childData;
+			shapes[i]->ComputeMass(&childData, 2.0f);
+			mass += childData.mass;
+			center += childData.mass * childData.center;
+			inertia += childData.I;
+		}
+		CHECK(b2Abs(massData.mass - mass) < 1e-3f);
+		CHECK(b2Distance(massData.center, (1.0f / mass) * center) < 1e-4f);
+		CHECK(b2Abs(massData.I - inertia) < 1e-2f);
+
+		b2Transform xf(b2Vec2(1.0f, -2.0f), b2Rot(0.7f));
+		CHECK(compound.TestPoint(xf, b2Mul(xf, circles[4].m_p)));
+
+		b2DistanceProxy proxy;
+		proxy.Set(&compound, 32);
+		CHECK(proxy.m_count == 2);
+		CHECK(proxy.m_radius == 0.25f);
+
+		b2AABB bounds;
+		compound.ComputeProxyAABB(&bounds, xf, 0);
+		for (int32 i = 0; i < 40; ++i)
+		{
+			b2AABB aabb;
+			compound.ComputeAABB(&aabb, xf, i);
+			CHECK(bounds.Contains(aabb));
+		}
+
+		int32 hits = 0;
+		for (int32 k = 0; k < 300; ++k)
+		{
+			// The tree must report exactly the children whose boxes overlap.
+			b2Vec2 c(-1.0f + 22.0f * rand() / float(RAND_MAX), -1.0f + 12.0f * rand() / float(RAND_MAX));
+			b2Vec2 h(0.1f + 2.0f * rand() / float(RAND_MAX), 0.1f + 2.0f * rand() / float(RAND_MAX));
+			b2AABB box;
+			box.lowerBound = c - h;
+			box.upperBound = c + h;
+
+			ChildRecorder recorder;
+			compound.QueryChildren(&recorder, box);
+			ChildRecorder expected;
+			compound.b2Shape::QueryChildren(&expected, box);
+			REQUIRE(recorder.count == expected.count);
+			bool found[40] = {};
+			for (int32 i = 0; i < recorder.count; ++i)
+			{
+				CHECK(found[recorder.children[i]] == false);
+				found[recorder.children[i]] = true;
+			}
+			for (int32 i = 0; i < expected.count; ++i)
+			{
+				CHECK(found[expected.children[i]]);
+			}
+
+			// The tree must find the same hit as casting against every child.
+			b2RayCastInput input;
+			input.p1 = b2Mul(xf, b2Vec2(-1.0f + 22.0f * rand() / float(RAND_MAX), -1.0f + 12.0f * rand() / float(RAND_MAX)));
+			input.p2 = b2Mul(xf, b2Vec2(-1.0f + 22.0f * rand() / float(RAND_MAX), -1.0f + 12.0f * rand() / float(RAND_MAX)));
+			input.maxFraction = 1.0f;
+			b2RayCastOutput output, expectedOutput;
+			int32 child = -1, expectedChild = -1;
+			bool hit = compound.RayCastChildren(&output, &child, input, xf);
+			bool expectedHit = compound.b2Shape::RayCastChildren(&expectedOutput, &expectedChild, input, xf);
+			REQUIRE(hit == expectedHit);
+			if (hit)
+			{
+				++hits;
+				CHECK(b2Abs(output.fraction - expectedOutput.fraction) < 1e-5f);
+				CHECK(b2Distance(output.normal, expectedOutput.normal) < 1e-4f);
+			}
+		}
+		CHECK(hits > 50);
+	}
+
+	SUBCASE("batch queries")
+	{
+		b2CircleShape circle;
+		circle.m_p.Set(0.5f, -0.25f);
+		circle.m_radius = 1.5f;
+
+		b2PolygonShape box;
+		box.SetAsBox(1.0f, 2.0f, b2Vec2(0.5f, 0.0f), 0.3f);
+
+		b2Vec2 hexagon[6];
+		for (int32 i = 0; i < 6; ++i)
+		{
+			hexagon[i].Set(2.0f * cosf(i * b2_pi / 3.0f), 1.5f * sinf(i * b2_pi / 3.0f));
+		}
+		b2PolygonShape polygon;
+		polygon.Set(hexagon, 6);
+
+		b2EdgeShape twoSided;
+		twoSided.SetTwoSided(b2Vec2(-2.0f, -1.0f), b2Vec2(2.0f, 1.0f));
+		b2EdgeShape oneSided;
+		oneSided.SetOneSided(b2Vec2(-3.0f, 0.0f), b2Vec2(-2.0f, -1.0f), b2Vec2(2.0f, 1.0f), b2Vec2(3.0f, 0.0f));
+
+		b2Vec2 loop[5] = { b2Vec2(-2.0f, -2.0f), b2Vec2(2.0f, -2.0f), b2Vec2(3.0f, 1.0f), b2Vec2(0.0f, 3.0f), b2Vec2(-3.0f, 1.0f) };
+		b2ChainShape chain;
+		chain.CreateLoop(loop, 5);
+
+		const b2Shape* shapes[6] = { &circle, &box, &polygon, &twoSided, &oneSided, &chain };
+
+		// An odd count so that the scalar tail runs too.
+		const int32 count = 103;
+		srand(23);
+		b2Vec2 points[count];
+		b2RayCastInput inputs[count];
+		for (int32 i = 0; i < count; ++i)
+		{
+			points[i].Set(-4.0f + 8.0f * rand() / float(RAND_MAX), -4.0f + 8.0f * rand() / float(RAND_MAX));
+			inputs[i].p1 = points[i];
+			inputs[i].p2.Set(-4.0f + 8.0f * rand() / float(RAND_MAX), -4.0f + 8.0f * rand() / float(RAND_MAX));
+			inputs[i].maxFraction = 0.5f + 0.5f * rand() / float(RAND_MAX);
+		}
+
+		b2Transform xf(b2Vec2(0.3f, -0.2f), b2Rot(0.4f));
+		for (int32 k = 0; k < 6; ++k)
+		{
+			const b2Shape* shape = shapes[k];
+			int32 childCount = shape->GetChildCount();
+			for (int32 child = 0; child < childCount; ++child)
+			{
+				// The batch results must match the single queries.
+				float distances[count];
+				b2Vec2 normals[count];
+				shape->ComputeDistances(xf, points, count, distances, normals, child);
+
+				b2RayCastOutput outputs[count];
+				bool hits[count];
+				int32 hitCount = shape->RayCasts(outputs, hits, inputs, count, xf, child);
+
+				int32 expectedHits = 0;
+				for (int32 i = 0; i < count; ++i)
+				{
+					float distance;
+					b2Vec2 normal;
+					shape->ComputeDistance(xf, points[i], &distance, &normal, child);
+					CHECK(b2Abs(distances[i] - distance) < 1e-5f);
+					CHECK(b2Distance(normals[i], normal) < 1e-5f);
+
+					b2RayCastOutput output;
+					bool hit = shape->RayCast(&output, inputs[i], xf, child);
+					REQUIRE(hits[i] == hit);
+					if (hit)
+					{
+						++expectedHits;
+						CHECK(b2Abs(outputs[i].fraction - output.fraction) < 1e-5f);
+						CHECK(b2Distance(outputs[i].normal, output.normal) < 1e-5f);
+					}
+				}
+				CHECK(hitCount == expectedHits);
+			}
+
+			bool inside[count];
+			shape->TestPoints(xf, points, count, inside);
+			for (int32 i = 0; i < count; ++i)
+			{
+				CHECK(inside[i] == shape->TestPoint(xf, points[i]));
+			}
+		}
+	}
+
+	SUBCASE("simplex regions")
+	{
+		// A point against a triangle. With the whole triangle in the cache every support
+		// point is a duplicate, so GJK stops after one Solve3 and reports its region.
+		b2Vec2 triangle[3] = { b2Vec2(0.0f, 0.0f), b2Vec2(4.0f, 0.0f), b2Vec2(0.0f, 3.0f) };
+
+		struct Region
+		{
+			b2Vec2 point;
+			b2Vec2 closest;
+			int32 vertices;
+		};
+
+		// Three vertex regions, three edge regions off their midpoints and the inside.
+		const Region regions[7] =
+		{
+			{ b2Vec2(-1.0f, -1.0f), b2Vec2(0.0f, 0.0f), 0x1 },
+			{ b2Vec2(5.0f, -1.0f), b2Vec2(4.0f, 0.0f), 0x2 },
+			{ b2Vec2(-1.0f, 4.0f), b2Vec2(0.0f, 3.0f), 0x4 },
+			{ b2Vec2(1.0f, -1.0f), b2Vec2(1.0f, 0.0f), 0x3 },
+			{ b2Vec2(-1.0f, 1.0f), b2Vec2(0.0f, 1.0f), 0x5 },
+			{ b2Vec2(3.6f, 1.55f), b2Vec2(3.0f, 0.75f), 0x6 },
+			{ b2Vec2(1.0f, 1.0f), b2Vec2(1.0f, 1.0f), 0x7 },
+		};
+
+		// Each order puts a different triangle vertex first in Solve3.
+		for (int32 first = 0; first < 3; ++first)
+		{
+			for (int32 r = 0; r < 7; ++r)
+			{
+				const Region& region = regions[r];
+
+				b2DistanceInput input;
+				input.proxyA.Set(triangle, 3, 0.0f);
+				input.proxyB.Set(&region.point, 1, 0.0f);
+				input.transformA.SetIdentity();
+				input.transformB.SetIdentity();
+				input.useRadii = false;
+
+				// The cached metric must match or the simplex is flushed.
+				b2SimplexCache cache;
+				cache.count = 3;
+				b2Vec2 w[3];
+				for (int32 i = 0; i < 3; ++i)
+				{
+					cache.indexA[i] = uint8((first + i) % 3);
+					cache.indexB[i] = 0;
+					w[i] = region.point - triangle[cache.indexA[i]];
+				}
+				cache.metric = b2Cross(w[1] - w[0], w[2] - w[0]);
+				if (cache.metric < 0.0f)
+				{
+					b2Swap(cache.indexA[1], cache.indexA[2]);
+					cache.metric = -cache.metric;
+				}
+
+				b2DistanceOutput output;
+				b2Distance(&output, &cache, &input);
+				CHECK(output.iterations == (region.vertices == 0x7 ? 0 : 1));
+
+				int32 vertices = 0;
+				for (int32 i = 0; i < cache.count; ++i)
+				{
+					vertices |= 1 << cache.indexA[i];
+				}
+				CHECK(vertices == region.vertices);
+				CHECK(b2Distance(output.pointA, region.closest) < 1e-5f);
+				CHECK(output.distance == doctest::Approx(b2Distance(region.point, region.closest)));
+			}
+		}
+	}
+
+	SUBCASE("circle time of impact")
+	{
+		b2CircleShape circle;
+		circle.m_radius = 0.25f;
+
+		b2CircleShape target;
+		target.m_p.Set(0.5f, 0.0f);
+		target.m_radius = 0.5f;
+
+		b2EdgeShape edge;
+		edge.SetTwoSided(b2Vec2(-2.0f, 0.0f), b2Vec2(2.0f, 0.5f));
+
+		b2PolygonShape box;
+		box.SetAsBox(1.0f, 0.5f, b2Vec2(0.25f, 0.0f), 0.3f);
+
+		const b2Shape* others[3] = { &target, &edge, &box };
+
+		srand(42);
+		int32 touching = 0;
+		for (int32 k = 0; k < 600; ++k)
+		{
+			b2TOIInput input;
+			input.proxyA.Set(&circle, 0);
+			input.proxyB.Set(others[k % 3], 0);
+			input.tMax = 1.0f;
+
+			// A bullet circle, sometimes spinning about its center.
+			input.sweepA.localCenter.SetZero();
+			input.sweepA.c0.Set(-6.0f + 12.0f * rand() / float(RAND_MAX), -6.0f + 12.0f * rand() / float(RAND_MAX));
+			input.sweepA.c.Set(-6.0f + 12.0f * rand() / float(RAND_MAX), -6.0f + 12.0f * rand() / float(RAND_MAX));
+			input.sweepA.a0 = 0.0f;
+			input.sweepA.a = (k & 1) ? 2.0f : 0.0f;
+			input.sweepA.alpha0 = 0.0f;
+
+			// A sliding, non-rotating target.
+			input.sweepB.localCenter.Set(0.1f, -0.2f);
+			input.sweepB.c0.Set(0.5f, 0.0f);
+			input.sweepB.c.Set(0.0f, 0.5f);
+			input.sweepB.a0 = 0.7f;
+			input.sweepB.a = 0.7f;
+			input.sweepB.alpha0 = 0.0f;
+
+			float separation = b2Max(b2_linearSlop, input.proxyA.m_radius + input.proxyB.m_radius - 3.0f * b2_linearSlop);
+
+			b2TOIOutput output;
+			REQUIRE(b2TimeOfImpactCircle(&output, &input));
+			b2TOIOutput reference;
+			b2TimeOfImpact(&reference, &input);
+
+			if (output.state == b2TOIOutput::e_touching && output.t > 0.0f)
+			{
+				// The cores reach the target separation at the reported time and not before.
+				++touching;
+				CHECK(CoreDistance(input, output.t) == doctest::Approx(separation).epsilon(1e-3));
+				for (int32 i = 0; i < 8; ++i)
+				{
+					CHECK(CoreDistance(input, output.t * i / 8.0f) > separation - 1e-3f);
+				}
+
+				// The general algorithm stops within its tolerance of the same point.
+				if (reference.state == b2TOIOutput::e_touching)
+				{
+					CHECK(b2Abs(CoreDistance(input, reference.t) - separation) < 0.25f * b2_linearSlop + 1e-4f);
+					CHECK(b2Abs(output.t - reference.t) < 0.01f);
+				}
+			}
+			else if (output.state == b2TOIOutput::e_separated)
+			{
+				CHECK(output.t == 1.0f);
+				for (int32 i = 0; i <= 32; ++i)
+				{
+					CHECK(CoreDistance(input, i / 32.0f) > separation - 1e-3f);
+				}
+			}
+			else
+			{
+				CHECK(output.t == 0.0f);
+				CHECK(reference.state == output.state);
+			}
+		}
+		CHECK(touching > 50);
+
+		// A rotating polygon has no closed form.
+		b2TOIInput input;
+		input.proxyA.Set(&circle, 0);
+		input.proxyB.Set(&box, 0);
+		input.sweepA.localCenter.SetZero();
+		input.sweepA.c0.Set(-4.0f, 0.0f);
+		input.sweepA.c.Set(4.0f, 0.0f);
+		input.sweepA.a0 = input.sweepA.a = 0.0f;
+		input.sweepA.alpha0 = 0.0f;
+		input.sweepB = input.sweepA;
+		input.sweepB.c0.SetZero();
+		input.sweepB.c.SetZero();
+		input.sweepB.a = 1.0f;
+		input.tMax = 1.0f;
+		b2TOIOutput output;
+		CHECK_FALSE(b2TimeOfImpactCircle(&output, &input));
+	}
 }
@@ -104,3 +104,459 @@ DOCTEST_TEST_CASE("joint reactions")
 		CHECK(T == 0.0f);
 	}
 }
+
+// A hanging revolute chain, a motorized and limited arm and a chain of soft and rigid welds.
+static void CreateJointScene(b2World* world, b2RevoluteJoint** top, b2RevoluteJoint** arm)
+{
+	b2BodyDef bd;
+	b2Body* ground = world->CreateBody(&bd);
+
+	b2PolygonShape link;
+	link.SetAsBox(0.1f, 0.5f);
+	b2FixtureDef fd;
+	fd.shape = &link;
+	fd.density = 1.0f;
+	fd.filter.maskBits = 0;
+
+	bd.type = b2_dynamicBody;
+	b2RevoluteJointDef rjd;
+	b2Body* prev = ground;
+	for (int32 i = 0; i < 30; ++i)
+	{
+		bd.position.Set(0.0f, 19.5f - i);
+		b2Body* body = world->CreateBody(&bd);
+		body->CreateFixture(&fd);
+		rjd.Initialize(prev, body, b2Vec2(0.0f, 20.0f - i));
+		b2Joint* joint = world->CreateJoint(&rjd);
+		if (i == 0)
+		{
+			*top = (b2RevoluteJoint*)joint;
+		}
+
+		prev = body;
+	}
+
+	bd.position.Set(5.0f, 10.5f);
+	b2Body* body = world->CreateBody(&bd);
+	body->CreateFixture(&fd);
+	rjd.Initialize(ground, body, b2Vec2(5.0f, 10.0f));
+	rjd.enableMotor = true;
+	rjd.motorSpeed = 1.0f;
+	rjd.maxMotorTorque = 1000.0f;
+	rjd.enableLimit = true;
+	rjd.lowerAngle = -0.25f * b2_pi;
+	rjd.upperAngle = 0.5f * b2_pi;
+	*arm = (b2RevoluteJoint*)world->CreateJoint(&rjd);
+
+	b2WeldJointDef wjd;
+	prev = ground;
+	for (int32 i = 0; i < 20; ++i)
+	{
+		bd.position.Set(10.5f + i, 10.0f);
+		body = world->CreateBody(&bd);
+		body->CreateFixture(&fd);
+		wjd.Initialize(prev, body, b2Vec2(10.0f + i, 10.0f));
+		if (i % 2 == 1)
+		{
+			b2AngularStiffness(wjd.stiffness, wjd.damping, 5.0f, 0.7f, prev, body);
+		}
+
+		world->CreateJoint(&wjd);
+		prev = body;
+	}
+}
+
+DOCTEST_TEST_CASE("joint batching")
+{
+	extern B2_API int32 b2_batchedJoints;
+
+	b2Vec2 gravity(0.0f, -10.0f);
+	b2World batched(gravity);
+	b2World scalar(gravity);
+	CHECK(scalar.GetJointBatching() == false);
+	batched.SetJointBatching(true);
+
+	b2RevoluteJoint *topBatched, *topScalar, *armBatched, *armScalar;
+	CreateJointScene(&batched, &topBatched, &armBatched);
+	CreateJointScene(&scalar, &topScalar, &armScalar);
+
+	const float timeStep = 1.0f / 60.0f;
+	int32 batchedJoints = 0;
+	for (int32 i = 0; i < 120; ++i)
+	{
+		b2_batchedJoints = 0;
+		batched.Step(timeStep, 8, 3);
+		batchedJoints = b2_batchedJoints;
+
+		b2_batchedJoints = 0;
+		scalar.Step(timeStep, 8, 3);
+		CHECK(b2_batchedJoints == 0);
+	}
+
+	// Each body is in the scalar world at the same place in the list.
+	const b2Body* b = batched.GetBodyList();
+	const b2Body* s = scalar.GetBodyList();
+	float maxDrift = 0.0f;
+	for (; b && s; b = b->GetNext(), s = s->GetNext())
+	{
+		maxDrift = b2Max(maxDrift, b2Distance(b->GetPosition(), s->GetPosition()));
+	}
+	CHECK(maxDrift < 0.05f);
+
+	// The batched joints hold together as well as the scalar ones.
+	float batchedError = 0.0f;
+	for (const b2Joint* j = batched.GetJointList(); j; j = j->GetNext())
+	{
+		batchedError = b2Max(batchedError, b2Distance(j->GetAnchorA(), j->GetAnchorB()));
+	}
+
+	float scalarError = 0.0f;
+	for (const b2Joint* j = scalar.GetJointList(); j; j = j->GetNext())
+	{
+		scalarError = b2Max(scalarError, b2Distance(j->GetAnchorA(), j->GetAnchorB()));
+	}
+	CHECK(batchedError < 1.1f * scalarError);
+
+	// The arm is alone in its island, which is too small to batch.
+#if defined(LIQUIDFUN_SIMD_SSE)
+	CHECK(batchedJoints == 50);
+#endif
+
+	// The impulses come back to the joints. The top link carries the chain.
+	float weight = 30.0f * 0.2f * 1.0f * 10.0f;
+	float topForce = topBatched->GetReactionForce(60.0f).y;
+	CHECK(b2Abs(topForce - weight) < 0.15f * weight);
+	CHECK(b2Abs(topForce - topScalar->GetReactionForce(60.0f).y) < 0.01f * weight);
+
+	// The motor drives the arm to its upper limit.
+	CHECK(b2Abs(armBatched->GetJointAngle() - 0.5f * b2_pi) < 0.01f);
+	CHECK(b2Abs(armBatched->GetMotorTorque(60.0f) - armScalar->GetMotorTorque(60.0f)) < 0.01f * b2Abs(armScalar->GetMotorTorque(60.0f)));
+}
+
+// A row of sliders on vertical prismatic joints tied together by spring, rigid and
+// ranged distance joints. Every other slider is driven down by its motor.
+static void CreateSliderScene(b2World* world, b2PrismaticJoint** motor)
+{
+	b2BodyDef bd;
+	b2Body* ground = world->CreateBody(&bd);
+
+	b2PolygonShape box;
+	box.SetAsBox(0.25f, 0.25f);
+	b2FixtureDef fd;
+	fd.shape = &box;
+	fd.density = 1.0f;
+	fd.filter.maskBits = 0;
+
+	bd.type = b2_dynamicBody;
+	b2PrismaticJointDef pjd;
+	pjd.enableLimit = true;
+	pjd.lowerTranslation = -2.0f;
+	pjd.upperTranslation = 1.0f;
+	pjd.maxMotorForce = 50.0f;
+	pjd.motorSpeed = -1.0f;
+
+	b2DistanceJointDef djd;
+	b2Body* prev = NULL;
+	for (int32 i = 0; i < 16; ++i)
+	{
+		bd.position.Set(1.0f * i, 10.0f);
+		b2Body* body = world->CreateBody(&bd);
+		body->CreateFixture(&fd);
+
+		pjd.Initialize(ground, body, bd.position, b2Vec2(0.0f, 1.0f));
+		pjd.enableMotor = i % 2 == 0;
+		b2Joint* joint = world->CreateJoint(&pjd);
+		if (i == 0)
+		{
+			*motor = (b2PrismaticJoint*)joint;
+		}
+
+		if (prev != NULL)
+		{
+			djd.Initialize(prev, body, prev->GetPosition(), body->GetPosition());
+			djd.minLength = djd.length;
+			djd.maxLength = djd.length;
+			djd.stiffness = 0.0f;
+			djd.damping = 0.0f;
+			if (i % 3 == 1)
+			{
+				b2LinearStiffness(djd.stiffness, djd.damping, 2.0f, 0.5f, prev, body);
+			}
+			else if (i % 3 == 2)
+			{
+				djd.minLength = 0.9f * djd.length;
+				djd.maxLength = 1.2f * djd.length;
+			}
+
+			world->CreateJoint(&djd);
+		}
+
+		prev = body;
+	}
+}
+
+DOCTEST_TEST_CASE("prismatic and distance batching")
+{
+	extern B2_API int32 b2_batchedJoints;
+
+	b2Vec2 gravity(0.0f, -10.0f);
+	b2World batched(gravity);
+	b2World scalar(gravity);
+	batched.SetJointBatching(true);
+
+	b2PrismaticJoint *motorBatched, *motorScalar;
+	CreateSliderScene(&batched, &motorBatched);
+	CreateSliderScene(&scalar, &motorScalar);
+
+	const float timeStep = 1.0f / 60.0f;
+	int32 batchedJoints = 0;
+	for (int32 i = 0; i < 120; ++i)
+	{
+		// Cutting a joint changes the graph, so the joints are colored again.
+		if (i == 60)
+		{
+			batched.DestroyJoint(batched.GetJointList());
+			scalar.DestroyJoint(scalar.GetJointList());
+		}
+
+		b2_batchedJoints = 0;
+		batched.Step(timeStep, 8, 3);
+		batchedJoints = b2_batchedJoints;
+
+		b2_batchedJoints = 0;
+		scalar.Step(timeStep, 8, 3);
+		CHECK(b2_batchedJoints == 0);
+	}
+
+	const b2Body* b = batched.GetBodyList();
+	const b2Body* s = scalar.GetBodyList();
+	float maxDrift = 0.0f;
+	for (; b && s; b = b->GetNext(), s = s->GetNext())
+	{
+		CHECK(b->GetPosition().IsValid());
+		maxDrift = b2Max(maxDrift, b2Distance(b->GetPosition(), s->GetPosition()));
+	}
+	CHECK(maxDrift < 0.01f);
+
+	// The cut left the last slider alone in its island, which is too small to batch.
+#if defined(LIQUIDFUN_SIMD_SSE)
+	CHECK(batchedJoints == 16 + 15 - 2);
+#endif
+
+	// The impulses come back to the joints. The row is over-constrained sideways, so only
+	// the forces along the slider axes are unique.
+	CHECK(b2Abs(motorBatched->GetJointTranslation() + 2.0f) < 0.01f);
+	CHECK(b2Abs(motorBatched->GetMotorForce(60.0f) - motorScalar->GetMotorForce(60.0f)) < 0.01f);
+	float axialForce = 0.0f;
+	float axialError = 0.0f;
+	const b2Joint* jb = batched.GetJointList();
+	const b2Joint* js = scalar.GetJointList();
+	for (; jb && js; jb = jb->GetNext(), js = js->GetNext())
+	{
+		if (jb->GetType() == e_prismaticJoint)
+		{
+			float force = js->GetReactionForce(60.0f).y;
+			axialForce = b2Max(axialForce, b2Abs(force));
+			axialError = b2Max(axialError, b2Abs(jb->GetReactionForce(60.0f).y - force));
+		}
+	}
+	CHECK(axialError < 0.05f * axialForce);
+}
+
+// A chain swinging a ball. The loop ties the top of the chain to the ball with a rigid distance joint.
+static void CreateSwingingChain(b2World* world, bool loop)
+{
+	b2BodyDef bd;
+	b2Body* ground = world->CreateBody(&bd);
+
+	b2PolygonShape link;
+	link.SetAsBox(0.1f, 0.25f);
+	b2FixtureDef fd;
+	fd.shape = &link;
+	fd.density = 1.0f;
+	fd.filter.maskBits = 0;
+
+	bd.type = b2_dynamicBody;
+	b2RevoluteJointDef rjd;
+	b2Body* prev = ground;
+	b2Body* top = NULL;
+	for (int32 i = 0; i < 20; ++i)
+	{
+		bd.position.Set(0.0f, 19.75f - 0.5f * i);
+		b2Body* body = world->CreateBody(&bd);
+		body->CreateFixture(&fd);
+		rjd.Initialize(prev, body, b2Vec2(0.0f, 20.0f - 0.5f * i));
+		world->CreateJoint(&rjd);
+		top = top ? top : body;
+		prev = body;
+	}
+
+	b2CircleShape ball;
+	ball.m_radius = 1.0f;
+	fd.shape = &ball;
+	bd.position.Set(0.0f, 9.0f);
+	bd.linearVelocity.Set(5.0f, 0.0f);
+	b2Body* body = world->CreateBody(&bd);
+	body->CreateFixture(&fd);
+	rjd.Initialize(prev, body, b2Vec2(0.0f, 10.0f));
+	world->CreateJoint(&rjd);
+
+	if (loop)
+	{
+		b2DistanceJointDef djd;
+		djd.Initialize(top, body, top->GetPosition(), body->GetPosition());
+		djd.minLength = djd.length;
+		djd.maxLength = djd.length;
+		world->CreateJoint(&djd);
+	}
+}
+
+static float GetMaxJointError(const b2World* world)
+{
+	float maxError = 0.0f;
+	for (const b2Joint* j = world->GetJointList(); j; j = j->GetNext())
+	{
+		if (j->GetType() == e_revoluteJoint)
+		{
+			maxError = b2Max(maxError, b2Distance(j->GetAnchorA(), j->GetAnchorB()));
+		}
+	}
+
+	return maxError;
+}
+
+DOCTEST_TEST_CASE("direct joint solver")
+{
+	extern B2_API int32 b2_directJoints;
+
+	b2Vec2 gravity(0.0f, -10.0f);
+	b2World direct(gravity);
+	b2World loop(gravity);
+	b2World iterative(gravity);
+	direct.SetDirectJointSolver(true);
+	loop.SetDirectJointSolver(true);
+	CreateSwingingChain(&direct, false);
+	CreateSwingingChain(&loop, true);
+	CreateSwingingChain(&iterative, false);
+
+	const float timeStep = 1.0f / 60.0f;
+	int32 directJoints = 0, loopJoints = 0;
+	for (int32 i = 0; i < 120; ++i)
+	{
+		b2_directJoints = 0;
+		direct.Step(timeStep, 4, 2);
+		directJoints = b2_directJoints;
+
+		b2_directJoints = 0;
+		loop.Step(timeStep, 4, 2);
+		loopJoints = b2_directJoints;
+
+		b2_directJoints = 0;
+		iterative.Step(timeStep, 4, 2);
+		CHECK(b2_directJoints == 0);
+	}
+
+	// The joint closing the loop is left to the iterative solver.
+	CHECK(directJoints == 21);
+	CHECK(loopJoints == 21);
+
+	// The chain stretches much less with the same iteration count.
+	float iterativeError = GetMaxJointError(&iterative);
+	CHECK(GetMaxJointError(&direct) < 0.25f * iterativeError);
+	CHECK(GetMaxJointError(&loop) < iterativeError);
+
+	// A hanging chain is carried exactly by the top joint. The arm, with its motor and limit,
+	// stays iterative, and so do the welds after the first soft one.
+	b2World hanging(gravity);
+	hanging.SetDirectJointSolver(true);
+	b2RevoluteJoint *top, *arm;
+	CreateJointScene(&hanging, &top, &arm);
+	b2_directJoints = 0;
+	hanging.Step(timeStep, 8, 3);
+	CHECK(b2_directJoints == 31);
+	for (int32 i = 0; i < 120; ++i)
+	{
+		hanging.Step(timeStep, 8, 3);
+	}
+
+	float weight = 30.0f * 0.2f * 1.0f * 10.0f;
+	CHECK(b2Abs(top->GetReactionForce(60.0f).y - weight) < 0.01f * weight);
+	CHECK(b2Abs(arm->GetJointAngle() - 0.5f * b2_pi) < 0.01f);
+
+	// Bodies pinned to the ground by several revolute or weld joints. Only one anchor of
+	// each body is direct, the others would make the direct rows singular.
+	b2World pinned(gravity);
+	pinned.SetDirectJointSolver(true);
+	b2BodyDef pd;
+	b2Body* pinGround = pinned.CreateBody(&pd);
+	b2PolygonShape plate;
+	plate.SetAsBox(0.5f, 0.5f);
+	pd.type = b2_dynamicBody;
+	for (int32 i = 0; i < 20; ++i)
+	{
+		pd.position.Set(2.0f * i, 5.0f);
+		b2Body* body = pinned.CreateBody(&pd);
+		body->CreateFixture(&plate, 1.0f);
+		int32 count = 2 + i % 3;
+		for (int32 j = 0; j < count; ++j)
+		{
+			b2Vec2 anchor = pd.position + b2Vec2(0.4f * (j % 2) - 0.2f, 0.4f * (j / 2) - 0.2f);
+			if (i % 2 == 0)
+			{
+				b2RevoluteJointDef pin;
+				pin.Initialize(pinGround, body, anchor);
+				pinned.CreateJoint(&pin);
+			}
+			else
+			{
+				b2WeldJointDef pin;
+				pin.Initialize(pinGround, body, anchor);
+				pinned.CreateJoint(&pin);
+			}
+		}
+	}
+
+	b2_directJoints = 0;
+	pinned.Step(timeStep, 8, 3);
+	CHECK(b2_directJoints == 20);
+	for (int32 i = 0; i < 60; ++i)
+	{
+		pinned.Step(timeStep, 8, 3);
+	}
+
+	for (b2Body* b = pinned.GetBodyList(); b; b = b->GetNext())
+	{
+		CHECK(b->GetPosition().IsValid());
+		CHECK(b->GetLinearVelocity().IsValid());
+		if (b != pinGround)
+		{
+			CHECK(b2Abs(b->GetPosition().y - 5.0f) < 0.01f);
+		}
+	}
+
+	// A body hanging from a moving kinematic body is carried along with it.
+	b2World carried(gravity);
+	carried.SetDirectJointSolver(true);
+	b2BodyDef bd;
+	bd.type = b2_kinematicBody;
+	bd.linearVelocity.Set(5.0f, 0.0f);
+	b2Body* platform = carried.CreateBody(&bd);
+	bd.type = b2_dynamicBody;
+	bd.position.Set(0.0f, -1.0f);
+	b2Body* load = carried.CreateBody(&bd);
+	b2PolygonShape box;
+	box.SetAsBox(0.25f, 0.25f);
+	load->CreateFixture(&box, 1.0f);
+	b2RevoluteJointDef rjd;
+	rjd.Initialize(platform, load, b2Vec2(0.0f, 0.0f));
+	carried.CreateJoint(&rjd);
+	b2_directJoints = 0;
+	for (int32 i = 0; i < 60; ++i)
+	{
+		carried.Step(timeStep, 8, 3);
+	}
+
+	CHECK(b2_directJoints == 0);
+	CHECK(b2Abs(load->GetLinearVelocity().x - 5.0f) < 0.1f);
+	CHECK(b2Distance(load->GetPosition(), platform->GetPosition()) == doctest::Approx(1.0f).epsilon(0.01));
+}
@@ -23,6 +23,8 @@
 #include "box2d/box2d.h"
 #include "doctest.h"
 #include <stdio.h>
+#include <atomic>
+#include <thread>
 
 static bool begin_contact = false;
 
@@ -71,3 +73,1305 @@ DOCTEST_TEST_CASE("begin contact")
 	CHECK(world.GetContactList() != nullptr);
 	CHECK(begin_contact == true);
 }
+
+DOCTEST_TEST_CASE("contact pairs")
+{
+	SUBCASE("pair set")
+	{
+		// Addresses inside an array serve as keys.
+		const int32 count = 64;
+		static char keys[count];
+		static bool present[count][count];
+
+		b2PairSet set;
+		int32 expected = 0;
+		srand(3);
+
+		for (int32 k = 0; k < 4000; ++k)
+		{
+			int32 i = rand() % count;
+			int32 j = rand() % count;
+			if (i == j)
+			{
+				continue;
+			}
+
+			bool& flag = present[b2Min(i, j)][b2Max(i, j)];
+			if (rand() % 3 == 0)
+			{
+				CHECK(set.Remove(keys + j, 0, keys + i, 0) == flag);
+				expected -= flag ? 1 : 0;
+				flag = false;
+			}
+			else
+			{
+				CHECK(set.Add(keys + i, 0, keys + j, 0) == (flag == false));
+				expected += flag ? 0 : 1;
+				flag = true;
+			}
+
+			CHECK(set.Contains(keys + j, 0, keys + i, 0) == flag);
+		}
+
+		CHECK(set.GetCount() == expected);
+
+		for (int32 i = 0; i < count; ++i)
+		{
+			for (int32 j = i + 1; j < count; ++j)
+			{
+				CHECK(set.Contains(keys + i, 0, keys + j, 0) == present[i][j]);
+			}
+		}
+	}
+
+	SUBCASE("pile on one ground body")
+	{
+		b2World world(b2Vec2(0.0f, -10.0f));
+
+		b2BodyDef bd;
+		b2Body* ground = world.CreateBody(&bd);
+		b2EdgeShape edge;
+		edge.SetTwoSided(b2Vec2(-40.0f, 0.0f), b2Vec2(40.0f, 0.0f));
+		ground->CreateFixture(&edge, 0.0f);
+
+		b2PolygonShape box;
+		box.SetAsBox(0.5f, 0.5f);
+
+		const int32 count = 60;
+		b2Body* bodies[count];
+		bd.type = b2_dynamicBody;
+		for (int32 i = 0; i < count; ++i)
+		{
+			bd.position.Set(-30.0f + 1.0f * i, 0.5f);
+			bodies[i] = world.CreateBody(&bd);
+			bodies[i]->CreateFixture(&box, 1.0f);
+		}
+
+		for (int32 i = 0; i < 10; ++i)
+		{
+			world.Step(1.0f / 60.0f, 8, 3);
+		}
+
+		// Each box touches the ground and its neighbors, exactly once per pair.
+		CHECK(world.GetContactCount() == count + count - 1);
+
+		for (int32 i = 0; i < count; i += 2)
+		{
+			world.DestroyBody(bodies[i]);
+		}
+
+		// Touching the proxies finds the same pairs again, which must not duplicate contacts.
+		for (int32 i = 1; i < count; i += 2)
+		{
+			bodies[i]->SetType(b2_kinematicBody);
+			bodies[i]->SetType(b2_dynamicBody);
+			bodies[i]->SetAwake(true);
+		}
+
+		world.Step(1.0f / 60.0f, 8, 3);
+		world.Step(1.0f / 60.0f, 8, 3);
+		CHECK(world.GetContactCount() == count / 2);
+	}
+}
+
+DOCTEST_TEST_CASE("manifold reuse")
+{
+	b2World world(b2Vec2(0.0f, 0.0f));
+	world.SetAllowSleeping(false);
+
+	b2BodyDef bd;
+	b2Body* ground = world.CreateBody(&bd);
+	b2EdgeShape edge;
+	edge.SetTwoSided(b2Vec2(-10.0f, 0.0f), b2Vec2(10.0f, 0.0f));
+	ground->CreateFixture(&edge, 0.0f);
+
+	b2PolygonShape box;
+	box.SetAsBox(0.5f, 0.5f);
+	bd.type = b2_dynamicBody;
+	bd.position.Set(0.0f, 0.5f);
+	b2Body* body = world.CreateBody(&bd);
+	body->CreateFixture(&box, 1.0f);
+
+	for (int32 i = 0; i < 10; ++i)
+	{
+		world.Step(1.0f / 60.0f, 8, 3);
+	}
+
+	b2Contact* contact = world.GetContactList();
+	REQUIRE(contact != nullptr);
+	REQUIRE(contact->IsTouching());
+	b2Manifold manifold = *contact->GetManifold();
+
+	// The box is at rest, so stepping keeps the manifold and its impulses.
+	world.Step(1.0f / 60.0f, 8, 3);
+	const b2Manifold* cached = contact->GetManifold();
+	CHECK(contact->IsTouching());
+	REQUIRE(cached->pointCount == manifold.pointCount);
+	for (int32 i = 0; i < manifold.pointCount; ++i)
+	{
+		CHECK(cached->points[i].localPoint == manifold.points[i].localPoint);
+		CHECK(cached->points[i].id.key == manifold.points[i].id.key);
+	}
+
+	// Moving the body over the end of the edge recomputes the clipped manifold.
+	body->SetTransform(b2Vec2(9.8f, 0.5f), 0.0f);
+	world.Step(1.0f / 60.0f, 8, 3);
+	CHECK(contact->IsTouching());
+	REQUIRE(contact->GetManifold()->pointCount == manifold.pointCount);
+	bool changed = false;
+	for (int32 i = 0; i < manifold.pointCount; ++i)
+	{
+		changed = changed || contact->GetManifold()->points[i].localPoint != manifold.points[i].localPoint;
+	}
+	CHECK(changed);
+}
+
+DOCTEST_TEST_CASE("capsule")
+{
+	b2World world(b2Vec2(0.0f, -10.0f));
+
+	b2BodyDef bd;
+	b2Body* ground = world.CreateBody(&bd);
+	b2Vec2 vs[4] = { b2Vec2(20.0f, 10.0f), b2Vec2(10.0f, 0.0f), b2Vec2(-10.0f, 0.0f), b2Vec2(-20.0f, 10.0f) };
+	b2ChainShape chain;
+	chain.CreateChain(vs, 4, b2Vec2(30.0f, 10.0f), b2Vec2(-30.0f, 10.0f));
+	ground->CreateFixture(&chain, 0.0f);
+
+	b2EdgeShape edge;
+	edge.SetTwoSided(b2Vec2(20.0f, 5.0f), b2Vec2(30.0f, 5.0f));
+	ground->CreateFixture(&edge, 0.0f);
+
+	b2CapsuleShape capsule;
+	capsule.Set(b2Vec2(-0.5f, 0.0f), b2Vec2(0.5f, 0.0f), 0.25f);
+
+	b2PolygonShape box;
+	box.SetAsBox(1.0f, 0.5f);
+
+	b2CircleShape circle;
+	circle.m_radius = 0.25f;
+
+	// A capsule lying on the chain, a box on top of it, a capsule on the box and a
+	// circle on that capsule.
+	bd.type = b2_dynamicBody;
+	bd.position.Set(0.0f, 0.25f);
+	b2Body* lying = world.CreateBody(&bd);
+	lying->CreateFixture(&capsule, 1.0f);
+
+	bd.position.Set(0.0f, 1.0f);
+	b2Body* boxBody = world.CreateBody(&bd);
+	boxBody->CreateFixture(&box, 1.0f);
+
+	bd.position.Set(0.0f, 1.75f);
+	b2Body* top = world.CreateBody(&bd);
+	top->CreateFixture(&capsule, 1.0f);
+
+	bd.position.Set(0.0f, 2.25f);
+	b2Body* ball = world.CreateBody(&bd);
+	ball->CreateFixture(&circle, 1.0f);
+
+	// A capsule whose end cap overlaps the end of the two-sided edge. Only the
+	// rounded cap touches it.
+	bd.position.Set(30.6f, 5.2f);
+	b2Body* overhang = world.CreateBody(&bd);
+	overhang->CreateFixture(&capsule, 1.0f);
+
+	world.Step(1.0f / 60.0f, 8, 3);
+	CHECK(overhang->GetContactList() != nullptr);
+	CHECK(overhang->GetContactList()->contact->IsTouching());
+
+	for (int32 i = 0; i < 120; ++i)
+	{
+		world.Step(1.0f / 60.0f, 8, 3);
+	}
+
+	CHECK(b2Abs(lying->GetPosition().y - 0.25f) < 2.0f * b2_linearSlop);
+	CHECK(b2Abs(boxBody->GetPosition().y - 1.0f) < 3.0f * b2_linearSlop);
+	CHECK(b2Abs(top->GetPosition().y - 1.75f) < 4.0f * b2_linearSlop);
+	CHECK(b2Abs(top->GetAngle()) < 0.01f);
+	CHECK(b2Abs(lying->GetPosition().x) < 0.01f);
+
+	// Each body in the stack touches the one below it, once.
+	int32 touching = 0;
+	for (b2Contact* c = world.GetContactList(); c; c = c->GetNext())
+	{
+		const b2Body* bodyA = c->GetFixtureA()->GetBody();
+		const b2Body* bodyB = c->GetFixtureB()->GetBody();
+		if (c->IsTouching() && bodyA != overhang && bodyB != overhang)
+		{
+			++touching;
+		}
+	}
+	CHECK(touching == 4);
+}
+
+DOCTEST_TEST_CASE("circle bullets")
+{
+	extern B2_API int32 b2_toiCalls, b2_toiCircleCalls;
+
+	b2World world(b2Vec2(0.0f, -10.0f));
+
+	// A thin floor and a thin wall.
+	b2BodyDef bd;
+	b2Body* ground = world.CreateBody(&bd);
+	b2EdgeShape edge;
+	edge.SetTwoSided(b2Vec2(-20.0f, 0.0f), b2Vec2(20.0f, 0.0f));
+	ground->CreateFixture(&edge, 0.0f);
+	b2PolygonShape wall;
+	wall.SetAsBox(0.05f, 5.0f, b2Vec2(10.0f, 5.0f), 0.0f);
+	ground->CreateFixture(&wall, 0.0f);
+
+	b2CircleShape circle;
+	circle.m_radius = 0.1f;
+
+	// Fast bullets, some spinning, aimed at the floor and the wall.
+	bd.type = b2_dynamicBody;
+	bd.bullet = true;
+	b2Body* bullets[8];
+	for (int32 i = 0; i < 8; ++i)
+	{
+		bd.position.Set(-4.0f + i, 3.0f);
+		bd.linearVelocity = (i & 1) ? b2Vec2(300.0f, -20.0f) : b2Vec2(5.0f, -300.0f);
+		bd.angularVelocity = (i & 2) ? 40.0f : 0.0f;
+		bullets[i] = world.CreateBody(&bd);
+		bullets[i]->CreateFixture(&circle, 1.0f);
+	}
+
+	b2_toiCalls = 0;
+	b2_toiCircleCalls = 0;
+	for (int32 i = 0; i < 60; ++i)
+	{
+		world.Step(1.0f / 60.0f, 8, 3);
+	}
+
+	// Every impact took the closed form and nothing tunneled.
+	CHECK(b2_toiCircleCalls > 0);
+	CHECK(b2_toiCalls == 0);
+	for (int32 i = 0; i < 8; ++i)
+	{
+		b2Vec2 p = bullets[i]->GetPosition();
+		CHECK(p.y > 0.0f);
+		CHECK(p.x < 10.0f);
+	}
+}
+
+// Keeps the closest shape cast hit, skipping one fixture.
+class ClosestShapeCast : public b2ShapeCastCallback
+{
+public:
+	bool ShouldCastFixture(b2Fixture* fixture) override
+	{
+		return fixture != skip;
+	}
+
+	float ReportFixture(b2Fixture* fixture, int32 childIndex, const b2Vec2& point,
+		const b2Vec2& normal, float fraction) override
+	{
+		++reports;
+		this->fixture = fixture;
+		this->childIndex = childIndex;
+		this->point = point;
+		this->normal = normal;
+		this->fraction = fraction;
+		return fraction;
+	}
+
+	b2Fixture* skip = nullptr;
+	b2Fixture* fixture = nullptr;
+	int32 childIndex = -1;
+	int32 reports = 0;
+	b2Vec2 point, normal;
+	float fraction = 1.0f;
+};
+
+// Counts every shape cast hit.
+class AllShapeCast : public b2ShapeCastCallback
+{
+public:
+	float ReportFixture(b2Fixture*, int32, const b2Vec2&, const b2Vec2&, float) override
+	{
+		++count;
+		return 1.0f;
+	}
+
+	int32 count = 0;
+};
+
+DOCTEST_TEST_CASE("shape cast")
+{
+	b2World world(b2Vec2(0.0f, -10.0f));
+
+	// A row of boxes along the x axis and a single proxy chain floor below them.
+	b2BodyDef bd;
+	b2Body* ground = world.CreateBody(&bd);
+	b2Vec2 vs[3] = { b2Vec2(-10.0f, -2.0f), b2Vec2(0.0f, -3.0f), b2Vec2(40.0f, -2.0f) };
+	b2ChainShape chain;
+	chain.CreateChain(vs, 3, b2Vec2(-20.0f, -2.0f), b2Vec2(50.0f, -2.0f));
+	chain.SetSingleProxy(true);
+	b2Fixture* floor = ground->CreateFixture(&chain, 0.0f);
+
+	b2Fixture* boxes[10];
+	b2PolygonShape box;
+	box.SetAsBox(0.5f, 0.5f);
+	for (int32 i = 0; i < 10; ++i)
+	{
+		bd.position.Set(4.0f * (i + 1), 0.25f * (i % 3));
+		b2Body* body = world.CreateBody(&bd);
+		boxes[i] = body->CreateFixture(&box, 0.0f);
+	}
+
+	b2CapsuleShape capsule;
+	capsule.Set(b2Vec2(0.0f, -0.5f), b2Vec2(0.0f, 0.5f), 0.25f);
+	b2Transform xf(b2Vec2(0.0f, 0.0f), b2Rot(0.0f));
+
+	// The closest hit is the first box. Its face is at x = 3.5 and the capsule radius is 0.25.
+	ClosestShapeCast closest;
+	world.ShapeCast(&closest, &capsule, xf, b2Vec2(50.0f, 0.0f));
+	CHECK(closest.fixture == boxes[0]);
+	CHECK(closest.fraction == doctest::Approx(3.25f / 50.0f).epsilon(0.01));
+	CHECK(closest.normal.x == doctest::Approx(-1.0f).epsilon(0.01));
+	CHECK(closest.point.x == doctest::Approx(3.5f).epsilon(0.01));
+
+	// The candidates beyond the first hit are never cast.
+	CHECK(closest.reports == 1);
+
+	// The filter moves the closest hit to the next box.
+	ClosestShapeCast filtered;
+	filtered.skip = boxes[0];
+	world.ShapeCast(&filtered, &capsule, xf, b2Vec2(50.0f, 0.0f));
+	CHECK(filtered.fixture == boxes[1]);
+
+	// Every box is in the way when nothing clips the cast. The floor is not.
+	AllShapeCast all;
+	world.ShapeCast(&all, &capsule, xf, b2Vec2(50.0f, 0.0f));
+	CHECK(all.count == 10);
+
+	// Cast down onto the chain. The hit child is the edge under the shape.
+	ClosestShapeCast down;
+	world.ShapeCast(&down, &capsule, b2Transform(b2Vec2(2.0f, 0.0f), b2Rot(0.0f)), b2Vec2(0.0f, -10.0f));
+	CHECK(down.fixture == floor);
+	CHECK(down.childIndex == 1);
+	CHECK(down.normal.y > 0.9f);
+
+	// Nothing in the way.
+	ClosestShapeCast none;
+	world.ShapeCast(&none, &capsule, xf, b2Vec2(0.0f, 10.0f));
+	CHECK(none.fixture == nullptr);
+
+	// A height field with 599 cells under the sweep and a raised patch near its far end.
+	float heights[600];
+	for (int32 i = 0; i < 600; ++i)
+	{
+		heights[i] = i >= 500 && i < 520 ? 1.0f : 0.0f;
+	}
+	b2GridShape field;
+	field.CreateHeightField(heights, 600, 0.25f, b2Vec2(0.0f, 100.0f));
+	b2Fixture* fieldFixture = ground->CreateFixture(&field, 0.0f);
+
+	b2PolygonShape plank;
+	plank.SetAsBox(80.0f, 0.5f);
+	ClosestShapeCast patch;
+	world.ShapeCast(&patch, &plank, b2Transform(b2Vec2(75.0f, 105.0f), b2Rot(0.0f)), b2Vec2(0.0f, -10.0f));
+	CHECK(patch.fixture == fieldFixture);
+	CHECK(patch.childIndex >= 499);
+	CHECK(patch.point.y == doctest::Approx(101.0f).epsilon(0.01));
+}
+
+// Records the fixtures reported by a world query.
+class FixtureRecorder : public b2QueryCallback
+{
+public:
+	bool ReportFixture(b2Fixture* fixture) override
+	{
+		fixtures[count++] = fixture;
+		return count < 256;
+	}
+
+	b2Fixture* fixtures[256];
+	int32 count = 0;
+};
+
+DOCTEST_TEST_CASE("query shape")
+{
+	extern B2_API int32 b2_gjkCalls;
+
+	b2World world(b2Vec2(0.0f, -10.0f));
+
+	// Rotated boxes, circles and capsules scattered over a single proxy chain.
+	b2BodyDef bd;
+	b2Body* ground = world.CreateBody(&bd);
+	b2Vec2 vs[4] = { b2Vec2(-20.0f, 0.0f), b2Vec2(-5.0f, -1.0f), b2Vec2(5.0f, -1.0f), b2Vec2(20.0f, 0.0f) };
+	b2ChainShape chain;
+	chain.CreateChain(vs, 4, b2Vec2(-30.0f, 0.0f), b2Vec2(30.0f, 0.0f));
+	chain.SetSingleProxy(true);
+	ground->CreateFixture(&chain, 0.0f);
+
+	b2PolygonShape box;
+	box.SetAsBox(0.5f, 0.3f);
+	b2CircleShape circle;
+	circle.m_radius = 0.4f;
+	b2CapsuleShape capsule;
+	capsule.Set(b2Vec2(-0.4f, 0.0f), b2Vec2(0.4f, 0.0f), 0.2f);
+	const b2Shape* shapes[3] = { &box, &circle, &capsule };
+
+	srand(44);
+	bd.type = b2_dynamicBody;
+	for (int32 i = 0; i < 200; ++i)
+	{
+		bd.position.Set(-15.0f + 30.0f * rand() / float(RAND_MAX), -1.0f + 10.0f * rand() / float(RAND_MAX));
+		bd.angle = 3.0f * rand() / float(RAND_MAX);
+		world.CreateBody(&bd)->CreateFixture(shapes[i % 3], 1.0f);
+	}
+
+	b2PolygonShape blast;
+	blast.SetAsBox(3.0f, 2.0f);
+	b2CircleShape ball;
+	ball.m_radius = 3.0f;
+	const b2Shape* queries[2] = { &blast, &ball };
+
+	int32 totalHits = 0;
+	for (int32 k = 0; k < 20; ++k)
+	{
+		const b2Shape* query = queries[k % 2];
+		b2Transform xf(b2Vec2(-12.0f + 1.2f * k, 2.0f + 0.2f * k), b2Rot(0.3f * k));
+
+		FixtureRecorder recorder;
+		b2_gjkCalls = 0;
+		world.QueryShape(&recorder, query, xf);
+		int32 gjkCalls = b2_gjkCalls;
+
+		// Brute force with b2TestOverlap over every fixture child.
+		int32 expected = 0;
+		int32 pairs = 0;
+		for (b2Body* b = world.GetBodyList(); b; b = b->GetNext())
+		{
+			for (b2Fixture* f = b->GetFixtureList(); f; f = f->GetNext())
+			{
+				bool overlap = false;
+				for (int32 child = 0; child < f->GetShape()->GetChildCount() && overlap == false; ++child)
+				{
+					overlap = b2TestOverlap(query, 0, f->GetShape(), child, xf, b->GetTransform());
+				}
+
+				if (overlap)
+				{
+					++expected;
+					bool found = false;
+					for (int32 i = 0; i < recorder.count; ++i)
+					{
+						found = found || recorder.fixtures[i] == f;
+					}
+					CHECK(found);
+				}
+				++pairs;
+			}
+		}
+
+		CHECK(recorder.count == expected);
+		totalHits += expected;
+
+		// The cheap rejects keep GJK to a fraction of the candidates.
+		CHECK(gjkCalls < pairs / 4);
+
+		CHECK((world.QueryShape(query, xf) != nullptr) == (expected > 0));
+	}
+	CHECK(totalHits > 50);
+
+	b2Transform far(b2Vec2(0.0f, 100.0f), b2Rot(0.0f));
+	CHECK(world.QueryShape(&ball, far) == nullptr);
+
+	// A compound with 578 circles in the left corners of a diamond's bounds and one
+	// circle inside the diamond near its right vertex.
+	b2CircleShape dots[579];
+	const b2Shape* dotShapes[579];
+	int32 dotCount = 0;
+	for (int32 i = 0; i < 17; ++i)
+	{
+		for (int32 j = 0; j < 17; ++j)
+		{
+			dots[dotCount].m_radius = 0.05f;
+			dots[dotCount].m_p.Set(-9.5f + 0.25f * i, 5.5f + 0.25f * j);
+			dots[dotCount + 1].m_radius = 0.05f;
+			dots[dotCount + 1].m_p.Set(-9.5f + 0.25f * i, -5.5f - 0.25f * j);
+			dotCount += 2;
+		}
+	}
+	dots[dotCount].m_radius = 0.05f;
+	dots[dotCount].m_p.Set(9.0f, 0.0f);
+	++dotCount;
+	for (int32 i = 0; i < dotCount; ++i)
+	{
+		dotShapes[i] = dots + i;
+	}
+
+	b2CompoundShape compound;
+	compound.Create(dotShapes, dotCount);
+	b2BodyDef compoundDef;
+	compoundDef.position.Set(0.0f, 200.0f);
+	b2Fixture* compoundFixture = world.CreateBody(&compoundDef)->CreateFixture(&compound, 0.0f);
+
+	b2PolygonShape diamond;
+	diamond.SetAsBox(7.0f, 7.0f);
+	b2Transform diamondXf(b2Vec2(0.0f, 200.0f), b2Rot(0.25f * b2_pi));
+	CHECK(world.QueryShape(&diamond, diamondXf) == compoundFixture);
+}
+
+// Keeps the closest ray hit.
+class ClosestRayCast : public b2RayCastCallback
+{
+public:
+	float ReportFixture(b2Fixture* fixture, const b2Vec2&, const b2Vec2&, float fraction) override
+	{
+		this->fixture = fixture;
+		this->fraction = fraction;
+		return fraction;
+	}
+
+	b2Fixture* fixture = nullptr;
+	float fraction = 1.0f;
+};
+
+DOCTEST_TEST_CASE("callable queries")
+{
+	b2World world(b2Vec2(0.0f, -10.0f));
+
+	b2BodyDef bd;
+	b2PolygonShape box;
+	box.SetAsBox(0.5f, 0.5f);
+	for (int32 i = 0; i < 10; ++i)
+	{
+		for (int32 j = 0; j < 10; ++j)
+		{
+			bd.position.Set(2.0f * i, 2.0f * j);
+			world.CreateBody(&bd)->CreateFixture(&box, 0.0f);
+		}
+	}
+
+	b2AABB aabb;
+	aabb.lowerBound.Set(3.0f, 3.0f);
+	aabb.upperBound.Set(9.0f, 7.0f);
+
+	// A lambda sees the same fixtures as a b2QueryCallback.
+	FixtureRecorder recorder;
+	world.QueryAABB(&recorder, aabb);
+	int32 count = 0;
+	world.QueryAABB([&](b2Fixture* fixture) {
+		bool found = false;
+		for (int32 i = 0; i < recorder.count; ++i)
+		{
+			found = found || recorder.fixtures[i] == fixture;
+		}
+		CHECK(found);
+		++count;
+		return true;
+	}, aabb);
+	CHECK(count == recorder.count);
+	CHECK(count == 6);
+
+	// Returning false stops the query.
+	count = 0;
+	world.QueryAABB([&count](b2Fixture*) { ++count; return false; }, aabb);
+	CHECK(count == 1);
+
+	// A closest hit lambda ray cast matches the virtual callback.
+	b2Vec2 p1(-1.0f, 4.1f), p2(30.0f, 8.0f);
+	ClosestRayCast closest;
+	world.RayCast(&closest, p1, p2);
+	b2Fixture* hit = nullptr;
+	float hitFraction = 1.0f;
+	world.RayCast([&](b2Fixture* fixture, const b2Vec2&, const b2Vec2&, float fraction) {
+		hit = fixture;
+		hitFraction = fraction;
+		return fraction;
+	}, p1, p2);
+	CHECK(closest.fixture != nullptr);
+	CHECK(hit == closest.fixture);
+	CHECK(hitFraction == closest.fraction);
+}
+
+class SnapshotRecorder : public b2SnapshotQueryCallback
+{
+public:
+	bool ReportFixture(const b2SnapshotFixture& entry) override
+	{
+		fixtures[count++] = entry.fixture;
+		return true;
+	}
+
+	b2Fixture* fixtures[512];
+	int32 count = 0;
+};
+
+class SnapshotClosestRayCast : public b2SnapshotRayCastCallback
+{
+public:
+	float ReportFixture(const b2SnapshotFixture& entry, int32, const b2Vec2&, const b2Vec2&, float fraction) override
+	{
+		this->fixture = entry.fixture;
+		this->fraction = fraction;
+		return fraction;
+	}
+
+	b2Fixture* fixture = nullptr;
+	float fraction = 1.0f;
+};
+
+static bool SameFixtures(const SnapshotRecorder& a, const FixtureRecorder& b)
+{
+	if (a.count != b.count)
+	{
+		return false;
+	}
+
+	for (int32 i = 0; i < a.count; ++i)
+	{
+		bool found = false;
+		for (int32 j = 0; j < b.count; ++j)
+		{
+			found = found || a.fixtures[i] == b.fixtures[j];
+		}
+
+		if (found == false)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+DOCTEST_TEST_CASE("snapshot")
+{
+	extern B2_API int32 b2_gjkCalls;
+
+	b2World world(b2Vec2(0.0f, -10.0f));
+
+	b2BodyDef bd;
+	b2Body* ground = world.CreateBody(&bd);
+	b2Vec2 vs[4] = { b2Vec2(-20.0f, 0.0f), b2Vec2(-5.0f, -1.0f), b2Vec2(5.0f, -1.0f), b2Vec2(20.0f, 0.0f) };
+	b2ChainShape chain;
+	chain.CreateChain(vs, 4, b2Vec2(-30.0f, 0.0f), b2Vec2(30.0f, 0.0f));
+	chain.SetSingleProxy(true);
+	ground->CreateFixture(&chain, 0.0f);
+
+	b2PolygonShape box;
+	box.SetAsBox(0.5f, 0.3f);
+	b2CircleShape circle;
+	circle.m_radius = 0.4f;
+
+	srand(46);
+	bd.type = b2_dynamicBody;
+	for (int32 i = 0; i < 100; ++i)
+	{
+		bd.position.Set(-15.0f + 30.0f * rand() / float(RAND_MAX), 1.0f + 10.0f * rand() / float(RAND_MAX));
+		bd.angle = 3.0f * rand() / float(RAND_MAX);
+		world.CreateBody(&bd)->CreateFixture(i % 2 ? (const b2Shape*)&box : &circle, 1.0f);
+	}
+
+	CHECK(world.AcquireSnapshot() == nullptr);
+	world.SetSnapshotsEnabled(true);
+
+	for (int32 i = 0; i < 30; ++i)
+	{
+		world.Step(1.0f / 60.0f, 8, 3);
+	}
+
+	{
+		b2WorldSnapshotReader reader(&world);
+		REQUIRE(reader.Get() != nullptr);
+		CHECK(reader->GetStepCount() == 30);
+		CHECK(reader->GetFixtureCount() == 101);
+
+		// The captured transforms are those at the end of the last step.
+		for (int32 i = 0; i < reader->GetFixtureCount(); ++i)
+		{
+			const b2SnapshotFixture& entry = reader->GetFixture(i);
+			CHECK(entry.transform.p == entry.body->GetPosition());
+		}
+
+		// Queries agree with the world while it is not stepping.
+		b2AABB aabb;
+		aabb.lowerBound.Set(-6.0f, -2.0f);
+		aabb.upperBound.Set(4.0f, 3.0f);
+		SnapshotRecorder snapshotHits;
+		reader->QueryAABB(&snapshotHits, aabb);
+		FixtureRecorder worldHits;
+		world.QueryAABB(&worldHits, aabb);
+		CHECK(snapshotHits.count > 0);
+		CHECK(SameFixtures(snapshotHits, worldHits));
+
+		b2PolygonShape blast;
+		blast.SetAsBox(3.0f, 2.0f);
+		b2Transform xf(b2Vec2(2.0f, 0.5f), b2Rot(0.4f));
+		SnapshotRecorder snapshotShape;
+		b2_gjkCalls = 0;
+		reader->QueryShape(&snapshotShape, &blast, xf);
+		CHECK(b2_gjkCalls == 0);
+		FixtureRecorder worldShape;
+		world.QueryShape(&worldShape, &blast, xf);
+		CHECK(snapshotShape.count > 0);
+		CHECK(SameFixtures(snapshotShape, worldShape));
+
+		b2Vec2 p1(-25.0f, 8.0f), p2(25.0f, -3.0f);
+		SnapshotClosestRayCast snapshotRay;
+		reader->RayCast(&snapshotRay, p1, p2);
+		ClosestRayCast worldRay;
+		world.RayCast(&worldRay, p1, p2);
+		CHECK(snapshotRay.fixture != nullptr);
+		CHECK(snapshotRay.fixture == worldRay.fixture);
+		CHECK(snapshotRay.fraction == worldRay.fraction);
+
+		// A held snapshot is never overwritten. The world publishes into the
+		// other buffer and then skips publishing until the reader lets go.
+		world.Step(1.0f / 60.0f, 8, 3);
+		world.Step(1.0f / 60.0f, 8, 3);
+		world.Step(1.0f / 60.0f, 8, 3);
+		CHECK(reader->GetStepCount() == 30);
+
+		b2WorldSnapshotReader latest(&world);
+		CHECK(latest->GetStepCount() == 31);
+	}
+
+	world.Step(1.0f / 60.0f, 8, 3);
+	{
+		b2WorldSnapshotReader reader(&world);
+		CHECK(reader->GetStepCount() == 34);
+	}
+
+	// Query from another thread while the world steps.
+	std::atomic<bool> done(false);
+	std::atomic<int32> queries(0);
+	bool consistent = true;
+	std::thread querier([&]()
+	{
+		b2AABB all;
+		all.lowerBound.Set(-100.0f, -100.0f);
+		all.upperBound.Set(100.0f, 100.0f);
+		b2PolygonShape blast;
+		blast.SetAsBox(3.0f, 2.0f);
+		b2Transform xf(b2Vec2(2.0f, 0.5f), b2Rot(0.4f));
+		while (done.load() == false)
+		{
+			b2WorldSnapshotReader reader(&world);
+			SnapshotRecorder hits;
+			reader->QueryAABB(&hits, all);
+			consistent = consistent && hits.count == reader->GetFixtureCount();
+			SnapshotRecorder shapeHits;
+			reader->QueryShape(&shapeHits, &blast, xf);
+			++queries;
+		}
+	});
+
+	// Keep stepping until the querier has finished at least one pass.
+	for (int32 i = 0; i < 60 || queries.load() == 0; ++i)
+	{
+		world.Step(1.0f / 60.0f, 8, 3);
+	}
+
+	done = true;
+	querier.join();
+	CHECK(consistent);
+}
+
+DOCTEST_TEST_CASE("grid")
+{
+	b2World world(b2Vec2(0.0f, -10.0f));
+
+	// A flat height field with a hill, and a tile map with a floor two cells thick.
+	float heights[401];
+	for (int32 i = 0; i < 401; ++i)
+	{
+		float x = 0.25f * i - 50.0f;
+		heights[i] = x > 20.0f && x < 30.0f ? 2.0f - 0.4f * b2Abs(x - 25.0f) : 0.0f;
+	}
+	b2GridShape heightField;
+	heightField.CreateHeightField(heights, 401, 0.25f, b2Vec2(-50.0f, 0.0f));
+
+	uint8 tiles[100 * 4] = {};
+	for (int32 i = 0; i < 2 * 100; ++i)
+	{
+		tiles[i] = 1;
+	}
+	b2GridShape tileMap;
+	tileMap.CreateTileMap(tiles, 100, 4, 0.5f, b2Vec2(100.0f, -1.0f));
+
+	b2BodyDef bd;
+	b2Body* ground = world.CreateBody(&bd);
+	ground->CreateFixture(&heightField, 0.0f);
+	ground->CreateFixture(&tileMap, 0.0f);
+
+	// Each grid is a single proxy.
+	CHECK(world.GetProxyCount() == 2);
+
+	b2PolygonShape box;
+	box.SetAsBox(0.5f, 0.5f);
+	b2CircleShape circle;
+	circle.m_radius = 0.3f;
+	b2CapsuleShape capsule;
+	capsule.Set(b2Vec2(-0.4f, 0.0f), b2Vec2(0.4f, 0.0f), 0.2f);
+
+	bd.type = b2_dynamicBody;
+	bd.position.Set(0.1f, 0.6f);
+	b2Body* boxOnField = world.CreateBody(&bd);
+	boxOnField->CreateFixture(&box, 1.0f);
+
+	bd.position.Set(-10.0f, 0.5f);
+	b2Body* capsuleOnField = world.CreateBody(&bd);
+	capsuleOnField->CreateFixture(&capsule, 1.0f);
+
+	bd.position.Set(120.1f, 0.6f);
+	b2Body* boxOnTiles = world.CreateBody(&bd);
+	boxOnTiles->CreateFixture(&box, 1.0f);
+
+	// A ball rolling over the tile seams and another rolling up the hill.
+	bd.position.Set(130.0f, 0.4f);
+	bd.linearVelocity.Set(4.0f, 0.0f);
+	b2Body* ballOnTiles = world.CreateBody(&bd);
+	ballOnTiles->CreateFixture(&circle, 1.0f);
+
+	bd.position.Set(15.0f, 0.4f);
+	bd.linearVelocity.Set(4.0f, 0.0f);
+	b2Body* ballOnField = world.CreateBody(&bd);
+	ballOnField->CreateFixture(&circle, 1.0f);
+
+	// Let the bodies land before watching the ball on the tiles.
+	float maxBounce = 0.0f;
+	for (int32 i = 0; i < 300; ++i)
+	{
+		world.Step(1.0f / 60.0f, 8, 3);
+		if (i > 30 && ballOnTiles->GetPosition().x < 148.0f)
+		{
+			maxBounce = b2Max(maxBounce, b2Abs(ballOnTiles->GetLinearVelocity().y));
+		}
+	}
+
+	// The grids are rounded by the polygon radius.
+	float skin = b2_polygonRadius;
+	CHECK(b2Abs(boxOnField->GetPosition().y - 0.5f - 2.0f * skin) < 2.0f * b2_linearSlop);
+	CHECK(b2Abs(boxOnField->GetPosition().x - 0.1f) < 0.01f);
+	CHECK(b2Abs(capsuleOnField->GetPosition().y - 0.2f - skin) < 2.0f * b2_linearSlop);
+	CHECK(b2Abs(boxOnTiles->GetPosition().y - 0.5f - 2.0f * skin) < 2.0f * b2_linearSlop);
+	CHECK(ballOnTiles->GetPosition().x > 135.0f);
+	CHECK(maxBounce < 0.5f);
+
+	// The ball climbed the hill and rolled back down.
+	CHECK(b2Abs(ballOnField->GetPosition().y - 0.3f - skin) < 2.0f * b2_linearSlop);
+	CHECK(ballOnField->GetPosition().x < 20.0f);
+
+	// Ray casts find the surface inside the single proxy.
+	class RayCastClosest : public b2RayCastCallback
+	{
+	public:
+		float ReportFixture(b2Fixture* fixture, const b2Vec2& point, const b2Vec2& normal, float fraction) override
+		{
+			if (fixture->GetBody()->GetType() != b2_staticBody)
+			{
+				return -1.0f;
+			}
+
+			m_point = point;
+			m_normal = normal;
+			m_hit = true;
+			return fraction;
+		}
+
+		b2Vec2 m_point;
+		b2Vec2 m_normal;
+		bool m_hit = false;
+	};
+
+	RayCastClosest callback;
+	world.RayCast(&callback, b2Vec2(25.0f, 10.0f), b2Vec2(25.0f, -10.0f));
+	REQUIRE(callback.m_hit);
+	CHECK(b2Abs(callback.m_point.y - 2.0f) < 1e-4f);
+
+	RayCastClosest tileCallback;
+	world.RayCast(&tileCallback, b2Vec2(149.2f, 10.0f), b2Vec2(149.2f, -10.0f));
+	REQUIRE(tileCallback.m_hit);
+	CHECK(b2Abs(tileCallback.m_point.y) < 1e-4f);
+	CHECK(b2Distance(tileCallback.m_normal, b2Vec2(0.0f, 1.0f)) < 1e-4f);
+}
+
+DOCTEST_TEST_CASE("single proxy chain")
+{
+	b2World world(b2Vec2(0.0f, -10.0f));
+
+	// A spinning drum made of a fine loop on a kinematic body.
+	const int32 count = 720;
+	b2Vec2 vertices[count];
+	for (int32 i = 0; i < count; ++i)
+	{
+		float angle = -2.0f * b2_pi * i / count;
+		vertices[i].Set(10.0f * cosf(angle), 10.0f * sinf(angle));
+	}
+	b2ChainShape loop;
+	loop.CreateLoop(vertices, count);
+	loop.SetSingleProxy(true);
+
+	b2BodyDef bd;
+	bd.type = b2_kinematicBody;
+	bd.angularVelocity = 1.0f;
+	b2Body* drum = world.CreateBody(&bd);
+	drum->CreateFixture(&loop, 0.0f);
+	CHECK(world.GetProxyCount() == 1);
+
+	b2PolygonShape box;
+	box.SetAsBox(0.4f, 0.4f);
+	b2CircleShape circle;
+	circle.m_radius = 0.4f;
+
+	bd.type = b2_dynamicBody;
+	bd.angularVelocity = 0.0f;
+	b2Body* bodies[20];
+	for (int32 i = 0; i < 20; ++i)
+	{
+		bd.position.Set(-6.0f + 0.6f * i, -2.0f + 0.3f * (i % 5));
+		bodies[i] = world.CreateBody(&bd);
+		bodies[i]->CreateFixture(i % 2 ? (b2Shape*)&box : (b2Shape*)&circle, 1.0f);
+	}
+	CHECK(world.GetProxyCount() == 21);
+
+	float maxSpeed = 0.0f;
+	for (int32 i = 0; i < 600; ++i)
+	{
+		world.Step(1.0f / 60.0f, 8, 3);
+		for (int32 j = 0; j < 20; ++j)
+		{
+			maxSpeed = b2Max(maxSpeed, bodies[j]->GetLinearVelocity().Length());
+		}
+	}
+
+	// The drum has turned almost two rounds and kept everything inside.
+	CHECK(drum->GetAngle() > 9.9f);
+	for (int32 i = 0; i < 20; ++i)
+	{
+		CHECK(bodies[i]->GetPosition().Length() < 10.0f);
+	}
+
+	// The contacts are with single edges of the loop.
+	int32 drumContacts = 0;
+	for (b2ContactEdge* ce = drum->GetContactList(); ce; ce = ce->next)
+	{
+		CHECK(ce->contact->GetChildIndexA() < count);
+		drumContacts += ce->contact->IsTouching() ? 1 : 0;
+	}
+	CHECK(drumContacts >= 5);
+	CHECK(maxSpeed > 2.0f);
+}
+
+DOCTEST_TEST_CASE("compound")
+{
+	b2World world(b2Vec2(0.0f, -10.0f));
+
+	b2EdgeShape ground;
+	ground.SetTwoSided(b2Vec2(-40.0f, 0.0f), b2Vec2(40.0f, 0.0f));
+	b2BodyDef bd;
+	world.CreateBody(&bd)->CreateFixture(&ground, 0.0f);
+
+	// A table: a plank on two legs with round feet.
+	b2PolygonShape plank, leg1, leg2;
+	plank.SetAsBox(2.0f, 0.1f, b2Vec2(0.0f, 1.0f), 0.0f);
+	leg1.SetAsBox(0.1f, 0.4f, b2Vec2(-1.8f, 0.5f), 0.0f);
+	leg2.SetAsBox(0.1f, 0.4f, b2Vec2(1.8f, 0.5f), 0.0f);
+	b2CircleShape foot1, foot2;
+	foot1.m_p.Set(-1.8f, 0.0f);
+	foot1.m_radius = 0.15f;
+	foot2.m_p.Set(1.8f, 0.0f);
+	foot2.m_radius = 0.15f;
+	const b2Shape* parts[5] = { &plank, &leg1, &leg2, &foot1, &foot2 };
+	b2CompoundShape table;
+	table.Create(parts, 5);
+
+	// A bench resting on a capsule.
+	b2CapsuleShape seat;
+	seat.Set(b2Vec2(-1.0f, 0.0f), b2Vec2(1.0f, 0.0f), 0.3f);
+	b2PolygonShape back;
+	back.SetAsBox(1.0f, 0.1f, b2Vec2(0.0f, 0.4f), 0.0f);
+	const b2Shape* benchParts[2] = { &seat, &back };
+	b2CompoundShape bench;
+	bench.Create(benchParts, 2);
+
+	bd.type = b2_dynamicBody;
+	bd.position.Set(0.0f, 0.5f);
+	b2Body* tableBody = world.CreateBody(&bd);
+	tableBody->CreateFixture(&table, 1.0f);
+	bd.position.Set(-5.0f, 1.0f);
+	b2Body* benchBody = world.CreateBody(&bd);
+	benchBody->CreateFixture(&bench, 1.0f);
+	bd.position.Set(0.3f, 3.0f);
+	b2Body* topBench = world.CreateBody(&bd);
+	topBench->CreateFixture(&bench, 1.0f);
+
+	// One proxy per fixture, whatever the number of parts.
+	CHECK(world.GetProxyCount() == 4);
+
+	b2MassData massData;
+	table.ComputeMass(&massData, 1.0f);
+	CHECK(b2Abs(tableBody->GetMass() - massData.mass) < 1e-4f);
+
+	for (int32 i = 0; i < 300; ++i)
+	{
+		world.Step(1.0f / 60.0f, 8, 3);
+	}
+
+	// The table stands on its feet, the bench lies on its capsule and the second
+	// bench lies on the table. The resting heights include the child radii.
+	float tolerance = 2.0f * b2_linearSlop;
+	CHECK(b2Abs(tableBody->GetPosition().y - 0.15f) < tolerance);
+	CHECK(b2Abs(tableBody->GetAngle()) < 0.01f);
+	CHECK(b2Abs(benchBody->GetPosition().y - 0.3f) < tolerance);
+	CHECK(b2Abs(topBench->GetPosition().y - (0.15f + 1.1f + 0.3f)) < tolerance);
+
+	// The table touches the ground with its feet only, and the bench on top with its plank only.
+	for (b2ContactEdge* ce = tableBody->GetContactList(); ce; ce = ce->next)
+	{
+		b2Contact* contact = ce->contact;
+		if (contact->IsTouching() == false)
+		{
+			continue;
+		}
+
+		bool tableIsA = contact->GetFixtureA()->GetBody() == tableBody;
+		int32 child = tableIsA ? contact->GetChildIndexA() : contact->GetChildIndexB();
+		if (ce->other == topBench)
+		{
+			CHECK(child == 0);
+		}
+		else
+		{
+			CHECK((child == 3 || child == 4));
+		}
+	}
+}
+
+DOCTEST_TEST_CASE("shared shape")
+{
+	b2World world(b2Vec2(0.0f, -10.0f));
+
+	b2EdgeShape ground;
+	ground.SetTwoSided(b2Vec2(-40.0f, 0.0f), b2Vec2(40.0f, 0.0f));
+	b2BodyDef bd;
+	world.CreateBody(&bd)->CreateFixture(&ground, 0.0f);
+
+	b2PolygonShape box;
+	box.SetAsBox(0.5f, 0.5f);
+	b2SharedShape* crate = world.CreateSharedShape(&box);
+	CHECK(crate->GetFixtureCount() == 0);
+
+	// A pyramid of crates that all use the same polygon.
+	b2FixtureDef fd;
+	fd.sharedShape = crate;
+	fd.density = 1.0f;
+	fd.friction = 0.6f;
+	bd.type = b2_dynamicBody;
+	b2Body* bodies[55];
+	int32 count = 0;
+	for (int32 row = 0; row < 10; ++row)
+	{
+		for (int32 i = 0; i < 10 - row; ++i)
+		{
+			bd.position.Set(-4.5f + 0.5f * row + 1.0f * i, 0.5f + 1.0f * row);
+			bodies[count] = world.CreateBody(&bd);
+			b2Fixture* fixture = bodies[count]->CreateFixture(&fd);
+			CHECK(fixture->GetShape() == crate->GetShape());
+			CHECK(fixture->GetSharedShape() == crate);
+			++count;
+		}
+	}
+	CHECK(crate->GetFixtureCount() == 55);
+
+	// The world lets go but the fixtures keep the shape alive.
+	world.DestroySharedShape(crate);
+	CHECK(crate->GetFixtureCount() == 55);
+
+	// A shape still held by the world is freed with it.
+	b2CircleShape circle;
+	circle.m_radius = 0.25f;
+	b2SharedShape* ball = world.CreateSharedShape(&circle);
+	bd.position.Set(10.0f, 1.0f);
+	b2Body* ballBody = world.CreateBody(&bd);
+	ballBody->CreateFixture(ball, 1.0f);
+	CHECK(ball->GetFixtureCount() == 1);
+
+	for (int32 i = 0; i < 120; ++i)
+	{
+		world.Step(1.0f / 60.0f, 8, 3);
+	}
+
+	// The pyramid stands and each crate has the mass of its own box.
+	CHECK(b2Abs(bodies[count - 1]->GetPosition().y - 9.5f) < 0.25f);
+	for (int32 i = 0; i < count; ++i)
+	{
+		CHECK(b2Abs(bodies[i]->GetMass() - 1.0f) < 1e-4f);
+	}
+
+	for (int32 i = 0; i < 10; ++i)
+	{
+		world.DestroyBody(bodies[i]);
+	}
+	CHECK(crate->GetFixtureCount() == 45);
+}
+
+// Loose boxes resting on the ground, a falling ball and a stack of boxes.
+static void CreateIterationScene(b2World* world, b2Body** top)
+{
+	b2BodyDef bd;
+	b2Body* ground = world->CreateBody(&bd);
+	b2EdgeShape edge;
+	edge.SetTwoSided(b2Vec2(-100.0f, 0.0f), b2Vec2(100.0f, 0.0f));
+	ground->CreateFixture(&edge, 0.0f);
+
+	b2PolygonShape box;
+	box.SetAsBox(0.5f, 0.5f);
+	bd.type = b2_dynamicBody;
+	for (int32 i = 0; i < 50; ++i)
+	{
+		bd.position.Set(-90.0f + 2.0f * i, 0.5f);
+		world->CreateBody(&bd)->CreateFixture(&box, 1.0f);
+	}
+
+	for (int32 i = 0; i < 10; ++i)
+	{
+		bd.position.Set(50.0f, 0.5f + i);
+		*top = world->CreateBody(&bd);
+		(*top)->CreateFixture(&box, 1.0f);
+	}
+
+	b2CircleShape circle;
+	circle.m_radius = 0.5f;
+	bd.position.Set(80.0f, 50.0f);
+	world->CreateBody(&bd)->CreateFixture(&circle, 1.0f);
+}
+
+DOCTEST_TEST_CASE("adaptive iterations")
+{
+	b2Vec2 gravity(0.0f, -10.0f);
+	b2World adaptive(gravity);
+	b2World fixed(gravity);
+	b2World extended(gravity);
+	CHECK(fixed.GetAdaptiveIterations() == false);
+	adaptive.SetAdaptiveIterations(true);
+	extended.SetAdaptiveIterations(true);
+	extended.SetMaxVelocityIterations(30);
+
+	b2Body *adaptiveTop, *fixedTop, *extendedTop;
+	CreateIterationScene(&adaptive, &adaptiveTop);
+	CreateIterationScene(&fixed, &fixedTop);
+	CreateIterationScene(&extended, &extendedTop);
+
+	// The tall stack is not solved in 8 iterations without warm starting.
+	extended.Step(1.0f / 60.0f, 8, 3);
+	CHECK(extended.GetProfile().velocityIslands == 52);
+	CHECK(extended.GetProfile().maxVelocityIterations > 8);
+	CHECK(extended.GetProfile().maxVelocityIterations <= 30);
+
+	int32 adaptiveIters = 0, fixedIters = 0;
+	for (int32 i = 0; i < 60; ++i)
+	{
+		adaptive.Step(1.0f / 60.0f, 8, 3);
+		CHECK(adaptive.GetProfile().maxVelocityIterations <= 8);
+		adaptiveIters += adaptive.GetProfile().velocityIterations;
+
+		fixed.Step(1.0f / 60.0f, 8, 3);
+		const b2Profile& profile = fixed.GetProfile();
+		CHECK(profile.velocityIterations == 8 * profile.velocityIslands);
+		fixedIters += profile.velocityIterations;
+
+		extended.Step(1.0f / 60.0f, 8, 3);
+	}
+
+	// Resting islands and the ball in the air take far fewer iterations.
+	CHECK(adaptiveIters < fixedIters / 4);
+
+	// The boxes end up where they do with the full iteration count.
+	const b2Body* a = adaptive.GetBodyList();
+	const b2Body* f = fixed.GetBodyList();
+	float maxDrift = 0.0f;
+	for (; a && f; a = a->GetNext(), f = f->GetNext())
+	{
+		maxDrift = b2Max(maxDrift, b2Distance(a->GetPosition(), f->GetPosition()));
+	}
+	CHECK(maxDrift < 0.01f);
+	CHECK(b2Abs(adaptiveTop->GetPosition().y - fixedTop->GetPosition().y) < 0.01f);
+	CHECK(b2Abs(extendedTop->GetPosition().y - fixedTop->GetPosition().y) < 0.02f);
+}
+
+class ImpulseListener : public b2ContactListener
+{
+public:
+	void PostSolve(b2Contact* contact, const b2ContactImpulse* impulse)
+	{
+		float normalImpulse = 0.0f;
+		for (int32 i = 0; i < impulse->count; ++i)
+		{
+			normalImpulse += impulse->normalImpulses[i];
+		}
+
+		if (contact->GetFixtureA()->GetBody() == body || contact->GetFixtureB()->GetBody() == body)
+		{
+			bodyImpulse = normalImpulse;
+		}
+	}
+
+	const b2Body* body;
+	float bodyImpulse;
+};
+
+DOCTEST_TEST_CASE("one-body contacts")
+{
+	b2Vec2 gravity(0.0f, -10.0f);
+	b2World world(gravity);
+	ImpulseListener listener;
+	world.SetContactListener(&listener);
+
+	b2BodyDef bd;
+	b2Body* ground = world.CreateBody(&bd);
+	b2CircleShape circle;
+	circle.m_radius = 5.0f;
+	ground->CreateFixture(&circle, 0.0f);
+
+	// A polygon against a circle is body A of the contact, so its constraint is swapped.
+	b2PolygonShape box;
+	box.SetAsBox(0.5f, 0.5f);
+	bd.type = b2_dynamicBody;
+	bd.position.Set(0.0f, 5.5f);
+	b2Body* body = world.CreateBody(&bd);
+	body->CreateFixture(&box, 1.0f);
+
+	// A box riding a kinematic platform, next to a box resting on it.
+	bd.type = b2_kinematicBody;
+	bd.position.Set(20.0f, 0.0f);
+	bd.linearVelocity.Set(1.0f, 0.0f);
+	b2Body* platform = world.CreateBody(&bd);
+	b2PolygonShape plank;
+	plank.SetAsBox(10.0f, 0.5f);
+	platform->CreateFixture(&plank, 0.0f);
+
+	bd.type = b2_dynamicBody;
+	bd.linearVelocity.SetZero();
+	bd.position.Set(20.0f, 1.0f);
+	b2Body* rider = world.CreateBody(&bd);
+	b2FixtureDef fd;
+	fd.shape = &box;
+	fd.density = 1.0f;
+	fd.friction = 0.6f;
+	rider->CreateFixture(&fd);
+	bd.position.Set(20.0f, 2.0f);
+	world.CreateBody(&bd)->CreateFixture(&fd);
+
+	listener.body = body;
+	listener.bodyImpulse = 0.0f;
+	const float timeStep = 1.0f / 60.0f;
+	for (int32 i = 0; i < 60; ++i)
+	{
+		world.Step(timeStep, 8, 3);
+	}
+
+	// The box rests on the circle, held by an impulse that matches its weight.
+	CHECK(b2Abs(body->GetPosition().y - 5.5f) < 0.01f);
+	CHECK(body->GetLinearVelocity().Length() < 0.01f);
+	CHECK(b2Abs(listener.bodyImpulse - body->GetMass() * 10.0f * timeStep) < 0.01f * body->GetMass() * 10.0f * timeStep);
+
+	// Friction carries the boxes with the platform once they stop slipping.
+	CHECK(b2Abs(rider->GetLinearVelocity().x - 1.0f) < 0.01f);
+	CHECK(b2Abs(rider->GetPosition().x - platform->GetPosition().x) < 0.2f);
+}